@@ -1,4 +1,3 @@
-
 add_library(build-libs INTERFACE)
 
 macro(enable_sanitizer san)
@@ -10,9 +9,13 @@ endmacro()
 
 if( SANITIZER_ASAN )
     enable_sanitizer(address)
+    add_compile_options(-fno-omit-frame-pointer)
 endif()
 
 if( SANITIZER_UBSAN )
     enable_sanitizer(undefined)
-endif()
 
+    # Let the tests fail instead of only printing the findings
+    add_compile_options(-fno-sanitize-recover=undefined)
+    target_link_libraries(build-libs INTERFACE -fno-sanitize-recover=undefined)
+endif()
@@ -0,0 +1,53 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include "cli/Json.h"
+#include "SignalChain.h"
+#include "com/Mustang.h"
+#include "com/Stats.h"
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace plug::cli
+{
+    // A preset as written by load-bank and read by apply-file; models are
+    // given by their enum value.
+    Json toJson(const SignalChain& chain);
+
+    // Throws std::invalid_argument if a member is missing or out of range
+    SignalChain chainFromJson(const Json& json);
+
+    // Latencies of the operations used and the transfer counters
+    Json timingsJson(const com::StatsSnapshot& snapshot, std::chrono::steady_clock::duration total);
+
+
+    // Throws std::invalid_argument if the first argument names no command
+    // or the number of arguments doesn't fit; no amp is needed for this.
+    void validateCommand(const std::vector<std::string>& args);
+
+    // Runs the command named by the first argument on a started amp and
+    // returns its result. Throws std::invalid_argument for invalid
+    // arguments.
+    Json runCommand(com::Mustang& amp, const com::InitalData& initial, const std::vector<std::string>& args);
+
+    std::string usage();
+}
@@ -0,0 +1,81 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace plug::cli
+{
+    // Minimal JSON document, enough for the presets and timings read and
+    // written by the command line tool. Objects keep their insertion order.
+    // Accessing a value as the wrong type throws std::invalid_argument.
+    class Json
+    {
+    public:
+        using Array = std::vector<Json>;
+        using Object = std::vector<std::pair<std::string, Json>>;
+
+        Json();
+        Json(std::nullptr_t);
+        Json(bool b);
+        Json(double number);
+        Json(const char* text);
+        Json(std::string text);
+        Json(Array elements);
+        Json(Object members);
+
+        template <class T, std::enable_if_t<(std::is_integral_v<T> == true) && (std::is_same_v<T, bool> == false), int> = 0>
+        Json(T number)
+            : Json(static_cast<double>(number))
+        {
+        }
+
+        bool isNull() const;
+        bool isObject() const;
+
+        bool boolean() const;
+        double number() const;
+        const std::string& string() const;
+        const Array& array() const;
+        const Object& object() const;
+
+        // Member of an object, null if not present
+        const Json* find(std::string_view key) const;
+        const Json& operator[](std::string_view key) const;
+
+    private:
+        std::variant<std::nullptr_t, bool, double, std::string, Array, Object> value;
+
+        friend std::ostream& operator<<(std::ostream& os, const Json& json);
+    };
+
+    // Throws std::invalid_argument on malformed input
+    Json parseJson(std::string_view text);
+
+    // Compact output, no whitespace between tokens
+    std::ostream& operator<<(std::ostream& os, const Json& json);
+}
@@ -0,0 +1,60 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "SignalChain.h"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace plug::com
+{
+
+    struct AmpState
+    {
+        std::vector<std::string> presetNames;
+        SignalChain chain;
+        std::vector<std::optional<SignalChain>> banks;
+    };
+
+
+    // Cheap hash of what the amp reports at startup; if it matches the stored
+    // one, the stored banks are assumed to be still valid.
+    std::uint64_t fingerprint(const std::vector<std::string>& presetNames, const SignalChain& chain);
+
+
+    // Keeps the last known state of each amp in a file of its own, keyed by
+    // the device id. Any unreadable or foreign file is treated as missing.
+    class AmpStateCache
+    {
+    public:
+        explicit AmpStateCache(const std::string& directory);
+
+        std::optional<AmpState> load(const std::string& deviceId) const;
+        bool store(const std::string& deviceId, const AmpState& state) const;
+
+    private:
+        std::string path(const std::string& deviceId) const;
+
+        const std::string directory;
+    };
+}
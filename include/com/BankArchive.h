@@ -0,0 +1,85 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "com/Packet.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace plug::com
+{
+    class Mustang;
+
+    inline constexpr std::size_t bankPacketCount{7};
+
+    // The packets of a bank exactly as the amp sends them when it's selected:
+    // name, amp, four effects and usb gain.
+    using BankImage = std::array<PacketRawType, bankPacketCount>;
+
+    // FNV-1a of the payloads; headers are left out, as they only carry
+    // bookkeeping of the transfer.
+    std::uint64_t bankHash(const BankImage& image);
+
+
+    // Read-only mapping of a bank archive written by writeBankArchive(): a
+    // small header, the hash of each bank and the bank images as received.
+    class BankArchive
+    {
+    public:
+        // Throws std::invalid_argument if the file can't be read or is no archive
+        explicit BankArchive(const std::string& filename);
+        BankArchive(const BankArchive&) = delete;
+        ~BankArchive();
+
+        std::size_t size() const;
+        std::uint64_t hash(std::size_t bank) const;
+        BankImage image(std::size_t bank) const;
+
+        BankArchive& operator=(const BankArchive&) = delete;
+
+    private:
+        const std::uint8_t* data;
+        std::size_t fileSize;
+        std::size_t count;
+    };
+
+    // Replaces the file at once; throws std::invalid_argument if it can't be
+    // written.
+    void writeBankArchive(const std::string& filename, const std::vector<BankImage>& banks);
+
+
+    // Banks of the archive whose hash differs from the current one; banks
+    // without a current hash are always included.
+    std::vector<std::uint8_t> changedBanks(const BankArchive& archive, const std::vector<std::uint64_t>& current);
+
+    // Selects each bank in turn; the amp is left at the last one.
+    std::vector<BankImage> loadBankImages(Mustang& amp, std::size_t count);
+    std::vector<std::uint64_t> bankHashes(const std::vector<BankImage>& images);
+    std::vector<std::uint64_t> bankHashes(const BankArchive& archive);
+
+    // Writes the changed banks only and returns them. current holds the
+    // hashes of the amp's banks, either read from the amp or from an
+    // archive known to match it.
+    std::vector<std::uint8_t> restoreBanks(Mustang& amp, const BankArchive& archive, const std::vector<std::uint64_t>& current);
+}
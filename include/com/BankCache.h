@@ -0,0 +1,53 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "SignalChain.h"
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace plug::com
+{
+
+    // Decoded memory banks of the connected amp; safe to use from several threads.
+    class BankCache
+    {
+    public:
+        void reset(std::size_t bankCount);
+        std::size_t size() const;
+
+        std::optional<SignalChain> get(std::uint8_t slot) const;
+        void put(std::uint8_t slot, const SignalChain& chain);
+        void invalidate(std::uint8_t slot);
+
+        std::optional<std::uint8_t> nextMissing() const;
+
+        std::vector<std::optional<SignalChain>> snapshot() const;
+        // Fills the banks from a snapshot, surplus entries are ignored
+        void restore(const std::vector<std::optional<SignalChain>>& stored);
+
+    private:
+        mutable std::mutex mutex;
+        std::vector<std::optional<SignalChain>> banks;
+    };
+}
@@ -20,6 +20,13 @@
 
 #pragma once
 
+#include "com/Stats.h"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
 #include <vector>
 #include <cstdint>
 
@@ -35,14 +42,129 @@ namespace plug::com
         virtual bool isOpen() const = 0;
 
         template <class Container>
-        std::size_t send(Container c)
+        std::size_t send(const Container& c)
         {
             return sendImpl(c.data(), c.size());
         }
 
+        template <class Container>
+        std::future<std::size_t> sendAsync(const Container& c)
+        {
+            return sendAsyncImpl(c.data(), c.size());
+        }
+
+        // Starts sending without waiting for the transfer to complete;
+        // waitSent() waits for all sends started so far and throws if any
+        // of them failed. Unlike sendAsync(), no memory is allocated.
+        template <class Container>
+        void sendQueued(const Container& c)
+        {
+            sendQueuedImpl(c.data(), c.size());
+        }
+
+        virtual void waitSent()
+        {
+        }
+
         virtual std::vector<std::uint8_t> receive(std::size_t recvSize) = 0;
 
+        // Receives the next packet into the buffer and returns its size; 0
+        // means timeout. Unlike receive(), no memory is allocated.
+        template <class Container>
+        std::size_t receiveInto(Container& c)
+        {
+            return receiveIntoImpl(c.data(), c.size());
+        }
+
+        // Like receiveInto(), but waits at most the given time; used to drain
+        // what the amp sends beyond an expected response. Connections that
+        // can't wait shorter than their regular timeout report nothing.
+        template <class Container>
+        std::size_t receiveInto(Container& c, std::chrono::milliseconds timeout)
+        {
+            return receiveWithinImpl(c.data(), c.size(), timeout);
+        }
+
+        // Resolves to the next packet received; an empty buffer means timeout,
+        // the same as for receive().
+        virtual std::future<std::vector<std::uint8_t>> receiveAsync(std::size_t recvSize)
+        {
+            return std::async(std::launch::deferred, [this, recvSize] { return receive(recvSize); });
+        }
+
+        // Drops packets that arrived but weren't read yet, e.g. the tail of a
+        // response that was complete before the amp stopped sending.
+        virtual void discardReceived()
+        {
+        }
+
+        // Takes the packets that arrived but weren't read yet; these were sent
+        // by the amp on its own, e.g. when a knob on the amp was turned.
+        virtual std::vector<std::vector<std::uint8_t>> takeReceived()
+        {
+            return {};
+        }
+
+        // The listener is called from an arbitrary thread whenever a packet
+        // arrives that isn't waited for.
+        virtual void setReceiveListener(std::function<void()> listener)
+        {
+            static_cast<void>(listener);
+        }
+
+        // Identifies the connected device across sessions, e.g. by product id
+        // and serial number; empty if unknown.
+        virtual std::string deviceId() const
+        {
+            return "";
+        }
+
+        // Transfer statistics of the connection, shared with the layers
+        // above so they can add their own; null if not collected.
+        virtual std::shared_ptr<Stats> stats() const
+        {
+            return nullptr;
+        }
+
     private:
-        virtual std::size_t sendImpl(std::uint8_t* data, std::size_t size) = 0;
+        virtual std::size_t sendImpl(const std::uint8_t* data, std::size_t size) = 0;
+
+        // The data has to be copied before returning, the caller's buffer
+        // isn't kept alive until the transfer completes.
+        virtual std::future<std::size_t> sendAsyncImpl(const std::uint8_t* data, std::size_t size)
+        {
+            std::promise<std::size_t> result;
+
+            try
+            {
+                result.set_value(sendImpl(data, size));
+            }
+            catch (...)
+            {
+                result.set_exception(std::current_exception());
+            }
+            return result.get_future();
+        }
+
+        virtual void sendQueuedImpl(const std::uint8_t* data, std::size_t size)
+        {
+            sendImpl(data, size);
+        }
+
+        virtual std::size_t receiveIntoImpl(std::uint8_t* buffer, std::size_t size)
+        {
+            const auto data = receive(size);
+            const auto count = std::min(data.size(), size);
+            std::copy_n(data.cbegin(), count, buffer);
+            return count;
+        }
+
+        virtual std::size_t receiveWithinImpl(std::uint8_t* buffer, std::size_t size, std::chrono::milliseconds timeout)
+        {
+            static_cast<void>(buffer);
+            static_cast<void>(size);
+            static_cast<void>(timeout);
+            return 0;
+        }
     };
 }
@@ -21,9 +21,18 @@
 #pragma once
 
 #include "com/Connection.h"
+#include "com/Protocol.h"
 #include <memory>
 
 namespace plug::com
 {
-    std::shared_ptr<Connection> createUsbConnection();
+    struct UsbDevice
+    {
+        std::shared_ptr<Connection> connection;
+        ProtocolKind protocol;
+    };
+
+    // Opens the first amp found, the protocol is selected by its product id.
+    // All traffic is recorded to the file named by PLUG_CAPTURE, if set
+    UsbDevice openUsbDevice();
 }
@@ -0,0 +1,92 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+
+namespace plug::com
+{
+
+    enum class DecodeError
+    {
+        unknownAmp,
+        unknownCabinet,
+        unknownEffect
+    };
+
+    constexpr std::string_view nameOf(DecodeError error)
+    {
+        switch (error)
+        {
+            case DecodeError::unknownAmp:
+                return "unknown amp";
+            case DecodeError::unknownCabinet:
+                return "unknown cabinet";
+            case DecodeError::unknownEffect:
+                return "unknown effect";
+        }
+        return "unknown";
+    }
+
+
+    // Either a decoded value or the reason it couldn't be decoded; failing
+    // doesn't throw, only accessing the missing value does.
+    template <class T>
+    class DecodeResult
+    {
+    public:
+        DecodeResult(T value)
+            : result(std::move(value))
+        {
+        }
+
+        DecodeResult(DecodeError error)
+            : result(error)
+        {
+        }
+
+        bool has_value() const
+        {
+            return std::holds_alternative<T>(result);
+        }
+
+        const T& value() const
+        {
+            if (has_value() == false)
+            {
+                throw std::invalid_argument{std::string{nameOf(error())}};
+            }
+            return std::get<T>(result);
+        }
+
+        DecodeError error() const
+        {
+            return std::get<DecodeError>(result);
+        }
+
+    private:
+        std::variant<T, DecodeError> result;
+    };
+}
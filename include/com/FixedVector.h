@@ -0,0 +1,125 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <initializer_list>
+#include <stdexcept>
+
+namespace plug::com
+{
+
+    // Vector with its storage inline, up to a fixed capacity; never allocates.
+    template <class T, std::size_t Capacity>
+    class FixedVector
+    {
+    public:
+        using value_type = T;
+        using size_type = std::size_t;
+        using iterator = T*;
+        using const_iterator = const T*;
+
+
+        FixedVector() = default;
+
+        FixedVector(std::initializer_list<T> values)
+        {
+            for (const auto& value : values)
+            {
+                push_back(value);
+            }
+        }
+
+        void push_back(const T& value)
+        {
+            if (count == Capacity)
+            {
+                throw std::length_error{"Capacity exceeded"};
+            }
+            items[count++] = value;
+        }
+
+        void clear()
+        {
+            count = 0;
+        }
+
+        std::size_t size() const
+        {
+            return count;
+        }
+
+        bool empty() const
+        {
+            return (count == 0);
+        }
+
+        static constexpr std::size_t capacity()
+        {
+            return Capacity;
+        }
+
+        T& operator[](std::size_t index)
+        {
+            return items[index];
+        }
+
+        const T& operator[](std::size_t index) const
+        {
+            return items[index];
+        }
+
+        T* data()
+        {
+            return items.data();
+        }
+
+        const T* data() const
+        {
+            return items.data();
+        }
+
+        iterator begin()
+        {
+            return items.data();
+        }
+
+        iterator end()
+        {
+            return items.data() + count;
+        }
+
+        const_iterator begin() const
+        {
+            return items.data();
+        }
+
+        const_iterator end() const
+        {
+            return items.data() + count;
+        }
+
+    private:
+        std::array<T, Capacity> items{};
+        std::size_t count{0};
+    };
+}
@@ -21,204 +21,139 @@
 #pragma once
 
 #include "effects_enum.h"
+#include "com/ModelTable.h"
+#include <algorithm>
+#include <array>
 #include <cstdint>
+#include <optional>
 #include <stdexcept>
 #include <string>
 
 namespace plug
 {
 
-    constexpr amps lookupAmpById(std::uint8_t id)
+    // Bidirectional mapping between the model ids used by the amp and in
+    // .fuse files and the enums. Both directions are a single array access;
+    // the id to enum arrays are generated from com/ModelTable.h at compile
+    // time.
+    namespace detail
     {
-        switch (id)
+        inline constexpr std::uint8_t unknownId{0xff};
+
+        template <class Table, class Id>
+        constexpr std::size_t idRange(const Table& table, Id Table::value_type::*id)
+        {
+            std::size_t range{0};
+
+            for (const auto& entry : table)
+            {
+                range = std::max<std::size_t>(range, static_cast<std::size_t>(entry.*id) + 1);
+            }
+            return range;
+        }
+
+        template <std::size_t Size, class Table, class Id>
+        constexpr std::array<std::uint8_t, Size> indexById(const Table& table, Id Table::value_type::*id)
+        {
+            static_assert(std::tuple_size_v<Table> < unknownId, "Table too large for an index");
+
+            std::array<std::uint8_t, Size> index{};
+
+            for (std::size_t i = 0; i < index.size(); ++i)
+            {
+                index[i] = unknownId;
+            }
+
+            for (std::size_t i = 0; i < table.size(); ++i)
+            {
+                index[static_cast<std::size_t>(table[i].*id)] = static_cast<std::uint8_t>(i);
+            }
+            return index;
+        }
+
+        template <class Enum, class Index>
+        constexpr std::optional<Enum> findById(const Index& index, std::uint32_t id)
         {
-            case 0x67:
-                return amps::FENDER_57_DELUXE;
-            case 0x64:
-                return amps::FENDER_59_BASSMAN;
-            case 0x7c:
-                return amps::FENDER_57_CHAMP;
-            case 0x53:
-                return amps::FENDER_65_DELUXE_REVERB;
-            case 0x6a:
-                return amps::FENDER_65_PRINCETON;
-            case 0x75:
-                return amps::FENDER_65_TWIN_REVERB;
-            case 0x72:
-                return amps::FENDER_SUPER_SONIC;
-            case 0x61:
-                return amps::BRITISH_60S;
-            case 0x79:
-                return amps::BRITISH_70S;
-            case 0x5e:
-                return amps::BRITISH_80S;
-            case 0x5d:
-                return amps::AMERICAN_90S;
-            case 0x6d:
-                return amps::METAL_2000;
-            
-            //V2 Only
-            case 0xf1:
-                return amps::STUDIO_PREAMP;
-            case 0xf6:
-                return amps::FENDER_57_TWIN;
-            case 0xf9:
-                return amps::SIXTIES_THRIFT;
-            case 0xff:
-                return amps::BRITTISH_WATTS;
-            case 0xfc:
-                return amps::BRITTISH_COLOUR;
-           
-            default:
-                throw std::invalid_argument{"Invalid amp id: " + std::to_string(id)};
+            if ((id >= index.size()) || (index[id] == unknownId))
+            {
+                return std::nullopt;
+            }
+            return static_cast<Enum>(index[id]);
         }
+
+        inline constexpr auto ampIndex = indexById<idRange(com::ampDescriptors, &com::AmpDescriptor::model)>(com::ampDescriptors, &com::AmpDescriptor::model);
+        inline constexpr auto effectIndex = indexById<idRange(com::effectDescriptors, &com::EffectDescriptor::model)>(com::effectDescriptors, &com::EffectDescriptor::model);
+        inline constexpr auto cabinetIndex = indexById<idRange(com::cabinetDescriptors, &com::CabinetDescriptor::model)>(com::cabinetDescriptors, &com::CabinetDescriptor::model);
     }
 
 
-    constexpr effects lookupEffectById(std::uint16_t id)
+    // Ids out of range or without a model are not found
+    constexpr std::optional<amps> findAmpById(std::uint32_t id)
+    {
+        return detail::findById<amps>(detail::ampIndex, id);
+    }
+
+    constexpr std::optional<effects> findEffectById(std::uint32_t id)
     {
-        switch (id)
+        return detail::findById<effects>(detail::effectIndex, id);
+    }
+
+    constexpr std::optional<cabinets> findCabinetById(std::uint32_t id)
+    {
+        return detail::findById<cabinets>(detail::cabinetIndex, id);
+    }
+
+
+    constexpr amps lookupAmpById(std::uint8_t id)
+    {
+        const auto amp = findAmpById(id);
+
+        if (amp.has_value() == false)
         {
-            case 0x00:
-                return effects::EMPTY;
-            case 0x3c:
-                return effects::OVERDRIVE;
-            case 0x49:
-                return effects::WAH;
-            case 0x4a:
-                return effects::TOUCH_WAH;
-            case 0x1a:
-                return effects::FUZZ;
-            case 0x1c:
-                return effects::FUZZ_TOUCH_WAH;
-            case 0x88:
-                return effects::SIMPLE_COMP;
-            case 0x07:
-                return effects::COMPRESSOR;
-
-            // V2 only stomps
-            case 0x0103:
-                return effects::RANGE_BOOST;
-            case 0xba:
-                return effects::GREEN_BOX;
-            case 0x0110:
-                return effects::ORANGE_BOX;
-            case 0x0111:
-                return effects::BLACK_BOX;
-            case 0x010f:
-                return effects::BIG_FUZZ;
-
-
-            case 0x12:
-                return effects::SINE_CHORUS;
-            case 0x13:
-                return effects::TRIANGLE_CHORUS;
-            case 0x18:
-                return effects::SINE_FLANGER;
-            case 0x19:
-                return effects::TRIANGLE_FLANGER;
-            case 0x2d:
-                return effects::VIBRATONE;
-            case 0x40:
-                return effects::VINTAGE_TREMOLO;
-            case 0x41:
-                return effects::SINE_TREMOLO;
-            case 0x22:
-                return effects::RING_MODULATOR;
-            case 0x29:
-                return effects::STEP_FILTER;
-            case 0x4f:
-                return effects::PHASER;
-            case 0x1f:
-                return effects::PITCH_SHIFTER;
-
-            //V2 only mod
-            case 0xf4:
-                return effects::MOD_WHA;
-            case 0xf5:
-                return effects::MOD_TOUCH_WHA;
-            case 0x101f:
-                return effects::DIATONIC_PITCH_SHIFT;
-
-
-
-            case 0x16:
-                return effects::MONO_DELAY;
-            case 0x43:
-                return effects::MONO_ECHO_FILTER;
-            case 0x48:
-                return effects::STEREO_ECHO_FILTER;
-            case 0x44:
-                return effects::MULTITAP_DELAY;
-            case 0x45:
-                return effects::PING_PONG_DELAY;
-            case 0x15:
-                return effects::DUCKING_DELAY;
-            case 0x46:
-                return effects::REVERSE_DELAY;
-            case 0x2b:
-                return effects::TAPE_DELAY;
-            case 0x2a:
-                return effects::STEREO_TAPE_DELAY;
-            case 0x24:
-                return effects::SMALL_HALL_REVERB;
-            case 0x3a:
-                return effects::LARGE_HALL_REVERB;
-            case 0x26:
-                return effects::SMALL_ROOM_REVERB;
-            case 0x3b:
-                return effects::LARGE_ROOM_REVERB;
-            case 0x4e:
-                return effects::SMALL_PLATE_REVERB;
-            case 0x4b:
-                return effects::LARGE_PLATE_REVERB;
-            case 0x4c:
-                return effects::AMBIENT_REVERB;
-            case 0x4d:
-                return effects::ARENA_REVERB;
-            case 0x21:
-                return effects::FENDER_63_SPRING_REVERB;
-            case 0x0b:
-                return effects::FENDER_65_SPRING_REVERB;
-            default:
-                throw std::invalid_argument{"Invalid effect id: " + std::to_string(id)};
+            throw std::invalid_argument{"Invalid amp id: " + std::to_string(id)};
         }
+        return *amp;
     }
 
+    constexpr effects lookupEffectById(std::uint16_t id)
+    {
+        const auto effect = findEffectById(id);
+
+        if (effect.has_value() == false)
+        {
+            throw std::invalid_argument{"Invalid effect id: " + std::to_string(id)};
+        }
+        return *effect;
+    }
 
     constexpr cabinets lookupCabinetById(std::uint8_t id)
     {
-        switch (id)
+        const auto cabinet = findCabinetById(id);
+
+        if (cabinet.has_value() == false)
         {
-            case 0x00:
-                return cabinets::OFF;
-            case 0x01:
-                return cabinets::cab57DLX;
-            case 0x02:
-                return cabinets::cabBSSMN;
-            case 0x03:
-                return cabinets::cab65DLX;
-            case 0x04:
-                return cabinets::cab65PRN;
-            case 0x05:
-                return cabinets::cabCHAMP;
-            case 0x06:
-                return cabinets::cab4x12M;
-            case 0x07:
-                return cabinets::cab2x12C;
-            case 0x08:
-                return cabinets::cab4x12G;
-            case 0x09:
-                return cabinets::cab65TWN;
-            case 0x0a:
-                return cabinets::cab4x12V;
-            case 0x0b:
-                return cabinets::cabSS212;
-            case 0x0c:
-                return cabinets::cabSS112;
-            default:
-                throw std::invalid_argument{"Invalid cabinet id: " + std::to_string(id)};
+            throw std::invalid_argument{"Invalid cabinet id: " + std::to_string(id)};
         }
+        return *cabinet;
+    }
+
+
+    constexpr std::uint8_t ampId(amps a)
+    {
+        return com::descriptorOf(a).model;
+    }
+
+    constexpr std::uint16_t effectId(effects e)
+    {
+        return com::descriptorOf(e).model;
+    }
+
+    constexpr std::uint8_t cabinetId(cabinets c)
+    {
+        return com::descriptorOf(c).model;
     }
 
+    static_assert(lookupAmpById(ampId(amps::BRITTISH_COLOUR)) == amps::BRITTISH_COLOUR);
+    static_assert(lookupEffectById(effectId(effects::DIATONIC_PITCH_SHIFT)) == effects::DIATONIC_PITCH_SHIFT);
+    static_assert(findEffectById(0x0fff).has_value() == false);
 }
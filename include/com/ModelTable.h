@@ -0,0 +1,253 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "effects_enum.h"
+#include "com/Packet.h"
+#include "com/MustangConstants.h"
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+namespace plug::com
+{
+
+    // Wire description of every effect, amp and cabinet model, indexed by the enum
+    // value. Serialization is generated from these tables, so adding a model
+    // takes a single row.
+    struct EffectDescriptor
+    {
+        effects effect;
+        std::uint16_t model;
+        DSP dsp;
+        std::array<std::uint8_t, 3> unknown;
+        // Upper limit per knob; 0x00 means the knob is always sent as zero
+        std::array<std::uint8_t, 6> knobLimits;
+        std::uint8_t fxKnob;
+        // First amp generation providing the model
+        ProtocolVersion since;
+    };
+
+    struct AmpDescriptor
+    {
+        amps amp;
+        std::uint8_t model;
+        std::array<std::uint8_t, 5> ampSpecific;
+        std::array<std::uint8_t, 3> unknown;
+        ProtocolVersion since;
+    };
+
+    struct CabinetDescriptor
+    {
+        cabinets cabinet;
+        std::uint8_t model;
+    };
+
+
+    namespace detail
+    {
+        inline constexpr std::array<std::uint8_t, 6> fiveKnobs{{0xff, 0xff, 0xff, 0xff, 0xff, 0x00}};
+        inline constexpr std::array<std::uint8_t, 6> sixKnobs{{0xff, 0xff, 0xff, 0xff, 0xff, 0xff}};
+
+        inline constexpr std::array<std::uint8_t, 3> defaultUnknown{{0x00, 0x08, 0x01}};
+        inline constexpr std::array<std::uint8_t, 3> modUnknown{{0x01, 0x01, 0x01}};
+        inline constexpr std::array<std::uint8_t, 3> extendedModUnknown{{0x01, 0x08, 0x01}};
+        inline constexpr std::array<std::uint8_t, 3> delayUnknown{{0x02, 0x01, 0x01}};
+        inline constexpr std::array<std::uint8_t, 3> ampUnknown{{0x80, 0x80, 0x01}};
+    }
+
+
+    inline constexpr std::array<EffectDescriptor, value(effects::FENDER_65_SPRING_REVERB) + 1> effectDescriptors{{
+        {effects::EMPTY, 0x00, DSP::none, detail::defaultUnknown, detail::fiveKnobs, 0x02, ProtocolVersion::v1},
+        {effects::OVERDRIVE, 0x3c, DSP::effect0, detail::defaultUnknown, detail::fiveKnobs, 0x02, ProtocolVersion::v1},
+        {effects::WAH, 0x49, DSP::effect0, detail::extendedModUnknown, detail::fiveKnobs, 0x02, ProtocolVersion::v1},
+        {effects::TOUCH_WAH, 0x4a, DSP::effect0, detail::extendedModUnknown, detail::fiveKnobs, 0x02, ProtocolVersion::v1},
+        {effects::FUZZ, 0x1a, DSP::effect0, detail::defaultUnknown, detail::fiveKnobs, 0x02, ProtocolVersion::v1},
+        {effects::FUZZ_TOUCH_WAH, 0x1c, DSP::effect0, detail::defaultUnknown, detail::fiveKnobs, 0x02, ProtocolVersion::v1},
+        {effects::SIMPLE_COMP, 0x88, DSP::effect0, {{0x08, 0x08, 0x01}}, {{0x03, 0x00, 0x00, 0x00, 0x00, 0x00}}, 0x02, ProtocolVersion::v1},
+        {effects::COMPRESSOR, 0x07, DSP::effect0, detail::defaultUnknown, detail::fiveKnobs, 0x02, ProtocolVersion::v1},
+        {effects::RANGE_BOOST, 0x0103, DSP::effect0, detail::defaultUnknown, detail::fiveKnobs, 0x02, ProtocolVersion::v2},
+        {effects::GREEN_BOX, 0xba, DSP::effect0, detail::defaultUnknown, detail::fiveKnobs, 0x02, ProtocolVersion::v2},
+        {effects::ORANGE_BOX, 0x0110, DSP::effect0, detail::defaultUnknown, detail::fiveKnobs, 0x02, ProtocolVersion::v2},
+        {effects::BLACK_BOX, 0x0111, DSP::effect0, detail::defaultUnknown, detail::fiveKnobs, 0x02, ProtocolVersion::v2},
+        {effects::BIG_FUZZ, 0x010f, DSP::effect0, detail::defaultUnknown, detail::fiveKnobs, 0x02, ProtocolVersion::v2},
+
+        {effects::SINE_CHORUS, 0x12, DSP::effect1, detail::modUnknown, detail::fiveKnobs, 0x01, ProtocolVersion::v1},
+        {effects::TRIANGLE_CHORUS, 0x13, DSP::effect1, detail::modUnknown, detail::fiveKnobs, 0x01, ProtocolVersion::v1},
+        {effects::SINE_FLANGER, 0x18, DSP::effect1, detail::modUnknown, detail::fiveKnobs, 0x01, ProtocolVersion::v1},
+        {effects::TRIANGLE_FLANGER, 0x19, DSP::effect1, detail::modUnknown, detail::fiveKnobs, 0x01, ProtocolVersion::v1},
+        {effects::VIBRATONE, 0x2d, DSP::effect1, detail::modUnknown, detail::fiveKnobs, 0x01, ProtocolVersion::v1},
+        {effects::VINTAGE_TREMOLO, 0x40, DSP::effect1, detail::modUnknown, detail::fiveKnobs, 0x01, ProtocolVersion::v1},
+        {effects::SINE_TREMOLO, 0x41, DSP::effect1, detail::modUnknown, detail::fiveKnobs, 0x01, ProtocolVersion::v1},
+        {effects::RING_MODULATOR, 0x22, DSP::effect1, detail::extendedModUnknown, {{0xff, 0xff, 0xff, 0x01, 0xff, 0x00}}, 0x01, ProtocolVersion::v1},
+        {effects::STEP_FILTER, 0x29, DSP::effect1, detail::modUnknown, detail::fiveKnobs, 0x01, ProtocolVersion::v1},
+        {effects::PHASER, 0x4f, DSP::effect1, detail::modUnknown, {{0xff, 0xff, 0xff, 0xff, 0x01, 0x00}}, 0x01, ProtocolVersion::v1},
+        {effects::PITCH_SHIFTER, 0x1f, DSP::effect1, detail::extendedModUnknown, detail::fiveKnobs, 0x01, ProtocolVersion::v1},
+
+        //V2 only mod
+        {effects::MOD_WHA, 0xf4, DSP::effect1, detail::extendedModUnknown, detail::fiveKnobs, 0x02, ProtocolVersion::v2},
+        {effects::MOD_TOUCH_WHA, 0xf5, DSP::effect1, detail::extendedModUnknown, detail::fiveKnobs, 0x02, ProtocolVersion::v2},
+        {effects::DIATONIC_PITCH_SHIFT, 0x101f, DSP::effect1, detail::defaultUnknown, detail::fiveKnobs, 0x02, ProtocolVersion::v2},
+
+        {effects::MONO_DELAY, 0x16, DSP::effect2, detail::delayUnknown, detail::fiveKnobs, 0x02, ProtocolVersion::v1},
+        {effects::MONO_ECHO_FILTER, 0x43, DSP::effect2, detail::delayUnknown, detail::sixKnobs, 0x02, ProtocolVersion::v1},
+        {effects::STEREO_ECHO_FILTER, 0x48, DSP::effect2, detail::delayUnknown, detail::sixKnobs, 0x02, ProtocolVersion::v1},
+        {effects::MULTITAP_DELAY, 0x44, DSP::effect2, detail::delayUnknown, {{0xff, 0xff, 0xff, 0xff, 0x03, 0x00}}, 0x02, ProtocolVersion::v1},
+        {effects::PING_PONG_DELAY, 0x45, DSP::effect2, detail::delayUnknown, detail::fiveKnobs, 0x02, ProtocolVersion::v1},
+        {effects::DUCKING_DELAY, 0x15, DSP::effect2, detail::delayUnknown, detail::fiveKnobs, 0x02, ProtocolVersion::v1},
+        {effects::REVERSE_DELAY, 0x46, DSP::effect2, detail::delayUnknown, detail::fiveKnobs, 0x02, ProtocolVersion::v1},
+        {effects::TAPE_DELAY, 0x2b, DSP::effect2, detail::delayUnknown, detail::sixKnobs, 0x02, ProtocolVersion::v1},
+        {effects::STEREO_TAPE_DELAY, 0x2a, DSP::effect2, detail::delayUnknown, detail::sixKnobs, 0x02, ProtocolVersion::v1},
+
+        {effects::SMALL_HALL_REVERB, 0x24, DSP::effect3, detail::defaultUnknown, detail::fiveKnobs, 0x02, ProtocolVersion::v1},
+        {effects::LARGE_HALL_REVERB, 0x3a, DSP::effect3, detail::defaultUnknown, detail::fiveKnobs, 0x02, ProtocolVersion::v1},
+        {effects::SMALL_ROOM_REVERB, 0x26, DSP::effect3, detail::defaultUnknown, detail::fiveKnobs, 0x02, ProtocolVersion::v1},
+        {effects::LARGE_ROOM_REVERB, 0x3b, DSP::effect3, detail::defaultUnknown, detail::fiveKnobs, 0x02, ProtocolVersion::v1},
+        {effects::SMALL_PLATE_REVERB, 0x4e, DSP::effect3, detail::defaultUnknown, detail::fiveKnobs, 0x02, ProtocolVersion::v1},
+        {effects::LARGE_PLATE_REVERB, 0x4b, DSP::effect3, detail::defaultUnknown, detail::fiveKnobs, 0x02, ProtocolVersion::v1},
+        {effects::AMBIENT_REVERB, 0x4c, DSP::effect3, detail::defaultUnknown, detail::fiveKnobs, 0x02, ProtocolVersion::v1},
+        {effects::ARENA_REVERB, 0x4d, DSP::effect3, detail::defaultUnknown, detail::fiveKnobs, 0x02, ProtocolVersion::v1},
+        {effects::FENDER_63_SPRING_REVERB, 0x21, DSP::effect3, detail::defaultUnknown, detail::fiveKnobs, 0x02, ProtocolVersion::v1},
+        {effects::FENDER_65_SPRING_REVERB, 0x0b, DSP::effect3, detail::defaultUnknown, detail::fiveKnobs, 0x02, ProtocolVersion::v1}
+    }};
+
+    inline constexpr std::array<AmpDescriptor, value(amps::BRITTISH_COLOUR) + 1> ampDescriptors{{
+        {amps::FENDER_57_DELUXE, 0x67, {{0x01, 0x01, 0x01, 0x01, 0x53}}, detail::ampUnknown, ProtocolVersion::v1},
+        {amps::FENDER_59_BASSMAN, 0x64, {{0x02, 0x02, 0x02, 0x02, 0x67}}, detail::ampUnknown, ProtocolVersion::v1},
+        {amps::FENDER_57_CHAMP, 0x7c, {{0x0c, 0x0c, 0x0c, 0x0c, 0x00}}, detail::ampUnknown, ProtocolVersion::v1},
+        {amps::FENDER_65_DELUXE_REVERB, 0x53, {{0x03, 0x03, 0x03, 0x03, 0x6a}}, {{0x00, 0x00, 0x01}}, ProtocolVersion::v1},
+        {amps::FENDER_65_PRINCETON, 0x6a, {{0x04, 0x04, 0x04, 0x04, 0x61}}, detail::ampUnknown, ProtocolVersion::v1},
+        {amps::FENDER_65_TWIN_REVERB, 0x75, {{0x05, 0x05, 0x05, 0x05, 0x72}}, detail::ampUnknown, ProtocolVersion::v1},
+        {amps::FENDER_SUPER_SONIC, 0x72, {{0x06, 0x06, 0x06, 0x06, 0x79}}, detail::ampUnknown, ProtocolVersion::v1},
+        {amps::BRITISH_60S, 0x61, {{0x07, 0x07, 0x07, 0x07, 0x5e}}, detail::ampUnknown, ProtocolVersion::v1},
+        {amps::BRITISH_70S, 0x79, {{0x0b, 0x0b, 0x0b, 0x0b, 0x7c}}, detail::ampUnknown, ProtocolVersion::v1},
+        {amps::BRITISH_80S, 0x5e, {{0x09, 0x09, 0x09, 0x09, 0x5d}}, detail::ampUnknown, ProtocolVersion::v1},
+        {amps::AMERICAN_90S, 0x5d, {{0x0a, 0x0a, 0x0a, 0x0a, 0x6d}}, detail::ampUnknown, ProtocolVersion::v1},
+        {amps::METAL_2000, 0x6d, {{0x08, 0x08, 0x08, 0x08, 0x75}}, detail::ampUnknown, ProtocolVersion::v1},
+
+        //V2 only
+        {amps::STUDIO_PREAMP, 0xf1, {{0x0d, 0x0d, 0x0d, 0x0d, 0xf6}}, detail::ampUnknown, ProtocolVersion::v2},
+        {amps::FENDER_57_TWIN, 0xf6, {{0x0e, 0x0e, 0x0e, 0x0e, 0xf9}}, detail::ampUnknown, ProtocolVersion::v2},
+        {amps::SIXTIES_THRIFT, 0xf9, {{0x0f, 0x0f, 0x0f, 0x0f, 0xfc}}, detail::ampUnknown, ProtocolVersion::v2},
+        {amps::BRITTISH_WATTS, 0xff, {{0x11, 0x11, 0x11, 0x11, 0x00}}, detail::ampUnknown, ProtocolVersion::v2},
+        // The fourth byte has always been sent as 0x08, not 0x10 like the others
+        {amps::BRITTISH_COLOUR, 0xfc, {{0x10, 0x10, 0x10, 0x08, 0xff}}, detail::ampUnknown, ProtocolVersion::v2}
+    }};
+
+    inline constexpr std::array<CabinetDescriptor, value(cabinets::cabSS112) + 1> cabinetDescriptors{{
+        {cabinets::OFF, 0x00},
+        {cabinets::cab57DLX, 0x01},
+        {cabinets::cabBSSMN, 0x02},
+        {cabinets::cab65DLX, 0x03},
+        {cabinets::cab65PRN, 0x04},
+        {cabinets::cabCHAMP, 0x05},
+        {cabinets::cab4x12M, 0x06},
+        {cabinets::cab2x12C, 0x07},
+        {cabinets::cab4x12G, 0x08},
+        {cabinets::cab65TWN, 0x09},
+        {cabinets::cab4x12V, 0x0a},
+        {cabinets::cabSS212, 0x0b},
+        {cabinets::cabSS112, 0x0c}
+    }};
+
+
+    namespace detail
+    {
+        template <class Table, class Key>
+        constexpr bool isIndexedBy(const Table& table, Key Table::value_type::*key)
+        {
+            for (std::size_t i = 0; i < table.size(); ++i)
+            {
+                if (static_cast<std::size_t>(table[i].*key) != i)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        template <class Table, class Model>
+        constexpr bool hasUniqueModels(const Table& table, Model Table::value_type::*model)
+        {
+            for (std::size_t i = 0; i < table.size(); ++i)
+            {
+                for (std::size_t j = i + 1; j < table.size(); ++j)
+                {
+                    if (table[i].*model == table[j].*model)
+                    {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        constexpr bool hasConsistentEffectKnobs()
+        {
+            for (const auto& descriptor : effectDescriptors)
+            {
+                if ((descriptor.fxKnob == 0x01) && (descriptor.dsp != DSP::effect1))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+
+    static_assert(detail::isIndexedBy(effectDescriptors, &EffectDescriptor::effect), "Effect table must list every effect in enum order");
+    static_assert(detail::isIndexedBy(ampDescriptors, &AmpDescriptor::amp), "Amp table must list every amp in enum order");
+    static_assert(detail::hasUniqueModels(effectDescriptors, &EffectDescriptor::model), "Effect model ids must be unique");
+    static_assert(detail::hasUniqueModels(ampDescriptors, &AmpDescriptor::model), "Amp model ids must be unique");
+    static_assert(detail::isIndexedBy(cabinetDescriptors, &CabinetDescriptor::cabinet), "Cabinet table must list every cabinet in enum order");
+    static_assert(detail::hasUniqueModels(cabinetDescriptors, &CabinetDescriptor::model), "Cabinet ids must be unique");
+    static_assert(detail::hasConsistentEffectKnobs(), "Only modulation effects use fx knob 0x01");
+
+
+    constexpr const EffectDescriptor& descriptorOf(effects e)
+    {
+        if (value(e) >= effectDescriptors.size())
+        {
+            throw std::invalid_argument{"Invalid effect: " + std::to_string(value(e))};
+        }
+        return effectDescriptors[value(e)];
+    }
+
+    constexpr const AmpDescriptor& descriptorOf(amps a)
+    {
+        if (value(a) >= ampDescriptors.size())
+        {
+            throw std::invalid_argument{"Invalid amp: " + std::to_string(value(a))};
+        }
+        return ampDescriptors[value(a)];
+    }
+
+    constexpr const CabinetDescriptor& descriptorOf(cabinets c)
+    {
+        if (value(c) >= cabinetDescriptors.size())
+        {
+            throw std::invalid_argument{"Invalid cabinet: " + std::to_string(value(c))};
+        }
+        return cabinetDescriptors[value(c)];
+    }
+}
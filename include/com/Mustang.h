@@ -22,38 +22,112 @@
 #pragma once
 
 #include "SignalChain.h"
+#include "com/BankArchive.h"
 #include "com/Connection.h"
+#include "com/Protocol.h"
+#include "com/Span.h"
+#include <functional>
 #include <string_view>
 #include <vector>
 #include <memory>
+#include <optional>
 #include <cstdint>
 
 namespace plug::com
 {
     using InitalData = std::tuple<SignalChain, std::vector<std::string>>;
 
+    // Called with slot and name for each preset name as soon as it's received
+    using PresetNameCallback = std::function<void(std::uint8_t, const std::string&)>;
+
+    // Called with the new state whenever a change made on the amp is received
+    using StateListener = std::function<void(const SignalChain&)>;
+
+    // Operations on an amp; created with createMustang() for the protocol of
+    // the connected device.
     class Mustang
     {
     public:
-        explicit Mustang(std::shared_ptr<Connection> connection);
         Mustang(const Mustang&) = delete;
+        virtual ~Mustang() = default;
+
+        virtual InitalData start_amp(const PresetNameCallback& onPresetName = nullptr) = 0;
+        virtual void stop_amp() = 0;
+        virtual void set_effect(fx_pedal_settings value) = 0;
+        virtual void set_amplifier(amp_settings value) = 0;
+        virtual void applyChain(const SignalChain& chain) = 0;
+        virtual void save_on_amp(std::string_view name, std::uint8_t slot) = 0;
+        virtual SignalChain load_memory_bank(std::uint8_t slot) = 0;
+        virtual void save_effects(std::uint8_t slot, std::string_view name, Span<fx_pedal_settings> effects) = 0;
+        virtual std::optional<SignalChain> current_state() const = 0;
+
+        // Selects the bank and returns it as received. Throws
+        // CommunicationException if the amp sends less.
+        virtual BankImage loadBankImage(std::uint8_t slot) = 0;
+
+        // Sends the image as received by loadBankImage() and saves it to the
+        // bank in a single burst, without decoding and serializing it again.
+        // The image is selected afterwards.
+        virtual void writeBankImage(std::uint8_t slot, const BankImage& image) = 0;
 
-        InitalData start_amp();
-        void stop_amp();
-        void set_effect(fx_pedal_settings value);
-        void set_amplifier(amp_settings value);
-        void save_on_amp(std::string_view name, std::uint8_t slot);
-        SignalChain load_memory_bank(std::uint8_t slot);
-        void save_effects(std::uint8_t slot, std::string_view name, const std::vector<fx_pedal_settings>& effects);
+        // Latencies of the operations, along with the transfer statistics of
+        // the connection if it collects them
+        virtual std::shared_ptr<Stats> statistics() const = 0;
+
+        virtual void subscribe(StateListener listener) = 0;
+
+        // Applies the packets the amp sent on its own since the last command,
+        // e.g. when a knob or preset was changed on the amp itself.
+        virtual void listen() = 0;
 
 
         Mustang& operator=(const Mustang&) = delete;
 
 
+    protected:
+        Mustang() = default;
+    };
+
+
+    // Models not available on the amp generation and banks beyond the bank
+    // count are rejected with std::invalid_argument before anything is sent.
+    template <class Protocol>
+    class BasicMustang final : public Mustang
+    {
+    public:
+        explicit BasicMustang(std::shared_ptr<Connection> connection);
+
+        InitalData start_amp(const PresetNameCallback& onPresetName = nullptr) override;
+        void stop_amp() override;
+        void set_effect(fx_pedal_settings value) override;
+        void set_amplifier(amp_settings value) override;
+        void applyChain(const SignalChain& chain) override;
+        void save_on_amp(std::string_view name, std::uint8_t slot) override;
+        SignalChain load_memory_bank(std::uint8_t slot) override;
+        void save_effects(std::uint8_t slot, std::string_view name, Span<fx_pedal_settings> effects) override;
+        std::optional<SignalChain> current_state() const override;
+        BankImage loadBankImage(std::uint8_t slot) override;
+        void writeBankImage(std::uint8_t slot, const BankImage& image) override;
+        std::shared_ptr<Stats> statistics() const override;
+        void subscribe(StateListener listener) override;
+        void listen() override;
+
+
     private:
-        InitalData loadData();
+        InitalData loadData(const PresetNameCallback& onPresetName);
         void initializeAmp();
 
         const std::shared_ptr<Connection> conn;
+        const std::shared_ptr<Stats> stats;
+        std::optional<SignalChain> shadow;
+        std::vector<StateListener> listeners;
     };
+
+    extern template class BasicMustang<SmallAmpsV1>;
+    extern template class BasicMustang<BigAmpsV1>;
+    extern template class BasicMustang<SmallAmpsV2>;
+    extern template class BasicMustang<BigAmpsV2>;
+
+
+    std::unique_ptr<Mustang> createMustang(std::shared_ptr<Connection> connection, ProtocolKind protocol);
 }
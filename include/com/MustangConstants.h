@@ -26,6 +26,13 @@
 
 namespace plug::com
 {
+    // Amp generations; V2 added models and otherwise kept the protocol of V1
+    enum class ProtocolVersion
+    {
+        v1,
+        v2
+    };
+
     namespace v1
     {
         // effect array fields
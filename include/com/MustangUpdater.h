@@ -21,7 +21,67 @@
 
 #pragma once
 
+#include "com/Connection.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
 namespace plug::com
 {
-    int updateFirmware(const char* filename);
+    // Read-only mapping of a firmware update file (*.upd). The header holds
+    // the build date, the firmware follows at a fixed offset.
+    class FirmwareImage
+    {
+    public:
+        static inline constexpr std::size_t dateOffset{0x1a};
+        static inline constexpr std::size_t dateSize{11};
+        static inline constexpr std::size_t firmwareOffset{0x110};
+
+        // Throws std::invalid_argument if the file can't be read or holds no firmware
+        explicit FirmwareImage(const std::string& filename);
+        FirmwareImage(const FirmwareImage&) = delete;
+        ~FirmwareImage();
+
+        const std::uint8_t* date() const;
+        const std::uint8_t* firmware() const;
+        std::size_t firmwareSize() const;
+
+        FirmwareImage& operator=(const FirmwareImage&) = delete;
+
+    private:
+        const std::uint8_t* data;
+        std::size_t size;
+    };
+
+
+    struct UpdateProgress
+    {
+        std::size_t bytesSent;
+        std::size_t totalBytes;
+        std::chrono::steady_clock::duration elapsed;
+
+        double bytesPerSecond() const
+        {
+            const auto seconds = std::chrono::duration<double>{elapsed}.count();
+            return (seconds > 0.0 ? static_cast<double>(bytesSent) / seconds : 0.0);
+        }
+    };
+
+    // Called whenever the amp acknowledged another packet
+    using UpdateProgressCallback = std::function<void(const UpdateProgress&)>;
+
+    // Number of firmware packets sent ahead of the acknowledgements
+    inline constexpr std::size_t updateWindowSize{4};
+
+
+    // Sends the image to an amp in update mode. Packets are paced by the
+    // amp's acknowledgements, with up to updateWindowSize of them in flight.
+    // Throws CommunicationException if an acknowledgement doesn't arrive.
+    void updateFirmware(Connection& conn, const FirmwareImage& image, const UpdateProgressCallback& onProgress = nullptr);
+
+    // Validates the file, then opens the first amp in update mode and
+    // updates it.
+    void updateFirmware(const std::string& filename, const UpdateProgressCallback& onProgress = nullptr);
 }
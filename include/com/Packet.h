@@ -22,8 +22,11 @@
 
 #include <array>
 #include <algorithm>
+#include <optional>
 #include <string>
 #include <string_view>
+#include <stdexcept>
+#include <cstdio>
 
 namespace plug::com
 {
@@ -61,13 +64,153 @@ namespace plug::com
         unknown
     };
 
-    class Header
+    // Read-only access to a fixed number of bytes owned by someone else
+    template <std::size_t Size>
+    class ByteView
+    {
+    public:
+        explicit constexpr ByteView(const std::uint8_t* data)
+            : first(data)
+        {
+        }
+
+        constexpr std::uint8_t operator[](std::size_t index) const
+        {
+            return first[index];
+        }
+
+        constexpr const std::uint8_t* cbegin() const
+        {
+            return first;
+        }
+
+        constexpr const std::uint8_t* cend() const
+        {
+            return first + Size;
+        }
+
+        static constexpr std::size_t size()
+        {
+            return Size;
+        }
+
+    private:
+        const std::uint8_t* first;
+    };
+
+
+    // The getters are shared by the classes owning their bytes and the views
+    // used to read received packets in place.
+    template <class Bytes>
+    class BasicHeader
+    {
+    public:
+        explicit BasicHeader(Bytes data)
+            : bytes(data)
+        {
+        }
+
+        Stage getStage() const
+        {
+            switch (bytes[0])
+            {
+                case 0x00:
+                    return Stage::init0;
+                case 0x1a:
+                    return Stage::init1;
+                case 0x1c:
+                    return Stage::ready;
+                default:
+                    return Stage::unknown;
+            }
+        }
+
+        std::optional<Type> findType() const
+        {
+            switch (bytes[1])
+            {
+                case 0x01:
+                    return Type::operation;
+                case 0x03:
+                    return Type::data; // Same value as Type::init1
+                case 0xc3:
+                    return Type::init0;
+                case 0xc1:
+                    return Type::load;
+                default:
+                    return std::nullopt;
+            }
+        }
+
+        Type getType() const
+        {
+            const auto type = findType();
+
+            if (type.has_value() == false)
+            {
+                throw std::domain_error("Invalid Type: " + std::to_string(bytes[1]));
+            }
+            return *type;
+        }
+
+        std::optional<DSP> findDSP() const
+        {
+            switch (bytes[2])
+            {
+                case 0x00:
+                    return DSP::none;
+                case 0x05:
+                    return DSP::amp;
+                case 0x0d:
+                    return DSP::usbGain;
+                case 0x06:
+                    return DSP::effect0;
+                case 0x07:
+                    return DSP::effect1;
+                case 0x08:
+                    return DSP::effect2;
+                case 0x09:
+                    return DSP::effect3;
+                case 0x03:
+                    return DSP::opSave;
+                case 0x04:
+                    return DSP::opSaveEffectName;
+                case 0x01:
+                    return DSP::opSelectMemBank;
+                default:
+                    return std::nullopt;
+            }
+        }
+
+        DSP getDSP() const
+        {
+            const auto dsp = findDSP();
+
+            if (dsp.has_value() == false)
+            {
+                throw std::domain_error("Invalid DSP: " + std::to_string(bytes[2]));
+            }
+            return *dsp;
+        }
+
+        std::uint8_t getSlot() const
+        {
+            return bytes[4];
+        }
+
+    protected:
+        Bytes bytes;
+    };
+
+    class Header : public BasicHeader<std::array<std::uint8_t, sizeHeader>>
     {
     public:
         using RawType = std::array<std::uint8_t, sizeHeader>;
+        using View = BasicHeader<ByteView<sizeHeader>>;
 
 
         Header()
+            : BasicHeader(RawType{{}})
         {
         }
 
@@ -88,21 +231,6 @@ namespace plug::com
             }();
         }
 
-        Stage getStage() const
-        {
-            switch (bytes[0])
-            {
-                case 0x00:
-                    return Stage::init0;
-                case 0x1a:
-                    return Stage::init1;
-                case 0x1c:
-                    return Stage::ready;
-                default:
-                    return Stage::unknown;
-            }
-        }
-
         void setType(Type type)
         {
             bytes[1] = [type]() -> std::uint8_t {
@@ -124,23 +252,6 @@ namespace plug::com
             }();
         }
 
-        Type getType() const
-        {
-            switch (bytes[1])
-            {
-                case 0x01:
-                    return Type::operation;
-                case 0x03:
-                    return Type::data; // Same value as Type::init1
-                case 0xc3:
-                    return Type::init0;
-                case 0xc1:
-                    return Type::load;
-                default:
-                    throw std::domain_error("Invalid Type: " + std::to_string(bytes[1]));
-            }
-        }
-
         void setDSP(DSP dsp)
         {
             bytes[2] = [dsp]() -> std::uint8_t {
@@ -172,45 +283,11 @@ namespace plug::com
             }();
         }
 
-        DSP getDSP() const
-        {
-            switch (bytes[2])
-            {
-                case 0x00:
-                    return DSP::none;
-                case 0x05:
-                    return DSP::amp;
-                case 0x0d:
-                    return DSP::usbGain;
-                case 0x06:
-                    return DSP::effect0;
-                case 0x07:
-                    return DSP::effect1;
-                case 0x08:
-                    return DSP::effect2;
-                case 0x09:
-                    return DSP::effect3;
-                case 0x03:
-                    return DSP::opSave;
-                case 0x04:
-                    return DSP::opSaveEffectName;
-                case 0x01:
-                    return DSP::opSelectMemBank;
-                default:
-                    throw std::domain_error("Invalid DSP: " + std::to_string(bytes[2]));
-            }
-        }
-
         void setSlot(std::uint8_t slot)
         {
             bytes[4] = slot;
         }
 
-        std::uint8_t getSlot() const
-        {
-            return bytes[4];
-        }
-
         void setUnknown(std::uint8_t value0, std::uint8_t value1, std::uint8_t value2)
         {
             bytes[3] = value0;
@@ -227,9 +304,6 @@ namespace plug::com
         {
             bytes = data;
         }
-
-    private:
-        RawType bytes{{}};
     };
 
 
@@ -248,17 +322,13 @@ namespace plug::com
         RawType bytes{{}};
     };
 
-    class NamePayload
+    template <class Bytes>
+    class BasicNamePayload
     {
     public:
-        using RawType = std::array<std::uint8_t, sizePayload>;
-
-
-        void setName(std::string_view name)
+        explicit BasicNamePayload(Bytes data)
+            : bytes(data)
         {
-            constexpr std::size_t nameLength{32};
-            const auto n = std::min(name.length(), nameLength);
-            std::copy_n(name.cbegin(), n, bytes.begin());
         }
 
         std::string getName() const
@@ -270,6 +340,29 @@ namespace plug::com
             return std::string(bytes.cbegin(), std::min(end, maxEnd));
         }
 
+    protected:
+        Bytes bytes;
+    };
+
+    class NamePayload : public BasicNamePayload<std::array<std::uint8_t, sizePayload>>
+    {
+    public:
+        using RawType = std::array<std::uint8_t, sizePayload>;
+        using View = BasicNamePayload<ByteView<sizePayload>>;
+
+
+        NamePayload()
+            : BasicNamePayload(RawType{{}})
+        {
+        }
+
+        void setName(std::string_view name)
+        {
+            constexpr std::size_t nameLength{32};
+            const auto n = std::min(name.length(), nameLength);
+            std::copy_n(name.cbegin(), n, bytes.begin());
+        }
+
         RawType getBytes() const
         {
             return bytes;
@@ -279,20 +372,15 @@ namespace plug::com
         {
             bytes = data;
         }
-
-    private:
-        RawType bytes{{}};
     };
 
-    class EffectPayload
+    template <class Bytes>
+    class BasicEffectPayload
     {
     public:
-        using RawType = std::array<std::uint8_t, sizePayload>;
-
-
-        void setKnob1(std::uint8_t value)
+        explicit BasicEffectPayload(Bytes data)
+            : bytes(data)
         {
-            bytes[16] = value;
         }
 
         std::uint8_t getKnob1() const
@@ -300,85 +388,96 @@ namespace plug::com
             return bytes[16];
         }
 
-        void setKnob2(std::uint8_t value)
+        std::uint8_t getKnob2() const
         {
-            bytes[17] = value;
+            return bytes[17];
         }
 
-        std::uint8_t getKnob2() const
+        std::uint8_t getKnob3() const
         {
-            return bytes[17];
+            return bytes[18];
         }
 
-        void setKnob3(std::uint8_t value)
+        std::uint8_t getKnob4() const
         {
-            bytes[18] = value;
+            return bytes[19];
         }
 
-        std::uint8_t getKnob3() const
+        std::uint8_t getKnob5() const
         {
-            return bytes[18];
+            return bytes[20];
         }
 
-        void setKnob4(std::uint8_t value)
+        std::uint8_t getKnob6() const
         {
-            bytes[19] = value;
+            return bytes[21];
         }
 
-        std::uint8_t getKnob4() const
+        std::uint8_t getSlot() const
         {
-            return bytes[19];
+            return bytes[2];
         }
 
-        void setKnob5(std::uint8_t value)
+        std::uint16_t getModel() const
         {
-            bytes[20] = value;
+            return static_cast<std::uint16_t>(bytes[0] + bytes[1] * 256);
         }
 
-        std::uint8_t getKnob5() const
+    protected:
+        Bytes bytes;
+    };
+
+    class EffectPayload : public BasicEffectPayload<std::array<std::uint8_t, sizePayload>>
+    {
+    public:
+        using RawType = std::array<std::uint8_t, sizePayload>;
+        using View = BasicEffectPayload<ByteView<sizePayload>>;
+
+
+        EffectPayload()
+            : BasicEffectPayload(RawType{{}})
         {
-            return bytes[20];
         }
 
-        void setKnob6(std::uint8_t value)
+        void setKnob1(std::uint8_t value)
         {
-            bytes[21] = value;
+            bytes[16] = value;
         }
 
-        std::uint8_t getKnob6() const
+        void setKnob2(std::uint8_t value)
         {
-            return bytes[21];
+            bytes[17] = value;
         }
 
-        void setSlot(std::uint8_t slot)
+        void setKnob3(std::uint8_t value)
         {
-            bytes[2] = slot;
+            bytes[18] = value;
         }
 
-        std::uint8_t getSlot() const
+        void setKnob4(std::uint8_t value)
         {
-            return bytes[2];
+            bytes[19] = value;
         }
 
-        void setModel(std::uint16_t model)
+        void setKnob5(std::uint8_t value)
         {
+            bytes[20] = value;
+        }
 
-            bytes[0] = model%256;
-            bytes[1] = model/256;
-            printf("setModel: %02x -> %02x:%02x\n"
-                    ,static_cast<int>(model)
-                    ,static_cast<int>(bytes[0])
-                    ,static_cast<int>(bytes[1]));
+        void setKnob6(std::uint8_t value)
+        {
+            bytes[21] = value;
         }
 
-        std::uint16_t getModel() const
+        void setSlot(std::uint8_t slot)
         {
-            uint16_t mod=bytes[0]+bytes[1]*256;
-             printf("getModel: %02x -> %02x:%02x\n"
-                    ,static_cast<int>(mod)
-                    ,static_cast<int>(bytes[0])
-                    ,static_cast<int>(bytes[1]));
-            return mod;
+            bytes[2] = slot;
+        }
+
+        void setModel(std::uint16_t model)
+        {
+            bytes[0] = static_cast<std::uint8_t>(model % 256);
+            bytes[1] = static_cast<std::uint8_t>(model / 256);
         }
 
         void setUnknown(std::uint8_t value0, std::uint8_t value1, std::uint8_t value2)
@@ -397,180 +496,197 @@ namespace plug::com
         {
             bytes = data;
         }
-
-    private:
-        RawType bytes{{}};
     };
 
 
-    class AmpPayload
+    template <class Bytes>
+    class BasicAmpPayload
     {
     public:
-        using RawType = std::array<std::uint8_t, sizePayload>;
+        explicit BasicAmpPayload(Bytes data)
+            : bytes(data)
+        {
+        }
 
+        std::uint8_t getModel() const
+        {
+            return bytes[0];
+        }
 
-        AmpPayload()
+        std::uint8_t getVolume() const
         {
+            return bytes[16];
         }
 
-        void setModel(std::uint8_t value)
+        std::uint8_t getGain() const
         {
-            bytes[0] = value;
+            return bytes[17];
         }
 
-        std::uint8_t getModel() const
+        std::uint8_t getGain2() const
         {
-            return bytes[0];
+            return bytes[18];
         }
 
-        void setVolume(std::uint8_t value)
+        std::uint8_t getMasterVolume() const
         {
-            bytes[16] = value;
+            return bytes[19];
         }
 
-        std::uint8_t getVolume() const
+        std::uint8_t getTreble() const
         {
-            return bytes[16];
+            return bytes[20];
         }
 
-        void setGain(std::uint8_t value)
+        std::uint8_t getMiddle() const
         {
-            bytes[17] = value;
+            return bytes[21];
         }
 
-        std::uint8_t getGain() const
+        std::uint8_t getBass() const
         {
-            return bytes[17];
+            return bytes[22];
         }
 
-        void setGain2(std::uint8_t value)
+        std::uint8_t getPresence() const
         {
-            bytes[18] = value;
+            return bytes[23];
         }
 
-        std::uint8_t getGain2() const
+        std::uint8_t getDepth() const
         {
-            return bytes[18];
+            return bytes[25];
         }
 
-        void setMasterVolume(std::uint8_t value)
+        std::uint8_t getBias() const
         {
-            bytes[19] = value;
+            return bytes[26];
         }
 
-        std::uint8_t getMasterVolume() const
+        std::uint8_t getNoiseGate() const
         {
-            return bytes[19];
+            return bytes[31];
         }
 
-        void setTreble(std::uint8_t value)
+        std::uint8_t getThreshold() const
         {
-            bytes[20] = value;
+            return bytes[32];
         }
 
-        std::uint8_t getTreble() const
+        std::uint8_t getCabinet() const
         {
-            return bytes[20];
+            return bytes[33];
         }
 
-        void setMiddle(std::uint8_t value)
+        std::uint8_t getSag() const
         {
-            bytes[21] = value;
+            return bytes[35];
         }
 
-        std::uint8_t getMiddle() const
+        std::uint8_t getBrightness() const
         {
-            return bytes[21];
+            return bytes[36];
         }
 
-        void setBass(std::uint8_t value)
+        std::uint8_t getUsbGain() const
         {
-            bytes[22] = value;
+            return bytes[0];
         }
 
-        std::uint8_t getBass() const
+    protected:
+        Bytes bytes;
+    };
+
+    class AmpPayload : public BasicAmpPayload<std::array<std::uint8_t, sizePayload>>
+    {
+    public:
+        using RawType = std::array<std::uint8_t, sizePayload>;
+        using View = BasicAmpPayload<ByteView<sizePayload>>;
+
+
+        AmpPayload()
+            : BasicAmpPayload(RawType{{}})
         {
-            return bytes[22];
         }
 
-        void setPresence(std::uint8_t value)
+        void setModel(std::uint8_t value)
         {
-            bytes[23] = value;
+            bytes[0] = value;
         }
 
-        std::uint8_t getPresence() const
+        void setVolume(std::uint8_t value)
         {
-            return bytes[23];
+            bytes[16] = value;
         }
 
-        void setDepth(std::uint8_t value)
+        void setGain(std::uint8_t value)
         {
-            bytes[25] = value;
+            bytes[17] = value;
         }
 
-        std::uint8_t getDepth() const
+        void setGain2(std::uint8_t value)
         {
-            return bytes[25];
+            bytes[18] = value;
         }
 
-        void setBias(std::uint8_t value)
+        void setMasterVolume(std::uint8_t value)
         {
-            bytes[26] = value;
+            bytes[19] = value;
         }
 
-        std::uint8_t getBias() const
+        void setTreble(std::uint8_t value)
         {
-            return bytes[26];
+            bytes[20] = value;
         }
 
-        void setNoiseGate(std::uint8_t value)
+        void setMiddle(std::uint8_t value)
         {
-            bytes[31] = value;
+            bytes[21] = value;
         }
 
-        std::uint8_t getNoiseGate() const
+        void setBass(std::uint8_t value)
         {
-            return bytes[31];
+            bytes[22] = value;
         }
 
-        void setThreshold(std::uint8_t value)
+        void setPresence(std::uint8_t value)
         {
-            bytes[32] = value;
+            bytes[23] = value;
         }
 
-        std::uint8_t getThreshold() const
+        void setDepth(std::uint8_t value)
         {
-            return bytes[32];
+            bytes[25] = value;
         }
 
-        void setCabinet(std::uint8_t value)
+        void setBias(std::uint8_t value)
         {
-            bytes[33] = value;
+            bytes[26] = value;
         }
 
-        std::uint8_t getCabinet() const
+        void setNoiseGate(std::uint8_t value)
         {
-            return bytes[33];
+            bytes[31] = value;
         }
 
-        void setSag(std::uint8_t value)
+        void setThreshold(std::uint8_t value)
         {
-            bytes[35] = value;
+            bytes[32] = value;
         }
 
-        std::uint8_t getSag() const
+        void setCabinet(std::uint8_t value)
         {
-            return bytes[35];
+            bytes[33] = value;
         }
 
-        void setBrightness(std::uint8_t value)
+        void setSag(std::uint8_t value)
         {
-            bytes[36] = value;
+            bytes[35] = value;
         }
 
-        std::uint8_t getBrightness() const
+        void setBrightness(std::uint8_t value)
         {
-            return bytes[36];
+            bytes[36] = value;
         }
 
         void setUnknown(std::uint8_t value0, std::uint8_t value1, std::uint8_t value2)
@@ -594,11 +710,6 @@ namespace plug::com
             bytes[0] = value;
         }
 
-        std::uint8_t getUsbGain() const
-        {
-            return bytes[0];
-        }
-
         RawType getBytes() const
         {
             return bytes;
@@ -608,10 +719,6 @@ namespace plug::com
         {
             bytes = data;
         }
-
-
-    private:
-        RawType bytes{{}};
     };
 
 
@@ -674,4 +781,30 @@ namespace plug::com
         Payload payload;
     };
 
+
+    // Typed access to a received packet without copying it; the packet must
+    // outlive the view.
+    template <class Payload>
+    class PacketView
+    {
+    public:
+        explicit constexpr PacketView(const PacketRawType& data)
+            : bytes(data.data())
+        {
+        }
+
+        Header::View getHeader() const
+        {
+            return Header::View{ByteView<sizeHeader>{bytes.cbegin()}};
+        }
+
+        auto getPayload() const
+        {
+            return typename Payload::View{ByteView<sizePayload>{bytes.cbegin() + sizeHeader}};
+        }
+
+    private:
+        ByteView<packetRawTypeSize> bytes;
+    };
+
 }
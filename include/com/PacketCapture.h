@@ -0,0 +1,74 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace plug::com
+{
+    enum class Direction : std::uint8_t
+    {
+        out,
+        in
+    };
+
+    // An empty incoming packet is a receive that timed out
+    struct CapturedPacket
+    {
+        std::chrono::nanoseconds time;
+        Direction direction;
+        std::vector<std::uint8_t> data;
+    };
+
+    struct Capture
+    {
+        std::chrono::system_clock::time_point start;
+        std::vector<CapturedPacket> packets;
+    };
+
+
+    // Writes packets to a capture as they pass; times are taken from a
+    // monotonic clock, relative to the creation of the writer.
+    class CaptureWriter
+    {
+    public:
+        explicit CaptureWriter(std::ostream& stream);
+
+        void write(Direction direction, const std::uint8_t* data, std::size_t size);
+
+    private:
+        std::mutex mutex;
+        std::ostream& os;
+        const std::chrono::steady_clock::time_point start;
+    };
+
+
+    // Throws std::runtime_error if the data isn't a valid capture
+    Capture readCapture(std::istream& stream);
+
+    // Converts a capture to pcapng with usbmon headers, for Wireshark
+    void exportPcapng(const Capture& capture, std::ostream& stream);
+}
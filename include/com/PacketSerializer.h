@@ -25,6 +25,9 @@
 #include "effects_enum.h"
 #include "com/MustangConstants.h"
 #include "com/Packet.h"
+#include "com/FixedVector.h"
+#include "com/Span.h"
+#include "com/DecodeResult.h"
 #include <string>
 #include <vector>
 #include <array>
@@ -40,9 +43,23 @@ namespace plug::com
         return packet;
     }
 
+    // Non-throwing decoding, for packets that may come from newer firmware
+    DecodeResult<amp_settings> tryDecodeAmpFromData(PacketView<AmpPayload> packet, PacketView<AmpPayload> packetUsbGain);
+    DecodeResult<fx_pedal_settings> tryDecodeEffectFromData(PacketView<EffectPayload> packet);
+
+    std::string decodeNameFromData(PacketView<NamePayload> packet);
+    amp_settings decodeAmpFromData(PacketView<AmpPayload> packet, PacketView<AmpPayload> packetUsbGain);
+
+    fx_pedal_settings decodeEffectFromData(PacketView<EffectPayload> packet);
+    std::array<fx_pedal_settings, 4> decodeEffectsFromData(const std::array<PacketView<EffectPayload>, 4>& packet);
+
+    // Decodes the names of the first count packets
+    std::vector<std::string> decodePresetListFromData(const std::vector<PacketRawType>& packets, std::size_t count);
+
     std::string decodeNameFromData(const Packet<NamePayload>& packet);
     amp_settings decodeAmpFromData(const Packet<AmpPayload>& packet, const Packet<AmpPayload>& packetUsbGain);
 
+    fx_pedal_settings decodeEffectFromData(const Packet<EffectPayload>& packet);
     std::array<fx_pedal_settings, 4> decodeEffectsFromData(const std::array<Packet<EffectPayload>, 4>& packet);
     std::vector<std::string> decodePresetListFromData(const std::vector<Packet<NamePayload>>& packet);
 
@@ -51,8 +68,10 @@ namespace plug::com
     Packet<NamePayload> serializeName(std::uint8_t slot, std::string_view name);
     Packet<EffectPayload> serializeEffectSettings(const fx_pedal_settings& value);
     Packet<EffectPayload> serializeClearEffectSettings();
-    Packet<NamePayload> serializeSaveEffectName(std::uint8_t slot, std::string_view name, const std::vector<fx_pedal_settings>& effects);
-    std::vector<Packet<EffectPayload>> serializeSaveEffectPacket(std::uint8_t slot, const std::vector<fx_pedal_settings>& effects);
+    Packet<NamePayload> serializeSaveEffectName(std::uint8_t slot, std::string_view name, Span<fx_pedal_settings> effects);
+    inline constexpr std::size_t maxSaveEffectPackets{2};
+
+    FixedVector<Packet<EffectPayload>, maxSaveEffectPackets> serializeSaveEffectPacket(std::uint8_t slot, Span<fx_pedal_settings> effects);
 
     Packet<EmptyPayload> serializeLoadSlotCommand(std::uint8_t slot);
     Packet<EmptyPayload> serializeLoadCommand();
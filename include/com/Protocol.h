@@ -0,0 +1,70 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include "effects_enum.h"
+#include "com/MustangConstants.h"
+#include "com/ModelTable.h"
+#include <cstddef>
+
+namespace plug::com
+{
+    // Properties of an amp family that are known once the device is opened.
+    // Small amps (Mustang I and II) have 24 preset banks, the others 100.
+    template <ProtocolVersion Version, std::size_t Banks>
+    struct Protocol
+    {
+        static inline constexpr ProtocolVersion version{Version};
+        static inline constexpr std::size_t bankCount{Banks};
+
+        // Each preset name is followed by an empty packet
+        static inline constexpr std::size_t presetNamePacketCount{2 * Banks};
+
+        static constexpr bool supports(amps amp)
+        {
+            return descriptorOf(amp).since <= version;
+        }
+
+        static constexpr bool supports(effects effect)
+        {
+            return descriptorOf(effect).since <= version;
+        }
+    };
+
+    using SmallAmpsV1 = Protocol<ProtocolVersion::v1, 24>;
+    using BigAmpsV1 = Protocol<ProtocolVersion::v1, 100>;
+    using SmallAmpsV2 = Protocol<ProtocolVersion::v2, 24>;
+    using BigAmpsV2 = Protocol<ProtocolVersion::v2, 100>;
+
+
+    // Selects one of the protocols above at runtime
+    enum class ProtocolKind
+    {
+        smallAmpsV1,
+        bigAmpsV1,
+        smallAmpsV2,
+        bigAmpsV2
+    };
+
+    static_assert(SmallAmpsV1::supports(amps::METAL_2000) == true, "V1 amps must be available on V1");
+    static_assert(SmallAmpsV1::supports(amps::STUDIO_PREAMP) == false, "V2 amps must not be available on V1");
+    static_assert(BigAmpsV1::supports(effects::MOD_WHA) == false, "V2 effects must not be available on V1");
+    static_assert(BigAmpsV2::supports(effects::BIG_FUZZ) == true, "V2 effects must be available on V2");
+}
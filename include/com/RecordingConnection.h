@@ -0,0 +1,62 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "com/Connection.h"
+#include "com/PacketCapture.h"
+#include <fstream>
+#include <memory>
+
+namespace plug::com
+{
+
+    // Passes everything to the wrapped connection and writes all packets
+    // sent and received to a capture file.
+    class RecordingConnection : public Connection
+    {
+    public:
+        RecordingConnection(std::shared_ptr<Connection> connection, const std::string& fileName);
+
+        void close() override;
+        bool isOpen() const override;
+
+        void waitSent() override;
+        std::vector<std::uint8_t> receive(std::size_t recvSize) override;
+        std::future<std::vector<std::uint8_t>> receiveAsync(std::size_t recvSize) override;
+        void discardReceived() override;
+        std::vector<std::vector<std::uint8_t>> takeReceived() override;
+        void setReceiveListener(std::function<void()> listener) override;
+        std::string deviceId() const override;
+        std::shared_ptr<Stats> stats() const override;
+
+    private:
+        std::size_t sendImpl(const std::uint8_t* data, std::size_t size) override;
+        std::future<std::size_t> sendAsyncImpl(const std::uint8_t* data, std::size_t size) override;
+        void sendQueuedImpl(const std::uint8_t* data, std::size_t size) override;
+        std::size_t receiveIntoImpl(std::uint8_t* buffer, std::size_t size) override;
+        std::size_t receiveWithinImpl(std::uint8_t* buffer, std::size_t size, std::chrono::milliseconds timeout) override;
+        void record(Direction direction, const std::vector<std::uint8_t>& data);
+
+        std::shared_ptr<Connection> conn;
+        std::ofstream file;
+        CaptureWriter writer;
+    };
+}
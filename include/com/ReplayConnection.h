@@ -0,0 +1,61 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "com/Connection.h"
+#include "com/PacketCapture.h"
+#include <chrono>
+
+namespace plug::com
+{
+
+    // Plays back the incoming packets of a capture, each not before its
+    // recorded time multiplied by the time scale (0 replays without any
+    // delay). Sent packets are compared to the recorded ones.
+    class ReplayConnection : public Connection
+    {
+    public:
+        explicit ReplayConnection(Capture recorded, double timeScale = 1.0);
+
+        void close() override;
+        bool isOpen() const override;
+
+        std::vector<std::uint8_t> receive(std::size_t recvSize) override;
+        void discardReceived() override;
+        std::vector<std::vector<std::uint8_t>> takeReceived() override;
+
+        // Number of sent packets that differ from the capture
+        std::size_t mismatches() const;
+
+    private:
+        std::size_t sendImpl(const std::uint8_t* data, std::size_t size) override;
+        std::chrono::steady_clock::time_point dueTime(const CapturedPacket& packet) const;
+        std::size_t nextIndex(std::size_t from, Direction direction) const;
+
+        const Capture capture;
+        const double scale;
+        const std::chrono::steady_clock::time_point start;
+        std::size_t nextIn;
+        std::size_t nextOut;
+        std::size_t mismatchCount;
+        bool open;
+    };
+}
@@ -0,0 +1,86 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <initializer_list>
+
+namespace plug::com
+{
+
+    // Read-only view of contiguous elements, e.g. of a std::vector or a
+    // FixedVector; doesn't own or copy them. A view of a braced list is
+    // valid only for the call it's passed to.
+    template <class T>
+    class Span
+    {
+    public:
+        using value_type = T;
+        using size_type = std::size_t;
+        using const_iterator = const T*;
+
+
+        Span(const T* first, std::size_t size)
+            : items(first), count(size)
+        {
+        }
+
+        template <class Container>
+        Span(const Container& container)
+            : Span(container.data(), container.size())
+        {
+        }
+
+        Span(std::initializer_list<T> values)
+            : Span(values.begin(), values.size())
+        {
+        }
+
+        std::size_t size() const
+        {
+            return count;
+        }
+
+        bool empty() const
+        {
+            return (count == 0);
+        }
+
+        const T& operator[](std::size_t index) const
+        {
+            return items[index];
+        }
+
+        const_iterator begin() const
+        {
+            return items;
+        }
+
+        const_iterator end() const
+        {
+            return items + count;
+        }
+
+    private:
+        const T* items;
+        std::size_t count;
+    };
+}
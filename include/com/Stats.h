@@ -0,0 +1,151 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+
+namespace plug::com
+{
+    enum class Operation : std::size_t
+    {
+        send,
+        receive,
+        startAmp,
+        setEffect,
+        setAmplifier,
+        applyChain,
+        loadMemoryBank,
+        saveOnAmp,
+        writeBank
+    };
+
+    inline constexpr std::size_t operationCount{9};
+
+    enum class Counter : std::size_t
+    {
+        packetsSent,
+        packetsReceived,
+        bytesSent,
+        bytesReceived,
+        sendRetries,
+        receiveTimeouts,
+        errors,
+        unknownPackets
+    };
+
+    inline constexpr std::size_t counterCount{8};
+
+    std::string_view nameOf(Operation operation);
+    std::string_view nameOf(Counter counter);
+
+
+    // HDR-style histogram with 32 linear sub-buckets per power of two, which
+    // keeps the error below 3 % from 1 us up to days. Recording is lock-free
+    // and may happen from any thread.
+    class LatencyHistogram
+    {
+    public:
+        LatencyHistogram() = default;
+        LatencyHistogram(const LatencyHistogram&) = delete;
+
+        void record(std::chrono::nanoseconds latency);
+        void reset();
+
+        std::uint64_t count() const;
+        std::chrono::microseconds max() const;
+
+        // Highest value equivalent to the given percentile (0 - 100)
+        std::chrono::microseconds percentile(double p) const;
+
+        LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+        static inline constexpr std::size_t bucketCount{1152};
+
+    private:
+        std::array<std::atomic<std::uint64_t>, bucketCount> buckets{};
+        std::atomic<std::uint64_t> total{0};
+        std::atomic<std::uint64_t> maximum{0};
+    };
+
+
+    struct LatencySummary
+    {
+        std::uint64_t count;
+        std::chrono::microseconds p50;
+        std::chrono::microseconds p90;
+        std::chrono::microseconds p99;
+        std::chrono::microseconds max;
+    };
+
+    struct StatsSnapshot
+    {
+        std::array<LatencySummary, operationCount> latencies;
+        std::array<std::uint64_t, counterCount> counters;
+
+        const LatencySummary& latency(Operation operation) const;
+        std::uint64_t counter(Counter counter) const;
+    };
+
+    std::ostream& operator<<(std::ostream& os, const StatsSnapshot& snapshot);
+
+
+    class Stats
+    {
+    public:
+        // Records the time from its creation until it's destroyed
+        class Timer
+        {
+        public:
+            Timer(Stats& stats, Operation operation);
+            Timer(const Timer&) = delete;
+            ~Timer();
+
+            Timer& operator=(const Timer&) = delete;
+
+        private:
+            Stats& owner;
+            const Operation op;
+            const std::chrono::steady_clock::time_point start;
+        };
+
+
+        Stats() = default;
+        Stats(const Stats&) = delete;
+
+        void record(Operation operation, std::chrono::nanoseconds latency);
+        void add(Counter counter, std::uint64_t value = 1);
+        Timer measure(Operation operation);
+
+        StatsSnapshot snapshot() const;
+        void reset();
+
+        Stats& operator=(const Stats&) = delete;
+
+    private:
+        std::array<LatencyHistogram, operationCount> histograms;
+        std::array<std::atomic<std::uint64_t>, counterCount> counters{};
+    };
+}
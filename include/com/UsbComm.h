@@ -22,12 +22,15 @@
 
 #include "com/Connection.h"
 #include <initializer_list>
+#include <memory>
 
 struct libusb_device_handle;
 
 
 namespace plug::com
 {
+    class UsbTransferEngine;
+
 
     class UsbComm : public Connection
     {
@@ -42,14 +45,34 @@ namespace plug::com
         bool isOpen() const override;
 
         std::vector<std::uint8_t> receive(std::size_t recvSize) override;
+        std::future<std::vector<std::uint8_t>> receiveAsync(std::size_t recvSize) override;
+        void waitSent() override;
+        void discardReceived() override;
+        std::vector<std::vector<std::uint8_t>> takeReceived() override;
+        void setReceiveListener(std::function<void()> listener) override;
+        std::string deviceId() const override;
+        std::shared_ptr<Stats> stats() const override;
+
+        // Product id of the opened device, 0 if not opened
+        std::uint16_t productId() const;
 
     private:
-        std::size_t sendImpl(std::uint8_t* data, std::size_t size) override;
+        std::size_t sendImpl(const std::uint8_t* data, std::size_t size) override;
+        std::future<std::size_t> sendAsyncImpl(const std::uint8_t* data, std::size_t size) override;
+        void sendQueuedImpl(const std::uint8_t* data, std::size_t size) override;
+        std::size_t receiveIntoImpl(std::uint8_t* buffer, std::size_t size) override;
+        std::size_t receiveWithinImpl(std::uint8_t* buffer, std::size_t size, std::chrono::milliseconds timeout) override;
+        UsbTransferEngine& transfers();
         void closeAndRelease();
 
         void initInterface();
 
 
         libusb_device_handle* handle;
+        std::unique_ptr<UsbTransferEngine> engine;
+        std::string id;
+        std::uint16_t product;
+        std::function<void()> receiveListener;
+        const std::shared_ptr<Stats> statistics;
     };
 }
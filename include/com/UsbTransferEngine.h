@@ -0,0 +1,141 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "com/Stats.h"
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+struct libusb_device_handle;
+struct libusb_transfer;
+
+
+namespace plug::com
+{
+
+    // Asynchronous interrupt transfers on a claimed interface. A fixed pool of
+    // OUT transfers is reused for sending, while several IN transfers are kept
+    // in flight all the time; packets arriving without a pending receive are
+    // queued in a fixed ring. Completions are handled by a dedicated event
+    // thread.
+    //
+    // sendQueued(), waitSent() and receiveInto() don't allocate any memory,
+    // unlike the future based send() and receive().
+    //
+    // Latencies, retries, timeouts and byte counts are added to the stats.
+    class UsbTransferEngine
+    {
+    public:
+        UsbTransferEngine(libusb_device_handle* handle, std::uint8_t endpointSend, std::uint8_t endpointRecv, Stats& stats);
+        UsbTransferEngine(const UsbTransferEngine&) = delete;
+        ~UsbTransferEngine();
+
+        std::future<std::size_t> send(const std::uint8_t* data, std::size_t size);
+        std::future<std::vector<std::uint8_t>> receive(std::size_t recvSize);
+
+        void sendQueued(const std::uint8_t* data, std::size_t size);
+        std::size_t waitSent();
+        std::size_t receiveInto(std::uint8_t* buffer, std::size_t size);
+        std::size_t receiveWithin(std::uint8_t* buffer, std::size_t size, std::chrono::milliseconds timeout);
+
+        void discardReceived();
+        std::vector<std::vector<std::uint8_t>> takeReceived();
+        void setReceiveListener(std::function<void()> listener);
+
+        UsbTransferEngine& operator=(const UsbTransferEngine&) = delete;
+
+    private:
+        struct OutTransfer;
+        struct InTransfer;
+
+        static inline constexpr std::size_t packetSize{64};
+        static inline constexpr std::size_t receiveQueueSize{256};
+
+        struct ReceivedPacket
+        {
+            std::array<std::uint8_t, packetSize> data;
+            std::size_t size;
+        };
+
+        struct PendingReceive
+        {
+            std::promise<std::vector<std::uint8_t>> result;
+            std::size_t size;
+            std::chrono::steady_clock::time_point requested;
+            std::chrono::steady_clock::time_point deadline;
+        };
+
+        static void onSendCompleted(libusb_transfer* transfer);
+        static void onReceiveCompleted(libusb_transfer* transfer);
+
+        bool isRunning();
+        OutTransfer& acquireOut(bool queued);
+        void submitOut(OutTransfer& out, const std::uint8_t* data, std::size_t size);
+        void completeSend(OutTransfer& out);
+        void completeReceive(InTransfer& in);
+        bool submitReceive(InTransfer& in);
+        std::size_t waitReceived(std::uint8_t* buffer, std::size_t size, std::chrono::milliseconds timeout);
+        void deliver(const std::uint8_t* data, std::size_t size);
+        void pushReceived(const std::uint8_t* data, std::size_t size);
+        std::size_t popReceived(std::uint8_t* buffer, std::size_t size);
+        void fail(std::exception_ptr error);
+        void expireReceives();
+        std::chrono::microseconds nextEventTimeout();
+        void handleEvents();
+        void shutdown();
+
+        libusb_device_handle* const handle;
+        const std::uint8_t endpointSend;
+        const std::uint8_t endpointRecv;
+        Stats& stats;
+        std::vector<std::unique_ptr<OutTransfer>> outTransfers;
+        std::vector<std::unique_ptr<InTransfer>> inTransfers;
+
+        std::mutex mutex;
+        std::condition_variable outAvailable;
+        std::condition_variable packetArrived;
+        std::vector<OutTransfer*> idleOut;
+        std::size_t queuedSends;
+        std::size_t queuedBytes;
+        bool queuedFailed;
+        std::array<ReceivedPacket, receiveQueueSize> received;
+        std::size_t receivedFirst;
+        std::size_t receivedCount;
+        std::size_t waitingReceives;
+        std::deque<PendingReceive> pendingReceives;
+        std::exception_ptr receiveError;
+        std::function<void()> receiveListener;
+        std::size_t inFlight;
+        bool running;
+        std::thread eventThread;
+    };
+}
@@ -0,0 +1,56 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "SignalChain.h"
+#include <string>
+#include <string_view>
+
+namespace plug::fuse
+{
+    // The parts of a FUSE preset (*.fuse) used by plug; everything else in
+    // a file is skipped when reading.
+    struct Preset
+    {
+        SignalChain chain;
+        std::string author;
+    };
+
+
+    // Reads the document in place; only name and author are copied. Unknown
+    // models and values are left at their defaults, like FUSE does. Effects
+    // get their slots in the order of their positions.
+    //
+    // Throws std::invalid_argument if the text holds no preset.
+    Preset parsePreset(std::string_view text);
+
+    // Throws std::invalid_argument if the file can't be read or holds no preset
+    Preset readPresetFile(const std::string& filename);
+
+
+    // Appends the document to out, so the buffer can be reused for many
+    // presets. Only one effect per kind (stompbox, modulation, delay and
+    // reverb) can be stored.
+    void writePreset(std::string& out, const Preset& preset);
+
+    // Throws std::invalid_argument if the file can't be written
+    void writePresetFile(const std::string& filename, const Preset& preset);
+}
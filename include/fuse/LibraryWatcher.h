@@ -0,0 +1,71 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace plug::fuse
+{
+    struct LibraryChanges
+    {
+        // Created, modified, renamed (old and new name) and deleted files
+        std::vector<std::string> fileNames;
+
+        // Events were lost or the directory itself changed, so only a full
+        // refresh brings the library up to date
+        bool rescan;
+    };
+
+
+    // Watches a directory for changes using inotify. Events are collected
+    // until none arrived for the debounce time, so a burst like a bulk copy
+    // is reported at once; during continuous changes they are reported at
+    // least every ten debounce times.
+    //
+    // The listener is called on a thread of the watcher. If watching fails,
+    // a rescan is reported once and no further changes follow.
+    class LibraryWatcher
+    {
+    public:
+        using Listener = std::function<void(const LibraryChanges&)>;
+
+        // Throws std::invalid_argument if the directory can't be watched
+        LibraryWatcher(const std::string& directory, std::chrono::milliseconds debounce, Listener listener);
+        LibraryWatcher(const LibraryWatcher&) = delete;
+        ~LibraryWatcher();
+
+        LibraryWatcher& operator=(const LibraryWatcher&) = delete;
+
+    private:
+        void run();
+        bool readEvents(LibraryChanges& changes);
+
+        const std::chrono::milliseconds debounce;
+        const Listener listener;
+        const int inotifyFd;
+        const int stopFd;
+        std::thread thread;
+    };
+}
@@ -0,0 +1,77 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "fuse/FuseFile.h"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace plug::fuse
+{
+    struct IndexEntry
+    {
+        std::string fileName;
+        std::int64_t modified;
+        std::uint64_t size;
+        std::optional<Preset> preset;
+    };
+
+
+    // Metadata of the presets (*.fuse) in a directory, kept in an index file
+    // so the files don't have to be parsed again. A file is only parsed if
+    // it's new or its modification time or size changed. Files that aren't
+    // presets are kept without one, so they are skipped as well.
+    class PresetIndex
+    {
+    public:
+        PresetIndex(const std::string& directory, const std::string& indexFile);
+
+        // An unreadable or foreign index, or that of another directory, is
+        // treated as empty
+        void load();
+        bool store() const;
+
+        // Parses new and changed files on up to threads workers (0 for one
+        // per core) and drops removed ones. Returns the number of files parsed.
+        std::size_t refresh(std::size_t threads = 0);
+
+        // Like refresh(), limited to the given files of the directory, so the
+        // cost doesn't depend on the size of the library. Files that are gone
+        // or aren't presets are dropped.
+        std::size_t update(const std::vector<std::string>& fileNames, std::size_t threads = 0);
+
+        // Sorted by file name, ignoring case
+        const std::vector<IndexEntry>& entries() const;
+        std::string path(const IndexEntry& entry) const;
+        const std::string& directory() const;
+
+    private:
+        const std::string dir;
+        const std::string indexFile;
+        std::vector<IndexEntry> indexed;
+    };
+
+
+    // File name of the index of a directory, so several can be kept side by side
+    std::string indexFileName(const std::string& directory);
+}
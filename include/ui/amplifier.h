@@ -83,6 +83,7 @@ namespace plug
 
         // send settings to the amplifier
         void send_amp();
+        void send_on_change();
 
         void load(amp_settings);
         void get_settings(amp_settings*);
@@ -81,6 +81,7 @@ namespace plug
 
         // send settings to the amplifier
         void send_fx();
+        void send_on_change();
 
         void load(fx_pedal_settings);
         void get_settings(fx_pedal_settings&);
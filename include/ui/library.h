@@ -21,10 +21,16 @@
 
 #pragma once
 
+#include "fuse/PresetIndex.h"
+#include "fuse/LibraryWatcher.h"
 #include <QDialog>
 #include <QResizeEvent>
-#include <QFileInfoList>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
 
 namespace Ui
 {
@@ -34,6 +40,9 @@ namespace Ui
 namespace plug
 {
 
+    // Presets of the chosen directory are shown from its index right away,
+    // while the index is refreshed in the background. Afterwards, changes
+    // of the directory are applied to the index as they happen.
     class Library : public QDialog
     {
         Q_OBJECT
@@ -47,19 +56,31 @@ namespace plug
 
 
     private:
-        const std::unique_ptr<Ui::Library> ui;
-        const std::unique_ptr<QFileInfoList> files;
+        void stop_indexing();
+        void update_index(const std::function<void(fuse::PresetIndex&)>& change);
+        void show_presets(const std::vector<fuse::IndexEntry>& entries);
         void resizeEvent(QResizeEvent*) override;
 
+        const std::unique_ptr<Ui::Library> ui;
+        std::vector<fuse::IndexEntry> presets;
+        std::unique_ptr<fuse::PresetIndex> index;
+        std::mutex indexMutex;
+        std::unique_ptr<fuse::LibraryWatcher> watcher;
+        std::thread indexer;
+        std::mutex mutex;
+        std::optional<std::vector<fuse::IndexEntry>> refreshed;
+
     private slots:
         void load_slot(int);
         void get_directory();
         void get_files(const QString&);
+        void index_refreshed();
         void load_file(int);
         void change_font_size(int);
         void change_font_family(QFont);
 
     signals:
         void directory_changed(QString);
+        void index_ready();
     };
 }
@@ -21,10 +21,15 @@
 
 #pragma once
 
+#include "SignalChain.h"
 #include "data_structs.h"
+#include "com/Stats.h"
 #include <QMainWindow>
+#include <QTimer>
 #include <memory>
 
+class QLabel;
+
 namespace Ui
 {
     class MainWindow;
@@ -42,11 +47,7 @@ namespace plug
     class Library;
     class DefaultEffects;
     class QuickPresets;
-
-    namespace com
-    {
-        class Mustang;
-    }
+    class MustangWorker;
 }
 
 
@@ -62,6 +63,8 @@ namespace plug
         MainWindow(const MainWindow&) = delete;
         ~MainWindow() override;
 
+        com::StatsSnapshot statistics() const;
+
         MainWindow& operator=(const MainWindow&) = delete;
 
     public slots:
@@ -76,18 +79,21 @@ namespace plug
         void save_effects(int, char*, int, bool, bool, bool);
         void set_index(int);
         void loadfile(QString filename = QString());
+        void load_preset(const plug::SignalChain& chain);
         void get_settings(amp_settings*, fx_pedal_settings[4]);
         void change_title(const QString&);
         void update_firmware();
         void empty_other(int, Effect*);
 
     private:
+        void apply_all(amp_settings amplifier_set);
+
         const std::unique_ptr<Ui::MainWindow> ui;
 
         QString current_name;
         std::vector<std::string> presetNames;
         bool connected;
-        std::unique_ptr<com::Mustang> amp_ops;
+        std::unique_ptr<MustangWorker> worker;
         Amplifier* amp;
         Effect* effect1;
         Effect* effect2;
@@ -101,6 +107,8 @@ namespace plug
         std::unique_ptr<Library> library;
         std::unique_ptr<DefaultEffects> deffx;
         QuickPresets* quickpres;
+        QLabel* statsLabel;
+        QTimer statsTimer;
 
     private slots:
         void about();
@@ -121,7 +129,15 @@ namespace plug
         void load_presets7();
         void load_presets8();
         void load_presets9();
-
+        void amp_started(plug::SignalChain signalChain, std::vector<std::string> presets);
+        void preset_name_loaded(int slot, QString name);
+        void amp_stopped();
+        void bank_loaded(plug::SignalChain signalChain);
+        void bank_saved(QString name, int slot);
+        void show_error(QString message);
+        void firmware_progress(int percent, double bytesPerSecond);
+        void firmware_updated(QString errorMessage);
+        void update_stats();
 
     signals:
         void started();
@@ -0,0 +1,142 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "SignalChain.h"
+#include "data_structs.h"
+#include "com/Packet.h"
+#include "com/BankCache.h"
+#include "com/AmpStateCache.h"
+#include "com/Stats.h"
+#include <QMetaType>
+#include <QObject>
+#include <QThread>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace plug
+{
+    namespace com
+    {
+        class Mustang;
+    }
+
+
+    // Runs all amplifier communication on a thread of its own. Commands are
+    // queued and executed in order, results are reported through signals and
+    // therefore delivered to the receiver's thread.
+    //
+    // Updates of a DSP (amp or effect slot) still waiting in the queue are
+    // replaced by newer ones, so only the latest state is sent.
+    //
+    // If enabled in the settings, all memory banks are read into a cache
+    // while idle. Banks can only be read by selecting them, which is audible
+    // on the amp; the previous state is restored afterwards, also on errors.
+    // Only completely decoded banks are cached.
+    //
+    // The state of each amp is kept on disk, so it's available immediately
+    // on the next start.
+    //
+    // Changes made on the amp itself are picked up as soon as the amp sends
+    // them and reported through state_changed().
+    class MustangWorker : public QObject
+    {
+        Q_OBJECT
+
+    public:
+        MustangWorker();
+        MustangWorker(const MustangWorker&) = delete;
+        ~MustangWorker() override;
+
+        void start_amp();
+        void stop_amp();
+        void set_effect(fx_pedal_settings pedal);
+        void set_amplifier(amp_settings settings);
+        void apply_chain(const SignalChain& chain);
+        void save_on_amp(const std::string& name, int slot);
+        void load_memory_bank(int slot);
+        void save_effects(int slot, const std::string& name, const std::vector<fx_pedal_settings>& effects);
+
+        // Updates the first amp in update mode; progress is reported through
+        // firmware_progress(), the result through firmware_updated()
+        void update_firmware(const std::string& filename);
+
+        // Statistics of the current or last connection; may be called from
+        // any thread
+        com::StatsSnapshot statistics();
+
+        MustangWorker& operator=(const MustangWorker&) = delete;
+
+    signals:
+        void amp_started(plug::SignalChain, std::vector<std::string>);
+        void preset_name_loaded(int, QString);
+        void state_changed(plug::SignalChain);
+        void amp_stopped();
+        void bank_loaded(plug::SignalChain);
+        void bank_saved(QString, int);
+        void error(QString);
+        void firmware_progress(int, double);
+        void firmware_updated(QString);
+
+    private:
+        using Command = std::function<void()>;
+
+        struct QueuedCommand
+        {
+            std::optional<com::DSP> target;
+            Command command;
+        };
+
+        void enqueue(Command command, std::optional<com::DSP> target = std::nullopt);
+        bool next_command(Command& command);
+        bool has_pending_commands();
+        bool prefetch_banks();
+        void store_state();
+        void request_listen();
+        com::Mustang& mustang();
+
+        QThread thread;
+        std::mutex mutex;
+        std::deque<QueuedCommand> commands;
+        bool processing;
+        std::unique_ptr<com::Mustang> amp_ops;
+        com::BankCache cache;
+        bool prefetching;
+        com::AmpStateCache stateCache;
+        std::string deviceId;
+        std::vector<std::string> presetNames;
+        std::atomic<bool> listenRequested;
+        std::shared_ptr<com::Stats> stats;
+
+    private slots:
+        void process_commands();
+        void listen();
+    };
+}
+
+Q_DECLARE_METATYPE(plug::SignalChain)
+Q_DECLARE_METATYPE(std::vector<std::string>)
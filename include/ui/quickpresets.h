@@ -23,7 +23,12 @@
 
 #include <QDialog>
 #include <QSettings>
+#include <array>
 #include <memory>
+#include <string>
+#include <vector>
+
+class QComboBox;
 
 namespace Ui
 {
@@ -41,6 +46,7 @@ namespace plug
         explicit QuickPresets(QWidget* parent = nullptr);
 
         void load_names(const std::vector<std::string>& names);
+        void set_name(int slot, const std::string& name);
         void delete_items();
         void change_name(int, QString*);
 
@@ -60,6 +66,8 @@ namespace plug
         void setDefaultPreset9(int);
 
     private:
+        std::array<QComboBox*, 10> comboBoxes() const;
+
         const std::unique_ptr<Ui::QuickPresets> ui;
     };
 }
@@ -22,6 +22,7 @@
 #pragma once
 
 #include <QMainWindow>
+#include <string>
 #include <vector>
 #include <memory>
 
@@ -43,6 +44,7 @@ namespace plug
         ~SaveOnAmp() override;
 
         void load_names(const std::vector<std::string>& names);
+        void set_name(int slot, const std::string& name);
         void delete_items();
 
         SaveOnAmp& operator=(const SaveOnAmp&) = delete;
@@ -46,6 +46,8 @@ namespace plug
         void change_keepopen(bool);
         void change_popupwindows(bool);
         void change_effectvalues(bool);
+        void change_sendonchange(bool);
+        void change_prefetchbanks(bool);
 
     private:
         const std::unique_ptr<Ui::Settings> ui;
@@ -0,0 +1,447 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "cli/Commands.h"
+#include "com/BankArchive.h"
+#include "com/CommunicationException.h"
+#include "com/ModelTable.h"
+#include "fuse/FuseFile.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+
+namespace plug::cli
+{
+    namespace
+    {
+        using Run = Json (*)(com::Mustang&, const com::InitalData&, const std::vector<std::string>&);
+
+        struct Command
+        {
+            std::string_view name;
+            std::string_view arguments;
+            std::string_view description;
+            std::size_t minArguments;
+            std::size_t maxArguments;
+            Run run;
+        };
+
+
+        std::uint8_t byteValue(const Json& json, std::string_view what)
+        {
+            const double number = json.number();
+
+            if ((number < 0.0) || (number > 255.0) || (std::trunc(number) != number))
+            {
+                throw std::invalid_argument{"Invalid value of " + std::string{what} + ": " + std::to_string(number)};
+            }
+            return static_cast<std::uint8_t>(number);
+        }
+
+        std::uint8_t byteOf(const Json& json, std::string_view key)
+        {
+            return byteValue(json[key], key);
+        }
+
+        template <class Enum>
+        Enum enumOf(const Json& json, std::string_view key, std::size_t count)
+        {
+            const auto number = byteOf(json, key);
+
+            if (number >= count)
+            {
+                throw std::invalid_argument{"Invalid " + std::string{key} + ": " + std::to_string(number)};
+            }
+            return static_cast<Enum>(number);
+        }
+
+        Json effectJson(const fx_pedal_settings& effect)
+        {
+            return Json::Object{{"slot", effect.fx_slot},
+                                {"model", value(effect.effect_num)},
+                                {"knobs", Json::Array{effect.knob1, effect.knob2, effect.knob3, effect.knob4, effect.knob5, effect.knob6}},
+                                {"position", (effect.position == Position::effectsLoop ? "effects_loop" : "input")}};
+        }
+
+        fx_pedal_settings effectFromJson(const Json& json)
+        {
+            const auto& knobs = json["knobs"].array();
+
+            if (knobs.size() != 6)
+            {
+                throw std::invalid_argument{"An effect needs six knobs"};
+            }
+
+            std::array<std::uint8_t, 6> values{};
+            std::transform(knobs.cbegin(), knobs.cend(), values.begin(), [](const auto& knob) { return byteValue(knob, "knob"); });
+
+            const auto& position = json["position"].string();
+
+            if ((position != "input") && (position != "effects_loop"))
+            {
+                throw std::invalid_argument{"Invalid effect position: " + position};
+            }
+
+            return fx_pedal_settings{byteOf(json, "slot"),
+                                     enumOf<effects>(json, "model", com::effectDescriptors.size()),
+                                     values[0], values[1], values[2], values[3], values[4], values[5],
+                                     (position == "effects_loop" ? Position::effectsLoop : Position::input)};
+        }
+
+        Json bankJson(std::size_t slot, const SignalChain& chain)
+        {
+            auto members = toJson(chain).object();
+            members.insert(members.begin(), {"slot", slot});
+            return Json{std::move(members)};
+        }
+
+        // Accepts the output of the tool itself as well as the bare result
+        const Json& resultOf(const Json& document)
+        {
+            const auto* result = (document.isObject() == true ? document.find("result") : nullptr);
+            return (result != nullptr ? *result : document);
+        }
+
+        Json readJsonFile(const std::string& filename)
+        {
+            std::ifstream file{filename};
+
+            if (file.is_open() == false)
+            {
+                throw std::invalid_argument{"Can't open file: " + filename};
+            }
+
+            std::ostringstream content;
+            content << file.rdbuf();
+            return parseJson(content.str());
+        }
+
+        std::uint8_t checkedSlot(std::size_t slot, const com::InitalData& initial)
+        {
+            if (slot >= std::get<1>(initial).size())
+            {
+                throw std::invalid_argument{"Invalid bank: " + std::to_string(slot)};
+            }
+            return static_cast<std::uint8_t>(slot);
+        }
+
+        std::uint8_t slotOf(const std::string& argument, const com::InitalData& initial)
+        {
+            const bool digits = (argument.empty() == false) && (argument.size() <= 3)
+                                && std::all_of(argument.cbegin(), argument.cend(), [](char c) { return (c >= '0') && (c <= '9'); });
+
+            if (digits == false)
+            {
+                throw std::invalid_argument{"Invalid bank: " + argument};
+            }
+            return checkedSlot(std::stoul(argument), initial);
+        }
+
+
+        Json listNames(com::Mustang&, const com::InitalData& initial, const std::vector<std::string>&)
+        {
+            const auto& names = std::get<1>(initial);
+            return Json::Array(names.cbegin(), names.cend());
+        }
+
+        // The state before the dump is restored afterwards
+        Json dumpBanks(com::Mustang& amp, const com::InitalData& initial, const std::vector<std::string>&)
+        {
+            const auto& names = std::get<1>(initial);
+            Json::Array banks;
+            banks.reserve(names.size());
+
+            for (std::size_t slot = 0; slot < names.size(); ++slot)
+            {
+                banks.push_back(bankJson(slot, amp.load_memory_bank(static_cast<std::uint8_t>(slot))));
+            }
+
+            amp.applyChain(std::get<0>(initial));
+            return Json::Object{{"banks", std::move(banks)}};
+        }
+
+        Json loadBank(com::Mustang& amp, const com::InitalData& initial, const std::vector<std::string>& args)
+        {
+            const auto slot = slotOf(args[1], initial);
+            return bankJson(slot, amp.load_memory_bank(slot));
+        }
+
+        bool isFuseFile(const std::string& filename)
+        {
+            constexpr std::string_view extension{".fuse"};
+            return (filename.size() >= extension.size()) && (filename.compare(filename.size() - extension.size(), extension.size(), extension) == 0);
+        }
+
+        Json applyFile(com::Mustang& amp, const com::InitalData&, const std::vector<std::string>& args)
+        {
+            const auto chain = (isFuseFile(args[1]) == true ? fuse::readPresetFile(args[1]).chain : chainFromJson(resultOf(readJsonFile(args[1]))));
+            amp.applyChain(chain);
+            return toJson(chain);
+        }
+
+        Json saveFile(com::Mustang& amp, const com::InitalData&, const std::vector<std::string>& args)
+        {
+            const auto state = amp.current_state();
+
+            if (state.has_value() == false)
+            {
+                throw com::CommunicationException{"Current state of the amp is unknown"};
+            }
+
+            fuse::writePresetFile(args[1], fuse::Preset{*state, (args.size() > 2 ? args[2] : std::string{})});
+            return toJson(*state);
+        }
+
+        Json saveBank(com::Mustang& amp, const com::InitalData& initial, const std::vector<std::string>& args)
+        {
+            const auto slot = slotOf(args[1], initial);
+            auto state = amp.current_state();
+
+            if (state.has_value() == false)
+            {
+                throw com::CommunicationException{"Current state of the amp is unknown"};
+            }
+
+            state->setName(args.size() > 2 ? args[2] : state->name());
+            amp.save_on_amp(state->name(), slot);
+            return bankJson(slot, amp.current_state().value_or(*state));
+        }
+
+        // Each bank is applied as a whole, then saved; the state before the
+        // restore is applied again afterwards.
+        Json restoreBanks(com::Mustang& amp, const com::InitalData& initial, const std::vector<std::string>& args)
+        {
+            const auto document = readJsonFile(args[1]);
+            const auto& banks = resultOf(document)["banks"].array();
+            std::vector<std::pair<std::uint8_t, SignalChain>> restore;
+            restore.reserve(banks.size());
+
+            for (const auto& bank : banks)
+            {
+                restore.emplace_back(checkedSlot(byteOf(bank, "slot"), initial), chainFromJson(bank));
+            }
+
+            for (const auto& [slot, chain] : restore)
+            {
+                amp.applyChain(chain);
+                amp.save_on_amp(chain.name(), slot);
+            }
+
+            amp.applyChain(std::get<0>(initial));
+            return Json::Object{{"restored", restore.size()}};
+        }
+
+        Json dumpArchive(com::Mustang& amp, const com::InitalData& initial, const std::vector<std::string>& args)
+        {
+            const auto images = com::loadBankImages(amp, std::get<1>(initial).size());
+            amp.applyChain(std::get<0>(initial));
+            com::writeBankArchive(args[1], images);
+            return Json::Object{{"banks", images.size()}};
+        }
+
+        // Only banks differing from the amp are written. Their hashes are
+        // read from the amp, unless an archive matching it is given.
+        Json restoreArchive(com::Mustang& amp, const com::InitalData& initial, const std::vector<std::string>& args)
+        {
+            const com::BankArchive archive{args[1]};
+
+            if (archive.size() > std::get<1>(initial).size())
+            {
+                throw std::invalid_argument{"Archive holds more banks than the amp: " + std::to_string(archive.size())};
+            }
+
+            const auto current = (args.size() > 2 ? com::bankHashes(com::BankArchive{args[2]}) : com::bankHashes(com::loadBankImages(amp, archive.size())));
+            const auto written = com::restoreBanks(amp, archive, current);
+            amp.applyChain(std::get<0>(initial));
+            return Json::Object{{"written", Json::Array(written.cbegin(), written.cend())}, {"unchanged", archive.size() - written.size()}};
+        }
+
+
+        inline constexpr std::array<Command, 9> commands{{
+            {"list-names", "", "Prints the names of all banks", 0, 0, &listNames},
+            {"dump-banks", "", "Prints all banks", 0, 0, &dumpBanks},
+            {"load-bank", "<bank>", "Selects a bank and prints it", 1, 1, &loadBank},
+            {"apply-file", "<file>", "Applies a .fuse file or a preset as printed by load-bank", 1, 1, &applyFile},
+            {"save-file", "<file> [author]", "Writes the current settings to a .fuse file", 1, 2, &saveFile},
+            {"save-bank", "<bank> [name]", "Saves the current settings to a bank", 1, 2, &saveBank},
+            {"restore-banks", "<file>", "Saves all banks as printed by dump-banks", 1, 1, &restoreBanks},
+            {"dump-archive", "<file>", "Writes all banks as received to an archive", 1, 1, &dumpArchive},
+            {"restore-archive", "<file> [current]", "Writes the banks differing from the amp or the current archive", 1, 2, &restoreArchive},
+        }};
+
+        const Command& commandOf(const std::vector<std::string>& args)
+        {
+            const auto command = std::find_if(commands.cbegin(), commands.cend(), [&args](const auto& c) {
+                return (args.empty() == false) && (c.name == args[0]);
+            });
+
+            if (command == commands.cend())
+            {
+                throw std::invalid_argument{"Unknown command: " + (args.empty() == true ? std::string{} : args[0])};
+            }
+
+            const std::size_t count = args.size() - 1;
+
+            if ((count < command->minArguments) || (count > command->maxArguments))
+            {
+                throw std::invalid_argument{"Invalid arguments, usage: " + std::string{command->name} + " " + std::string{command->arguments}};
+            }
+            return *command;
+        }
+
+        double milliseconds(std::chrono::microseconds us)
+        {
+            return static_cast<double>(us.count()) / 1000.0;
+        }
+    }
+
+
+    Json toJson(const SignalChain& chain)
+    {
+        const auto amp = chain.amp();
+        const auto fxSettings = chain.effects();
+        Json::Array effectList;
+        std::transform(fxSettings.cbegin(), fxSettings.cend(), std::back_inserter(effectList), effectJson);
+
+        return Json::Object{{"name", chain.name()},
+                            {"amp", Json::Object{{"model", value(amp.amp_num)},
+                                                 {"gain", amp.gain},
+                                                 {"volume", amp.volume},
+                                                 {"treble", amp.treble},
+                                                 {"middle", amp.middle},
+                                                 {"bass", amp.bass},
+                                                 {"cabinet", value(amp.cabinet)},
+                                                 {"noise_gate", amp.noise_gate},
+                                                 {"master_vol", amp.master_vol},
+                                                 {"gain2", amp.gain2},
+                                                 {"presence", amp.presence},
+                                                 {"threshold", amp.threshold},
+                                                 {"depth", amp.depth},
+                                                 {"bias", amp.bias},
+                                                 {"sag", amp.sag},
+                                                 {"brightness", amp.brightness},
+                                                 {"usb_gain", amp.usb_gain}}},
+                            {"effects", std::move(effectList)}};
+    }
+
+    SignalChain chainFromJson(const Json& json)
+    {
+        const auto& ampJson = json["amp"];
+        amp_settings amp{};
+        amp.amp_num = enumOf<amps>(ampJson, "model", com::ampDescriptors.size());
+        amp.gain = byteOf(ampJson, "gain");
+        amp.volume = byteOf(ampJson, "volume");
+        amp.treble = byteOf(ampJson, "treble");
+        amp.middle = byteOf(ampJson, "middle");
+        amp.bass = byteOf(ampJson, "bass");
+        amp.cabinet = enumOf<cabinets>(ampJson, "cabinet", com::cabinetDescriptors.size());
+        amp.noise_gate = byteOf(ampJson, "noise_gate");
+        amp.master_vol = byteOf(ampJson, "master_vol");
+        amp.gain2 = byteOf(ampJson, "gain2");
+        amp.presence = byteOf(ampJson, "presence");
+        amp.threshold = byteOf(ampJson, "threshold");
+        amp.depth = byteOf(ampJson, "depth");
+        amp.bias = byteOf(ampJson, "bias");
+        amp.sag = byteOf(ampJson, "sag");
+        amp.brightness = ampJson["brightness"].boolean();
+        amp.usb_gain = byteOf(ampJson, "usb_gain");
+
+        const auto& effectList = json["effects"].array();
+
+        if (effectList.size() > 4)
+        {
+            throw std::invalid_argument{"At most four effects are supported"};
+        }
+
+        std::array<fx_pedal_settings, 4> fxSettings{{}};
+        std::for_each(fxSettings.begin(), fxSettings.end(), [i = std::uint8_t{0}](auto& effect) mutable { effect.fx_slot = i++; });
+
+        for (const auto& effectJson : effectList)
+        {
+            const auto effect = effectFromJson(effectJson);
+            fxSettings[effect.fx_slot % 4] = effect;
+        }
+
+        return SignalChain{json["name"].string(), amp, fxSettings};
+    }
+
+    Json timingsJson(const com::StatsSnapshot& snapshot, std::chrono::steady_clock::duration total)
+    {
+        Json::Object operations;
+
+        for (std::size_t i = 0; i < com::operationCount; ++i)
+        {
+            const auto operation = static_cast<com::Operation>(i);
+            const auto& latency = snapshot.latency(operation);
+
+            if (latency.count > 0)
+            {
+                operations.emplace_back(std::string{com::nameOf(operation)}, Json::Object{{"count", latency.count},
+                                                                                          {"p50_ms", milliseconds(latency.p50)},
+                                                                                          {"p90_ms", milliseconds(latency.p90)},
+                                                                                          {"p99_ms", milliseconds(latency.p99)},
+                                                                                          {"max_ms", milliseconds(latency.max)}});
+            }
+        }
+
+        Json::Object counters;
+
+        for (std::size_t i = 0; i < com::counterCount; ++i)
+        {
+            const auto counter = static_cast<com::Counter>(i);
+            std::string name{com::nameOf(counter)};
+            std::replace(name.begin(), name.end(), ' ', '_');
+            counters.emplace_back(std::move(name), snapshot.counter(counter));
+        }
+
+        return Json::Object{{"total_ms", milliseconds(std::chrono::duration_cast<std::chrono::microseconds>(total))},
+                            {"operations", std::move(operations)},
+                            {"counters", std::move(counters)}};
+    }
+
+    void validateCommand(const std::vector<std::string>& args)
+    {
+        commandOf(args);
+    }
+
+    Json runCommand(com::Mustang& amp, const com::InitalData& initial, const std::vector<std::string>& args)
+    {
+        return commandOf(args).run(amp, initial, args);
+    }
+
+    std::string usage()
+    {
+        std::ostringstream os;
+        os << "Usage: plug-cli <command> [arguments]\n\n"
+           << "Results are printed as JSON, along with the timings of the amp operations.\n\n"
+           << "Commands:\n";
+
+        for (const auto& command : commands)
+        {
+            const std::string call = std::string{command.name} + " " + std::string{command.arguments};
+            os << "  " << call << std::string(call.size() < 28 ? 28 - call.size() : 1, ' ') << command.description << '\n';
+        }
+        return os.str();
+    }
+}
@@ -0,0 +1,552 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "cli/Json.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <stdexcept>
+
+namespace plug::cli
+{
+    namespace
+    {
+        template <class T>
+        const T& as(const std::variant<std::nullptr_t, bool, double, std::string, Json::Array, Json::Object>& value, const char* expected)
+        {
+            if (const auto* v = std::get_if<T>(&value); v != nullptr)
+            {
+                return *v;
+            }
+            throw std::invalid_argument{std::string{"JSON value is not "} + expected};
+        }
+
+        void writeString(std::ostream& os, std::string_view text)
+        {
+            os << '"';
+
+            for (const char c : text)
+            {
+                switch (c)
+                {
+                    case '"':
+                        os << "\\\"";
+                        break;
+                    case '\\':
+                        os << "\\\\";
+                        break;
+                    case '\n':
+                        os << "\\n";
+                        break;
+                    case '\r':
+                        os << "\\r";
+                        break;
+                    case '\t':
+                        os << "\\t";
+                        break;
+                    default:
+                        if (static_cast<unsigned char>(c) < 0x20)
+                        {
+                            os << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec << std::setfill(' ');
+                        }
+                        else
+                        {
+                            os << c;
+                        }
+                        break;
+                }
+            }
+            os << '"';
+        }
+
+        void writeNumber(std::ostream& os, double number)
+        {
+            if (std::isfinite(number) == false)
+            {
+                os << "null";
+            }
+            else if ((std::trunc(number) == number) && (std::fabs(number) < 1e15))
+            {
+                os << static_cast<std::int64_t>(number);
+            }
+            else
+            {
+                const auto precision = os.precision(15);
+                os << number;
+                os.precision(precision);
+            }
+        }
+
+
+        class Parser
+        {
+        public:
+            explicit Parser(std::string_view t)
+                : text(t), pos(0)
+            {
+            }
+
+            Json document()
+            {
+                auto result = value();
+                skipWhitespace();
+
+                if (pos != text.size())
+                {
+                    fail("Unexpected trailing data");
+                }
+                return result;
+            }
+
+        private:
+            [[noreturn]] void fail(const std::string& message) const
+            {
+                throw std::invalid_argument{message + " at offset " + std::to_string(pos)};
+            }
+
+            void skipWhitespace()
+            {
+                while ((pos < text.size()) && ((text[pos] == ' ') || (text[pos] == '\n') || (text[pos] == '\r') || (text[pos] == '\t')))
+                {
+                    ++pos;
+                }
+            }
+
+            char peek()
+            {
+                skipWhitespace();
+
+                if (pos == text.size())
+                {
+                    fail("Unexpected end of input");
+                }
+                return text[pos];
+            }
+
+            void expect(char c)
+            {
+                if (peek() != c)
+                {
+                    fail(std::string{"Expected '"} + c + "'");
+                }
+                ++pos;
+            }
+
+            bool consume(std::string_view word)
+            {
+                if (text.substr(pos, word.size()) == word)
+                {
+                    pos += word.size();
+                    return true;
+                }
+                return false;
+            }
+
+            Json value()
+            {
+                switch (peek())
+                {
+                    case '{':
+                        return object();
+                    case '[':
+                        return array();
+                    case '"':
+                        return Json{string()};
+                    default:
+                        break;
+                }
+
+                if (consume("null") == true)
+                {
+                    return Json{};
+                }
+                if (consume("true") == true)
+                {
+                    return Json{true};
+                }
+                if (consume("false") == true)
+                {
+                    return Json{false};
+                }
+                return number();
+            }
+
+            Json object()
+            {
+                expect('{');
+                Json::Object members;
+
+                if (peek() == '}')
+                {
+                    ++pos;
+                    return Json{std::move(members)};
+                }
+
+                do
+                {
+                    if (peek() != '"')
+                    {
+                        fail("Expected member name");
+                    }
+                    auto key = string();
+                    expect(':');
+                    members.emplace_back(std::move(key), value());
+                } while (separator('}') == true);
+
+                return Json{std::move(members)};
+            }
+
+            Json array()
+            {
+                expect('[');
+                Json::Array elements;
+
+                if (peek() == ']')
+                {
+                    ++pos;
+                    return Json{std::move(elements)};
+                }
+
+                do
+                {
+                    elements.push_back(value());
+                } while (separator(']') == true);
+
+                return Json{std::move(elements)};
+            }
+
+            // True if another element follows, false at the closing bracket
+            bool separator(char closing)
+            {
+                const char c = peek();
+                ++pos;
+
+                if (c == ',')
+                {
+                    return true;
+                }
+                if (c != closing)
+                {
+                    fail(std::string{"Expected ',' or '"} + closing + "'");
+                }
+                return false;
+            }
+
+            Json number()
+            {
+                const std::size_t start = pos;
+
+                while ((pos < text.size()) && (std::string_view{"+-0123456789.eE"}.find(text[pos]) != std::string_view::npos))
+                {
+                    ++pos;
+                }
+
+                const std::string token{text.substr(start, pos - start)};
+                char* end = nullptr;
+                const double result = std::strtod(token.c_str(), &end);
+
+                if ((token.empty() == true) || (end != token.c_str() + token.size()))
+                {
+                    pos = start;
+                    fail("Invalid value");
+                }
+                return Json{result};
+            }
+
+            std::string string()
+            {
+                expect('"');
+                std::string result;
+
+                while (true)
+                {
+                    if (pos == text.size())
+                    {
+                        fail("Unterminated string");
+                    }
+
+                    const char c = text[pos++];
+
+                    if (c == '"')
+                    {
+                        return result;
+                    }
+                    if (c != '\\')
+                    {
+                        result.push_back(c);
+                        continue;
+                    }
+                    if (pos == text.size())
+                    {
+                        fail("Unterminated string");
+                    }
+
+                    switch (const char escaped = text[pos++]; escaped)
+                    {
+                        case '"':
+                        case '\\':
+                        case '/':
+                            result.push_back(escaped);
+                            break;
+                        case 'b':
+                            result.push_back('\b');
+                            break;
+                        case 'f':
+                            result.push_back('\f');
+                            break;
+                        case 'n':
+                            result.push_back('\n');
+                            break;
+                        case 'r':
+                            result.push_back('\r');
+                            break;
+                        case 't':
+                            result.push_back('\t');
+                            break;
+                        case 'u':
+                            appendUtf8(result, codePoint());
+                            break;
+                        default:
+                            fail("Invalid escape sequence");
+                    }
+                }
+            }
+
+            std::uint32_t hexQuad()
+            {
+                if (pos + 4 > text.size())
+                {
+                    fail("Invalid unicode escape");
+                }
+
+                std::uint32_t result{0};
+
+                for (std::size_t i = 0; i < 4; ++i)
+                {
+                    const char c = text[pos++];
+                    const auto digit = std::string_view{"0123456789abcdef"}.find(static_cast<char>(std::tolower(static_cast<unsigned char>(c))));
+
+                    if (digit == std::string_view::npos)
+                    {
+                        fail("Invalid unicode escape");
+                    }
+                    result = (result << 4) | static_cast<std::uint32_t>(digit);
+                }
+                return result;
+            }
+
+            std::uint32_t codePoint()
+            {
+                const auto high = hexQuad();
+
+                if ((high >= 0xd800) && (high < 0xdc00) && (consume("\\u") == true))
+                {
+                    const auto low = hexQuad();
+
+                    if ((low >= 0xdc00) && (low < 0xe000))
+                    {
+                        return 0x10000 + ((high - 0xd800) << 10) + (low - 0xdc00);
+                    }
+                    fail("Invalid surrogate pair");
+                }
+                return high;
+            }
+
+            static void appendUtf8(std::string& out, std::uint32_t cp)
+            {
+                const auto put = [&out](std::uint32_t byte) { out.push_back(static_cast<char>(byte)); };
+
+                if (cp < 0x80)
+                {
+                    put(cp);
+                }
+                else if (cp < 0x800)
+                {
+                    put(0xc0 | (cp >> 6));
+                    put(0x80 | (cp & 0x3f));
+                }
+                else if (cp < 0x10000)
+                {
+                    put(0xe0 | (cp >> 12));
+                    put(0x80 | ((cp >> 6) & 0x3f));
+                    put(0x80 | (cp & 0x3f));
+                }
+                else
+                {
+                    put(0xf0 | (cp >> 18));
+                    put(0x80 | ((cp >> 12) & 0x3f));
+                    put(0x80 | ((cp >> 6) & 0x3f));
+                    put(0x80 | (cp & 0x3f));
+                }
+            }
+
+            const std::string_view text;
+            std::size_t pos;
+        };
+    }
+
+
+    Json::Json()
+        : value(nullptr)
+    {
+    }
+
+    Json::Json(std::nullptr_t)
+        : value(nullptr)
+    {
+    }
+
+    Json::Json(bool b)
+        : value(b)
+    {
+    }
+
+    Json::Json(double number)
+        : value(number)
+    {
+    }
+
+    Json::Json(const char* text)
+        : value(std::string{text})
+    {
+    }
+
+    Json::Json(std::string text)
+        : value(std::move(text))
+    {
+    }
+
+    Json::Json(Array elements)
+        : value(std::move(elements))
+    {
+    }
+
+    Json::Json(Object members)
+        : value(std::move(members))
+    {
+    }
+
+    bool Json::isNull() const
+    {
+        return std::holds_alternative<std::nullptr_t>(value);
+    }
+
+    bool Json::isObject() const
+    {
+        return std::holds_alternative<Object>(value);
+    }
+
+    bool Json::boolean() const
+    {
+        return as<bool>(value, "a boolean");
+    }
+
+    double Json::number() const
+    {
+        return as<double>(value, "a number");
+    }
+
+    const std::string& Json::string() const
+    {
+        return as<std::string>(value, "a string");
+    }
+
+    const Json::Array& Json::array() const
+    {
+        return as<Array>(value, "an array");
+    }
+
+    const Json::Object& Json::object() const
+    {
+        return as<Object>(value, "an object");
+    }
+
+    const Json* Json::find(std::string_view key) const
+    {
+        const auto& members = object();
+        const auto member = std::find_if(members.cbegin(), members.cend(), [key](const auto& m) { return m.first == key; });
+        return (member != members.cend() ? &member->second : nullptr);
+    }
+
+    const Json& Json::operator[](std::string_view key) const
+    {
+        if (const auto* member = find(key); member != nullptr)
+        {
+            return *member;
+        }
+        throw std::invalid_argument{"Missing JSON member: " + std::string{key}};
+    }
+
+
+    Json parseJson(std::string_view text)
+    {
+        return Parser{text}.document();
+    }
+
+    std::ostream& operator<<(std::ostream& os, const Json& json)
+    {
+        std::visit([&os](const auto& v) {
+            using T = std::decay_t<decltype(v)>;
+
+            if constexpr (std::is_same_v<T, std::nullptr_t>)
+            {
+                os << "null";
+            }
+            else if constexpr (std::is_same_v<T, bool>)
+            {
+                os << (v == true ? "true" : "false");
+            }
+            else if constexpr (std::is_same_v<T, double>)
+            {
+                writeNumber(os, v);
+            }
+            else if constexpr (std::is_same_v<T, std::string>)
+            {
+                writeString(os, v);
+            }
+            else if constexpr (std::is_same_v<T, Json::Array>)
+            {
+                os << '[';
+
+                for (std::size_t i = 0; i < v.size(); ++i)
+                {
+                    os << (i > 0 ? "," : "") << v[i];
+                }
+                os << ']';
+            }
+            else
+            {
+                os << '{';
+
+                for (std::size_t i = 0; i < v.size(); ++i)
+                {
+                    os << (i > 0 ? "," : "");
+                    writeString(os, v[i].first);
+                    os << ':' << v[i].second;
+                }
+                os << '}';
+            }
+        },
+                   json.value);
+        return os;
+    }
+}
@@ -0,0 +1,81 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "cli/Commands.h"
+#include "com/ConnectionFactory.h"
+#include "com/Mustang.h"
+#include "version.h"
+#include <chrono>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+int main(int argc, char* argv[])
+{
+    using namespace plug;
+
+    const std::vector<std::string> args(std::next(argv), std::next(argv, argc));
+
+    if ((args.empty() == true) || (args[0] == "--help") || (args[0] == "-h"))
+    {
+        std::cout << cli::usage();
+        return (args.empty() == true ? 2 : 0);
+    }
+
+    if (args[0] == "--version")
+    {
+        std::cout << "plug-cli " << version() << '\n';
+        return 0;
+    }
+
+    try
+    {
+        cli::validateCommand(args);
+    }
+    catch (const std::invalid_argument& ex)
+    {
+        std::cerr << "plug-cli: " << ex.what() << "\n\n"
+                  << cli::usage();
+        return 2;
+    }
+
+    try
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const auto device = com::openUsbDevice();
+        const auto amp = com::createMustang(device.connection, device.protocol);
+        const auto initial = amp->start_amp();
+        auto result = cli::runCommand(*amp, initial, args);
+        const auto snapshot = amp->statistics()->snapshot();
+        amp->stop_amp();
+
+        std::cout << cli::Json{cli::Json::Object{{"command", args[0]},
+                                                 {"result", std::move(result)},
+                                                 {"timings", cli::timingsJson(snapshot, std::chrono::steady_clock::now() - start)}}}
+                  << '\n';
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "plug-cli: " << ex.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
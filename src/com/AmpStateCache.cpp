@@ -0,0 +1,323 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "com/AmpStateCache.h"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+
+namespace plug::com
+{
+    namespace
+    {
+        inline constexpr std::array<char, 4> magic{{'P', 'L', 'G', 'S'}};
+        inline constexpr std::uint8_t version{1};
+
+
+        class Writer
+        {
+        public:
+            void byte(std::uint8_t value)
+            {
+                data.push_back(static_cast<char>(value));
+            }
+
+            void word(std::uint16_t value)
+            {
+                byte(static_cast<std::uint8_t>(value & 0xff));
+                byte(static_cast<std::uint8_t>(value >> 8));
+            }
+
+            void text(const std::string& value)
+            {
+                const auto size = std::min<std::size_t>(value.size(), 0xff);
+                byte(static_cast<std::uint8_t>(size));
+                data.append(value, 0, size);
+            }
+
+            template <class Enum>
+            void enumValue(Enum value)
+            {
+                byte(static_cast<std::uint8_t>(value));
+            }
+
+            void chain(const SignalChain& signalChain)
+            {
+                text(signalChain.name());
+
+                const auto amp = signalChain.amp();
+                enumValue(amp.amp_num);
+                byte(amp.gain);
+                byte(amp.volume);
+                byte(amp.treble);
+                byte(amp.middle);
+                byte(amp.bass);
+                enumValue(amp.cabinet);
+                byte(amp.noise_gate);
+                byte(amp.master_vol);
+                byte(amp.gain2);
+                byte(amp.presence);
+                byte(amp.threshold);
+                byte(amp.depth);
+                byte(amp.bias);
+                byte(amp.sag);
+                byte(amp.brightness ? 1 : 0);
+                byte(amp.usb_gain);
+
+                for (const auto& effect : signalChain.effects())
+                {
+                    byte(effect.fx_slot);
+                    enumValue(effect.effect_num);
+                    byte(effect.knob1);
+                    byte(effect.knob2);
+                    byte(effect.knob3);
+                    byte(effect.knob4);
+                    byte(effect.knob5);
+                    byte(effect.knob6);
+                    enumValue(effect.position);
+                }
+            }
+
+            std::string data;
+        };
+
+
+        // Throws std::out_of_range if the data is truncated
+        class Reader
+        {
+        public:
+            explicit Reader(std::string d)
+                : data(std::move(d)), pos(0)
+            {
+            }
+
+            std::uint8_t byte()
+            {
+                return static_cast<std::uint8_t>(data.at(pos++));
+            }
+
+            std::uint16_t word()
+            {
+                const std::uint16_t low = byte();
+                return static_cast<std::uint16_t>(low | (byte() << 8));
+            }
+
+            std::string text()
+            {
+                const std::size_t size = byte();
+                std::string value = data.substr(pos, size);
+
+                if (value.size() != size)
+                {
+                    throw std::out_of_range{"Truncated text"};
+                }
+                pos += size;
+                return value;
+            }
+
+            template <class Enum>
+            Enum enumValue()
+            {
+                return static_cast<Enum>(byte());
+            }
+
+            SignalChain chain()
+            {
+                const auto name = text();
+
+                amp_settings amp{};
+                amp.amp_num = enumValue<amps>();
+                amp.gain = byte();
+                amp.volume = byte();
+                amp.treble = byte();
+                amp.middle = byte();
+                amp.bass = byte();
+                amp.cabinet = enumValue<cabinets>();
+                amp.noise_gate = byte();
+                amp.master_vol = byte();
+                amp.gain2 = byte();
+                amp.presence = byte();
+                amp.threshold = byte();
+                amp.depth = byte();
+                amp.bias = byte();
+                amp.sag = byte();
+                amp.brightness = (byte() != 0);
+                amp.usb_gain = byte();
+
+                std::array<fx_pedal_settings, 4> fxSettings{{}};
+
+                for (auto& effect : fxSettings)
+                {
+                    effect.fx_slot = byte();
+                    effect.effect_num = enumValue<effects>();
+                    effect.knob1 = byte();
+                    effect.knob2 = byte();
+                    effect.knob3 = byte();
+                    effect.knob4 = byte();
+                    effect.knob5 = byte();
+                    effect.knob6 = byte();
+                    effect.position = enumValue<Position>();
+                }
+
+                return SignalChain{name, amp, fxSettings};
+            }
+
+            bool atEnd() const
+            {
+                return (pos == data.size());
+            }
+
+        private:
+            const std::string data;
+            std::size_t pos;
+        };
+
+
+        void writeNames(Writer& writer, const std::vector<std::string>& presetNames)
+        {
+            writer.word(static_cast<std::uint16_t>(presetNames.size()));
+            std::for_each(presetNames.cbegin(), presetNames.cend(), [&writer](const auto& name) { writer.text(name); });
+        }
+    }
+
+
+    std::uint64_t fingerprint(const std::vector<std::string>& presetNames, const SignalChain& chain)
+    {
+        Writer writer;
+        writeNames(writer, presetNames);
+        writer.chain(chain);
+
+        // FNV-1a
+        return std::accumulate(writer.data.cbegin(), writer.data.cend(), std::uint64_t{0xcbf29ce484222325}, [](std::uint64_t hash, char c) {
+            return (hash ^ static_cast<std::uint8_t>(c)) * std::uint64_t{0x100000001b3};
+        });
+    }
+
+
+    AmpStateCache::AmpStateCache(const std::string& dir)
+        : directory(dir)
+    {
+    }
+
+    std::optional<AmpState> AmpStateCache::load(const std::string& deviceId) const
+    {
+        if (deviceId.empty() == true)
+        {
+            return std::nullopt;
+        }
+
+        std::ifstream file{path(deviceId), std::ios::binary};
+
+        if (file.is_open() == false)
+        {
+            return std::nullopt;
+        }
+
+        std::ostringstream content;
+        content << file.rdbuf();
+
+        try
+        {
+            Reader reader{content.str()};
+
+            const bool validHeader = std::all_of(magic.cbegin(), magic.cend(), [&reader](char c) { return reader.byte() == static_cast<std::uint8_t>(c); });
+
+            if ((validHeader == false) || (reader.byte() != version) || (reader.text() != deviceId))
+            {
+                return std::nullopt;
+            }
+
+            AmpState state;
+            state.presetNames.resize(reader.word());
+            std::generate(state.presetNames.begin(), state.presetNames.end(), [&reader] { return reader.text(); });
+            state.chain = reader.chain();
+            state.banks.resize(reader.word());
+            std::generate(state.banks.begin(), state.banks.end(), [&reader]() -> std::optional<SignalChain> {
+                if (reader.byte() == 0)
+                {
+                    return std::nullopt;
+                }
+                return reader.chain();
+            });
+
+            if (reader.atEnd() == false)
+            {
+                return std::nullopt;
+            }
+            return state;
+        }
+        catch (const std::out_of_range&)
+        {
+            return std::nullopt;
+        }
+    }
+
+    bool AmpStateCache::store(const std::string& deviceId, const AmpState& state) const
+    {
+        if (deviceId.empty() == true)
+        {
+            return false;
+        }
+
+        Writer writer;
+        std::for_each(magic.cbegin(), magic.cend(), [&writer](char c) { writer.byte(static_cast<std::uint8_t>(c)); });
+        writer.byte(version);
+        writer.text(deviceId);
+        writeNames(writer, state.presetNames);
+        writer.chain(state.chain);
+        writer.word(static_cast<std::uint16_t>(state.banks.size()));
+
+        for (const auto& bank : state.banks)
+        {
+            writer.byte(bank.has_value() ? 1 : 0);
+
+            if (bank.has_value() == true)
+            {
+                writer.chain(*bank);
+            }
+        }
+
+        // Replace the file at once, so a crash never leaves a partial one
+        const auto target = path(deviceId);
+        const auto temp = target + ".tmp";
+        {
+            std::ofstream file{temp, std::ios::binary | std::ios::trunc};
+            file.write(writer.data.data(), static_cast<std::streamsize>(writer.data.size()));
+
+            if (file.good() == false)
+            {
+                return false;
+            }
+        }
+        return (std::rename(temp.c_str(), target.c_str()) == 0);
+    }
+
+    std::string AmpStateCache::path(const std::string& deviceId) const
+    {
+        std::string name{deviceId};
+        std::replace_if(name.begin(), name.end(), [](char c) { return std::isalnum(static_cast<unsigned char>(c)) == 0; }, '_');
+        return directory + "/amp-" + name + ".state";
+    }
+}
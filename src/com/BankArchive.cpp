@@ -0,0 +1,233 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "com/BankArchive.h"
+#include "com/Mustang.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <numeric>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace plug::com
+{
+    namespace
+    {
+        inline constexpr std::array<std::uint8_t, 4> magic{{'P', 'L', 'G', 'B'}};
+        inline constexpr std::uint8_t version{1};
+
+        // Magic, version, a reserved byte and the bank count; the hashes
+        // follow, then the images. All values are little endian.
+        inline constexpr std::size_t headerSize{8};
+        inline constexpr std::size_t hashSize{8};
+        inline constexpr std::size_t imageSize{bankPacketCount * packetRawTypeSize};
+
+        std::size_t archiveSize(std::size_t count)
+        {
+            return headerSize + count * (hashSize + imageSize);
+        }
+
+        std::uint64_t readHash(const std::uint8_t* bytes)
+        {
+            return std::accumulate(std::make_reverse_iterator(std::next(bytes, hashSize)), std::make_reverse_iterator(bytes), std::uint64_t{0}, [](std::uint64_t value, std::uint8_t b) {
+                return (value << 8) | b;
+            });
+        }
+
+        void appendHash(std::string& out, std::uint64_t hash)
+        {
+            for (std::size_t i = 0; i < hashSize; ++i)
+            {
+                out.push_back(static_cast<char>((hash >> (8 * i)) & 0xff));
+            }
+        }
+    }
+
+
+    std::uint64_t bankHash(const BankImage& image)
+    {
+        return std::accumulate(image.cbegin(), image.cend(), std::uint64_t{0xcbf29ce484222325}, [](std::uint64_t hash, const auto& packet) {
+            return std::accumulate(std::next(packet.cbegin(), sizeHeader), packet.cend(), hash, [](std::uint64_t h, std::uint8_t b) {
+                return (h ^ b) * std::uint64_t{0x100000001b3};
+            });
+        });
+    }
+
+
+    BankArchive::BankArchive(const std::string& filename)
+        : data(nullptr), fileSize(0), count(0)
+    {
+        const int fd = ::open(filename.c_str(), O_RDONLY);
+
+        if (fd < 0)
+        {
+            throw std::invalid_argument{"Can't open bank archive: " + filename};
+        }
+
+        struct stat info{};
+
+        if ((::fstat(fd, &info) != 0) || (static_cast<std::size_t>(info.st_size) < headerSize))
+        {
+            ::close(fd);
+            throw std::invalid_argument{"Not a bank archive: " + filename};
+        }
+
+        fileSize = static_cast<std::size_t>(info.st_size);
+        void* mapping = ::mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+
+        if (mapping == MAP_FAILED)
+        {
+            throw std::invalid_argument{"Can't map bank archive: " + filename};
+        }
+
+        data = static_cast<const std::uint8_t*>(mapping);
+        count = static_cast<std::size_t>(data[6] | (data[7] << 8));
+        const bool valid = std::equal(magic.cbegin(), magic.cend(), data) && (data[4] == version) && (fileSize == archiveSize(count));
+
+        if (valid == false)
+        {
+            ::munmap(mapping, fileSize);
+            throw std::invalid_argument{"Not a bank archive: " + filename};
+        }
+    }
+
+    BankArchive::~BankArchive()
+    {
+        ::munmap(const_cast<std::uint8_t*>(data), fileSize);
+    }
+
+    std::size_t BankArchive::size() const
+    {
+        return count;
+    }
+
+    std::uint64_t BankArchive::hash(std::size_t bank) const
+    {
+        return readHash(std::next(data, static_cast<std::ptrdiff_t>(headerSize + bank * hashSize)));
+    }
+
+    BankImage BankArchive::image(std::size_t bank) const
+    {
+        BankImage image{};
+        const auto* first = std::next(data, static_cast<std::ptrdiff_t>(headerSize + count * hashSize + bank * imageSize));
+
+        for (auto& packet : image)
+        {
+            std::copy_n(first, packet.size(), packet.begin());
+            first = std::next(first, static_cast<std::ptrdiff_t>(packet.size()));
+        }
+        return image;
+    }
+
+
+    void writeBankArchive(const std::string& filename, const std::vector<BankImage>& banks)
+    {
+        if (banks.size() > 0xffff)
+        {
+            throw std::invalid_argument{"Too many banks for an archive: " + std::to_string(banks.size())};
+        }
+
+        std::string content;
+        content.reserve(archiveSize(banks.size()));
+        content.append(magic.cbegin(), magic.cend());
+        content.push_back(static_cast<char>(version));
+        content.push_back('\0');
+        content.push_back(static_cast<char>(banks.size() & 0xff));
+        content.push_back(static_cast<char>(banks.size() >> 8));
+        std::for_each(banks.cbegin(), banks.cend(), [&content](const auto& bank) { appendHash(content, bankHash(bank)); });
+
+        for (const auto& bank : banks)
+        {
+            std::for_each(bank.cbegin(), bank.cend(), [&content](const auto& packet) { content.append(packet.cbegin(), packet.cend()); });
+        }
+
+        // Replace the file at once, so a crash never leaves a partial one
+        const auto temp = filename + ".tmp";
+        {
+            std::ofstream file{temp, std::ios::binary | std::ios::trunc};
+            file.write(content.data(), static_cast<std::streamsize>(content.size()));
+
+            if (file.good() == false)
+            {
+                throw std::invalid_argument{"Can't write bank archive: " + filename};
+            }
+        }
+
+        if (std::rename(temp.c_str(), filename.c_str()) != 0)
+        {
+            throw std::invalid_argument{"Can't write bank archive: " + filename};
+        }
+    }
+
+
+    std::vector<std::uint8_t> changedBanks(const BankArchive& archive, const std::vector<std::uint64_t>& current)
+    {
+        std::vector<std::uint8_t> changed;
+
+        for (std::size_t i = 0; i < archive.size(); ++i)
+        {
+            if ((i >= current.size()) || (current[i] != archive.hash(i)))
+            {
+                changed.push_back(static_cast<std::uint8_t>(i));
+            }
+        }
+        return changed;
+    }
+
+    std::vector<BankImage> loadBankImages(Mustang& amp, std::size_t count)
+    {
+        std::vector<BankImage> images;
+        images.reserve(count);
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            images.push_back(amp.loadBankImage(static_cast<std::uint8_t>(i)));
+        }
+        return images;
+    }
+
+    std::vector<std::uint64_t> bankHashes(const std::vector<BankImage>& images)
+    {
+        std::vector<std::uint64_t> hashes;
+        hashes.reserve(images.size());
+        std::transform(images.cbegin(), images.cend(), std::back_inserter(hashes), [](const auto& image) { return bankHash(image); });
+        return hashes;
+    }
+
+    std::vector<std::uint64_t> bankHashes(const BankArchive& archive)
+    {
+        std::vector<std::uint64_t> hashes(archive.size());
+        std::generate(hashes.begin(), hashes.end(), [&archive, i = std::size_t{0}]() mutable { return archive.hash(i++); });
+        return hashes;
+    }
+
+    std::vector<std::uint8_t> restoreBanks(Mustang& amp, const BankArchive& archive, const std::vector<std::uint64_t>& current)
+    {
+        const auto changed = changedBanks(archive, current);
+        std::for_each(changed.cbegin(), changed.cend(), [&amp, &archive](std::uint8_t bank) { amp.writeBankImage(bank, archive.image(bank)); });
+        return changed;
+    }
+}
@@ -0,0 +1,94 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "com/BankCache.h"
+#include <algorithm>
+
+namespace plug::com
+{
+
+    void BankCache::reset(std::size_t bankCount)
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        banks.assign(bankCount, std::nullopt);
+    }
+
+    std::size_t BankCache::size() const
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        return banks.size();
+    }
+
+    std::optional<SignalChain> BankCache::get(std::uint8_t slot) const
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        if (slot >= banks.size())
+        {
+            return std::nullopt;
+        }
+        return banks[slot];
+    }
+
+    void BankCache::put(std::uint8_t slot, const SignalChain& chain)
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        if (slot < banks.size())
+        {
+            banks[slot] = chain;
+        }
+    }
+
+    void BankCache::invalidate(std::uint8_t slot)
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        if (slot < banks.size())
+        {
+            banks[slot].reset();
+        }
+    }
+
+    std::optional<std::uint8_t> BankCache::nextMissing() const
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        const auto itr = std::find_if(banks.cbegin(), banks.cend(), [](const auto& bank) { return bank.has_value() == false; });
+
+        if (itr == banks.cend())
+        {
+            return std::nullopt;
+        }
+        return static_cast<std::uint8_t>(std::distance(banks.cbegin(), itr));
+    }
+
+    std::vector<std::optional<SignalChain>> BankCache::snapshot() const
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        return banks;
+    }
+
+    void BankCache::restore(const std::vector<std::optional<SignalChain>>& stored)
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        const auto count = std::min(stored.size(), banks.size());
+        std::copy_n(stored.cbegin(), count, banks.begin());
+    }
+}
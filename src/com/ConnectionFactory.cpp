@@ -21,6 +21,10 @@
 #include "com/ConnectionFactory.h"
 #include "com/UsbComm.h"
 #include "com/MustangConstants.h"
+#include "com/RecordingConnection.h"
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
 
 namespace plug::com
 {
@@ -45,12 +49,38 @@ namespace plug::com
             usbPID::floorAmps,
             usbPID::smallAmpsV2,
             usbPID::bigAmpsV2};
+
+        // Mini and Floor are treated as V2, so none of their models is rejected
+        constexpr ProtocolKind protocolOf(std::uint16_t pid)
+        {
+            switch (pid)
+            {
+                case usbPID::smallAmps:
+                    return ProtocolKind::smallAmpsV1;
+                case usbPID::bigAmps:
+                    return ProtocolKind::bigAmpsV1;
+                case usbPID::miniAmps:
+                case usbPID::smallAmpsV2:
+                    return ProtocolKind::smallAmpsV2;
+                case usbPID::floorAmps:
+                case usbPID::bigAmpsV2:
+                    return ProtocolKind::bigAmpsV2;
+                default:
+                    throw std::invalid_argument{"Unsupported product id: " + std::to_string(pid)};
+            }
+        }
     }
 
-    std::shared_ptr<Connection> createUsbConnection()
+    UsbDevice openUsbDevice()
     {
         auto conn = std::make_shared<UsbComm>();
         conn->openFirst(usbVID, pids);
-        return conn;
+        const auto protocol = protocolOf(conn->productId());
+
+        if (const char* captureFile = std::getenv("PLUG_CAPTURE"); captureFile != nullptr)
+        {
+            return {std::make_shared<RecordingConnection>(conn, captureFile), protocol};
+        }
+        return {conn, protocol};
     }
 }
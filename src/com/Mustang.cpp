@@ -23,169 +23,744 @@
 #include "com/PacketSerializer.h"
 #include "com/CommunicationException.h"
 #include "com/Packet.h"
+#include "com/FixedVector.h"
 #include <algorithm>
+#include <chrono>
+#include <exception>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
 
 namespace plug::com
 {
-    SignalChain decode_data(const std::array<PacketRawType, 7>& data)
+    struct DecodedBank
     {
-        const auto name = decodeNameFromData(fromRawData<NamePayload>(data[0]));
-        const auto amp = decodeAmpFromData(fromRawData<AmpPayload>(data[1]), fromRawData<AmpPayload>(data[6]));
-        const auto effects = decodeEffectsFromData({{fromRawData<EffectPayload>(data[2]), fromRawData<EffectPayload>(data[3]),
-                                                     fromRawData<EffectPayload>(data[4]), fromRawData<EffectPayload>(data[5])}});
+        SignalChain chain;
+        bool complete;
+    };
+
+    // Decodes the packets of a bank in place, starting at data. Packets with
+    // unknown models are counted and left at their defaults instead of
+    // failing the whole bank.
+    template <class Iterator>
+    DecodedBank decode_data(Iterator data, Stats& stats)
+    {
+        bool complete{true};
+        const auto skip = [&stats, &complete] {
+            stats.add(Counter::unknownPackets);
+            complete = false;
+        };
+
+        const auto name = decodeNameFromData(PacketView<NamePayload>{data[0]});
+        const auto decodedAmp = tryDecodeAmpFromData(PacketView<AmpPayload>{data[1]}, PacketView<AmpPayload>{data[6]});
+        amp_settings amp{};
+
+        if (decodedAmp.has_value() == true)
+        {
+            amp = decodedAmp.value();
+        }
+        else
+        {
+            skip();
+        }
+
+        std::array<fx_pedal_settings, 4> effects{{}};
+
+        for (std::size_t i = 2; i < 6; ++i)
+        {
+            const auto effect = tryDecodeEffectFromData(PacketView<EffectPayload>{data[i]});
+
+            if (effect.has_value() == true)
+            {
+                effects[effect.value().fx_slot] = effect.value();
+            }
+            else
+            {
+                skip();
+            }
+        }
+
+        return {SignalChain{name, amp, effects}, complete};
+    }
+
+    bool sameModel(const fx_pedal_settings& lhs, const fx_pedal_settings& rhs)
+    {
+        return std::tie(lhs.effect_num, lhs.position) == std::tie(rhs.effect_num, rhs.position);
+    }
+
+    bool sameKnobs(const fx_pedal_settings& lhs, const fx_pedal_settings& rhs)
+    {
+        return std::tie(lhs.knob1, lhs.knob2, lhs.knob3, lhs.knob4, lhs.knob5, lhs.knob6)
+                == std::tie(rhs.knob1, rhs.knob2, rhs.knob3, rhs.knob4, rhs.knob5, rhs.knob6);
+    }
+
+    bool sameAmp(const amp_settings& lhs, const amp_settings& rhs)
+    {
+        const auto values = [](const amp_settings& s) {
+            return std::tie(s.amp_num, s.gain, s.volume, s.treble, s.middle, s.bass, s.cabinet, s.noise_gate,
+                            s.master_vol, s.gain2, s.presence, s.threshold, s.depth, s.bias, s.sag, s.brightness);
+        };
+        return values(lhs) == values(rhs);
+    }
+
+    // Up to clear, amp, usb gain, four effects and apply
+    using Commands = FixedVector<PacketRawType, 8>;
+
+    // The same followed by save
+    using BankBurst = FixedVector<PacketRawType, 9>;
 
-        return SignalChain{name, amp, effects};
+
+    bool isEffect(const PacketRawType& packet)
+    {
+        const auto dsp = PacketView<EmptyPayload>{packet}.getHeader().findDSP();
+        return (dsp == DSP::effect0) || (dsp == DSP::effect1) || (dsp == DSP::effect2) || (dsp == DSP::effect3);
     }
 
-    std::vector<std::uint8_t> receivePacket(Connection& conn)
+    // Returns the packet size, 0 on timeout
+    std::size_t receivePacket(Connection& conn, PacketRawType& packet)
     {
-        return conn.receive(packetRawTypeSize);
+        return conn.receiveInto(packet);
     }
 
 
+    // Packets the amp sent on its own before the command are taken by
+    // listen() first; whatever arrives during the command counts as reply.
     void sendCommand(Connection& conn, const PacketRawType& packet)
     {
+        PacketRawType reply{};
         conn.send(packet);
-        receivePacket(conn);
+        receivePacket(conn, reply);
+    }
+
+    // Sends all packets back-to-back and collects the replies afterwards,
+    // instead of waiting a full round trip per packet. All packets are sent
+    // even if one fails; the first error is reported.
+    template <class Packets>
+    void sendCommands(Connection& conn, const Packets& packets)
+    {
+        std::exception_ptr error;
+        const auto attempt = [&error](auto&& operation) {
+            try
+            {
+                operation();
+            }
+            catch (...)
+            {
+                if (error == nullptr)
+                {
+                    error = std::current_exception();
+                }
+            }
+        };
+
+        std::for_each(packets.begin(), packets.end(), [&conn, &attempt](const auto& p) { attempt([&conn, &p] { conn.sendQueued(p); }); });
+        attempt([&conn] { conn.waitSent(); });
+        PacketRawType reply{};
+        std::for_each(packets.begin(), packets.end(), [&conn, &attempt, &reply](const auto&) { attempt([&conn, &reply] { receivePacket(conn, reply); }); });
+
+        if (error != nullptr)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+
+    void sendCommands(Connection& conn, std::initializer_list<PacketRawType> packets)
+    {
+        sendCommands<std::initializer_list<PacketRawType>>(conn, packets);
+    }
+
+    // Packets the amp sends beyond an expected response are dropped, so they
+    // can't be taken for the replies of the next command. The amp sends
+    // back-to-back, a short pause ends its response; at most as many packets
+    // as in the longest response are dropped.
+    inline constexpr std::chrono::milliseconds drainTimeout{10};
+    inline constexpr std::size_t drainLimit{BigAmpsV2::presetNamePacketCount + bankPacketCount};
+
+    void drainResponse(Connection& conn, Stats& stats)
+    {
+        PacketRawType packet{};
+
+        for (std::size_t i = 0; (i < drainLimit) && (conn.receiveInto(packet, drainTimeout) != 0); ++i)
+        {
+            stats.add(Counter::unknownPackets);
+        }
     }
 
-    void sendApplyCommand(Connection& conn)
+    // Reads packets until the response of count packets is complete, so
+    // reading stops on the last one instead of waiting for a timeout. An
+    // empty receive means the amp stopped sending early.
+    template <class Consumer>
+    void receiveResponse(Connection& conn, std::size_t count, Stats& stats, Consumer consume)
     {
-        sendCommand(conn, serializeApplyCommand().getBytes());
+        for (std::size_t received = 0; received < count; ++received)
+        {
+            PacketRawType packet{};
+
+            if (receivePacket(conn, packet) == 0)
+            {
+                return;
+            }
+            consume(packet);
+        }
+        drainResponse(conn, stats);
     }
 
-    std::array<PacketRawType, 7> loadBankData(Connection& conn, std::uint8_t slot)
+    std::tuple<std::array<PacketRawType, 7>, bool> loadBankData(Connection& conn, std::uint8_t slot, Stats& stats)
     {
         std::array<PacketRawType, 7> data{{}};
-    //printf("loadBankData: \n");
+        std::size_t i{0};
 
         const auto loadCommand = serializeLoadSlotCommand(slot);
-        auto n = conn.send(loadCommand.getBytes());
 
-        for (std::size_t i = 0; n != 0; ++i)
+        if (conn.send(loadCommand.getBytes()) != 0)
+        {
+            receiveResponse(conn, bankPacketCount, stats, [&data, &i](const auto& packet) { data[i++] = packet; });
+        }
+        return {data, (i == data.size())};
+    }
+
+
+    Header commandHeader(Type type, DSP dsp)
+    {
+        Header header{};
+        header.setStage(Stage::ready);
+        header.setType(type);
+        header.setDSP(dsp);
+        header.setUnknown(0x00, 0x01, 0x01);
+        return header;
+    }
+
+    // A packet received from a bank is sent back with the header of a
+    // command; the payload is kept as it is.
+    PacketRawType asCommand(const PacketRawType& received, const Header& header)
     {
-        //printf("i: %d ",static_cast<int>(i));
+        PacketRawType packet{received};
+        const auto bytes = header.getBytes();
+        std::copy(bytes.cbegin(), bytes.cend(), packet.begin());
+        return packet;
+    }
+
 
-        const auto recvData = receivePacket(conn);
-        n = recvData.size();
-        //printf("n: %d ",static_cast<int>(n));
+    // Names are sent in every second packet
+    void reportPresetName(const std::vector<PacketRawType>& received, std::size_t namePacketCount, const PresetNameCallback& callback)
+    {
+        const std::size_t index = received.size() - 1;
 
-        if (i < 7)
+        if ((index < namePacketCount) && (index % 2 == 0))
         {
-            std::copy(recvData.cbegin(), recvData.cend(), data[i].begin());
+            callback(static_cast<std::uint8_t>(index / 2), decodeNameFromData(PacketView<NamePayload>{received[index]}));
         }
     }
-        return data;
+
+    template <class Protocol>
+    void checkSupported(const amp_settings& amp)
+    {
+        if (Protocol::supports(amp.amp_num) == false)
+        {
+            throw std::invalid_argument{"Amp not supported by the device: " + std::to_string(value(amp.amp_num))};
+        }
     }
 
+    template <class Protocol>
+    void checkSupported(const fx_pedal_settings& effect)
+    {
+        if (Protocol::supports(effect.effect_num) == false)
+        {
+            throw std::invalid_argument{"Effect not supported by the device: " + std::to_string(value(effect.effect_num))};
+        }
+    }
 
-    Mustang::Mustang(std::shared_ptr<Connection> connection)
-        : conn(connection)
+    template <class Protocol>
+    void checkBank(std::uint8_t slot)
     {
+        if (slot >= Protocol::bankCount)
+        {
+            throw std::invalid_argument{"Invalid memory bank: " + std::to_string(slot)};
+        }
     }
 
-    InitalData Mustang::start_amp()
+
+    enum class Received
+    {
+        changed,
+        unchanged,
+        unknown
+    };
+
+    // Updates the state from a packet sent by the amp on its own. Stale
+    // replies leave it unchanged.
+    Received applyReceivedPacket(SignalChain& state, const PacketRawType& packet)
+    {
+        const auto header = PacketView<EmptyPayload>{packet}.getHeader();
+
+        if (header.getStage() != Stage::ready)
+        {
+            return Received::unchanged;
+        }
+
+        const auto type = header.findType();
+        const auto dsp = header.findDSP();
+
+        if ((type.has_value() == false) || (dsp.has_value() == false))
+        {
+            return Received::unknown;
+        }
+
+        if ((type == Type::operation) && (dsp == DSP::opSave))
+        {
+            state.setName(decodeNameFromData(PacketView<NamePayload>{packet}));
+            return Received::changed;
+        }
+
+        if (type != Type::data)
+        {
+            return Received::unchanged;
+        }
+
+        switch (*dsp)
+        {
+            case DSP::amp:
+            {
+                const PacketView<AmpPayload> view{packet};
+                const auto decoded = tryDecodeAmpFromData(view, view);
+
+                if (decoded.has_value() == false)
+                {
+                    return Received::unknown;
+                }
+                auto amp = decoded.value();
+                amp.usb_gain = state.amp().usb_gain;
+                state.setAmp(amp);
+                return Received::changed;
+            }
+            case DSP::usbGain:
+            {
+                auto amp = state.amp();
+                amp.usb_gain = PacketView<AmpPayload>{packet}.getPayload().getUsbGain();
+                state.setAmp(amp);
+                return Received::changed;
+            }
+            case DSP::effect0:
+            case DSP::effect1:
+            case DSP::effect2:
+            case DSP::effect3:
+            {
+                const auto decoded = tryDecodeEffectFromData(PacketView<EffectPayload>{packet});
+
+                if (decoded.has_value() == false)
+                {
+                    return Received::unknown;
+                }
+                const auto& effect = decoded.value();
+                auto fxSettings = state.effects();
+                fxSettings[effect.fx_slot] = effect;
+                state.setEffects(fxSettings);
+                return Received::changed;
+            }
+            default:
+                return Received::unchanged;
+        }
+    }
+
+
+    template <class Protocol>
+    BasicMustang<Protocol>::BasicMustang(std::shared_ptr<Connection> connection)
+        : conn(connection), stats(conn->stats() != nullptr ? conn->stats() : std::make_shared<Stats>())
+    {
+    }
+
+    template <class Protocol>
+    InitalData BasicMustang<Protocol>::start_amp(const PresetNameCallback& onPresetName)
     {
         if (conn->isOpen() == false)
         {
             throw CommunicationException{"Device not connected"};
         }
 
+        const auto timer = stats->measure(Operation::startAmp);
+        listen();
         initializeAmp();
 
-        return loadData();
+        return loadData(onPresetName);
     }
 
-    void Mustang::stop_amp()
+    template <class Protocol>
+    void BasicMustang<Protocol>::stop_amp()
     {
+        shadow.reset();
         conn->close();
     }
 
-    void Mustang::set_effect(fx_pedal_settings value)
+    // Only the packets needed to get from the last known device state to the
+    // new one are sent; the state is forgotten if a command fails.
+    template <class Protocol>
+    void BasicMustang<Protocol>::set_effect(fx_pedal_settings value)
     {
-        const auto clearEffectPacket = serializeClearEffectSettings();
-        sendCommand(*conn, clearEffectPacket.getBytes());
-        sendApplyCommand(*conn);
-        printf("mustang::set_effect: \n");
+        checkSupported<Protocol>(value);
+        listen();
+        const std::size_t index = value.fx_slot % 4;
+        auto current = (shadow.has_value() == true ? std::optional<fx_pedal_settings>{shadow->effects()[index]} : std::nullopt);
+
+        if (current.has_value() == true)
+        {
+            const bool bothEmpty = (current->effect_num == effects::EMPTY) && (value.effect_num == effects::EMPTY);
+
+            if ((bothEmpty == true) || ((sameModel(*current, value) == true) && (sameKnobs(*current, value) == true)))
+            {
+                return;
+            }
+        }
+
+        const auto timer = stats->measure(Operation::setEffect);
+        const auto clearEffectPacket = serializeClearEffectSettings().getBytes();
+        const auto applyPacket = serializeApplyCommand().getBytes();
+        Commands packets;
+
+        if ((current.has_value() == false) || (sameModel(*current, value) == false))
+        {
+            packets.push_back(clearEffectPacket);
+            packets.push_back(applyPacket);
+        }
         if (value.effect_num != effects::EMPTY)
         {
-            const auto settingsPacket = serializeEffectSettings(value);
-            sendCommand(*conn, settingsPacket.getBytes());
-            sendApplyCommand(*conn);
+            packets.push_back(serializeEffectSettings(value).getBytes());
+            packets.push_back(applyPacket);
+        }
+
+        auto state = std::exchange(shadow, std::nullopt);
+        sendCommands(*conn, packets);
+
+        if (state.has_value() == true)
+        {
+            auto effects = state->effects();
+            effects[index] = value;
+            effects[index].fx_slot = static_cast<std::uint8_t>(index);
+            state->setEffects(effects);
+            shadow = std::move(state);
+        }
+    }
+
+    template <class Protocol>
+    void BasicMustang<Protocol>::set_amplifier(amp_settings value)
+    {
+        checkSupported<Protocol>(value);
+        listen();
+        const bool ampChanged = (shadow.has_value() == false) || (sameAmp(shadow->amp(), value) == false);
+        const bool usbGainChanged = (shadow.has_value() == false) || (shadow->amp().usb_gain != value.usb_gain);
+        const auto applyPacket = serializeApplyCommand().getBytes();
+        Commands packets;
+
+        if (ampChanged == true)
+        {
+            packets.push_back(serializeAmpSettings(value).getBytes());
+            packets.push_back(applyPacket);
+        }
+        if (usbGainChanged == true)
+        {
+            packets.push_back(serializeAmpSettingsUsbGain(value).getBytes());
+            packets.push_back(applyPacket);
+        }
+        if (packets.empty() == true)
+        {
+            return;
+        }
+
+        const auto timer = stats->measure(Operation::setAmplifier);
+        auto state = std::exchange(shadow, std::nullopt);
+        sendCommands(*conn, packets);
+
+        if (state.has_value() == true)
+        {
+            state->setAmp(value);
+            shadow = std::move(state);
         }
     }
 
-    void Mustang::set_amplifier(amp_settings value)
+    // Sends the whole chain as one burst with a single apply at the end. After
+    // a clear all effects are sent, whatever it did to the other slots.
+    template <class Protocol>
+    void BasicMustang<Protocol>::applyChain(const SignalChain& chain)
     {
-        const auto settingsPacket = serializeAmpSettings(value);
-        sendCommand(*conn, settingsPacket.getBytes());
-        sendApplyCommand(*conn);
+        const auto chainEffects = chain.effects();
+        checkSupported<Protocol>(chain.amp());
+        std::for_each(chainEffects.cbegin(), chainEffects.cend(), [](const auto& effect) { checkSupported<Protocol>(effect); });
+        const auto timer = stats->measure(Operation::applyChain);
+        listen();
+        std::array<fx_pedal_settings, 4> fxSettings{{}};
+        std::for_each(fxSettings.begin(), fxSettings.end(), [i = std::uint8_t{0}](auto& effect) mutable { effect.fx_slot = i++; });
+
+        for (const auto& effect : chainEffects)
+        {
+            const std::size_t index = effect.fx_slot % 4;
+            fxSettings[index] = effect;
+            fxSettings[index].fx_slot = static_cast<std::uint8_t>(index);
+        }
+
+        const auto current = (shadow.has_value() == true ? shadow->effects() : std::array<fx_pedal_settings, 4>{{}});
+        const bool clear = (shadow.has_value() == false) || std::any_of(fxSettings.cbegin(), fxSettings.cend(), [&current](const auto& effect) {
+                               return sameModel(current[effect.fx_slot], effect) == false;
+                           });
+        const amp_settings amp = chain.amp();
+        Commands packets;
 
-        const auto settingsGainPacket = serializeAmpSettingsUsbGain(value);
-        sendCommand(*conn, settingsGainPacket.getBytes());
-        sendApplyCommand(*conn);
+        if (clear == true)
+        {
+            packets.push_back(serializeClearEffectSettings().getBytes());
+        }
+        if ((shadow.has_value() == false) || (sameAmp(shadow->amp(), amp) == false))
+        {
+            packets.push_back(serializeAmpSettings(amp).getBytes());
+        }
+        if ((shadow.has_value() == false) || (shadow->amp().usb_gain != amp.usb_gain))
+        {
+            packets.push_back(serializeAmpSettingsUsbGain(amp).getBytes());
+        }
+        for (const auto& effect : fxSettings)
+        {
+            const bool changed = (clear == true) || (sameKnobs(current[effect.fx_slot], effect) == false);
+
+            if ((effect.effect_num != effects::EMPTY) && (changed == true))
+            {
+                packets.push_back(serializeEffectSettings(effect).getBytes());
+            }
+        }
+        if (packets.empty() == true)
+        {
+            return;
+        }
+        packets.push_back(serializeApplyCommand().getBytes());
+
+        shadow.reset();
+        sendCommands(*conn, packets);
+        shadow = SignalChain{chain.name(), amp, fxSettings};
     }
 
-    void Mustang::save_on_amp(std::string_view name, std::uint8_t slot)
+    template <class Protocol>
+    void BasicMustang<Protocol>::save_on_amp(std::string_view name, std::uint8_t slot)
     {
-        printf("mustang::saveonamp:\n");
+        checkBank<Protocol>(slot);
+        const auto timer = stats->measure(Operation::saveOnAmp);
+        listen();
         const auto data = serializeName(slot, name).getBytes();
+        shadow.reset();
         sendCommand(*conn, data);
-        loadBankData(*conn, slot);
+        const auto [bank, complete] = loadBankData(*conn, slot, *stats);
+
+        if (const auto decoded = decode_data(bank.cbegin(), *stats); (complete == true) && (decoded.complete == true))
+        {
+            shadow = decoded.chain;
+        }
     }
 
-    SignalChain Mustang::load_memory_bank(std::uint8_t slot)
+    template <class Protocol>
+    SignalChain BasicMustang<Protocol>::load_memory_bank(std::uint8_t slot)
     {
-        return decode_data(loadBankData(*conn, slot));
+        checkBank<Protocol>(slot);
+        const auto timer = stats->measure(Operation::loadMemoryBank);
+        listen();
+        shadow.reset();
+        const auto [data, complete] = loadBankData(*conn, slot, *stats);
+        const auto decoded = decode_data(data.cbegin(), *stats);
+
+        if ((complete == true) && (decoded.complete == true))
+        {
+            shadow = decoded.chain;
+        }
+        return decoded.chain;
     }
 
-    void Mustang::save_effects(std::uint8_t slot, std::string_view name, const std::vector<fx_pedal_settings>& effects)
+    template <class Protocol>
+    void BasicMustang<Protocol>::save_effects(std::uint8_t slot, std::string_view name, Span<fx_pedal_settings> effects)
     {
-        printf("mustang::save_effects:\n");
+        std::for_each(effects.begin(), effects.end(), [](const auto& effect) { checkSupported<Protocol>(effect); });
+        listen();
+        shadow.reset();
         const auto saveNamePacket = serializeSaveEffectName(slot, name, effects);
-        sendCommand(*conn, saveNamePacket.getBytes());
-
         const auto packets = serializeSaveEffectPacket(slot, effects);
-        std::for_each(packets.cbegin(), packets.cend(), [this](const auto& p) { sendCommand(*conn, p.getBytes()); });
 
-        sendCommand(*conn, serializeApplyCommand(effects[0]).getBytes());
+        Commands data;
+        data.push_back(saveNamePacket.getBytes());
+        std::for_each(packets.begin(), packets.end(), [&data](const auto& p) { data.push_back(p.getBytes()); });
+        data.push_back(serializeApplyCommand(effects[0]).getBytes());
+
+        sendCommands(*conn, data);
     }
 
-    InitalData Mustang::loadData()
+    template <class Protocol>
+    std::optional<SignalChain> BasicMustang<Protocol>::current_state() const
     {
-        std::vector<std::array<std::uint8_t, 64>> recieved_data;
+        return shadow;
+    }
 
-        const auto loadCommand = serializeLoadCommand();
-        auto recieved = conn->send(loadCommand.getBytes());
+    template <class Protocol>
+    BankImage BasicMustang<Protocol>::loadBankImage(std::uint8_t slot)
+    {
+        checkBank<Protocol>(slot);
+        const auto timer = stats->measure(Operation::loadMemoryBank);
+        listen();
+        shadow.reset();
+        const auto [data, complete] = loadBankData(*conn, slot, *stats);
 
-        while (recieved != 0)
+        if (complete == false)
         {
-            const auto recvData = receivePacket(*conn);
-            recieved = recvData.size();
-            PacketRawType p{};
-            std::copy(recvData.cbegin(), recvData.cend(), p.begin());
-            recieved_data.push_back(p);
+            throw CommunicationException{"Incomplete memory bank: " + std::to_string(slot)};
         }
 
-        const std::size_t max_to_receive = (recieved_data.size() > 143 ? 200 : 48);
-        std::vector<Packet<NamePayload>> presetListData;
-        presetListData.reserve(max_to_receive);
-        std::transform(recieved_data.cbegin(), std::next(recieved_data.cbegin(), max_to_receive), std::back_inserter(presetListData), [](const auto& p) {
-            Packet<NamePayload> packet{};
-            packet.fromBytes(p);
-            return packet;
+        if (const auto decoded = decode_data(data.cbegin(), *stats); decoded.complete == true)
+        {
+            shadow = decoded.chain;
+        }
+        return data;
+    }
+
+    // Effects are sent for their slots only, empty ones are left cleared like
+    // in applyChain(). The models are checked on the decoded image.
+    template <class Protocol>
+    void BasicMustang<Protocol>::writeBankImage(std::uint8_t slot, const BankImage& image)
+    {
+        checkBank<Protocol>(slot);
+        const auto decoded = decode_data(image.cbegin(), *stats);
+
+        if (decoded.complete == false)
+        {
+            throw std::invalid_argument{"Invalid image of memory bank: " + std::to_string(slot)};
+        }
+
+        const auto decodedEffects = decoded.chain.effects();
+        checkSupported<Protocol>(decoded.chain.amp());
+        std::for_each(decodedEffects.cbegin(), decodedEffects.cend(), [](const auto& effect) { checkSupported<Protocol>(effect); });
+        const auto timer = stats->measure(Operation::writeBank);
+        listen();
+
+        auto saveHeader = commandHeader(Type::operation, DSP::opSave);
+        saveHeader.setSlot(slot);
+
+        BankBurst packets;
+        packets.push_back(serializeClearEffectSettings().getBytes());
+        packets.push_back(asCommand(image[1], commandHeader(Type::data, DSP::amp)));
+        packets.push_back(asCommand(image[6], commandHeader(Type::data, DSP::usbGain)));
+        std::for_each(std::next(image.cbegin(), 2), std::next(image.cbegin(), 6), [&packets](const auto& packet) {
+            if (isEffect(packet) == true)
+            {
+                packets.push_back(asCommand(packet, commandHeader(Type::data, PacketView<EmptyPayload>{packet}.getHeader().getDSP())));
+            }
         });
-        auto presetNames = decodePresetListFromData(presetListData);
+        packets.push_back(serializeApplyCommand().getBytes());
+        packets.push_back(asCommand(image[0], saveHeader));
+
+        shadow.reset();
+        sendCommands(*conn, packets);
+        shadow = decoded.chain;
+    }
 
-        std::array<PacketRawType, 7> presetData{{}};
-        std::copy(std::next(recieved_data.cbegin(), max_to_receive), std::next(recieved_data.cbegin(), max_to_receive + 7), presetData.begin());
+    template <class Protocol>
+    std::shared_ptr<Stats> BasicMustang<Protocol>::statistics() const
+    {
+        return stats;
+    }
 
-        return {decode_data(presetData), presetNames};
+    template <class Protocol>
+    void BasicMustang<Protocol>::subscribe(StateListener listener)
+    {
+        listeners.push_back(std::move(listener));
     }
 
-    void Mustang::initializeAmp()
+    template <class Protocol>
+    void BasicMustang<Protocol>::listen()
     {
-        const auto packets = serializeInitCommand();
-        std::for_each(packets.cbegin(), packets.cend(), [this](const auto& p) { sendCommand(*conn, p.getBytes()); });
+        const auto received = conn->takeReceived();
+
+        if ((received.empty() == true) || (shadow.has_value() == false))
+        {
+            return;
+        }
+
+        bool changed{false};
+
+        for (const auto& data : received)
+        {
+            PacketRawType packet{};
+            std::copy_n(data.cbegin(), std::min(data.size(), packet.size()), packet.begin());
+            const auto result = applyReceivedPacket(*shadow, packet);
+
+            if (result == Received::unknown)
+            {
+                stats->add(Counter::unknownPackets);
+            }
+            changed = ((result == Received::changed) || changed);
+        }
+
+        if (changed == true)
+        {
+            std::for_each(listeners.cbegin(), listeners.cend(), [this](const auto& listener) { listener(*shadow); });
+        }
+    }
+
+    template <class Protocol>
+    InitalData BasicMustang<Protocol>::loadData(const PresetNameCallback& onPresetName)
+    {
+        constexpr std::size_t max_to_receive{Protocol::presetNamePacketCount};
+        std::vector<PacketRawType> recieved_data;
+
+        shadow.reset();
+        const auto loadCommand = serializeLoadCommand();
+
+        if (conn->send(loadCommand.getBytes()) != 0)
+        {
+            recieved_data.reserve(max_to_receive + bankPacketCount);
+            receiveResponse(*conn, max_to_receive + bankPacketCount, *stats, [&recieved_data, &onPresetName](const auto& packet) {
+                recieved_data.push_back(packet);
+
+                if (onPresetName != nullptr)
+                {
+                    reportPresetName(recieved_data, max_to_receive, onPresetName);
+                }
+            });
+        }
+
+        const bool complete = (recieved_data.size() >= max_to_receive + bankPacketCount);
+        recieved_data.resize(std::max(recieved_data.size(), max_to_receive + bankPacketCount));
+
+        auto presetNames = decodePresetListFromData(recieved_data, max_to_receive);
+        const auto decoded = decode_data(std::next(recieved_data.cbegin(), max_to_receive), *stats);
+
+        if ((complete == true) && (decoded.complete == true))
+        {
+            shadow = decoded.chain;
+        }
+        return {decoded.chain, presetNames};
+    }
+
+    template <class Protocol>
+    void BasicMustang<Protocol>::initializeAmp()
+    {
+        const auto [initPacket0, initPacket1] = serializeInitCommand();
+        sendCommands(*conn, {initPacket0.getBytes(), initPacket1.getBytes()});
+    }
+
+
+    template class BasicMustang<SmallAmpsV1>;
+    template class BasicMustang<BigAmpsV1>;
+    template class BasicMustang<SmallAmpsV2>;
+    template class BasicMustang<BigAmpsV2>;
+
+
+    std::unique_ptr<Mustang> createMustang(std::shared_ptr<Connection> connection, ProtocolKind protocol)
+    {
+        switch (protocol)
+        {
+            case ProtocolKind::smallAmpsV1:
+                return std::make_unique<BasicMustang<SmallAmpsV1>>(connection);
+            case ProtocolKind::bigAmpsV1:
+                return std::make_unique<BasicMustang<BigAmpsV1>>(connection);
+            case ProtocolKind::smallAmpsV2:
+                return std::make_unique<BasicMustang<SmallAmpsV2>>(connection);
+            case ProtocolKind::bigAmpsV2:
+                return std::make_unique<BasicMustang<BigAmpsV2>>(connection);
+        }
+        throw std::invalid_argument{"Invalid protocol"};
     }
 }
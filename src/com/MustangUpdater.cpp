@@ -20,14 +20,16 @@
  */
 
 #include "com/MustangUpdater.h"
-#include "com/MustangConstants.h"
-#include "com/Mustang.h"
+#include "com/UsbComm.h"
+#include "com/CommunicationException.h"
 #include "com/Packet.h"
-#include <chrono>
-#include <cstdio>
-#include <cstring>
+#include <algorithm>
+#include <initializer_list>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
-#include <libusb-1.0/libusb.h>
 
 namespace plug::com
 {
@@ -41,134 +43,156 @@ namespace plug::com
         inline constexpr std::uint16_t FLOOR_USB_UPDATE_PID{0x0013};         //Mustang Floor
         inline constexpr std::uint16_t SMALL_AMPS_V2_USB_UPDATE_PID{0x0015}; //Mustang I & II V2
         inline constexpr std::uint16_t BIG_AMPS_V2_USB_UPDATE_PID{0x0017};   //Mustang III+ V2
-    }
 
-    namespace
-    {
-        void closeUsb(libusb_device_handle* handle)
+        inline constexpr std::initializer_list<std::uint16_t> updatePids{
+            SMALL_AMPS_USB_UPDATE_PID,
+            BIG_AMPS_USB_UPDATE_PID,
+            SMALL_AMPS_V2_USB_UPDATE_PID,
+            BIG_AMPS_V2_USB_UPDATE_PID,
+            MINI_USB_UPDATE_PID,
+            FLOOR_USB_UPDATE_PID};
+
+        inline constexpr std::size_t chunkSize{packetRawTypeSize - 8};
+
+
+        PacketRawType datePacket(const FirmwareImage& image)
         {
-            if (handle != nullptr)
-            {
-                const int ret = libusb_release_interface(handle, 0);
+            PacketRawType packet{};
+            packet[0] = 0x02;
+            packet[1] = 0x03;
+            packet[2] = 0x01;
+            packet[3] = 0x06;
+            std::copy_n(image.date(), FirmwareImage::dateSize, std::next(packet.begin(), 4));
+            return packet;
+        }
 
-                if (ret != LIBUSB_ERROR_NO_DEVICE)
-                {
-                    libusb_attach_kernel_driver(handle, 0);
-                }
+        // The counter wraps around, only its lowest byte is sent
+        PacketRawType chunkPacket(const FirmwareImage& image, std::size_t chunk)
+        {
+            const std::size_t offset = chunk * chunkSize;
+            const std::size_t size = std::min(chunkSize, image.firmwareSize() - offset);
+            PacketRawType packet{};
+            packet[0] = 0x03;
+            packet[1] = 0x03;
+            packet[2] = static_cast<std::uint8_t>(chunk);
+            packet[3] = static_cast<std::uint8_t>(size);
+            std::copy_n(std::next(image.firmware(), static_cast<std::ptrdiff_t>(offset)), size, std::next(packet.begin(), 4));
+            return packet;
+        }
 
-                libusb_close(handle);
-                libusb_exit(nullptr);
-            }
+        PacketRawType finishedPacket()
+        {
+            PacketRawType packet{};
+            packet[0] = 0x04;
+            packet[1] = 0x03;
+            return packet;
         }
 
+        void awaitAcknowledge(Connection& conn)
+        {
+            PacketRawType reply{};
 
-        inline constexpr std::chrono::milliseconds timeout{500};
-        inline constexpr std::size_t sizeOfPacket = packetRawTypeSize;
+            if (conn.receiveInto(reply) == 0)
+            {
+                throw CommunicationException{"Firmware update not acknowledged"};
+            }
+        }
     }
 
 
-    int updateFirmware(const char* filename)
+    FirmwareImage::FirmwareImage(const std::string& filename)
+        : data(nullptr), size(0)
     {
-        // initialize libusb
-        int ret = libusb_init(nullptr);
-        if (ret != 0)
-        {
-            return ret;
-        }
+        const int fd = ::open(filename.c_str(), O_RDONLY);
 
-        // get handle for the device
-        libusb_device_handle* amp_hand = libusb_open_device_with_vid_pid(nullptr, USB_UPDATE_VID, SMALL_AMPS_USB_UPDATE_PID);
-        if (amp_hand == nullptr)
+        if (fd < 0)
         {
-            amp_hand = libusb_open_device_with_vid_pid(nullptr, USB_UPDATE_VID, BIG_AMPS_USB_UPDATE_PID);
-            if (amp_hand == nullptr)
-            {
-                amp_hand = libusb_open_device_with_vid_pid(nullptr, USB_UPDATE_VID, SMALL_AMPS_V2_USB_UPDATE_PID);
-                if (amp_hand == nullptr)
-                {
-                    amp_hand = libusb_open_device_with_vid_pid(nullptr, USB_UPDATE_VID, BIG_AMPS_V2_USB_UPDATE_PID);
-                    if (amp_hand == nullptr)
-                    {
-                        amp_hand = libusb_open_device_with_vid_pid(nullptr, USB_UPDATE_VID, MINI_USB_UPDATE_PID);
-                        if (amp_hand == nullptr)
-                        {
-                            amp_hand = libusb_open_device_with_vid_pid(nullptr, USB_UPDATE_VID, FLOOR_USB_UPDATE_PID);
-                            if (amp_hand == nullptr)
-                            {
-                                libusb_exit(nullptr);
-                                return -100;
-                            }
-                        }
-                    }
-                }
-            }
+            throw std::invalid_argument{"Can't open firmware file: " + filename};
         }
 
-        // detach kernel driver
-        ret = libusb_kernel_driver_active(amp_hand, 0);
-        if (ret != 0)
+        struct stat info{};
+        const bool valid = (::fstat(fd, &info) == 0) && (static_cast<std::size_t>(info.st_size) > firmwareOffset);
+
+        if (valid == false)
         {
-            ret = libusb_detach_kernel_driver(amp_hand, 0);
-            if (ret != 0)
-            {
-                closeUsb(amp_hand);
-                return ret;
-            }
+            ::close(fd);
+            throw std::invalid_argument{"Not a firmware file: " + filename};
         }
 
-        // claim the device
-        ret = libusb_claim_interface(amp_hand, 0);
-        if (ret != 0)
+        size = static_cast<std::size_t>(info.st_size);
+        void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+
+        if (mapping == MAP_FAILED)
         {
-            closeUsb(amp_hand);
-            return ret;
+            throw std::invalid_argument{"Can't map firmware file: " + filename};
         }
 
-        FILE* file = fopen(filename, "rb");
-        // send date when firmware was created
-        fseek(file, 0x1a, SEEK_SET);
-        unsigned char array[sizeOfPacket];
-        memset(array, 0x00, sizeOfPacket);
-        array[0] = 0x02;
-        array[1] = 0x03;
-        array[2] = 0x01;
-        array[3] = 0x06;
-        [[maybe_unused]] const auto n = fread(array + 4, 1, 11, file);
-        int recieved{0};
-        ret = libusb_interrupt_transfer(amp_hand, 0x01, array, sizeOfPacket, &recieved, timeout.count());
-        libusb_interrupt_transfer(amp_hand, 0x81, array, sizeOfPacket, &recieved, timeout.count());
-        usleep(10000);
-
-        // send firmware
-        fseek(file, 0x110, SEEK_SET);
-        for (;;)
+        ::madvise(mapping, size, MADV_SEQUENTIAL);
+        data = static_cast<const std::uint8_t*>(mapping);
+    }
+
+    FirmwareImage::~FirmwareImage()
+    {
+        ::munmap(const_cast<std::uint8_t*>(data), size);
+    }
+
+    const std::uint8_t* FirmwareImage::date() const
+    {
+        return std::next(data, dateOffset);
+    }
+
+    const std::uint8_t* FirmwareImage::firmware() const
+    {
+        return std::next(data, firmwareOffset);
+    }
+
+    std::size_t FirmwareImage::firmwareSize() const
+    {
+        return size - firmwareOffset;
+    }
+
+
+    void updateFirmware(Connection& conn, const FirmwareImage& image, const UpdateProgressCallback& onProgress)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const std::size_t total = image.firmwareSize();
+        const std::size_t chunks = (total + chunkSize - 1) / chunkSize;
+
+        conn.discardReceived();
+        conn.send(datePacket(image));
+        awaitAcknowledge(conn);
+
+        std::size_t sent{0};
+        std::size_t acknowledged{0};
+
+        while (acknowledged < chunks)
         {
-            memset(array, 0x00, sizeOfPacket);
-            unsigned char number{0};
-            array[0] = array[1] = 0x03;
-            array[2] = number;
-            ++number;
-            array[3] = static_cast<std::uint8_t>(fread(array + 4, 1, sizeOfPacket - 8, file));
-            ret = libusb_interrupt_transfer(amp_hand, 0x01, array, sizeOfPacket, &recieved, timeout.count());
-            libusb_interrupt_transfer(amp_hand, 0x81, array, sizeOfPacket, &recieved, timeout.count());
-            usleep(10000);
-
-            if (feof(file) != 0) // if reached end of the file
+            for (; (sent < chunks) && (sent - acknowledged < updateWindowSize); ++sent)
             {
-                break; // exit loop
+                conn.sendQueued(chunkPacket(image, sent));
             }
-        }
-        fclose(file);
 
-        // send "finished" packet
-        memset(array, 0x00, sizeOfPacket);
-        array[0] = 0x04;
-        array[1] = 0x03;
-        libusb_interrupt_transfer(amp_hand, 0x01, array, sizeOfPacket, &recieved, timeout.count());
-        libusb_interrupt_transfer(amp_hand, 0x81, array, sizeOfPacket, &recieved, timeout.count());
+            awaitAcknowledge(conn);
+            ++acknowledged;
 
-        closeUsb(amp_hand);
+            if (onProgress != nullptr)
+            {
+                onProgress(UpdateProgress{std::min(acknowledged * chunkSize, total), total, std::chrono::steady_clock::now() - start});
+            }
+        }
+        conn.waitSent();
 
-        return 0;
+        // The amp may restart right away, so there's no acknowledgement to wait for
+        conn.send(finishedPacket());
+    }
+
+    void updateFirmware(const std::string& filename, const UpdateProgressCallback& onProgress)
+    {
+        const FirmwareImage image{filename};
+        UsbComm conn;
+        conn.openFirst(USB_UPDATE_VID, updatePids);
+        updateFirmware(conn, image, onProgress);
+        conn.close();
     }
 }
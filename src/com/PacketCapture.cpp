@@ -0,0 +1,224 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "com/PacketCapture.h"
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <string>
+
+namespace plug::com
+{
+    namespace
+    {
+        inline constexpr std::array<char, 4> magic{{'P', 'L', 'G', 'C'}};
+        inline constexpr std::uint8_t version{1};
+        inline constexpr std::size_t maxPacketSize{64};
+
+        inline constexpr std::uint8_t endpointSend{0x01};
+        inline constexpr std::uint8_t endpointRecv{0x81};
+
+
+        template <class T>
+        void writeValue(std::ostream& os, T value)
+        {
+            for (std::size_t i = 0; i < sizeof(T); ++i)
+            {
+                os.put(static_cast<char>((static_cast<std::uint64_t>(value) >> (8 * i)) & 0xff));
+            }
+        }
+
+        template <class T>
+        T readValue(std::istream& is)
+        {
+            std::uint64_t value{0};
+
+            for (std::size_t i = 0; i < sizeof(T); ++i)
+            {
+                const auto c = is.get();
+
+                if (c == std::istream::traits_type::eof())
+                {
+                    throw std::runtime_error{"Truncated capture"};
+                }
+                value |= (static_cast<std::uint64_t>(c & 0xff) << (8 * i));
+            }
+            return static_cast<T>(value);
+        }
+
+        void writePadding(std::ostream& os, std::size_t size)
+        {
+            for (std::size_t i = size; i % 4 != 0; ++i)
+            {
+                os.put(0);
+            }
+        }
+
+        std::uint32_t padded(std::size_t size)
+        {
+            return static_cast<std::uint32_t>((size + 3) & ~std::size_t{3});
+        }
+
+        // Linux usbmon header (LINKTYPE_USB_LINUX_MMAPPED), 64 bytes
+        void writeUsbmonHeader(std::ostream& os, std::uint64_t id, const CapturedPacket& packet, std::chrono::nanoseconds timestamp)
+        {
+            const bool out = (packet.direction == Direction::out);
+            const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(timestamp);
+            const auto micros = std::chrono::duration_cast<std::chrono::microseconds>(timestamp - seconds);
+            const auto size = static_cast<std::uint32_t>(packet.data.size());
+
+            writeValue<std::uint64_t>(os, id);
+            writeValue<std::uint8_t>(os, out ? 'S' : 'C');
+            writeValue<std::uint8_t>(os, 1); // Interrupt transfer
+            writeValue<std::uint8_t>(os, out ? endpointSend : endpointRecv);
+            writeValue<std::uint8_t>(os, 1);  // Device number
+            writeValue<std::uint16_t>(os, 1); // Bus number
+            writeValue<std::uint8_t>(os, '-');
+            writeValue<std::uint8_t>(os, 0); // Data present
+            writeValue<std::int64_t>(os, seconds.count());
+            writeValue<std::int32_t>(os, static_cast<std::int32_t>(micros.count()));
+            writeValue<std::int32_t>(os, 0); // Status
+            writeValue<std::uint32_t>(os, out ? size : static_cast<std::uint32_t>(maxPacketSize));
+            writeValue<std::uint32_t>(os, size);
+            writeValue<std::uint64_t>(os, 0); // Setup
+            writeValue<std::int32_t>(os, 1);  // Interval
+            writeValue<std::int32_t>(os, 0);  // Start frame
+            writeValue<std::uint32_t>(os, 0); // Transfer flags
+            writeValue<std::uint32_t>(os, 0); // Iso descriptors
+        }
+    }
+
+
+    CaptureWriter::CaptureWriter(std::ostream& stream)
+        : os(stream), start(std::chrono::steady_clock::now())
+    {
+        const auto wallClock = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch());
+
+        os.write(magic.data(), magic.size());
+        writeValue<std::uint8_t>(os, version);
+        writeValue<std::int64_t>(os, wallClock.count());
+        os.flush();
+    }
+
+    void CaptureWriter::write(Direction direction, const std::uint8_t* data, std::size_t size)
+    {
+        const auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        const auto length = std::min(size, maxPacketSize);
+
+        std::lock_guard<std::mutex> lock{mutex};
+        writeValue<std::int64_t>(os, time.count());
+        writeValue<std::uint8_t>(os, static_cast<std::uint8_t>(direction));
+        writeValue<std::uint8_t>(os, static_cast<std::uint8_t>(length));
+        os.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(length));
+        os.flush();
+    }
+
+
+    Capture readCapture(std::istream& stream)
+    {
+        std::array<char, 4> header{{}};
+        stream.read(header.data(), header.size());
+
+        if ((stream.gcount() != static_cast<std::streamsize>(header.size())) || (header != magic) || (readValue<std::uint8_t>(stream) != version))
+        {
+            throw std::runtime_error{"Invalid capture"};
+        }
+
+        Capture capture;
+        capture.start = std::chrono::system_clock::time_point{std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds{readValue<std::int64_t>(stream)})};
+
+        while (stream.peek() != std::istream::traits_type::eof())
+        {
+            CapturedPacket packet;
+            packet.time = std::chrono::nanoseconds{readValue<std::int64_t>(stream)};
+            const auto direction = readValue<std::uint8_t>(stream);
+
+            if (direction > static_cast<std::uint8_t>(Direction::in))
+            {
+                throw std::runtime_error{"Invalid capture"};
+            }
+            packet.direction = static_cast<Direction>(direction);
+            packet.data.resize(readValue<std::uint8_t>(stream));
+            stream.read(reinterpret_cast<char*>(packet.data.data()), static_cast<std::streamsize>(packet.data.size()));
+
+            if (stream.gcount() != static_cast<std::streamsize>(packet.data.size()))
+            {
+                throw std::runtime_error{"Truncated capture"};
+            }
+            capture.packets.push_back(std::move(packet));
+        }
+
+        return capture;
+    }
+
+    void exportPcapng(const Capture& capture, std::ostream& stream)
+    {
+        constexpr std::uint32_t sectionHeaderLength{28};
+        constexpr std::uint32_t interfaceLength{32};
+        constexpr std::uint16_t linkTypeUsbmon{220};
+        constexpr std::uint32_t usbmonHeaderSize{64};
+
+        // Section header block
+        writeValue<std::uint32_t>(stream, 0x0a0d0d0a);
+        writeValue<std::uint32_t>(stream, sectionHeaderLength);
+        writeValue<std::uint32_t>(stream, 0x1a2b3c4d);
+        writeValue<std::uint16_t>(stream, 1);
+        writeValue<std::uint16_t>(stream, 0);
+        writeValue<std::int64_t>(stream, -1);
+        writeValue<std::uint32_t>(stream, sectionHeaderLength);
+
+        // Interface description block, timestamps in nanoseconds
+        writeValue<std::uint32_t>(stream, 1);
+        writeValue<std::uint32_t>(stream, interfaceLength);
+        writeValue<std::uint16_t>(stream, linkTypeUsbmon);
+        writeValue<std::uint16_t>(stream, 0);
+        writeValue<std::uint32_t>(stream, 0);
+        writeValue<std::uint16_t>(stream, 9); // if_tsresol
+        writeValue<std::uint16_t>(stream, 1);
+        writeValue<std::uint8_t>(stream, 9);
+        writePadding(stream, 1);
+        writeValue<std::uint32_t>(stream, 0); // opt_endofopt
+        writeValue<std::uint32_t>(stream, interfaceLength);
+
+        const auto start = std::chrono::duration_cast<std::chrono::nanoseconds>(capture.start.time_since_epoch());
+        std::uint64_t id{0};
+
+        for (const auto& packet : capture.packets)
+        {
+            const auto timestamp = start + packet.time;
+            const auto captured = usbmonHeaderSize + static_cast<std::uint32_t>(packet.data.size());
+            const auto blockLength = 32 + padded(captured);
+            const auto ticks = static_cast<std::uint64_t>(timestamp.count());
+
+            // Enhanced packet block
+            writeValue<std::uint32_t>(stream, 6);
+            writeValue<std::uint32_t>(stream, blockLength);
+            writeValue<std::uint32_t>(stream, 0);
+            writeValue<std::uint32_t>(stream, static_cast<std::uint32_t>(ticks >> 32));
+            writeValue<std::uint32_t>(stream, static_cast<std::uint32_t>(ticks & 0xffffffff));
+            writeValue<std::uint32_t>(stream, captured);
+            writeValue<std::uint32_t>(stream, captured);
+            writeUsbmonHeader(stream, id++, packet, timestamp);
+            stream.write(reinterpret_cast<const char*>(packet.data.data()), static_cast<std::streamsize>(packet.data.size()));
+            writePadding(stream, captured);
+            writeValue<std::uint32_t>(stream, blockLength);
+        }
+    }
+}
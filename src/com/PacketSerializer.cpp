@@ -21,8 +21,10 @@
 
 #include "com/PacketSerializer.h"
 #include "com/IdLookup.h"
+#include "com/ModelTable.h"
 #include "effects_enum.h"
 #include <algorithm>
+#include <iterator>
 
 namespace plug::com
 {
@@ -36,11 +38,7 @@ namespace plug::com
 
         constexpr std::uint8_t getFxKnob(const fx_pedal_settings& effect)
         {
-            if ((effect.effect_num >= effects::SINE_CHORUS) && (effect.effect_num <= effects::PITCH_SHIFTER))
-            {
-                return 0x01;
-            }
-            return 0x02;
+            return descriptorOf(effect.effect_num).fxKnob;
         }
 
         constexpr std::uint8_t getSlot(const fx_pedal_settings& effect)
@@ -54,22 +52,14 @@ namespace plug::com
         }
 
 
-        constexpr bool hasExtraKnob(effects e)
+        constexpr bool canSaveEffect(effects e)
         {
-            switch (e)
-            {
-                case effects::MONO_ECHO_FILTER:
-                case effects::STEREO_ECHO_FILTER:
-                case effects::TAPE_DELAY:
-                case effects::STEREO_TAPE_DELAY:
-                    return true;
-                default:
-                    return false;
-            }
+            const auto dsp = descriptorOf(e).dsp;
+            return (dsp != DSP::none) && (dsp != DSP::effect0);
         }
 
 
-        std::size_t getSaveEffectsRepeats(const std::vector<fx_pedal_settings>& effects)
+        std::size_t getSaveEffectsRepeats(Span<fx_pedal_settings> effects)
         {
             const auto size = effects.size();
 
@@ -77,9 +67,7 @@ namespace plug::com
             {
                 return 1;
             }
-            const auto effect = effects[0].effect_num;
-
-            if ((effect >= effects::SINE_CHORUS) && (effect <= effects::PITCH_SHIFTER))
+            if (getFxKnob(effects[0]) == 0x01)
             {
                 return 1;
             }
@@ -89,23 +77,36 @@ namespace plug::com
     }
 
 
-    std::string decodeNameFromData(const Packet<NamePayload>& packet)
+    std::string decodeNameFromData(PacketView<NamePayload> packet)
     {
         return packet.getPayload().getName();
     }
 
-    amp_settings decodeAmpFromData(const Packet<AmpPayload>& packet, const Packet<AmpPayload>& packetUsbGain)
+    DecodeResult<amp_settings> tryDecodeAmpFromData(PacketView<AmpPayload> packet, PacketView<AmpPayload> packetUsbGain)
     {
         const auto payload = packet.getPayload();
+        const auto amp = findAmpById(payload.getModel());
+
+        if (amp.has_value() == false)
+        {
+            return DecodeError::unknownAmp;
+        }
+
+        const auto cabinet = findCabinetById(payload.getCabinet());
+
+        if (cabinet.has_value() == false)
+        {
+            return DecodeError::unknownCabinet;
+        }
 
         amp_settings settings{};
-        settings.amp_num = lookupAmpById(payload.getModel());
+        settings.amp_num = *amp;
         settings.gain = payload.getGain();
         settings.volume = payload.getVolume();
         settings.treble = payload.getTreble();
         settings.middle = payload.getMiddle();
         settings.bass = payload.getBass();
-        settings.cabinet = lookupCabinetById(payload.getCabinet());
+        settings.cabinet = *cabinet;
         settings.noise_gate = payload.getNoiseGate();
         settings.master_vol = payload.getMasterVolume();
         settings.gain2 = payload.getGain2();
@@ -119,48 +120,99 @@ namespace plug::com
         return settings;
     }
 
-    std::array<fx_pedal_settings, 4> decodeEffectsFromData(const std::array<Packet<EffectPayload>, 4>& packet)
+    DecodeResult<fx_pedal_settings> tryDecodeEffectFromData(PacketView<EffectPayload> packet)
+    {
+        const auto payload = packet.getPayload();
+        const auto model = findEffectById(payload.getModel());
+
+        if (model.has_value() == false)
+        {
+            return DecodeError::unknownEffect;
+        }
+
+        fx_pedal_settings effect{};
+        effect.fx_slot = payload.getSlot() % 4;
+        effect.knob1 = payload.getKnob1();
+        effect.knob2 = payload.getKnob2();
+        effect.knob3 = payload.getKnob3();
+        effect.knob4 = payload.getKnob4();
+        effect.knob5 = payload.getKnob5();
+        effect.knob6 = payload.getKnob6();
+        effect.position = (payload.getSlot() > 0x03 ? Position::effectsLoop : Position::input);
+        effect.effect_num = *model;
+        return effect;
+    }
+
+    amp_settings decodeAmpFromData(PacketView<AmpPayload> packet, PacketView<AmpPayload> packetUsbGain)
+    {
+        return tryDecodeAmpFromData(packet, packetUsbGain).value();
+    }
+
+    fx_pedal_settings decodeEffectFromData(PacketView<EffectPayload> packet)
+    {
+        return tryDecodeEffectFromData(packet).value();
+    }
+
+    std::array<fx_pedal_settings, 4> decodeEffectsFromData(const std::array<PacketView<EffectPayload>, 4>& packet)
     {
         std::array<fx_pedal_settings, 4> effects{{}};
-        int i=0;
-        std::for_each(packet.cbegin(), packet.cend(), [&effects, &i](const auto& p) {
-            i++;
-            const auto payload = p.getPayload();
-            const auto slot = payload.getSlot() % 4;
-            effects[slot].fx_slot = slot;
-            effects[slot].knob1 = payload.getKnob1();
-            effects[slot].knob2 = payload.getKnob2();
-            effects[slot].knob3 = payload.getKnob3();
-            effects[slot].knob4 = payload.getKnob4();
-            effects[slot].knob5 = payload.getKnob5();
-            effects[slot].knob6 = payload.getKnob6();
-            effects[slot].position = (payload.getSlot() > 0x03 ? Position::effectsLoop : Position::input);
-            effects[slot].effect_num = lookupEffectById(payload.getModel());
-            printf("decodeEffectsFromData: effect:%d slot: %d, position: %d, effect_num: %d, id: %02x\n"
-                        ,i
-                        ,static_cast<int>(slot)
-                        ,static_cast<int>(effects[slot].position)
-                        ,static_cast<int>(effects[slot].effect_num)
-                        ,static_cast<int>(payload.getModel()));
+        std::for_each(packet.cbegin(), packet.cend(), [&effects](const auto& p) {
+            const auto effect = decodeEffectFromData(p);
+            effects[effect.fx_slot] = effect;
         });
 
         return effects;
     }
 
-    std::vector<std::string> decodePresetListFromData(const std::vector<Packet<NamePayload>>& packets)
+    std::vector<std::string> decodePresetListFromData(const std::vector<PacketRawType>& packets, std::size_t count)
     {
-        const auto max_to_receive = std::min<std::size_t>(packets.size(), (packets.size() > 143 ? 200 : 48));
+        const auto available = std::min(packets.size(), count);
+        const auto max_to_receive = std::min<std::size_t>(available, (available > 143 ? 200 : 48));
         std::vector<std::string> presetNames;
         presetNames.reserve(max_to_receive);
 
         for (std::size_t i = 0; i < max_to_receive; i += 2)
         {
-            presetNames.push_back(packets[i].getPayload().getName());
+            presetNames.push_back(decodeNameFromData(PacketView<NamePayload>{packets[i]}));
         }
 
         return presetNames;
     }
 
+    std::string decodeNameFromData(const Packet<NamePayload>& packet)
+    {
+        const auto bytes = packet.getBytes();
+        return decodeNameFromData(PacketView<NamePayload>{bytes});
+    }
+
+    amp_settings decodeAmpFromData(const Packet<AmpPayload>& packet, const Packet<AmpPayload>& packetUsbGain)
+    {
+        const auto bytes = packet.getBytes();
+        const auto bytesUsbGain = packetUsbGain.getBytes();
+        return decodeAmpFromData(PacketView<AmpPayload>{bytes}, PacketView<AmpPayload>{bytesUsbGain});
+    }
+
+    fx_pedal_settings decodeEffectFromData(const Packet<EffectPayload>& packet)
+    {
+        const auto bytes = packet.getBytes();
+        return decodeEffectFromData(PacketView<EffectPayload>{bytes});
+    }
+
+    std::array<fx_pedal_settings, 4> decodeEffectsFromData(const std::array<Packet<EffectPayload>, 4>& packet)
+    {
+        const std::array<PacketRawType, 4> bytes{{packet[0].getBytes(), packet[1].getBytes(), packet[2].getBytes(), packet[3].getBytes()}};
+        return decodeEffectsFromData({{PacketView<EffectPayload>{bytes[0]}, PacketView<EffectPayload>{bytes[1]},
+                                       PacketView<EffectPayload>{bytes[2]}, PacketView<EffectPayload>{bytes[3]}}});
+    }
+
+    std::vector<std::string> decodePresetListFromData(const std::vector<Packet<NamePayload>>& packets)
+    {
+        std::vector<PacketRawType> bytes;
+        bytes.reserve(packets.size());
+        std::transform(packets.cbegin(), packets.cend(), std::back_inserter(bytes), [](const auto& packet) { return packet.getBytes(); });
+        return decodePresetListFromData(bytes, bytes.size());
+    }
+
     Packet<AmpPayload> serializeAmpSettings(const amp_settings& value)
     {
         Header header{};
@@ -180,10 +232,9 @@ namespace plug::com
         payload.setPresence(value.presence);
         payload.setBias(value.bias);
         payload.setNoiseGate(clampToRange<std::uint8_t, 0x05>(value.noise_gate));
-        payload.setCabinet(plug::value(value.cabinet));
+        payload.setCabinet(cabinetId(value.cabinet));
         payload.setSag(clampToRange<std::uint8_t, 0x02>(value.sag));
         payload.setBrightness(value.brightness);
-        payload.setUnknown(0x80, 0x80, 0x01);
 
         if (value.noise_gate == 0x05)
         {
@@ -195,91 +246,11 @@ namespace plug::com
             payload.setDepth(0x80);
         }
 
-        switch (value.amp_num)
-        {
-            case amps::FENDER_57_DELUXE:
-                payload.setModel(0x67);
-                payload.setUnknownAmpSpecific(0x01, 0x01, 0x01, 0x01, 0x53);
-                break;
-
-            case amps::FENDER_59_BASSMAN:
-                payload.setModel(0x64);
-                payload.setUnknownAmpSpecific(0x02, 0x02, 0x02, 0x02, 0x67);
-                break;
-
-            case amps::FENDER_57_CHAMP:
-                payload.setModel(0x7c);
-                payload.setUnknownAmpSpecific(0x0c, 0x0c, 0x0c, 0x0c, 0x00);
-                break;
-
-            case amps::FENDER_65_DELUXE_REVERB:
-                payload.setModel(0x53);
-                payload.setUnknownAmpSpecific(0x03, 0x03, 0x03, 0x03, 0x6a);
-                payload.setUnknown(0x00, 0x00, 0x01);
-                break;
-
-            case amps::FENDER_65_PRINCETON:
-                payload.setModel(0x6a);
-                payload.setUnknownAmpSpecific(0x04, 0x04, 0x04, 0x04, 0x61);
-                break;
-
-            case amps::FENDER_65_TWIN_REVERB:
-                payload.setModel(0x75);
-                payload.setUnknownAmpSpecific(0x05, 0x05, 0x05, 0x05, 0x72);
-                break;
-
-            case amps::FENDER_SUPER_SONIC:
-                payload.setModel(0x72);
-                payload.setUnknownAmpSpecific(0x06, 0x06, 0x06, 0x06, 0x79);
-                break;
-
-            case amps::BRITISH_60S:
-                payload.setModel(0x61);
-                payload.setUnknownAmpSpecific(0x07, 0x07, 0x07, 0x07, 0x5e);
-                break;
-
-            case amps::BRITISH_70S:
-                payload.setModel(0x79);
-                payload.setUnknownAmpSpecific(0x0b, 0x0b, 0x0b, 0x0b, 0x7c);
-                break;
-
-            case amps::BRITISH_80S:
-                payload.setModel(0x5e);
-                payload.setUnknownAmpSpecific(0x09, 0x09, 0x09, 0x09, 0x5d);
-                break;
-
-            case amps::AMERICAN_90S:
-                payload.setModel(0x5d);
-                payload.setUnknownAmpSpecific(0x0a, 0x0a, 0x0a, 0x0a, 0x6d);
-                break;
-
-            case amps::METAL_2000:
-                payload.setModel(0x6d);
-                payload.setUnknownAmpSpecific(0x08, 0x08, 0x08, 0x08, 0x75);
-                break;
-
-            //V2 Only
-            case amps::STUDIO_PREAMP:
-                payload.setModel(0xf1);
-                payload.setUnknownAmpSpecific(0x0d, 0x0d, 0x0d, 0x0d,0xf6);
-                break;
-            case amps::FENDER_57_TWIN:
-                payload.setModel(0xf6);
-                payload.setUnknownAmpSpecific(0x0e, 0x0e, 0x0e, 0x0e, 0xf9);
-                break;
-            case amps::SIXTIES_THRIFT:
-                payload.setModel(0xf9);
-                payload.setUnknownAmpSpecific(0x0f, 0x0f, 0x0f, 0x0f, 0xfc);
-                break;
-            case amps::BRITTISH_WATTS:
-                payload.setModel(0xff);
-                payload.setUnknownAmpSpecific(0x11, 0x11, 0x11, 0x11, 0x00);
-                break;
-            case amps::BRITTISH_COLOUR:
-                payload.setModel(0xfc);
-                payload.setUnknownAmpSpecific(0x10, 0x10, 0x10, 010, 0xff);
-                break;
-        }
+        const auto& descriptor = descriptorOf(value.amp_num);
+        const auto& specific = descriptor.ampSpecific;
+        payload.setModel(descriptor.model);
+        payload.setUnknownAmpSpecific(specific[0], specific[1], specific[2], specific[3], specific[4]);
+        payload.setUnknown(descriptor.unknown[0], descriptor.unknown[1], descriptor.unknown[2]);
 
         Packet<AmpPayload> packet{};
         packet.setHeader(header);
@@ -324,304 +295,25 @@ namespace plug::com
 
     Packet<EffectPayload> serializeEffectSettings(const fx_pedal_settings& value)
     {
+        const auto& descriptor = descriptorOf(value.effect_num);
+        const auto& limits = descriptor.knobLimits;
+
         Header header{};
         header.setStage(Stage::ready);
         header.setType(Type::data);
+        header.setDSP(descriptor.dsp);
         header.setUnknown(0x00, 0x01, 0x01);
 
-        printf("*serializeEffectSettings: slot: %d, model: %02x \n",
-                static_cast<int>(value.fx_slot)
-                ,static_cast<int>(value.effect_num));
         EffectPayload payload{};
         payload.setSlot(getSlot(value));
-        payload.setUnknown(0x00, 0x08, 0x01);
-        payload.setKnob1(value.knob1);
-        payload.setKnob2(value.knob2);
-        payload.setKnob3(value.knob3);
-        payload.setKnob4(value.knob4);
-        payload.setKnob5(value.knob5);
-
-        if (hasExtraKnob(value.effect_num) == true)
-        {
-            payload.setKnob6(value.knob6);
-        }
-
-        switch (value.effect_num)
-        {
-            case effects::OVERDRIVE:
-                header.setDSP(DSP::effect0);
-                payload.setModel(0x3c);
-                break;
-
-            case effects::WAH:
-                header.setDSP(DSP::effect0);
-                payload.setModel(0x49);
-                payload.setUnknown(0x01, 0x08, 0x01);
-                break;
-
-            case effects::TOUCH_WAH:
-                header.setDSP(DSP::effect0);
-                payload.setModel(0x4a);
-                payload.setUnknown(0x01, 0x08, 0x01);
-                break;
-
-            case effects::FUZZ:
-                header.setDSP(DSP::effect0);
-                payload.setModel(0x1a);
-                break;
-
-            case effects::FUZZ_TOUCH_WAH:
-                header.setDSP(DSP::effect0);
-                payload.setModel(0x1c);
-                break;
-
-            case effects::SIMPLE_COMP:
-                header.setDSP(DSP::effect0);
-                payload.setModel(0x88);
-                payload.setKnob1(clampToRange<std::uint8_t, 0x03>(value.knob1));
-                payload.setKnob2(0x00);
-                payload.setKnob3(0x00);
-                payload.setKnob4(0x00);
-                payload.setKnob5(0x00);
-                payload.setUnknown(0x08, 0x08, 0x01);
-                break;
-
-            case effects::COMPRESSOR:
-                header.setDSP(DSP::effect0);
-                payload.setModel(0x07);
-                break;
-
-        case effects::RANGE_BOOST:
-                header.setDSP(DSP::effect0);
-                payload.setModel(0x0103);
-                payload.setUnknown(0x00, 0x08, 0x01);
-                break;
-
-        case effects::GREEN_BOX:
-                header.setDSP(DSP::effect0);
-                payload.setModel(0xba);
-                payload.setUnknown(0x00, 0x08, 0x01);
-                break;
-
-        case effects::ORANGE_BOX:
-                header.setDSP(DSP::effect0);
-                payload.setModel(0x0110);
-                payload.setUnknown(0x00, 0x08, 0x01);
-                break;
-
-        case effects::BLACK_BOX:
-                header.setDSP(DSP::effect0);
-                payload.setModel(0x0111);
-                payload.setUnknown(0x00, 0x08, 0x01);
-                break;
-
-        case effects::BIG_FUZZ:
-                header.setDSP(DSP::effect0);
-                payload.setModel(0x010f);
-                payload.setUnknown(0x00, 0x08, 0x01);
-                break;
-
-            case effects::SINE_CHORUS:
-                header.setDSP(DSP::effect1);
-                payload.setModel(0x12);
-                payload.setUnknown(0x01, 0x01, 0x01);
-                break;
-
-            case effects::TRIANGLE_CHORUS:
-                header.setDSP(DSP::effect1);
-                payload.setModel(0x13);
-                payload.setUnknown(0x01, 0x01, 0x01);
-                break;
-
-            case effects::SINE_FLANGER:
-                header.setDSP(DSP::effect1);
-                payload.setModel(0x18);
-                payload.setUnknown(0x01, 0x01, 0x01);
-                break;
-
-            case effects::TRIANGLE_FLANGER:
-                header.setDSP(DSP::effect1);
-                payload.setModel(0x19);
-                payload.setUnknown(0x01, 0x01, 0x01);
-                break;
-
-            case effects::VIBRATONE:
-                header.setDSP(DSP::effect1);
-                payload.setModel(0x2d);
-                payload.setUnknown(0x01, 0x01, 0x01);
-                break;
-
-            case effects::VINTAGE_TREMOLO:
-                header.setDSP(DSP::effect1);
-                payload.setModel(0x40);
-                payload.setUnknown(0x01, 0x01, 0x01);
-                break;
-
-            case effects::SINE_TREMOLO:
-                header.setDSP(DSP::effect1);
-                payload.setModel(0x41);
-                payload.setUnknown(0x01, 0x01, 0x01);
-                break;
-
-            case effects::RING_MODULATOR:
-                header.setDSP(DSP::effect1);
-                payload.setModel(0x22);
-                payload.setKnob4(clampToRange<std::uint8_t, 0x01>(value.knob4));
-                payload.setUnknown(0x01, 0x08, 0x01);
-                break;
-
-            case effects::STEP_FILTER:
-                header.setDSP(DSP::effect1);
-                payload.setModel(0x29);
-                payload.setUnknown(0x01, 0x01, 0x01);
-                break;
-
-            case effects::PHASER:
-                header.setDSP(DSP::effect1);
-                payload.setModel(0x4f);
-                payload.setKnob5(clampToRange<std::uint8_t, 0x01>(value.knob5));
-                payload.setUnknown(0x01, 0x01, 0x01);
-                break;
-
-            case effects::PITCH_SHIFTER:
-                header.setDSP(DSP::effect1);
-                payload.setModel(0x1f);
-                payload.setUnknown(0x01, 0x08, 0x01);
-                break;
-        //V2 only mod
-            case effects::MOD_WHA:
-                header.setDSP(DSP::effect1);
-                payload.setModel(0xf4);
-                payload.setUnknown(0x01, 0x08, 0x01);
-                break;
-
-            case effects::MOD_TOUCH_WHA:
-                header.setDSP(DSP::effect1);
-                payload.setModel(0xf5);
-                payload.setUnknown(0x01, 0x08, 0x01);
-                break;
-
-            case effects::DIATONIC_PITCH_SHIFT:
-                header.setDSP(DSP::effect1);
-                payload.setModel(0x101f) ;
-                payload.setUnknown(0x00, 0x08, 0x01);
-                break;
-
-            case effects::MONO_DELAY:
-                header.setDSP(DSP::effect2);
-                payload.setModel(0x16);
-                payload.setUnknown(0x02, 0x01, 0x01);
-                break;
-
-            case effects::MONO_ECHO_FILTER:
-                header.setDSP(DSP::effect2);
-                payload.setModel(0x43);
-                payload.setUnknown(0x02, 0x01, 0x01);
-                break;
-
-            case effects::STEREO_ECHO_FILTER:
-                header.setDSP(DSP::effect2);
-                payload.setModel(0x48);
-                payload.setUnknown(0x02, 0x01, 0x01);
-                break;
-
-            case effects::MULTITAP_DELAY:
-                header.setDSP(DSP::effect2);
-                payload.setModel(0x44);
-                payload.setKnob5(clampToRange<std::uint8_t, 0x03>(value.knob5));
-                payload.setUnknown(0x02, 0x01, 0x01);
-                break;
-
-            case effects::PING_PONG_DELAY:
-                header.setDSP(DSP::effect2);
-                payload.setModel(0x45);
-                payload.setUnknown(0x02, 0x01, 0x01);
-                break;
-
-            case effects::DUCKING_DELAY:
-                header.setDSP(DSP::effect2);
-                payload.setModel(0x15);
-                payload.setUnknown(0x02, 0x01, 0x01);
-                break;
-
-            case effects::REVERSE_DELAY:
-                header.setDSP(DSP::effect2);
-                payload.setModel(0x46);
-                payload.setUnknown(0x02, 0x01, 0x01);
-                break;
-
-            case effects::TAPE_DELAY:
-                header.setDSP(DSP::effect2);
-                payload.setModel(0x2b);
-                payload.setUnknown(0x02, 0x01, 0x01);
-                break;
-
-            case effects::STEREO_TAPE_DELAY:
-                header.setDSP(DSP::effect2);
-                payload.setModel(0x2a);
-                payload.setUnknown(0x02, 0x01, 0x01);
-                break;
-
-            case effects::SMALL_HALL_REVERB:
-                header.setDSP(DSP::effect3);
-                payload.setModel(0x24);
-                break;
-
-            case effects::LARGE_HALL_REVERB:
-                header.setDSP(DSP::effect3);
-                payload.setModel(0x3a);
-                break;
-
-            case effects::SMALL_ROOM_REVERB:
-                header.setDSP(DSP::effect3);
-                payload.setModel(0x26);
-                break;
-
-            case effects::LARGE_ROOM_REVERB:
-                header.setDSP(DSP::effect3);
-                payload.setModel(0x3b);
-                break;
-
-            case effects::SMALL_PLATE_REVERB:
-                header.setDSP(DSP::effect3);
-                payload.setModel(0x4e);
-                break;
-
-            case effects::LARGE_PLATE_REVERB:
-                header.setDSP(DSP::effect3);
-                payload.setModel(0x4b);
-                break;
-
-            case effects::AMBIENT_REVERB:
-                header.setDSP(DSP::effect3);
-                payload.setModel(0x4c);
-                break;
-
-            case effects::ARENA_REVERB:
-                header.setDSP(DSP::effect3);
-                payload.setModel(0x4d);
-                break;
-
-            case effects::FENDER_63_SPRING_REVERB:
-                header.setDSP(DSP::effect3);
-                payload.setModel(0x21);
-                break;
-
-            case effects::FENDER_65_SPRING_REVERB:
-                header.setDSP(DSP::effect3);
-                payload.setModel(0x0b);
-                break;
-
-            default:
-                printf("unhandled value.effect_num: %d\n"
-                        ,static_cast<int>(value.effect_num));
-                break;
-        }
-        printf("*serializeEffectSettings: DSP: %d, ID: %02x\n"
-                ,static_cast<int>(payload.getSlot())
-                ,static_cast<int>(payload.getModel())
-                );
-
+        payload.setModel(descriptor.model);
+        payload.setUnknown(descriptor.unknown[0], descriptor.unknown[1], descriptor.unknown[2]);
+        payload.setKnob1(std::min(value.knob1, limits[0]));
+        payload.setKnob2(std::min(value.knob2, limits[1]));
+        payload.setKnob3(std::min(value.knob3, limits[2]));
+        payload.setKnob4(std::min(value.knob4, limits[3]));
+        payload.setKnob5(std::min(value.knob5, limits[4]));
+        payload.setKnob6(std::min(value.knob6, limits[5]));
 
         Packet<EffectPayload> packet{};
         packet.setHeader(header);
@@ -645,13 +337,13 @@ namespace plug::com
         return applyCommand;
     }
 
-    Packet<NamePayload> serializeSaveEffectName(std::uint8_t slot, std::string_view name, const std::vector<fx_pedal_settings>& effects)
+    Packet<NamePayload> serializeSaveEffectName(std::uint8_t slot, std::string_view name, Span<fx_pedal_settings> effects)
     {
         const std::size_t repeat = getSaveEffectsRepeats(effects);
 
         for (std::size_t i = 0; i < repeat; ++i)
         {
-            if (effects[i].effect_num < effects::SINE_CHORUS)
+            if (canSaveEffect(effects[i].effect_num) == false)
             {
                 throw std::invalid_argument{"Invalid effect"};
             }
@@ -674,21 +366,20 @@ namespace plug::com
         return packet;
     }
 
-    std::vector<Packet<EffectPayload>> serializeSaveEffectPacket(std::uint8_t slot, const std::vector<fx_pedal_settings>& effects)
+    FixedVector<Packet<EffectPayload>, maxSaveEffectPackets> serializeSaveEffectPacket(std::uint8_t slot, Span<fx_pedal_settings> effects)
     {
-        printf("serializeSaveEffectPacket:\n");
         const auto fxKnob = getFxKnob(effects[0]);
         const std::size_t repeat = getSaveEffectsRepeats(effects);
 
         for (std::size_t i = 0; i < repeat; ++i)
         {
-            if (effects[i].effect_num < effects::SINE_CHORUS)
+            if (canSaveEffect(effects[i].effect_num) == false)
             {
                 throw std::invalid_argument{"Invalid effect"};
             }
         }
 
-        std::vector<Packet<EffectPayload>> packets;
+        FixedVector<Packet<EffectPayload>, maxSaveEffectPackets> packets;
 
         for (std::size_t i = 0; i < repeat; ++i)
         {
@@ -0,0 +1,163 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "com/RecordingConnection.h"
+#include "com/CommunicationException.h"
+
+namespace plug::com
+{
+    namespace
+    {
+        template <class T>
+        struct BufferView
+        {
+            T* data() const
+            {
+                return ptr;
+            }
+
+            std::size_t size() const
+            {
+                return length;
+            }
+
+            T* ptr;
+            std::size_t length;
+        };
+    }
+
+
+    RecordingConnection::RecordingConnection(std::shared_ptr<Connection> connection, const std::string& fileName)
+        : conn(std::move(connection)), file(fileName, std::ios::binary | std::ios::trunc), writer(file)
+    {
+        if (file.good() == false)
+        {
+            throw CommunicationException{"Unable to open capture file " + fileName};
+        }
+    }
+
+    void RecordingConnection::close()
+    {
+        conn->close();
+    }
+
+    bool RecordingConnection::isOpen() const
+    {
+        return conn->isOpen();
+    }
+
+    void RecordingConnection::waitSent()
+    {
+        conn->waitSent();
+    }
+
+    std::vector<std::uint8_t> RecordingConnection::receive(std::size_t recvSize)
+    {
+        auto data = conn->receive(recvSize);
+        record(Direction::in, data);
+        return data;
+    }
+
+    // Recorded when the result is taken, which is close to its arrival as
+    // long as the caller waits for it
+    std::future<std::vector<std::uint8_t>> RecordingConnection::receiveAsync(std::size_t recvSize)
+    {
+        return std::async(std::launch::deferred, [this, result = conn->receiveAsync(recvSize)]() mutable {
+            auto data = result.get();
+            record(Direction::in, data);
+            return data;
+        });
+    }
+
+    // Dropped packets are part of the traffic as well
+    void RecordingConnection::discardReceived()
+    {
+        for (const auto& packet : conn->takeReceived())
+        {
+            record(Direction::in, packet);
+        }
+        conn->discardReceived();
+    }
+
+    std::vector<std::vector<std::uint8_t>> RecordingConnection::takeReceived()
+    {
+        auto packets = conn->takeReceived();
+
+        for (const auto& packet : packets)
+        {
+            record(Direction::in, packet);
+        }
+        return packets;
+    }
+
+    void RecordingConnection::setReceiveListener(std::function<void()> listener)
+    {
+        conn->setReceiveListener(std::move(listener));
+    }
+
+    std::string RecordingConnection::deviceId() const
+    {
+        return conn->deviceId();
+    }
+
+    std::shared_ptr<Stats> RecordingConnection::stats() const
+    {
+        return conn->stats();
+    }
+
+    std::size_t RecordingConnection::sendImpl(const std::uint8_t* data, std::size_t size)
+    {
+        writer.write(Direction::out, data, size);
+        return conn->send(BufferView<const std::uint8_t>{data, size});
+    }
+
+    std::future<std::size_t> RecordingConnection::sendAsyncImpl(const std::uint8_t* data, std::size_t size)
+    {
+        writer.write(Direction::out, data, size);
+        return conn->sendAsync(BufferView<const std::uint8_t>{data, size});
+    }
+
+    void RecordingConnection::sendQueuedImpl(const std::uint8_t* data, std::size_t size)
+    {
+        writer.write(Direction::out, data, size);
+        conn->sendQueued(BufferView<const std::uint8_t>{data, size});
+    }
+
+    std::size_t RecordingConnection::receiveIntoImpl(std::uint8_t* buffer, std::size_t size)
+    {
+        BufferView<std::uint8_t> view{buffer, size};
+        const auto received = conn->receiveInto(view);
+        writer.write(Direction::in, buffer, received);
+        return received;
+    }
+
+    std::size_t RecordingConnection::receiveWithinImpl(std::uint8_t* buffer, std::size_t size, std::chrono::milliseconds timeout)
+    {
+        BufferView<std::uint8_t> view{buffer, size};
+        const auto received = conn->receiveInto(view, timeout);
+        writer.write(Direction::in, buffer, received);
+        return received;
+    }
+
+    void RecordingConnection::record(Direction direction, const std::vector<std::uint8_t>& data)
+    {
+        writer.write(direction, data.data(), data.size());
+    }
+}
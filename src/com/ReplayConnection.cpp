@@ -0,0 +1,124 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "com/ReplayConnection.h"
+#include "com/CommunicationException.h"
+#include <algorithm>
+#include <thread>
+
+namespace plug::com
+{
+    ReplayConnection::ReplayConnection(Capture recorded, double timeScale)
+        : capture(std::move(recorded)), scale(timeScale), start(std::chrono::steady_clock::now()),
+          nextIn(0), nextOut(0), mismatchCount(0), open(true)
+    {
+        nextIn = nextIndex(0, Direction::in);
+        nextOut = nextIndex(0, Direction::out);
+    }
+
+    void ReplayConnection::close()
+    {
+        open = false;
+    }
+
+    bool ReplayConnection::isOpen() const
+    {
+        return open;
+    }
+
+    // Returns an empty buffer, same as a timeout, once the capture is exhausted
+    std::vector<std::uint8_t> ReplayConnection::receive(std::size_t recvSize)
+    {
+        if (open == false)
+        {
+            throw CommunicationException{"Device not connected"};
+        }
+
+        if (nextIn == capture.packets.size())
+        {
+            return {};
+        }
+
+        const auto& packet = capture.packets[nextIn];
+        nextIn = nextIndex(nextIn + 1, Direction::in);
+        std::this_thread::sleep_until(dueTime(packet));
+
+        const auto size = std::min(recvSize, packet.data.size());
+        return {packet.data.cbegin(), std::next(packet.data.cbegin(), static_cast<std::ptrdiff_t>(size))};
+    }
+
+    void ReplayConnection::discardReceived()
+    {
+        takeReceived();
+    }
+
+    // Packets due but not received yet weren't waited for, as with a real amp
+    std::vector<std::vector<std::uint8_t>> ReplayConnection::takeReceived()
+    {
+        const auto now = std::chrono::steady_clock::now();
+        std::vector<std::vector<std::uint8_t>> packets;
+
+        while ((nextIn < capture.packets.size()) && (dueTime(capture.packets[nextIn]) <= now))
+        {
+            if (capture.packets[nextIn].data.empty() == false)
+            {
+                packets.push_back(capture.packets[nextIn].data);
+            }
+            nextIn = nextIndex(nextIn + 1, Direction::in);
+        }
+        return packets;
+    }
+
+    std::size_t ReplayConnection::mismatches() const
+    {
+        return mismatchCount;
+    }
+
+    std::size_t ReplayConnection::sendImpl(const std::uint8_t* data, std::size_t size)
+    {
+        if (open == false)
+        {
+            throw CommunicationException{"Device not connected"};
+        }
+
+        if ((nextOut == capture.packets.size()) || (std::equal(data, data + size, capture.packets[nextOut].data.cbegin(), capture.packets[nextOut].data.cend()) == false))
+        {
+            ++mismatchCount;
+        }
+
+        if (nextOut < capture.packets.size())
+        {
+            nextOut = nextIndex(nextOut + 1, Direction::out);
+        }
+        return size;
+    }
+
+    std::chrono::steady_clock::time_point ReplayConnection::dueTime(const CapturedPacket& packet) const
+    {
+        return start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(packet.time * scale);
+    }
+
+    std::size_t ReplayConnection::nextIndex(std::size_t from, Direction direction) const
+    {
+        const auto itr = std::find_if(std::next(capture.packets.cbegin(), static_cast<std::ptrdiff_t>(from)), capture.packets.cend(),
+                                      [direction](const auto& packet) { return packet.direction == direction; });
+        return static_cast<std::size_t>(std::distance(capture.packets.cbegin(), itr));
+    }
+}
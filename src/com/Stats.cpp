@@ -0,0 +1,271 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "com/Stats.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+namespace plug::com
+{
+    namespace
+    {
+        inline constexpr std::size_t subBucketBits{5};
+        inline constexpr std::uint64_t subBucketCount{1u << subBucketBits};
+        inline constexpr std::uint64_t linearLimit{subBucketCount * 2};
+        inline constexpr std::uint64_t maxValue{(std::uint64_t{1} << 40) - 1};
+
+        constexpr std::size_t bitWidth(std::uint64_t value)
+        {
+            std::size_t width{0};
+
+            for (; value != 0; value >>= 1)
+            {
+                ++width;
+            }
+            return width;
+        }
+
+        constexpr std::size_t bucketOf(std::uint64_t value)
+        {
+            if (value < linearLimit)
+            {
+                return static_cast<std::size_t>(value);
+            }
+
+            const auto exponent = bitWidth(value) - (subBucketBits + 1);
+            return static_cast<std::size_t>(linearLimit + (exponent - 1) * subBucketCount + ((value >> exponent) - subBucketCount));
+        }
+
+        constexpr std::uint64_t highestValueOf(std::size_t bucket)
+        {
+            if (bucket < linearLimit)
+            {
+                return bucket;
+            }
+
+            const auto exponent = (bucket - linearLimit) / subBucketCount + 1;
+            const auto mantissa = (bucket - linearLimit) % subBucketCount + subBucketCount;
+            return ((mantissa + 1) << exponent) - 1;
+        }
+
+        static_assert(LatencyHistogram::bucketCount == (bucketOf(maxValue) + 1));
+
+        void printMillis(std::ostream& os, std::chrono::microseconds value)
+        {
+            os << std::setw(9) << std::fixed << std::setprecision(3) << (static_cast<double>(value.count()) / 1000.0);
+        }
+    }
+
+
+    std::string_view nameOf(Operation operation)
+    {
+        switch (operation)
+        {
+            case Operation::send:
+                return "send";
+            case Operation::receive:
+                return "receive";
+            case Operation::startAmp:
+                return "start_amp";
+            case Operation::setEffect:
+                return "set_effect";
+            case Operation::setAmplifier:
+                return "set_amplifier";
+            case Operation::applyChain:
+                return "apply_chain";
+            case Operation::loadMemoryBank:
+                return "load_memory_bank";
+            case Operation::saveOnAmp:
+                return "save_on_amp";
+            case Operation::writeBank:
+                return "write_bank";
+        }
+        return "unknown";
+    }
+
+    std::string_view nameOf(Counter counter)
+    {
+        switch (counter)
+        {
+            case Counter::packetsSent:
+                return "packets sent";
+            case Counter::packetsReceived:
+                return "packets received";
+            case Counter::bytesSent:
+                return "bytes sent";
+            case Counter::bytesReceived:
+                return "bytes received";
+            case Counter::sendRetries:
+                return "send retries";
+            case Counter::receiveTimeouts:
+                return "receive timeouts";
+            case Counter::errors:
+                return "errors";
+            case Counter::unknownPackets:
+                return "unknown packets";
+        }
+        return "unknown";
+    }
+
+
+    void LatencyHistogram::record(std::chrono::nanoseconds latency)
+    {
+        const auto micros = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+        const auto value = std::min(static_cast<std::uint64_t>(std::max<std::int64_t>(micros, 0)), maxValue);
+
+        buckets[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(1, std::memory_order_relaxed);
+
+        auto current = maximum.load(std::memory_order_relaxed);
+
+        while ((value > current) && (maximum.compare_exchange_weak(current, value, std::memory_order_relaxed) == false))
+        {
+        }
+    }
+
+    void LatencyHistogram::reset()
+    {
+        std::for_each(buckets.begin(), buckets.end(), [](auto& bucket) { bucket.store(0, std::memory_order_relaxed); });
+        total.store(0, std::memory_order_relaxed);
+        maximum.store(0, std::memory_order_relaxed);
+    }
+
+    std::uint64_t LatencyHistogram::count() const
+    {
+        return total.load(std::memory_order_relaxed);
+    }
+
+    std::chrono::microseconds LatencyHistogram::max() const
+    {
+        return std::chrono::microseconds{maximum.load(std::memory_order_relaxed)};
+    }
+
+    std::chrono::microseconds LatencyHistogram::percentile(double p) const
+    {
+        const auto recorded = count();
+
+        if (recorded == 0)
+        {
+            return std::chrono::microseconds{0};
+        }
+
+        const auto target = std::max<std::uint64_t>(static_cast<std::uint64_t>(std::ceil(std::clamp(p, 0.0, 100.0) / 100.0 * static_cast<double>(recorded))), 1);
+        const auto highest = static_cast<std::uint64_t>(max().count());
+        std::uint64_t seen{0};
+
+        for (std::size_t i = 0; i < buckets.size(); ++i)
+        {
+            seen += buckets[i].load(std::memory_order_relaxed);
+
+            if (seen >= target)
+            {
+                return std::chrono::microseconds{std::min(highestValueOf(i), highest)};
+            }
+        }
+        return max();
+    }
+
+
+    const LatencySummary& StatsSnapshot::latency(Operation operation) const
+    {
+        return latencies[static_cast<std::size_t>(operation)];
+    }
+
+    std::uint64_t StatsSnapshot::counter(Counter counter) const
+    {
+        return counters[static_cast<std::size_t>(counter)];
+    }
+
+    std::ostream& operator<<(std::ostream& os, const StatsSnapshot& snapshot)
+    {
+        os << std::left << std::setw(18) << "operation" << std::right << std::setw(8) << "count"
+           << std::setw(10) << "p50 ms" << std::setw(10) << "p90 ms" << std::setw(10) << "p99 ms" << std::setw(10) << "max ms" << '\n';
+
+        for (std::size_t i = 0; i < operationCount; ++i)
+        {
+            const auto& latency = snapshot.latencies[i];
+            os << std::left << std::setw(18) << nameOf(static_cast<Operation>(i)) << std::right << std::setw(8) << latency.count << ' ';
+            printMillis(os, latency.p50);
+            os << ' ';
+            printMillis(os, latency.p90);
+            os << ' ';
+            printMillis(os, latency.p99);
+            os << ' ';
+            printMillis(os, latency.max);
+            os << '\n';
+        }
+
+        for (std::size_t i = 0; i < counterCount; ++i)
+        {
+            os << std::left << std::setw(18) << nameOf(static_cast<Counter>(i)) << std::right << std::setw(8) << snapshot.counters[i] << '\n';
+        }
+        return os;
+    }
+
+
+    Stats::Timer::Timer(Stats& stats, Operation operation)
+        : owner(stats), op(operation), start(std::chrono::steady_clock::now())
+    {
+    }
+
+    Stats::Timer::~Timer()
+    {
+        owner.record(op, std::chrono::steady_clock::now() - start);
+    }
+
+    void Stats::record(Operation operation, std::chrono::nanoseconds latency)
+    {
+        histograms[static_cast<std::size_t>(operation)].record(latency);
+    }
+
+    void Stats::add(Counter counter, std::uint64_t value)
+    {
+        counters[static_cast<std::size_t>(counter)].fetch_add(value, std::memory_order_relaxed);
+    }
+
+    Stats::Timer Stats::measure(Operation operation)
+    {
+        return Timer{*this, operation};
+    }
+
+    StatsSnapshot Stats::snapshot() const
+    {
+        StatsSnapshot result{};
+
+        for (std::size_t i = 0; i < operationCount; ++i)
+        {
+            const auto& histogram = histograms[i];
+            result.latencies[i] = LatencySummary{histogram.count(), histogram.percentile(50.0), histogram.percentile(90.0), histogram.percentile(99.0), histogram.max()};
+        }
+
+        for (std::size_t i = 0; i < counterCount; ++i)
+        {
+            result.counters[i] = counters[i].load(std::memory_order_relaxed);
+        }
+        return result;
+    }
+
+    void Stats::reset()
+    {
+        std::for_each(histograms.begin(), histograms.end(), [](auto& histogram) { histogram.reset(); });
+        std::for_each(counters.begin(), counters.end(), [](auto& counter) { counter.store(0, std::memory_order_relaxed); });
+    }
+}
@@ -19,18 +19,18 @@
  */
 
 #include "com/UsbComm.h"
+#include "com/UsbTransferEngine.h"
 #include "com/CommunicationException.h"
 #include <algorithm>
-#include <chrono>
+#include <array>
+#include <iomanip>
+#include <sstream>
 #include <libusb-1.0/libusb.h>
 
 namespace plug::com
 {
     namespace
     {
-
-        inline constexpr std::chrono::milliseconds timeout{500};
-
         inline constexpr std::uint8_t endpointSend{0x01};
         inline constexpr std::uint8_t endpointRecv{0x81};
 
@@ -42,10 +42,41 @@ namespace plug::com
                 throw CommunicationException{msg};
             }
         }
+
+        std::string readSerialNumber(libusb_device_handle* handle)
+        {
+            libusb_device_descriptor descriptor{};
+
+            if ((libusb_get_device_descriptor(libusb_get_device(handle), &descriptor) != LIBUSB_SUCCESS) || (descriptor.iSerialNumber == 0))
+            {
+                return "";
+            }
+
+            std::array<unsigned char, 128> buffer{{}};
+            const int size = libusb_get_string_descriptor_ascii(handle, descriptor.iSerialNumber, buffer.data(), static_cast<int>(buffer.size()));
+
+            if (size <= 0)
+            {
+                return "";
+            }
+            return std::string(buffer.cbegin(), std::next(buffer.cbegin(), size));
+        }
+
+        std::string makeDeviceId(std::uint16_t pid, const std::string& serialNumber)
+        {
+            std::ostringstream os;
+            os << std::hex << std::setw(4) << std::setfill('0') << pid;
+
+            if (serialNumber.empty() == false)
+            {
+                os << '-' << serialNumber;
+            }
+            return os.str();
+        }
     }
 
     UsbComm::UsbComm()
-        : handle(nullptr)
+        : handle(nullptr), product(0), statistics(std::make_shared<Stats>())
     {
     }
 
@@ -63,7 +94,7 @@ namespace plug::com
     {
         libusb_init(nullptr);
 
-        std::find_if(pids.begin(), pids.end(), [this, vid](const auto& pid) {
+        const auto opened = std::find_if(pids.begin(), pids.end(), [this, vid](const auto& pid) {
             handle = libusb_open_device_with_vid_pid(nullptr, vid, pid);
             return (handle != nullptr);
         });
@@ -74,6 +105,8 @@ namespace plug::com
         }
 
         initInterface();
+        product = *opened;
+        id = makeDeviceId(*opened, readSerialNumber(handle));
     }
 
     void UsbComm::close()
@@ -89,92 +122,106 @@ namespace plug::com
     
     std::vector<std::uint8_t> UsbComm::receive(std::size_t recvSize)
     {
-        int actualTransfered{0};
-        std::vector<std::uint8_t> buffer(recvSize);
-        const auto rtn = libusb_interrupt_transfer(handle, endpointRecv, buffer.data(), 
-                    static_cast<int>(buffer.size()), &actualTransfered, 1000 /*timeout.count()*/);
+        return receiveAsync(recvSize).get();
+    }
+
+    std::future<std::vector<std::uint8_t>> UsbComm::receiveAsync(std::size_t recvSize)
+    {
+        return transfers().receive(recvSize);
+    }
 
-        if (rtn != LIBUSB_ERROR_TIMEOUT)
+    void UsbComm::discardReceived()
+    {
+        if (engine != nullptr)
         {
-            checked(rtn, "Interrupt receive failed");
+            engine->discardReceived();
         }
+    }
 
-    //printf("received %d\n",rtn);
+    std::size_t UsbComm::sendImpl(const std::uint8_t* data, std::size_t size)
+    {
+        auto& transfer = transfers();
+        transfer.sendQueued(data, size);
+        return transfer.waitSent();
+    }
 
-        buffer.resize(static_cast<std::size_t>(actualTransfered));
+    std::future<std::size_t> UsbComm::sendAsyncImpl(const std::uint8_t* data, std::size_t size)
+    {
+        return transfers().send(data, size);
+    }
+
+    void UsbComm::sendQueuedImpl(const std::uint8_t* data, std::size_t size)
+    {
+        transfers().sendQueued(data, size);
+    }
 
-        return buffer;
+    void UsbComm::waitSent()
+    {
+        if (engine != nullptr)
+        {
+            engine->waitSent();
+        }
     }
 
+    std::size_t UsbComm::receiveIntoImpl(std::uint8_t* buffer, std::size_t size)
+    {
+        return transfers().receiveInto(buffer, size);
+    }
 
-#if 0
-    std::size_t UsbComm::sendImpl(std::uint8_t* data, std::size_t size)
+    std::size_t UsbComm::receiveWithinImpl(std::uint8_t* buffer, std::size_t size, std::chrono::milliseconds timeout)
     {
-        int actualTransfered{0};
-        const auto rtn = libusb_interrupt_transfer(handle, endpointSend, data, static_cast<int>(size), &actualTransfered, timeout.count());
-        checked(rtn, "Interrupt write failed");
+        return transfers().receiveWithin(buffer, size, timeout);
+    }
 
-        return static_cast<std::size_t>(actualTransfered);
+    std::vector<std::vector<std::uint8_t>> UsbComm::takeReceived()
+    {
+        if (engine == nullptr)
+        {
+            return {};
+        }
+        return engine->takeReceived();
     }
 
-    std::vector<std::uint8_t> UsbComm::receive(std::size_t recvSize)
+    void UsbComm::setReceiveListener(std::function<void()> listener)
     {
-        int actualTransfered{0};
-        int totalTransfered{0};
-
-        std::vector<std::uint8_t> buffer(recvSize);
-        while ( totalTransfered < 64 ) {
-            const auto rtn = libusb_interrupt_transfer(handle, endpointRecv, buffer.data(), static_cast<int>(buffer.size()), &actualTransfered, timeout.count());
-        totalTransfered += actualTransfered;
-          // printf("received: %d/%d\n",actualTransfered , totalTransfered); 
-            if ( rtn!=0 ) { 
-                if (rtn != LIBUSB_ERROR_TIMEOUT)
-                {
-                    checked(rtn, "Interrupt receive failed");
-                    break;
-                }
-            }
+        receiveListener = listener;
+
+        if (engine != nullptr)
+        {
+            engine->setReceiveListener(std::move(listener));
         }
-    //printf("...\n");
-
-        buffer.resize(static_cast<std::size_t>(totalTransfered));
-
-        return buffer;
-    }
-
-#else
-
-    std::size_t UsbComm::sendImpl(std::uint8_t* data, std::size_t size)
-    {
-        int actualTransfered{0};
-        int totalTransfered{0};
-        int attempts{5};
-        
-        while ( totalTransfered < 64 ) {
-            const auto rtn = libusb_interrupt_transfer(handle, endpointSend, data, static_cast<int>(size), &actualTransfered, timeout.count());
-            totalTransfered += actualTransfered;
-          //  printf("transmitted: %d/%d\n",actualTransfered , totalTransfered); 
-            if ( rtn ) {
-                if ( rtn==LIBUSB_ERROR_TIMEOUT ) {
-                    // Up to five retries on timeout
-                    if ( attempts==0 ) 
-                        break;
-                    else  
-                        attempts--;
-                }        //checked(rtn, "Interrupt write failed");
-                else break;
-            }
+    }
+
+    std::string UsbComm::deviceId() const
+    {
+        return id;
+    }
+
+    std::uint16_t UsbComm::productId() const
+    {
+        return product;
+    }
+
+    std::shared_ptr<Stats> UsbComm::stats() const
+    {
+        return statistics;
+    }
+
+    UsbTransferEngine& UsbComm::transfers()
+    {
+        if (engine == nullptr)
+        {
+            throw CommunicationException{"Device not connected"};
         }
-        if (totalTransfered < 64)
-            throw CommunicationException{"Interrupt write failed"};
-        return static_cast<std::size_t>(totalTransfered);
+        return *engine;
     }
-#endif
 
     void UsbComm::closeAndRelease()
     {
         if (handle != nullptr)
         {
+            engine.reset();
+
             if (libusb_release_interface(handle, 0) != LIBUSB_ERROR_NO_DEVICE)
             {
                 libusb_attach_kernel_driver(handle, 0);
@@ -183,6 +230,7 @@ namespace plug::com
             libusb_close(handle);
             libusb_exit(nullptr);
             handle = nullptr;
+            id.clear();
         }
     }
 
@@ -194,5 +242,8 @@ namespace plug::com
         }
 
         checked(libusb_claim_interface(handle, 0), "Claiming interface failed");
+
+        engine = std::make_unique<UsbTransferEngine>(handle, endpointSend, endpointRecv, *statistics);
+        engine->setReceiveListener(receiveListener);
     }
 }
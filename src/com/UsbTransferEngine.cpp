@@ -0,0 +1,620 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "com/UsbTransferEngine.h"
+#include "com/CommunicationException.h"
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <utility>
+#include <libusb-1.0/libusb.h>
+
+namespace plug::com
+{
+    namespace
+    {
+        inline constexpr std::size_t outTransferCount{8};
+        inline constexpr std::size_t inTransferCount{4};
+        inline constexpr int sendRetries{5};
+
+        inline constexpr std::chrono::milliseconds sendTimeout{500};
+        inline constexpr std::chrono::milliseconds receiveTimeout{1000};
+        inline constexpr std::chrono::microseconds eventTimeout{50000};
+
+
+        libusb_transfer* allocTransfer()
+        {
+            auto transfer = libusb_alloc_transfer(0);
+
+            if (transfer == nullptr)
+            {
+                throw CommunicationException{"Allocating transfer failed"};
+            }
+            return transfer;
+        }
+
+        template <class T>
+        std::future<T> readyFuture(T value)
+        {
+            std::promise<T> result;
+            result.set_value(std::move(value));
+            return result.get_future();
+        }
+    }
+
+
+    struct UsbTransferEngine::OutTransfer
+    {
+        explicit OutTransfer(UsbTransferEngine* e)
+            : engine(e), transfer(allocTransfer()), retries(0)
+        {
+        }
+
+        ~OutTransfer()
+        {
+            libusb_free_transfer(transfer);
+        }
+
+        UsbTransferEngine* const engine;
+        libusb_transfer* const transfer;
+        std::array<std::uint8_t, packetSize> buffer{{}};
+        std::optional<std::promise<std::size_t>> result;
+        std::chrono::steady_clock::time_point submitted;
+        int retries;
+    };
+
+    struct UsbTransferEngine::InTransfer
+    {
+        explicit InTransfer(UsbTransferEngine* e)
+            : engine(e), transfer(allocTransfer())
+        {
+        }
+
+        ~InTransfer()
+        {
+            libusb_free_transfer(transfer);
+        }
+
+        UsbTransferEngine* const engine;
+        libusb_transfer* const transfer;
+        std::array<std::uint8_t, packetSize> buffer{{}};
+    };
+
+
+    UsbTransferEngine::UsbTransferEngine(libusb_device_handle* h, std::uint8_t epSend, std::uint8_t epRecv, Stats& s)
+        : handle(h), endpointSend(epSend), endpointRecv(epRecv), stats(s), queuedSends(0), queuedBytes(0), queuedFailed(false),
+          received{}, receivedFirst(0), receivedCount(0), waitingReceives(0), inFlight(0), running(true)
+    {
+        for (std::size_t i = 0; i < outTransferCount; ++i)
+        {
+            outTransfers.push_back(std::make_unique<OutTransfer>(this));
+            idleOut.push_back(outTransfers.back().get());
+        }
+
+        for (std::size_t i = 0; i < inTransferCount; ++i)
+        {
+            inTransfers.push_back(std::make_unique<InTransfer>(this));
+        }
+
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+
+            const bool submitted = std::all_of(inTransfers.cbegin(), inTransfers.cend(), [this](const auto& in) { return submitReceive(*in); });
+
+            if (submitted == false)
+            {
+                running = false;
+            }
+        }
+
+        if (running == false)
+        {
+            shutdown();
+            throw CommunicationException{"Interrupt receive failed"};
+        }
+
+        eventThread = std::thread{[this] { handleEvents(); }};
+    }
+
+    UsbTransferEngine::~UsbTransferEngine()
+    {
+        shutdown();
+    }
+
+    std::future<std::size_t> UsbTransferEngine::send(const std::uint8_t* data, std::size_t size)
+    {
+        if (size == 0)
+        {
+            return readyFuture<std::size_t>(0);
+        }
+
+        if (size > packetSize)
+        {
+            throw CommunicationException{"Packet exceeds transfer size"};
+        }
+
+        auto& out = acquireOut(false);
+        out.result.emplace();
+        auto result = out.result->get_future();
+        submitOut(out, data, size);
+        return result;
+    }
+
+    std::future<std::vector<std::uint8_t>> UsbTransferEngine::receive(std::size_t recvSize)
+    {
+        if (recvSize == 0)
+        {
+            return readyFuture(std::vector<std::uint8_t>{});
+        }
+
+        std::promise<std::vector<std::uint8_t>> result;
+        auto future = result.get_future();
+        const auto now = std::chrono::steady_clock::now();
+        std::unique_lock<std::mutex> lock{mutex};
+
+        if (receivedCount > 0)
+        {
+            std::vector<std::uint8_t> data(recvSize);
+            data.resize(popReceived(data.data(), data.size()));
+            lock.unlock();
+
+            // Already queued, there's no round trip to measure
+            result.set_value(std::move(data));
+        }
+        else if (receiveError != nullptr)
+        {
+            lock.unlock();
+            result.set_exception(receiveError);
+        }
+        else
+        {
+            pendingReceives.push_back({std::move(result), recvSize, now, now + receiveTimeout});
+        }
+
+        return future;
+    }
+
+    // Returns once a transfer is available, without waiting for the send
+    // to complete; failures are reported by waitSent().
+    void UsbTransferEngine::sendQueued(const std::uint8_t* data, std::size_t size)
+    {
+        if (size == 0)
+        {
+            return;
+        }
+
+        if (size > packetSize)
+        {
+            throw CommunicationException{"Packet exceeds transfer size"};
+        }
+
+        submitOut(acquireOut(true), data, size);
+    }
+
+    // Waits for all queued sends and returns the number of bytes sent
+    std::size_t UsbTransferEngine::waitSent()
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+        outAvailable.wait(lock, [this] { return queuedSends == 0; });
+
+        const auto bytes = std::exchange(queuedBytes, 0);
+
+        if (std::exchange(queuedFailed, false) == true)
+        {
+            throw CommunicationException{"Interrupt write failed"};
+        }
+        return bytes;
+    }
+
+    // Returns the size of the packet received, 0 on timeout
+    std::size_t UsbTransferEngine::receiveInto(std::uint8_t* buffer, std::size_t size)
+    {
+        const auto count = waitReceived(buffer, size, receiveTimeout);
+
+        if ((count == 0) && (size != 0))
+        {
+            stats.add(Counter::receiveTimeouts);
+        }
+        return count;
+    }
+
+    // Like receiveInto(), but a timeout is expected and not counted
+    std::size_t UsbTransferEngine::receiveWithin(std::uint8_t* buffer, std::size_t size, std::chrono::milliseconds timeout)
+    {
+        return waitReceived(buffer, size, timeout);
+    }
+
+    std::size_t UsbTransferEngine::waitReceived(std::uint8_t* buffer, std::size_t size, std::chrono::milliseconds timeout)
+    {
+        if (size == 0)
+        {
+            return 0;
+        }
+
+        const auto requested = std::chrono::steady_clock::now();
+        std::unique_lock<std::mutex> lock{mutex};
+        const bool queued = (receivedCount > 0);
+        ++waitingReceives;
+        packetArrived.wait_until(lock, requested + timeout, [this] { return (receivedCount > 0) || (receiveError != nullptr); });
+        --waitingReceives;
+
+        if (receivedCount > 0)
+        {
+            const auto count = popReceived(buffer, size);
+            lock.unlock();
+
+            if (queued == false)
+            {
+                stats.record(Operation::receive, std::chrono::steady_clock::now() - requested);
+            }
+            return count;
+        }
+
+        if (receiveError != nullptr)
+        {
+            const auto error = receiveError;
+            lock.unlock();
+            std::rethrow_exception(error);
+        }
+        return 0;
+    }
+
+    void UsbTransferEngine::discardReceived()
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        receivedCount = 0;
+    }
+
+    std::vector<std::vector<std::uint8_t>> UsbTransferEngine::takeReceived()
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        std::vector<std::vector<std::uint8_t>> packets;
+        packets.reserve(receivedCount);
+
+        while (receivedCount > 0)
+        {
+            std::vector<std::uint8_t> data(packetSize);
+            data.resize(popReceived(data.data(), data.size()));
+            packets.push_back(std::move(data));
+        }
+        return packets;
+    }
+
+    void UsbTransferEngine::setReceiveListener(std::function<void()> listener)
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        receiveListener = std::move(listener);
+    }
+
+    void UsbTransferEngine::onSendCompleted(libusb_transfer* transfer)
+    {
+        auto& out = *static_cast<OutTransfer*>(transfer->user_data);
+        out.engine->completeSend(out);
+    }
+
+    void UsbTransferEngine::onReceiveCompleted(libusb_transfer* transfer)
+    {
+        auto& in = *static_cast<InTransfer*>(transfer->user_data);
+        in.engine->completeReceive(in);
+    }
+
+    void UsbTransferEngine::completeSend(OutTransfer& out)
+    {
+        const auto status = out.transfer->status;
+
+        // A resubmitted send can't stall shutdown(), it's bounded by its timeout
+        if ((status == LIBUSB_TRANSFER_TIMED_OUT) && (out.retries > 0) && (isRunning() == true))
+        {
+            --out.retries;
+            stats.add(Counter::sendRetries);
+
+            if (libusb_submit_transfer(out.transfer) == LIBUSB_SUCCESS)
+            {
+                return;
+            }
+        }
+
+        const bool completed = (status == LIBUSB_TRANSFER_COMPLETED);
+        const auto transferred = static_cast<std::size_t>(out.transfer->actual_length);
+        const bool queued = (out.result.has_value() == false);
+
+        if (completed == true)
+        {
+            stats.record(Operation::send, std::chrono::steady_clock::now() - out.submitted);
+            stats.add(Counter::packetsSent);
+            stats.add(Counter::bytesSent, transferred);
+        }
+        else
+        {
+            stats.add(Counter::errors);
+        }
+
+        if (queued == false)
+        {
+            if (completed == true)
+            {
+                out.result->set_value(transferred);
+            }
+            else
+            {
+                out.result->set_exception(std::make_exception_ptr(CommunicationException{"Interrupt write failed"}));
+            }
+            out.result.reset();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+
+            if (queued == true)
+            {
+                --queuedSends;
+                queuedBytes += (completed == true ? transferred : 0);
+                queuedFailed = (queuedFailed || (completed == false));
+            }
+            idleOut.push_back(&out);
+            --inFlight;
+        }
+        outAvailable.notify_all();
+    }
+
+    bool UsbTransferEngine::isRunning()
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        return running;
+    }
+
+    UsbTransferEngine::OutTransfer& UsbTransferEngine::acquireOut(bool queued)
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+        outAvailable.wait(lock, [this] { return (idleOut.empty() == false) || (running == false); });
+
+        if (running == false)
+        {
+            throw CommunicationException{"Device not connected"};
+        }
+
+        auto out = idleOut.back();
+        idleOut.pop_back();
+        ++inFlight;
+
+        if (queued == true)
+        {
+            ++queuedSends;
+        }
+        return *out;
+    }
+
+    void UsbTransferEngine::submitOut(OutTransfer& out, const std::uint8_t* data, std::size_t size)
+    {
+        std::copy_n(data, size, out.buffer.begin());
+        out.retries = sendRetries;
+        out.submitted = std::chrono::steady_clock::now();
+
+        libusb_fill_interrupt_transfer(out.transfer, handle, endpointSend, out.buffer.data(), static_cast<int>(size),
+                                       &UsbTransferEngine::onSendCompleted, &out, static_cast<unsigned int>(sendTimeout.count()));
+
+        if (libusb_submit_transfer(out.transfer) != LIBUSB_SUCCESS)
+        {
+            const bool queued = (out.result.has_value() == false);
+            out.result.reset();
+            {
+                std::lock_guard<std::mutex> lock{mutex};
+                idleOut.push_back(&out);
+                --inFlight;
+
+                if (queued == true)
+                {
+                    --queuedSends;
+                }
+            }
+            outAvailable.notify_all();
+            stats.add(Counter::errors);
+            throw CommunicationException{"Interrupt write failed"};
+        }
+    }
+
+    void UsbTransferEngine::completeReceive(InTransfer& in)
+    {
+        const auto status = in.transfer->status;
+
+        if (status == LIBUSB_TRANSFER_COMPLETED)
+        {
+            stats.add(Counter::packetsReceived);
+            stats.add(Counter::bytesReceived, static_cast<std::uint64_t>(in.transfer->actual_length));
+            deliver(in.buffer.data(), static_cast<std::size_t>(in.transfer->actual_length));
+        }
+        else if ((status != LIBUSB_TRANSFER_TIMED_OUT) && (status != LIBUSB_TRANSFER_CANCELLED))
+        {
+            fail(std::make_exception_ptr(CommunicationException{"Interrupt receive failed"}));
+        }
+
+        std::lock_guard<std::mutex> lock{mutex};
+        --inFlight;
+
+        if ((running == true) && (receiveError == nullptr) && (submitReceive(in) == false))
+        {
+            receiveError = std::make_exception_ptr(CommunicationException{"Interrupt receive failed"});
+        }
+    }
+
+    // Requires the lock being held, so shutdown() can't miss a resubmitted transfer
+    bool UsbTransferEngine::submitReceive(InTransfer& in)
+    {
+        libusb_fill_interrupt_transfer(in.transfer, handle, endpointRecv, in.buffer.data(), static_cast<int>(in.buffer.size()),
+                                       &UsbTransferEngine::onReceiveCompleted, &in, 0);
+
+        if (libusb_submit_transfer(in.transfer) != LIBUSB_SUCCESS)
+        {
+            return false;
+        }
+        ++inFlight;
+        return true;
+    }
+
+    // Packets arriving while nobody waits for them are reported to the listener
+    void UsbTransferEngine::deliver(const std::uint8_t* data, std::size_t size)
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+
+        if (pendingReceives.empty() == true)
+        {
+            pushReceived(data, size);
+            const auto listener = (waitingReceives == 0 ? receiveListener : nullptr);
+            lock.unlock();
+            packetArrived.notify_all();
+
+            if (listener != nullptr)
+            {
+                listener();
+            }
+            return;
+        }
+
+        auto pending = std::move(pendingReceives.front());
+        pendingReceives.pop_front();
+        lock.unlock();
+
+        stats.record(Operation::receive, std::chrono::steady_clock::now() - pending.requested);
+        pending.result.set_value(std::vector<std::uint8_t>(data, data + std::min(size, pending.size)));
+    }
+
+    // Requires the lock being held; the oldest packet is dropped if the ring is full
+    void UsbTransferEngine::pushReceived(const std::uint8_t* data, std::size_t size)
+    {
+        if (receivedCount == received.size())
+        {
+            receivedFirst = (receivedFirst + 1) % received.size();
+            --receivedCount;
+            stats.add(Counter::errors);
+        }
+
+        auto& slot = received[(receivedFirst + receivedCount) % received.size()];
+        slot.size = std::min(size, slot.data.size());
+        std::copy_n(data, slot.size, slot.data.begin());
+        ++receivedCount;
+    }
+
+    // Requires the lock being held and a packet available
+    std::size_t UsbTransferEngine::popReceived(std::uint8_t* buffer, std::size_t size)
+    {
+        const auto& slot = received[receivedFirst];
+        const auto count = std::min(size, slot.size);
+        std::copy_n(slot.data.cbegin(), count, buffer);
+
+        receivedFirst = (receivedFirst + 1) % received.size();
+        --receivedCount;
+        return count;
+    }
+
+    void UsbTransferEngine::fail(std::exception_ptr error)
+    {
+        std::deque<PendingReceive> failed;
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            receiveError = error;
+            failed.swap(pendingReceives);
+        }
+        packetArrived.notify_all();
+        stats.add(Counter::errors);
+
+        std::for_each(failed.begin(), failed.end(), [&error](auto& pending) { pending.result.set_exception(error); });
+    }
+
+    void UsbTransferEngine::expireReceives()
+    {
+        std::deque<PendingReceive> expired;
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            const auto now = std::chrono::steady_clock::now();
+            const auto end = std::find_if(pendingReceives.begin(), pendingReceives.end(), [now](const auto& pending) { return pending.deadline > now; });
+
+            std::move(pendingReceives.begin(), end, std::back_inserter(expired));
+            pendingReceives.erase(pendingReceives.begin(), end);
+        }
+
+        if (expired.empty() == false)
+        {
+            stats.add(Counter::receiveTimeouts, expired.size());
+        }
+
+        std::for_each(expired.begin(), expired.end(), [](auto& pending) { pending.result.set_value({}); });
+    }
+
+    std::chrono::microseconds UsbTransferEngine::nextEventTimeout()
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        if (pendingReceives.empty() == true)
+        {
+            return eventTimeout;
+        }
+
+        const auto remaining = std::chrono::duration_cast<std::chrono::microseconds>(pendingReceives.front().deadline - std::chrono::steady_clock::now());
+        return std::clamp(remaining, std::chrono::microseconds{0}, eventTimeout);
+    }
+
+    void UsbTransferEngine::handleEvents()
+    {
+        while (true)
+        {
+            {
+                std::lock_guard<std::mutex> lock{mutex};
+
+                if ((running == false) && (inFlight == 0))
+                {
+                    break;
+                }
+            }
+
+            const auto timeout = nextEventTimeout();
+            timeval tv{0, static_cast<suseconds_t>(timeout.count())};
+            libusb_handle_events_timeout_completed(nullptr, &tv, nullptr);
+            expireReceives();
+        }
+    }
+
+    void UsbTransferEngine::shutdown()
+    {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            running = false;
+        }
+        outAvailable.notify_all();
+
+        std::for_each(outTransfers.cbegin(), outTransfers.cend(), [](const auto& out) { libusb_cancel_transfer(out->transfer); });
+        std::for_each(inTransfers.cbegin(), inTransfers.cend(), [](const auto& in) { libusb_cancel_transfer(in->transfer); });
+
+        if (eventThread.joinable() == true)
+        {
+            eventThread.join();
+        }
+        else
+        {
+            handleEvents();
+        }
+
+        std::deque<PendingReceive> remaining;
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            remaining.swap(pendingReceives);
+        }
+        std::for_each(remaining.begin(), remaining.end(), [](auto& pending) { pending.result.set_value({}); });
+    }
+}
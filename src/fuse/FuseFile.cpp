@@ -0,0 +1,779 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fuse/FuseFile.h"
+#include "com/IdLookup.h"
+#include "com/ModelTable.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+
+namespace plug::fuse
+{
+    namespace
+    {
+        enum class Section
+        {
+            none,
+            amp,
+            fx,
+            fuse
+        };
+
+        struct Tag
+        {
+            std::string_view name;
+            std::string_view attributes;
+            bool closing;
+            bool empty;
+        };
+
+        inline constexpr std::array<std::string_view, 4> fxKinds{{"Stompbox", "Modulation", "Delay", "Reverb"}};
+        inline constexpr std::size_t positionCount{8};
+
+
+        constexpr bool isSpace(char c)
+        {
+            return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r');
+        }
+
+        std::string_view trim(std::string_view text)
+        {
+            while ((text.empty() == false) && (isSpace(text.front()) == true))
+            {
+                text.remove_prefix(1);
+            }
+            while ((text.empty() == false) && (isSpace(text.back()) == true))
+            {
+                text.remove_suffix(1);
+            }
+            return text;
+        }
+
+        // Digits only, without sign or whitespace; empty if anything else is
+        // found or the value exceeds max
+        std::optional<std::uint32_t> parseDigits(std::string_view digits, std::uint32_t base, std::uint32_t max)
+        {
+            if (digits.empty() == true)
+            {
+                return std::nullopt;
+            }
+
+            std::uint64_t value{0};
+
+            for (const char c : digits)
+            {
+                std::uint32_t digit{base};
+
+                if ((c >= '0') && (c <= '9'))
+                {
+                    digit = static_cast<std::uint32_t>(c - '0');
+                }
+                else if ((c >= 'a') && (c <= 'f'))
+                {
+                    digit = static_cast<std::uint32_t>(c - 'a' + 10);
+                }
+                else if ((c >= 'A') && (c <= 'F'))
+                {
+                    digit = static_cast<std::uint32_t>(c - 'A' + 10);
+                }
+
+                if (digit >= base)
+                {
+                    return std::nullopt;
+                }
+
+                value = value * base + digit;
+
+                if (value > max)
+                {
+                    return std::nullopt;
+                }
+            }
+            return static_cast<std::uint32_t>(value);
+        }
+
+        // Anything not a number is 0, as with QString::toInt()
+        int toInt(std::string_view text)
+        {
+            text = trim(text);
+            const bool negative = (text.empty() == false) && (text.front() == '-');
+
+            if ((text.empty() == false) && ((text.front() == '+') || (negative == true)))
+            {
+                text.remove_prefix(1);
+            }
+
+            constexpr auto maxValue = static_cast<std::uint32_t>(std::numeric_limits<int>::max());
+            const auto value = parseDigits(text, 10, (negative == true ? maxValue + 1 : maxValue));
+
+            if (value.has_value() == false)
+            {
+                return 0;
+            }
+            return (negative == true ? static_cast<int>(-static_cast<std::int64_t>(*value)) : static_cast<int>(*value));
+        }
+
+        std::uint8_t knobValue(std::string_view text)
+        {
+            return static_cast<std::uint8_t>(toInt(text) >> 8);
+        }
+
+        // Value of an attribute as written, entities aren't decoded
+        std::string_view attribute(std::string_view attributes, std::string_view name)
+        {
+            std::size_t pos{0};
+
+            while (pos < attributes.size())
+            {
+                const auto equals = attributes.find('=', pos);
+
+                if (equals == std::string_view::npos)
+                {
+                    break;
+                }
+
+                const auto key = trim(attributes.substr(pos, equals - pos));
+                const auto quote = attributes.find_first_not_of(" \t\r\n", equals + 1);
+
+                if ((quote == std::string_view::npos) || ((attributes[quote] != '"') && (attributes[quote] != '\'')))
+                {
+                    break;
+                }
+
+                const auto end = attributes.find(attributes[quote], quote + 1);
+
+                if (end == std::string_view::npos)
+                {
+                    break;
+                }
+
+                if (key == name)
+                {
+                    return attributes.substr(quote + 1, end - quote - 1);
+                }
+                pos = end + 1;
+            }
+            return {};
+        }
+
+        void appendUtf8(std::string& out, std::uint32_t codePoint)
+        {
+            if (codePoint < 0x80)
+            {
+                out.push_back(static_cast<char>(codePoint));
+            }
+            else if (codePoint < 0x800)
+            {
+                out.push_back(static_cast<char>(0xc0 | (codePoint >> 6)));
+                out.push_back(static_cast<char>(0x80 | (codePoint & 0x3f)));
+            }
+            else if (codePoint < 0x10000)
+            {
+                out.push_back(static_cast<char>(0xe0 | (codePoint >> 12)));
+                out.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f)));
+                out.push_back(static_cast<char>(0x80 | (codePoint & 0x3f)));
+            }
+            else
+            {
+                out.push_back(static_cast<char>(0xf0 | (codePoint >> 18)));
+                out.push_back(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3f)));
+                out.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f)));
+                out.push_back(static_cast<char>(0x80 | (codePoint & 0x3f)));
+            }
+        }
+
+        std::optional<std::uint32_t> characterReference(std::string_view entity)
+        {
+            const bool hex = (entity.size() > 1) && ((entity[1] == 'x') || (entity[1] == 'X'));
+            const auto digits = entity.substr(hex == true ? 2 : 1);
+            return parseDigits(digits, (hex == true ? 16 : 10), 0x10ffff);
+        }
+
+        // Unknown entities are kept as they are
+        std::string decode(std::string_view text)
+        {
+            std::string out;
+            out.reserve(text.size());
+
+            while (text.empty() == false)
+            {
+                const auto amp = text.find('&');
+                const auto semicolon = text.find(';', amp);
+                out.append(text.substr(0, amp));
+
+                if ((amp == std::string_view::npos) || (semicolon == std::string_view::npos))
+                {
+                    out.append(text.substr(std::min(amp, text.size())));
+                    break;
+                }
+
+                const auto entity = text.substr(amp + 1, semicolon - amp - 1);
+                const auto reference = ((entity.empty() == false) && (entity.front() == '#') ? characterReference(entity) : std::nullopt);
+
+                if (reference.has_value() == true)
+                {
+                    appendUtf8(out, *reference);
+                }
+                else if (entity == "amp")
+                {
+                    out.push_back('&');
+                }
+                else if (entity == "lt")
+                {
+                    out.push_back('<');
+                }
+                else if (entity == "gt")
+                {
+                    out.push_back('>');
+                }
+                else if (entity == "quot")
+                {
+                    out.push_back('"');
+                }
+                else if (entity == "apos")
+                {
+                    out.push_back('\'');
+                }
+                else
+                {
+                    out.append(text.substr(amp, semicolon - amp + 1));
+                }
+                text.remove_prefix(semicolon + 1);
+            }
+            return out;
+        }
+
+
+        // Walks the tags of a document without building a tree; comments,
+        // declarations and CDATA sections are skipped.
+        class Scanner
+        {
+        public:
+            explicit Scanner(std::string_view document)
+                : text(document), pos(0)
+            {
+            }
+
+            std::optional<Tag> next()
+            {
+                while (true)
+                {
+                    const auto open = text.find('<', pos);
+
+                    if (open == std::string_view::npos)
+                    {
+                        return std::nullopt;
+                    }
+
+                    const auto rest = text.substr(open);
+
+                    if (startsWith(rest, "<!--") == true)
+                    {
+                        skipPast(open, "-->");
+                    }
+                    else if (startsWith(rest, "<![CDATA[") == true)
+                    {
+                        skipPast(open, "]]>");
+                    }
+                    else if (startsWith(rest, "<?") == true)
+                    {
+                        skipPast(open, "?>");
+                    }
+                    else if (startsWith(rest, "<!") == true)
+                    {
+                        skipPast(open, ">");
+                    }
+                    else
+                    {
+                        return tagAt(open);
+                    }
+                }
+            }
+
+            // Character data up to the next tag
+            std::string_view content() const
+            {
+                const auto end = text.find('<', pos);
+                return text.substr(pos, (end == std::string_view::npos ? std::string_view::npos : end - pos));
+            }
+
+        private:
+            static bool startsWith(std::string_view value, std::string_view prefix)
+            {
+                return value.substr(0, prefix.size()) == prefix;
+            }
+
+            void skipPast(std::size_t open, std::string_view terminator)
+            {
+                const auto end = text.find(terminator, open);
+
+                if (end == std::string_view::npos)
+                {
+                    throw std::invalid_argument{"Unterminated markup"};
+                }
+                pos = end + terminator.size();
+            }
+
+            // Attribute values may contain '>'
+            Tag tagAt(std::size_t open)
+            {
+                char quote{'\0'};
+                std::size_t close{open + 1};
+
+                for (; close < text.size(); ++close)
+                {
+                    const char c = text[close];
+
+                    if (quote != '\0')
+                    {
+                        quote = (c == quote ? '\0' : quote);
+                    }
+                    else if ((c == '"') || (c == '\''))
+                    {
+                        quote = c;
+                    }
+                    else if (c == '>')
+                    {
+                        break;
+                    }
+                }
+
+                if (close >= text.size())
+                {
+                    throw std::invalid_argument{"Unterminated tag"};
+                }
+
+                pos = close + 1;
+                auto inner = text.substr(open + 1, close - open - 1);
+                Tag tag{{}, {}, false, false};
+
+                if ((inner.empty() == false) && (inner.front() == '/'))
+                {
+                    tag.closing = true;
+                    inner.remove_prefix(1);
+                }
+                if ((inner.empty() == false) && (inner.back() == '/'))
+                {
+                    tag.empty = true;
+                    inner.remove_suffix(1);
+                }
+
+                const auto nameEnd = static_cast<std::size_t>(std::distance(inner.cbegin(), std::find_if(inner.cbegin(), inner.cend(), isSpace)));
+                tag.name = inner.substr(0, nameEnd);
+                tag.attributes = inner.substr(nameEnd);
+                return tag;
+            }
+
+            const std::string_view text;
+            std::size_t pos;
+        };
+
+
+        void applyAmpParam(amp_settings& amp, int index, std::string_view text)
+        {
+            switch (index)
+            {
+                case 0:
+                    amp.volume = knobValue(text);
+                    break;
+                case 1:
+                    amp.gain = knobValue(text);
+                    break;
+                case 2:
+                    amp.gain2 = knobValue(text);
+                    break;
+                case 3:
+                    amp.master_vol = knobValue(text);
+                    break;
+                case 4:
+                    amp.treble = knobValue(text);
+                    break;
+                case 5:
+                    amp.middle = knobValue(text);
+                    break;
+                case 6:
+                    amp.bass = knobValue(text);
+                    break;
+                case 7:
+                    amp.presence = knobValue(text);
+                    break;
+                case 9:
+                    amp.depth = knobValue(text);
+                    break;
+                case 10:
+                    amp.bias = knobValue(text);
+                    break;
+                case 15:
+                    amp.noise_gate = static_cast<std::uint8_t>(toInt(text));
+                    break;
+                case 16:
+                    amp.threshold = static_cast<std::uint8_t>(toInt(text));
+                    break;
+                case 17:
+                    if (const auto cabinet = findCabinetById(static_cast<std::uint32_t>(toInt(text))); cabinet.has_value() == true)
+                    {
+                        amp.cabinet = *cabinet;
+                    }
+                    break;
+                case 19:
+                    amp.sag = static_cast<std::uint8_t>(toInt(text));
+                    break;
+                case 20:
+                    amp.brightness = (toInt(text) != 0);
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        void applyEffectParam(fx_pedal_settings& effect, int index, std::string_view text)
+        {
+            switch (index)
+            {
+                case 0:
+                    effect.knob1 = knobValue(text);
+                    break;
+                case 1:
+                    effect.knob2 = knobValue(text);
+                    break;
+                case 2:
+                    effect.knob3 = knobValue(text);
+                    break;
+                case 3:
+                    effect.knob4 = knobValue(text);
+                    break;
+                case 4:
+                    effect.knob5 = knobValue(text);
+                    break;
+                case 5:
+                    effect.knob6 = knobValue(text);
+                    break;
+                default:
+                    break;
+            }
+        }
+
+
+        void appendNumber(std::string& out, int value)
+        {
+            out.append(std::to_string(value));
+        }
+
+        void appendEscaped(std::string& out, std::string_view text)
+        {
+            for (const char c : text)
+            {
+                switch (c)
+                {
+                    case '&':
+                        out.append("&amp;");
+                        break;
+                    case '<':
+                        out.append("&lt;");
+                        break;
+                    case '>':
+                        out.append("&gt;");
+                        break;
+                    case '"':
+                        out.append("&quot;");
+                        break;
+                    default:
+                        out.push_back(c);
+                        break;
+                }
+            }
+        }
+
+        // Knobs are stored in both bytes
+        constexpr int knob(std::uint8_t value)
+        {
+            return (value << 8) | value;
+        }
+
+        void appendParam(std::string& out, int index, int value)
+        {
+            out.append("<Param ControlIndex=\"");
+            appendNumber(out, index);
+            out.append("\">");
+            appendNumber(out, value);
+            out.append("</Param>");
+        }
+
+        void writeAmp(std::string& out, const amp_settings& amp)
+        {
+            const auto& descriptor = com::descriptorOf(amp.amp_num);
+            const int specific = descriptor.ampSpecific[0];
+            const int unknown = knob(descriptor.unknown[0]);
+
+            out.append("<Amplifier><Module ID=\"");
+            appendNumber(out, descriptor.model);
+            out.append("\" POS=\"0\" BypassState=\"1\">");
+            appendParam(out, 0, knob(amp.volume));
+            appendParam(out, 1, knob(amp.gain));
+            appendParam(out, 2, knob(amp.gain2));
+            appendParam(out, 3, knob(amp.master_vol));
+            appendParam(out, 4, knob(amp.treble));
+            appendParam(out, 5, knob(amp.middle));
+            appendParam(out, 6, knob(amp.bass));
+            appendParam(out, 7, knob(amp.presence));
+            appendParam(out, 8, unknown);
+            appendParam(out, 9, knob(amp.depth));
+            appendParam(out, 10, knob(amp.bias));
+            appendParam(out, 11, unknown);
+            appendParam(out, 12, specific);
+            appendParam(out, 13, specific);
+            appendParam(out, 14, specific);
+            appendParam(out, 15, amp.noise_gate);
+            appendParam(out, 16, amp.threshold);
+            appendParam(out, 17, com::descriptorOf(amp.cabinet).model);
+            appendParam(out, 18, specific);
+            appendParam(out, 19, amp.sag);
+            appendParam(out, 20, (amp.brightness == true ? 1 : 0));
+            appendParam(out, 21, 1);
+            appendParam(out, 22, knob(descriptor.ampSpecific[4]));
+            out.append("</Module></Amplifier>");
+        }
+
+        // The compressor has a single knob, some delays a sixth one
+        std::size_t knobCount(const com::EffectDescriptor& descriptor)
+        {
+            if (descriptor.knobLimits[1] == 0x00)
+            {
+                return 1;
+            }
+            return (descriptor.knobLimits[5] != 0x00 ? 6 : 5);
+        }
+
+        void writeEffect(std::string& out, const fx_pedal_settings& effect)
+        {
+            const auto& descriptor = com::descriptorOf(effect.effect_num);
+            const int position = (effect.position == Position::effectsLoop ? effect.fx_slot + 4 : effect.fx_slot);
+
+            out.append("<Module ID=\"");
+            appendNumber(out, descriptor.model);
+            out.append("\" POS=\"");
+            appendNumber(out, position);
+            out.append("\" BypassState=\"1\">");
+
+            if (effect.effect_num != effects::EMPTY)
+            {
+                const std::array<std::uint8_t, 6> knobs{{effect.knob1, effect.knob2, effect.knob3, effect.knob4, effect.knob5, effect.knob6}};
+
+                for (std::size_t i = 0; i < knobCount(descriptor); ++i)
+                {
+                    appendParam(out, static_cast<int>(i), knob(knobs[i]));
+                }
+            }
+            out.append("</Module>");
+        }
+
+        // The first effect of each kind is written, an empty module otherwise
+        void writeEffects(std::string& out, const std::array<fx_pedal_settings, 4>& effectList)
+        {
+            constexpr std::array<com::DSP, 4> kinds{{com::DSP::effect0, com::DSP::effect1, com::DSP::effect2, com::DSP::effect3}};
+            const fx_pedal_settings empty{0, effects::EMPTY, 0, 0, 0, 0, 0, 0, Position::input};
+
+            out.append("<FX>");
+
+            for (std::size_t i = 0; i < kinds.size(); ++i)
+            {
+                const auto effect = std::find_if(effectList.cbegin(), effectList.cend(), [kind = kinds[i]](const auto& e) { return com::descriptorOf(e.effect_num).dsp == kind; });
+
+                out.push_back('<');
+                out.append(fxKinds[i]);
+                out.append(" ID=\"");
+                appendNumber(out, static_cast<int>(i + 1));
+                out.append("\">");
+                writeEffect(out, (effect != effectList.cend() ? *effect : empty));
+                out.append("</");
+                out.append(fxKinds[i]);
+                out.push_back('>');
+            }
+            out.append("</FX>");
+        }
+    }
+
+
+    Preset parsePreset(std::string_view text)
+    {
+        Scanner scanner{text};
+        bool isPreset{false};
+        Section section{Section::none};
+        std::size_t kind{0};
+        amp_settings amp{};
+        std::uint8_t usbGain{0};
+        std::array<fx_pedal_settings, 4> found{{}};
+        std::array<std::size_t, positionCount> positions{{}};
+        Preset preset;
+
+        for (auto tag = scanner.next(); tag.has_value() == true; tag = scanner.next())
+        {
+            const auto name = tag->name;
+
+            if (tag->closing == true)
+            {
+                if ((name == "Amplifier") || (name == "FX") || (name == "FUSE"))
+                {
+                    section = Section::none;
+                }
+                continue;
+            }
+
+            if (name == "Preset")
+            {
+                isPreset = true;
+            }
+            else if ((name == "Amplifier") || (name == "FX") || (name == "FUSE"))
+            {
+                if (tag->empty == false)
+                {
+                    section = (name == "Amplifier" ? Section::amp : (name == "FX" ? Section::fx : Section::fuse));
+                }
+            }
+            else if (name == "UsbGain")
+            {
+                usbGain = static_cast<std::uint8_t>(tag->empty == true ? 0 : toInt(scanner.content()));
+            }
+            else if ((section == Section::amp) && (name == "Module"))
+            {
+                if (const auto model = findAmpById(static_cast<std::uint32_t>(toInt(attribute(tag->attributes, "ID")))); model.has_value() == true)
+                {
+                    amp.amp_num = *model;
+                }
+            }
+            else if ((section == Section::amp) && (name == "Param"))
+            {
+                applyAmpParam(amp, toInt(attribute(tag->attributes, "ControlIndex")), (tag->empty == true ? std::string_view{} : scanner.content()));
+            }
+            else if ((section == Section::fx) && (std::find(fxKinds.cbegin(), fxKinds.cend(), name) != fxKinds.cend()))
+            {
+                kind = static_cast<std::size_t>(std::distance(fxKinds.cbegin(), std::find(fxKinds.cbegin(), fxKinds.cend(), name)));
+            }
+            else if ((section == Section::fx) && (name == "Module"))
+            {
+                auto& effect = found[kind];
+                const int position = toInt(attribute(tag->attributes, "POS"));
+                effect.position = (position > 3 ? Position::effectsLoop : Position::input);
+
+                if (const auto model = findEffectById(static_cast<std::uint32_t>(toInt(attribute(tag->attributes, "ID")))); model.has_value() == true)
+                {
+                    effect.effect_num = *model;
+                }
+
+                // Some files have empty modules at the positions of others
+                if ((effect.effect_num != effects::EMPTY) && (position >= 0) && (static_cast<std::size_t>(position) < positions.size()))
+                {
+                    positions[static_cast<std::size_t>(position)] = kind + 1;
+                }
+            }
+            else if ((section == Section::fx) && (name == "Param"))
+            {
+                applyEffectParam(found[kind], toInt(attribute(tag->attributes, "ControlIndex")), (tag->empty == true ? std::string_view{} : scanner.content()));
+            }
+            else if ((section == Section::fuse) && (name == "Info"))
+            {
+                preset.chain.setName(decode(attribute(tag->attributes, "name")));
+                preset.author = decode(attribute(tag->attributes, "author"));
+            }
+        }
+
+        if (isPreset == false)
+        {
+            throw std::invalid_argument{"Not a FUSE preset"};
+        }
+
+        std::array<fx_pedal_settings, 4> effectList{{}};
+        std::for_each(effectList.begin(), effectList.end(), [i = std::uint8_t{0}](auto& effect) mutable { effect.fx_slot = i++; });
+        std::uint8_t slot{0};
+
+        for (const auto entry : positions)
+        {
+            if ((entry != 0) && (slot < effectList.size()))
+            {
+                effectList[slot] = found[entry - 1];
+                effectList[slot].fx_slot = slot;
+                ++slot;
+            }
+        }
+
+        amp.usb_gain = usbGain;
+        preset.chain.setAmp(amp);
+        preset.chain.setEffects(effectList);
+        return preset;
+    }
+
+    Preset readPresetFile(const std::string& filename)
+    {
+        std::ifstream file{filename, std::ios::binary | std::ios::ate};
+
+        if (file.is_open() == false)
+        {
+            throw std::invalid_argument{"Can't open preset file: " + filename};
+        }
+
+        std::string content(static_cast<std::size_t>(file.tellg()), '\0');
+        file.seekg(0);
+        file.read(content.data(), static_cast<std::streamsize>(content.size()));
+
+        if (file.good() == false)
+        {
+            throw std::invalid_argument{"Can't read preset file: " + filename};
+        }
+        return parsePreset(content);
+    }
+
+
+    void writePreset(std::string& out, const Preset& preset)
+    {
+        const auto amp = preset.chain.amp();
+
+        out.append("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+        out.append("<Preset amplifier=\"Mustang V2 I/II\" ProductId=\"13\">");
+        writeAmp(out, amp);
+        writeEffects(out, preset.chain.effects());
+        out.append("<FUSE><Info name=\"");
+        appendEscaped(out, preset.chain.name());
+        out.append("\" author=\"");
+        appendEscaped(out, preset.author);
+        out.append("\" rating=\"0\" genre1=\"-1\" genre2=\"-1\" genre3=\"-1\" tags=\"\" fenderid=\"0\"></Info></FUSE>");
+        out.append("<UsbGain>");
+        appendNumber(out, amp.usb_gain);
+        out.append("</UsbGain></Preset>\n");
+    }
+
+    void writePresetFile(const std::string& filename, const Preset& preset)
+    {
+        std::string content;
+        writePreset(content, preset);
+
+        std::ofstream file{filename, std::ios::binary | std::ios::trunc};
+        file.write(content.data(), static_cast<std::streamsize>(content.size()));
+
+        if (file.good() == false)
+        {
+            throw std::invalid_argument{"Can't write preset file: " + filename};
+        }
+    }
+}
@@ -0,0 +1,154 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fuse/LibraryWatcher.h"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace plug::fuse
+{
+    namespace
+    {
+        inline constexpr std::uint32_t watchedEvents{IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE | IN_DELETE_SELF | IN_MOVE_SELF};
+        inline constexpr std::uint32_t rescanEvents{IN_Q_OVERFLOW | IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF};
+        inline constexpr int maxDelayFactor{10};
+
+        void closeFd(int fd)
+        {
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+        }
+
+        int pollTimeout(std::chrono::steady_clock::time_point deadline)
+        {
+            const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            return static_cast<int>(std::max(remaining.count(), std::chrono::milliseconds::rep{0}));
+        }
+    }
+
+
+    LibraryWatcher::LibraryWatcher(const std::string& directory, std::chrono::milliseconds debounceTime, Listener changeListener)
+        : debounce(debounceTime), listener(std::move(changeListener)), inotifyFd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)), stopFd(eventfd(0, EFD_CLOEXEC))
+    {
+        if ((inotifyFd < 0) || (stopFd < 0) || (inotify_add_watch(inotifyFd, directory.c_str(), watchedEvents | IN_ONLYDIR) < 0))
+        {
+            closeFd(inotifyFd);
+            closeFd(stopFd);
+            throw std::invalid_argument{"Can't watch directory: " + directory};
+        }
+
+        thread = std::thread{[this] { run(); }};
+    }
+
+    LibraryWatcher::~LibraryWatcher()
+    {
+        const std::uint64_t stop{1};
+
+        // Apart from interrupts, writing to the eventfd can't fail, its
+        // counter is far from overflowing
+        while ((write(stopFd, &stop, sizeof(stop)) < 0) && (errno == EINTR))
+        {
+        }
+        thread.join();
+
+        closeFd(inotifyFd);
+        closeFd(stopFd);
+    }
+
+    void LibraryWatcher::run()
+    {
+        LibraryChanges changes{{}, false};
+        std::chrono::steady_clock::time_point first{};
+        std::chrono::steady_clock::time_point deadline{};
+
+        while (true)
+        {
+            const bool pending = ((changes.fileNames.empty() == false) || (changes.rescan == true));
+            std::array<pollfd, 2> fds{{{inotifyFd, POLLIN, 0}, {stopFd, POLLIN, 0}}};
+
+            // Changes can't be followed anymore, the library is refreshed once
+            if ((poll(fds.data(), fds.size(), (pending == true ? pollTimeout(deadline) : -1)) < 0) && (errno != EINTR))
+            {
+                listener(LibraryChanges{{}, true});
+                return;
+            }
+
+            if (fds[1].revents != 0)
+            {
+                return;
+            }
+
+            if (((fds[0].revents & POLLIN) != 0) && (readEvents(changes) == true))
+            {
+                const auto now = std::chrono::steady_clock::now();
+                first = (pending == true ? first : now);
+                deadline = std::min(now + debounce, first + debounce * maxDelayFactor);
+            }
+
+            if (((changes.fileNames.empty() == false) || (changes.rescan == true)) && (std::chrono::steady_clock::now() >= deadline))
+            {
+                std::sort(changes.fileNames.begin(), changes.fileNames.end());
+                changes.fileNames.erase(std::unique(changes.fileNames.begin(), changes.fileNames.end()), changes.fileNames.end());
+                listener(changes);
+                changes = LibraryChanges{{}, false};
+            }
+        }
+    }
+
+    // Returns true if any change was added
+    bool LibraryWatcher::readEvents(LibraryChanges& changes)
+    {
+        alignas(inotify_event) std::array<char, 4096> buffer;
+        bool changed{false};
+
+        for (auto size = read(inotifyFd, buffer.data(), buffer.size()); size > 0; size = read(inotifyFd, buffer.data(), buffer.size()))
+        {
+            for (std::size_t offset = 0; offset + sizeof(inotify_event) <= static_cast<std::size_t>(size);)
+            {
+                inotify_event event;
+                std::memcpy(&event, buffer.data() + offset, sizeof(event));
+                const char* name = buffer.data() + offset + sizeof(event);
+
+                if ((event.mask & rescanEvents) != 0)
+                {
+                    changes.rescan = true;
+                    changed = true;
+                }
+                else if (event.len > 0)
+                {
+                    changes.fileNames.emplace_back(name, strnlen(name, event.len));
+                    changed = true;
+                }
+                offset += sizeof(event) + event.len;
+            }
+        }
+        return changed;
+    }
+}
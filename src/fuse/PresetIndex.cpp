@@ -0,0 +1,480 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fuse/PresetIndex.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <dirent.h>
+#include <sys/stat.h>
+
+namespace plug::fuse
+{
+    namespace
+    {
+        inline constexpr std::array<char, 4> magic{{'P', 'L', 'G', 'I'}};
+        inline constexpr std::uint8_t version{1};
+
+
+        class Writer
+        {
+        public:
+            template <class T>
+            void integer(T value)
+            {
+                const auto bits = static_cast<std::uint64_t>(value);
+
+                for (std::size_t i = 0; i < sizeof(T); ++i)
+                {
+                    data.push_back(static_cast<char>((bits >> (i * 8)) & 0xff));
+                }
+            }
+
+            void text(const std::string& value)
+            {
+                const auto size = std::min<std::size_t>(value.size(), 0xffff);
+                integer(static_cast<std::uint16_t>(size));
+                data.append(value, 0, size);
+            }
+
+            void chain(const SignalChain& signalChain)
+            {
+                text(signalChain.name());
+
+                const auto amp = signalChain.amp();
+                const std::array<std::uint8_t, 17> ampValues{{static_cast<std::uint8_t>(amp.amp_num), amp.gain, amp.volume, amp.treble, amp.middle, amp.bass,
+                                                              static_cast<std::uint8_t>(amp.cabinet), amp.noise_gate, amp.master_vol, amp.gain2, amp.presence,
+                                                              amp.threshold, amp.depth, amp.bias, amp.sag, static_cast<std::uint8_t>(amp.brightness ? 1 : 0), amp.usb_gain}};
+                data.append(ampValues.cbegin(), ampValues.cend());
+
+                for (const auto& effect : signalChain.effects())
+                {
+                    const std::array<std::uint8_t, 9> effectValues{{effect.fx_slot, static_cast<std::uint8_t>(effect.effect_num), effect.knob1, effect.knob2, effect.knob3,
+                                                                    effect.knob4, effect.knob5, effect.knob6, static_cast<std::uint8_t>(effect.position)}};
+                    data.append(effectValues.cbegin(), effectValues.cend());
+                }
+            }
+
+            std::string data;
+        };
+
+
+        // Throws std::out_of_range if the data is truncated
+        class Reader
+        {
+        public:
+            explicit Reader(std::string_view d)
+                : data(d), pos(0)
+            {
+            }
+
+            std::uint8_t byte()
+            {
+                return static_cast<std::uint8_t>(data.at(pos++));
+            }
+
+            template <class T>
+            T integer()
+            {
+                std::uint64_t bits{0};
+
+                for (std::size_t i = 0; i < sizeof(T); ++i)
+                {
+                    bits |= std::uint64_t{byte()} << (i * 8);
+                }
+                return static_cast<T>(bits);
+            }
+
+            std::string text()
+            {
+                const std::size_t size = integer<std::uint16_t>();
+                std::string value{data.substr(std::min(pos, data.size()), size)};
+
+                if (value.size() != size)
+                {
+                    throw std::out_of_range{"Truncated text"};
+                }
+                pos += size;
+                return value;
+            }
+
+            SignalChain chain()
+            {
+                const auto name = text();
+
+                amp_settings amp{};
+                amp.amp_num = static_cast<amps>(byte());
+                amp.gain = byte();
+                amp.volume = byte();
+                amp.treble = byte();
+                amp.middle = byte();
+                amp.bass = byte();
+                amp.cabinet = static_cast<cabinets>(byte());
+                amp.noise_gate = byte();
+                amp.master_vol = byte();
+                amp.gain2 = byte();
+                amp.presence = byte();
+                amp.threshold = byte();
+                amp.depth = byte();
+                amp.bias = byte();
+                amp.sag = byte();
+                amp.brightness = (byte() != 0);
+                amp.usb_gain = byte();
+
+                std::array<fx_pedal_settings, 4> fxSettings{{}};
+
+                for (auto& effect : fxSettings)
+                {
+                    effect.fx_slot = byte();
+                    effect.effect_num = static_cast<effects>(byte());
+                    effect.knob1 = byte();
+                    effect.knob2 = byte();
+                    effect.knob3 = byte();
+                    effect.knob4 = byte();
+                    effect.knob5 = byte();
+                    effect.knob6 = byte();
+                    effect.position = static_cast<Position>(byte());
+                }
+
+                return SignalChain{name, amp, fxSettings};
+            }
+
+            bool atEnd() const
+            {
+                return (pos == data.size());
+            }
+
+        private:
+            const std::string_view data;
+            std::size_t pos;
+        };
+
+
+        bool isPresetFile(const std::string& fileName)
+        {
+            constexpr std::string_view extension{".fuse"};
+
+            if (fileName.size() <= extension.size())
+            {
+                return false;
+            }
+            return std::equal(extension.cbegin(), extension.cend(), fileName.cend() - static_cast<std::ptrdiff_t>(extension.size()), [](char a, char b) {
+                return a == std::tolower(static_cast<unsigned char>(b));
+            });
+        }
+
+        bool lessIgnoringCase(const std::string& a, const std::string& b)
+        {
+            const auto lower = [](char x, char y) { return std::tolower(static_cast<unsigned char>(x)) < std::tolower(static_cast<unsigned char>(y)); };
+            const bool less = std::lexicographical_compare(a.cbegin(), a.cend(), b.cbegin(), b.cend(), lower);
+
+            if ((less == false) && (std::lexicographical_compare(b.cbegin(), b.cend(), a.cbegin(), a.cend(), lower) == false))
+            {
+                return a < b;
+            }
+            return less;
+        }
+
+        // Regular preset files only, without their content
+        std::optional<IndexEntry> statFile(const std::string& directory, const std::string& fileName)
+        {
+            struct stat info{};
+
+            if ((isPresetFile(fileName) == false) || (stat((directory + "/" + fileName).c_str(), &info) != 0) || (S_ISREG(info.st_mode) == 0))
+            {
+                return std::nullopt;
+            }
+
+            const auto modified = static_cast<std::int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+            return IndexEntry{fileName, modified, static_cast<std::uint64_t>(info.st_size), std::nullopt};
+        }
+
+        std::vector<IndexEntry> listFiles(const std::string& directory)
+        {
+            std::vector<IndexEntry> files;
+            DIR* dir = opendir(directory.c_str());
+
+            if (dir == nullptr)
+            {
+                return files;
+            }
+
+            for (const dirent* entry = readdir(dir); entry != nullptr; entry = readdir(dir))
+            {
+                if (auto file = statFile(directory, entry->d_name); file.has_value() == true)
+                {
+                    files.push_back(std::move(*file));
+                }
+            }
+
+            closedir(dir);
+            return files;
+        }
+
+        bool isUnchanged(const IndexEntry& entry, const IndexEntry& file)
+        {
+            return (entry.modified == file.modified) && (entry.size == file.size);
+        }
+
+        std::optional<Preset> tryReadPresetFile(const std::string& filename)
+        {
+            try
+            {
+                return readPresetFile(filename);
+            }
+            catch (const std::invalid_argument&)
+            {
+                return std::nullopt;
+            }
+        }
+
+        void parseAll(const std::string& directory, std::vector<IndexEntry*>& pending, std::size_t threads)
+        {
+            std::atomic<std::size_t> next{0};
+            const auto work = [&directory, &pending, &next] {
+                for (auto i = next++; i < pending.size(); i = next++)
+                {
+                    pending[i]->preset = tryReadPresetFile(directory + "/" + pending[i]->fileName);
+                }
+            };
+
+            const auto workerCount = std::min(pending.size(), (threads == 0 ? std::max(std::size_t{std::thread::hardware_concurrency()}, std::size_t{1}) : threads));
+            std::vector<std::thread> workers;
+
+            for (std::size_t i = 1; i < workerCount; ++i)
+            {
+                workers.emplace_back(work);
+            }
+
+            work();
+            std::for_each(workers.begin(), workers.end(), [](auto& worker) { worker.join(); });
+        }
+    }
+
+
+    PresetIndex::PresetIndex(const std::string& directory, const std::string& file)
+        : dir(directory), indexFile(file)
+    {
+    }
+
+    void PresetIndex::load()
+    {
+        indexed.clear();
+
+        std::ifstream file{indexFile, std::ios::binary};
+
+        if (file.is_open() == false)
+        {
+            return;
+        }
+
+        std::ostringstream content;
+        content << file.rdbuf();
+
+        const auto data = content.str();
+
+        try
+        {
+            Reader reader{data};
+
+            const bool validHeader = std::all_of(magic.cbegin(), magic.cend(), [&reader](char c) { return reader.byte() == static_cast<std::uint8_t>(c); });
+
+            if ((validHeader == false) || (reader.byte() != version) || (reader.text() != dir))
+            {
+                return;
+            }
+
+            std::vector<IndexEntry> entries(reader.integer<std::uint32_t>());
+
+            for (auto& entry : entries)
+            {
+                entry.fileName = reader.text();
+                entry.modified = reader.integer<std::int64_t>();
+                entry.size = reader.integer<std::uint64_t>();
+
+                if (reader.byte() != 0)
+                {
+                    const auto author = reader.text();
+                    entry.preset = Preset{reader.chain(), author};
+                }
+            }
+
+            if (reader.atEnd() == true)
+            {
+                indexed = std::move(entries);
+            }
+        }
+        catch (const std::out_of_range&)
+        {
+        }
+    }
+
+    bool PresetIndex::store() const
+    {
+        Writer writer;
+        std::for_each(magic.cbegin(), magic.cend(), [&writer](char c) { writer.integer(static_cast<std::uint8_t>(c)); });
+        writer.integer(version);
+        writer.text(dir);
+        writer.integer(static_cast<std::uint32_t>(indexed.size()));
+
+        for (const auto& entry : indexed)
+        {
+            writer.text(entry.fileName);
+            writer.integer(entry.modified);
+            writer.integer(entry.size);
+            writer.integer(static_cast<std::uint8_t>(entry.preset.has_value() ? 1 : 0));
+
+            if (entry.preset.has_value() == true)
+            {
+                writer.text(entry.preset->author);
+                writer.chain(entry.preset->chain);
+            }
+        }
+
+        // Replace the file at once, so a crash never leaves a partial one
+        const auto temp = indexFile + ".tmp";
+        {
+            std::ofstream file{temp, std::ios::binary | std::ios::trunc};
+            file.write(writer.data.data(), static_cast<std::streamsize>(writer.data.size()));
+
+            if (file.good() == false)
+            {
+                return false;
+            }
+        }
+        return (std::rename(temp.c_str(), indexFile.c_str()) == 0);
+    }
+
+    std::size_t PresetIndex::refresh(std::size_t threads)
+    {
+        auto files = listFiles(dir);
+        std::unordered_map<std::string, IndexEntry*> known;
+        std::for_each(indexed.begin(), indexed.end(), [&known](auto& entry) { known.emplace(entry.fileName, &entry); });
+        std::vector<IndexEntry*> pending;
+
+        for (auto& file : files)
+        {
+            const auto entry = known.find(file.fileName);
+
+            if ((entry != known.end()) && (isUnchanged(*entry->second, file) == true))
+            {
+                file.preset = std::move(entry->second->preset);
+            }
+            else
+            {
+                pending.push_back(&file);
+            }
+        }
+
+        parseAll(dir, pending, threads);
+        std::sort(files.begin(), files.end(), [](const auto& a, const auto& b) { return lessIgnoringCase(a.fileName, b.fileName); });
+        indexed = std::move(files);
+        return pending.size();
+    }
+
+    std::size_t PresetIndex::update(const std::vector<std::string>& fileNames, std::size_t threads)
+    {
+        const auto less = [](const auto& a, const auto& b) { return lessIgnoringCase(a.fileName, b.fileName); };
+        std::vector<std::string> names{fileNames};
+        std::sort(names.begin(), names.end());
+        names.erase(std::unique(names.begin(), names.end()), names.end());
+
+        std::vector<IndexEntry> added;
+        added.reserve(names.size());
+        std::vector<IndexEntry*> pending;
+        std::vector<std::string> removed;
+
+        for (const auto& name : names)
+        {
+            auto file = statFile(dir, name);
+            const auto entry = std::lower_bound(indexed.begin(), indexed.end(), IndexEntry{name, 0, 0, std::nullopt}, less);
+            const bool known = ((entry != indexed.end()) && (entry->fileName == name));
+
+            if (file.has_value() == false)
+            {
+                if (known == true)
+                {
+                    removed.push_back(name);
+                }
+            }
+            else if (known == false)
+            {
+                added.push_back(std::move(*file));
+                pending.push_back(&added.back());
+            }
+            else if (isUnchanged(*entry, *file) == false)
+            {
+                *entry = std::move(*file);
+                pending.push_back(&*entry);
+            }
+        }
+
+        parseAll(dir, pending, threads);
+
+        indexed.erase(std::remove_if(indexed.begin(), indexed.end(), [&removed](const auto& entry) {
+                          return std::binary_search(removed.cbegin(), removed.cend(), entry.fileName);
+                      }),
+                      indexed.end());
+
+        std::sort(added.begin(), added.end(), less);
+        const auto middle = static_cast<std::ptrdiff_t>(indexed.size());
+        std::move(added.begin(), added.end(), std::back_inserter(indexed));
+        std::inplace_merge(indexed.begin(), indexed.begin() + middle, indexed.end(), less);
+        return pending.size();
+    }
+
+    const std::vector<IndexEntry>& PresetIndex::entries() const
+    {
+        return indexed;
+    }
+
+    std::string PresetIndex::path(const IndexEntry& entry) const
+    {
+        return dir + "/" + entry.fileName;
+    }
+
+    const std::string& PresetIndex::directory() const
+    {
+        return dir;
+    }
+
+
+    std::string indexFileName(const std::string& directory)
+    {
+        // FNV-1a
+        const auto hash = std::accumulate(directory.cbegin(), directory.cend(), std::uint64_t{0xcbf29ce484222325}, [](std::uint64_t h, char c) {
+            return (h ^ static_cast<std::uint8_t>(c)) * std::uint64_t{0x100000001b3};
+        });
+
+        std::array<char, 17> hex{};
+        std::snprintf(hex.data(), hex.size(), "%016llx", static_cast<unsigned long long>(hash));
+        return "library-" + std::string{hex.data()} + ".index";
+    }
+}
@@ -22,6 +22,8 @@
 #include "ui/mainwindow.h"
 #include "version.h"
 #include <QApplication>
+#include <QCommandLineParser>
+#include <iostream>
 
 int main(int argc, char* argv[])
 {
@@ -30,8 +32,21 @@ int main(int argc, char* argv[])
     QCoreApplication::setApplicationName("Plug");
     QCoreApplication::setApplicationVersion(QString::fromStdString(plug::version()));
 
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addVersionOption();
+    const QCommandLineOption statsOption{"stats", QCoreApplication::translate("main", "Print communication statistics on exit.")};
+    parser.addOption(statsOption);
+    parser.process(app);
+
     plug::MainWindow window;
     window.show();
 
-    return app.exec();
+    const int result = app.exec();
+
+    if (parser.isSet(statsOption) == true)
+    {
+        std::cout << window.statistics();
+    }
+    return result;
 }
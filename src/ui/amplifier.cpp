@@ -25,6 +25,7 @@
 #include "ui/amp_advanced.h"
 #include <QSettings>
 #include <QShortcut>
+#include <QSignalBlocker>
 
 namespace plug
 {
@@ -67,6 +68,12 @@ namespace plug
         connect(ui->dial_3, SIGNAL(valueChanged(int)), this, SLOT(set_treble(int)));
         connect(ui->dial_4, SIGNAL(valueChanged(int)), this, SLOT(set_middle(int)));
         connect(ui->dial_5, SIGNAL(valueChanged(int)), this, SLOT(set_bass(int)));
+        // Only changes made by the user are sent, the value is set after the action
+        connect(ui->dial, SIGNAL(actionTriggered(int)), this, SLOT(send_on_change()), Qt::QueuedConnection);
+        connect(ui->dial_2, SIGNAL(actionTriggered(int)), this, SLOT(send_on_change()), Qt::QueuedConnection);
+        connect(ui->dial_3, SIGNAL(actionTriggered(int)), this, SLOT(send_on_change()), Qt::QueuedConnection);
+        connect(ui->dial_4, SIGNAL(actionTriggered(int)), this, SLOT(send_on_change()), Qt::QueuedConnection);
+        connect(ui->dial_5, SIGNAL(actionTriggered(int)), this, SLOT(send_on_change()), Qt::QueuedConnection);
         connect(ui->setButton, SIGNAL(clicked()), this, SLOT(send_amp()));
 
         QShortcut* close = new QShortcut(QKeySequence(Qt::Key_Escape), this);
@@ -338,16 +345,38 @@ namespace plug
         dynamic_cast<MainWindow*>(parent())->set_amplifier(settings);
     }
 
+    void Amplifier::send_on_change()
+    {
+        QSettings settings;
+
+        if (settings.value("Settings/sendOnChange").toBool())
+        {
+            send_amp();
+        }
+    }
+
     void Amplifier::load(amp_settings settings)
     {
         changed = true;
 
         ui->comboBox->setCurrentIndex(value(settings.amp_num));
-        ui->dial->setValue(settings.gain);
-        ui->dial_2->setValue(settings.volume);
-        ui->dial_3->setValue(settings.treble);
-        ui->dial_4->setValue(settings.middle);
-        ui->dial_5->setValue(settings.bass);
+        {
+            const QSignalBlocker blockGain{ui->dial};
+            const QSignalBlocker blockVolume{ui->dial_2};
+            const QSignalBlocker blockTreble{ui->dial_3};
+            const QSignalBlocker blockMiddle{ui->dial_4};
+            const QSignalBlocker blockBass{ui->dial_5};
+            ui->dial->setValue(settings.gain);
+            ui->dial_2->setValue(settings.volume);
+            ui->dial_3->setValue(settings.treble);
+            ui->dial_4->setValue(settings.middle);
+            ui->dial_5->setValue(settings.bass);
+        }
+        gain = static_cast<std::uint8_t>(ui->dial->value());
+        volume = static_cast<std::uint8_t>(ui->dial_2->value());
+        treble = static_cast<std::uint8_t>(ui->dial_3->value());
+        middle = static_cast<std::uint8_t>(ui->dial_4->value());
+        bass = static_cast<std::uint8_t>(ui->dial_5->value());
 
         advanced->change_cabinet(value(settings.cabinet));
         advanced->change_noise_gate(settings.noise_gate);
@@ -24,6 +24,7 @@
 #include "ui_effect.h"
 #include <QShortcut>
 #include <QSettings>
+#include <QSignalBlocker>
 
 namespace plug
 {
@@ -124,6 +125,13 @@ namespace plug
         connect(ui->dial_4, SIGNAL(valueChanged(int)), this, SLOT(set_knob4(int)));
         connect(ui->dial_5, SIGNAL(valueChanged(int)), this, SLOT(set_knob5(int)));
         connect(ui->dial_6, SIGNAL(valueChanged(int)), this, SLOT(set_knob6(int)));
+        // Only changes made by the user are sent, the value is set after the action
+        connect(ui->dial, SIGNAL(actionTriggered(int)), this, SLOT(send_on_change()), Qt::QueuedConnection);
+        connect(ui->dial_2, SIGNAL(actionTriggered(int)), this, SLOT(send_on_change()), Qt::QueuedConnection);
+        connect(ui->dial_3, SIGNAL(actionTriggered(int)), this, SLOT(send_on_change()), Qt::QueuedConnection);
+        connect(ui->dial_4, SIGNAL(actionTriggered(int)), this, SLOT(send_on_change()), Qt::QueuedConnection);
+        connect(ui->dial_5, SIGNAL(actionTriggered(int)), this, SLOT(send_on_change()), Qt::QueuedConnection);
+        connect(ui->dial_6, SIGNAL(actionTriggered(int)), this, SLOT(send_on_change()), Qt::QueuedConnection);
         connect(ui->setButton, SIGNAL(clicked()), this, SLOT(send_fx()));
         connect(ui->pushButton, SIGNAL(toggled(bool)), this, SLOT(off_switch(bool)));
 
@@ -2067,16 +2075,40 @@ namespace plug
         dynamic_cast<MainWindow*>(parent())->set_effect(pedal);
     }
 
+    void Effect::send_on_change()
+    {
+        QSettings settings;
+
+        if (settings.value("Settings/sendOnChange").toBool())
+        {
+            send_fx();
+        }
+    }
+
     void Effect::load(fx_pedal_settings settings)
     {
         set_changed(true);
         ui->comboBox->setCurrentIndex(value(settings.effect_num));
-        ui->dial->setValue(settings.knob1);
-        ui->dial_2->setValue(settings.knob2);
-        ui->dial_3->setValue(settings.knob3);
-        ui->dial_4->setValue(settings.knob4);
-        ui->dial_5->setValue(settings.knob5);
-        ui->dial_6->setValue(settings.knob6);
+        {
+            const QSignalBlocker block1{ui->dial};
+            const QSignalBlocker block2{ui->dial_2};
+            const QSignalBlocker block3{ui->dial_3};
+            const QSignalBlocker block4{ui->dial_4};
+            const QSignalBlocker block5{ui->dial_5};
+            const QSignalBlocker block6{ui->dial_6};
+            ui->dial->setValue(settings.knob1);
+            ui->dial_2->setValue(settings.knob2);
+            ui->dial_3->setValue(settings.knob3);
+            ui->dial_4->setValue(settings.knob4);
+            ui->dial_5->setValue(settings.knob5);
+            ui->dial_6->setValue(settings.knob6);
+        }
+        knob1 = static_cast<std::uint8_t>(ui->dial->value());
+        knob2 = static_cast<std::uint8_t>(ui->dial_2->value());
+        knob3 = static_cast<std::uint8_t>(ui->dial_3->value());
+        knob4 = static_cast<std::uint8_t>(ui->dial_4->value());
+        knob5 = static_cast<std::uint8_t>(ui->dial_5->value());
+        knob6 = static_cast<std::uint8_t>(ui->dial_6->value());
         ui->checkBox->setChecked(settings.position == Position::effectsLoop);
         printf("Effect::load: effect_num: %d\n",static_cast<int>(settings.effect_num));
     }
@@ -22,19 +22,41 @@
 #include "ui/library.h"
 #include "ui/mainwindow.h"
 #include "ui_library.h"
+#include <QDebug>
 #include <QDir>
+#include <QFile>
 #include <QFileDialog>
 #include <QSettings>
+#include <QSignalBlocker>
+#include <QStandardPaths>
+#include <algorithm>
+#include <iterator>
 
 namespace plug
 {
+    namespace
+    {
+        std::string indexPath(const std::string& directory)
+        {
+            const auto dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+            QDir{}.mkpath(dir);
+            return dir.toStdString() + "/" + fuse::indexFileName(directory);
+        }
+
+        QString baseName(const std::string& fileName)
+        {
+            return QString::fromStdString(fileName.substr(0, fileName.rfind('.')));
+        }
+    }
+
 
     Library::Library(const std::vector<std::string>& names, QWidget* parent)
         : QDialog(parent),
-          ui(std::make_unique<Ui::Library>()),
-          files(std::make_unique<QList<QFileInfo>>())
+          ui(std::make_unique<Ui::Library>())
     {
         ui->setupUi(this);
+        connect(this, SIGNAL(index_ready()), this, SLOT(index_refreshed()), Qt::QueuedConnection);
+
         QSettings settings;
         restoreGeometry(settings.value("Windows/libraryWindowGeometry").toByteArray());
 
@@ -71,6 +93,8 @@ namespace plug
 
     Library::~Library()
     {
+        stop_indexing();
+
         QSettings settings;
         settings.setValue("Windows/libraryWindowGeometry", saveGeometry());
     }
@@ -102,17 +126,101 @@ namespace plug
 
     void Library::get_files(const QString& path)
     {
-        QDir directory(path, "*.fuse", (QDir::Name | QDir::IgnoreCase), (QDir::Files | QDir::NoDotAndDotDot | QDir::Readable));
+        stop_indexing();
 
-        if (!files->isEmpty())
         {
-            files->clear();
+            // Drop the result for the previous directory, if it's not shown yet
+            std::lock_guard<std::mutex> lock{mutex};
+            refreshed.reset();
         }
+
+        const auto directory = QFile::encodeName(QDir{path}.absolutePath()).toStdString();
+        index = std::make_unique<fuse::PresetIndex>(directory, indexPath(directory));
+        index->load();
+        ui->listWidget_2->setCurrentRow(-1);
+        show_presets(index->entries());
+
+        // Watch before refreshing, so no change gets lost in between
+        try
+        {
+            watcher = std::make_unique<fuse::LibraryWatcher>(directory, std::chrono::milliseconds{200}, [this](const fuse::LibraryChanges& changes) {
+                update_index([&changes](fuse::PresetIndex& presetIndex) {
+                    if (changes.rescan == true)
+                    {
+                        presetIndex.refresh();
+                    }
+                    else
+                    {
+                        presetIndex.update(changes.fileNames);
+                    }
+                });
+            });
+        }
+        catch (const std::invalid_argument& ex)
+        {
+            qWarning() << "WARNING: " << ex.what();
+        }
+
+        indexer = std::thread{[this] { update_index([](fuse::PresetIndex& presetIndex) { presetIndex.refresh(); }); }};
+    }
+
+    void Library::stop_indexing()
+    {
+        watcher.reset();
+
+        if (indexer.joinable() == true)
+        {
+            indexer.join();
+        }
+    }
+
+    // Called on the indexer and watcher threads
+    void Library::update_index(const std::function<void(fuse::PresetIndex&)>& change)
+    {
+        std::lock_guard<std::mutex> indexLock{indexMutex};
+        change(*index);
+        index->store();
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            refreshed = index->entries();
+        }
+        emit index_ready();
+    }
+
+    void Library::index_refreshed()
+    {
+        std::optional<std::vector<fuse::IndexEntry>> entries;
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            entries.swap(refreshed);
+        }
+
+        if (entries.has_value() == true)
+        {
+            show_presets(*entries);
+        }
+    }
+
+    // Keeps the selected preset, without loading it again
+    void Library::show_presets(const std::vector<fuse::IndexEntry>& entries)
+    {
+        const auto row = ui->listWidget_2->currentRow();
+        const auto selected = (row >= 0 ? presets[static_cast<std::size_t>(row)].fileName : std::string{});
+        const QSignalBlocker blocker{ui->listWidget_2};
+
+        presets.clear();
+        std::copy_if(entries.cbegin(), entries.cend(), std::back_inserter(presets), [](const auto& entry) { return entry.preset.has_value(); });
         ui->listWidget_2->clear();
-        *files = directory.entryInfoList(QDir::Files | QDir::NoDotAndDotDot | QDir::Readable);
-        for (int i = 0; i < files->size(); ++i)
+
+        for (const auto& entry : presets)
         {
-            ui->listWidget_2->addItem((*files)[i].completeBaseName());
+            ui->listWidget_2->addItem(baseName(entry.fileName));
+            ui->listWidget_2->item(ui->listWidget_2->count() - 1)->setToolTip(QString("%1\n%2").arg(QString::fromStdString(entry.preset->chain.name()), QString::fromStdString(entry.preset->author)));
+
+            if (entry.fileName == selected)
+            {
+                ui->listWidget_2->setCurrentRow(ui->listWidget_2->count() - 1);
+            }
         }
     }
 
@@ -124,7 +232,7 @@ namespace plug
         }
 
         ui->listWidget->setCurrentRow(-1);
-        dynamic_cast<MainWindow*>(parent())->loadfile((*files)[row].canonicalFilePath());
+        dynamic_cast<MainWindow*>(parent())->load_preset(presets[static_cast<std::size_t>(row)].preset->chain);
     }
 
     void Library::resizeEvent(QResizeEvent* event)
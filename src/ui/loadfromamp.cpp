@@ -61,24 +61,34 @@ namespace plug
 
     void LoadFromAmp::load_names(const std::vector<std::string>& names)
     {
-        for (std::size_t i = 0; i < 100; ++i)
+        ui->comboBox->clear();
+
+        for (std::size_t i = 0; (i < names.size()) && (names[i].empty() == false); ++i)
         {
-            if (names[i][0] == 0x00)
-            {
-                break;
-            }
-            ui->comboBox->addItem(QString("[%1] %2").arg(i + 1).arg(QString::fromStdString(names[i])));
+            set_name(static_cast<int>(i), names[i]);
         }
     }
 
-    void LoadFromAmp::delete_items()
+    // Names are added in order of their slots; a gap ends the list
+    void LoadFromAmp::set_name(int slot, const std::string& name)
     {
-        for (int i = 0; i < ui->comboBox->count(); ++i)
+        const QString text = QString("[%1] %2").arg(slot + 1).arg(QString::fromStdString(name));
+
+        if (slot < ui->comboBox->count())
+        {
+            ui->comboBox->setItemText(slot, text);
+        }
+        else if (slot == ui->comboBox->count())
         {
-            ui->comboBox->removeItem(0);
+            ui->comboBox->addItem(text);
         }
     }
 
+    void LoadFromAmp::delete_items()
+    {
+        ui->comboBox->clear();
+    }
+
     void LoadFromAmp::change_name(int slot, QString* name)
     {
         ui->comboBox->setItemText(slot, *name);
@@ -25,23 +25,23 @@
 #include "ui/effect.h"
 #include "ui/library.h"
 #include "ui/loadfromamp.h"
-#include "ui/loadfromfile.h"
 #include "ui/quickpresets.h"
 #include "ui/save_effects.h"
 #include "ui/saveonamp.h"
 #include "ui/savetofile.h"
 #include "ui/settings.h"
-#include "com/Mustang.h"
-#include "com/ConnectionFactory.h"
-#include "com/CommunicationException.h"
-#include "com/MustangUpdater.h"
+#include "ui/mustangworker.h"
+#include "fuse/FuseFile.h"
 #include "ui_defaulteffects.h"
 #include "ui_mainwindow.h"
+#include <QFile>
 #include <QFileDialog>
+#include <QLabel>
 #include <QMessageBox>
 #include <QSettings>
 #include <QShortcut>
 #include <QDebug>
+#include <stdexcept>
 
 namespace plug
 {
@@ -70,7 +70,7 @@ namespace plug
         : QMainWindow(parent),
           ui(std::make_unique<Ui::MainWindow>()),
           presetNames(100, ""),
-          amp_ops(nullptr)
+          worker(std::make_unique<MustangWorker>())
     {
         ui->setupUi(this);
 
@@ -107,6 +107,22 @@ namespace plug
 
         connected = false;
 
+        statsLabel = new QLabel(this);
+        ui->statusBar->addPermanentWidget(statsLabel);
+        connect(&statsTimer, &QTimer::timeout, this, &MainWindow::update_stats);
+        statsTimer.start(1000);
+
+        // results of the amplifier communication
+        connect(worker.get(), &MustangWorker::amp_started, this, &MainWindow::amp_started);
+        connect(worker.get(), &MustangWorker::preset_name_loaded, this, &MainWindow::preset_name_loaded);
+        connect(worker.get(), &MustangWorker::amp_stopped, this, &MainWindow::amp_stopped);
+        connect(worker.get(), &MustangWorker::bank_loaded, this, &MainWindow::bank_loaded);
+        connect(worker.get(), &MustangWorker::state_changed, this, &MainWindow::bank_loaded);
+        connect(worker.get(), &MustangWorker::bank_saved, this, &MainWindow::bank_saved);
+        connect(worker.get(), &MustangWorker::error, this, &MainWindow::show_error);
+        connect(worker.get(), &MustangWorker::firmware_progress, this, &MainWindow::firmware_progress);
+        connect(worker.get(), &MustangWorker::firmware_updated, this, &MainWindow::firmware_updated);
+
         // connect buttons to slots
         connect(ui->Amplifier, SIGNAL(clicked()), amp, SLOT(showAndActivate()));
         connect(ui->EffectButton1, SIGNAL(clicked()), effect1, SLOT(showAndActivate()));
@@ -185,6 +201,11 @@ namespace plug
         settings.setValue("Windows/mainWindowState", saveState());
     }
 
+    com::StatsSnapshot MainWindow::statistics() const
+    {
+        return worker->statistics();
+    }
+
     void MainWindow::about()
     {
         const QString title{tr("About %1").arg(QCoreApplication::applicationName())};
@@ -208,29 +229,18 @@ namespace plug
 
     void MainWindow::start_amp()
     {
-        QSettings settings;
-        amp_settings amplifier_set{};
-        std::array<fx_pedal_settings, 4> effects_set{{}};
-        QString name;
-
         ui->statusBar->showMessage(tr("Connecting..."));
-        this->repaint(); // this should not be needed!
+        ui->actionConnect->setDisabled(true);
+        worker->start_amp();
+    }
 
-        try
-        {
-            amp_ops = std::make_unique<com::Mustang>(com::createUsbConnection());
-            const auto [signalChain, presets] = amp_ops->start_amp();
-            name = QString::fromStdString(signalChain.name());
-            amplifier_set = signalChain.amp();
-            effects_set = signalChain.effects();
-            presetNames = presets;
-        }
-        catch (const std::exception& ex)
-        {
-            qWarning() << "ERROR: " << ex.what();
-            ui->statusBar->showMessage(QString(tr("Error: %1")).arg(ex.what()), 5000);
-            return;
-        }
+    void MainWindow::amp_started(SignalChain signalChain, std::vector<std::string> presets)
+    {
+        QSettings settings;
+        const QString name = QString::fromStdString(signalChain.name());
+        const amp_settings amplifier_set = signalChain.amp();
+        const std::array<fx_pedal_settings, 4> effects_set = signalChain.effects();
+        presetNames = presets;
 
         load->load_names(presetNames);
         save->load_names(presetNames);
@@ -322,39 +332,67 @@ namespace plug
         connected = true;
     }
 
+    // Names arrive while connecting, so presets can be picked before the
+    // whole list is received
+    void MainWindow::preset_name_loaded(int slot, QString name)
+    {
+        const auto index = static_cast<std::size_t>(slot);
+
+        if (index >= presetNames.size())
+        {
+            presetNames.resize(index + 1);
+        }
+        presetNames[index] = name.toStdString();
+
+        if (name.isEmpty() == true)
+        {
+            return;
+        }
+
+        load->set_name(slot, presetNames[index]);
+        save->set_name(slot, presetNames[index]);
+        quickpres->set_name(slot, presetNames[index]);
+        ui->actionSave_to_amplifier->setDisabled(false);
+        ui->action_Load_from_amplifier->setDisabled(false);
+    }
+
     void MainWindow::stop_amp()
     {
         save->delete_items();
         load->delete_items();
         quickpres->delete_items();
 
-        try
-        {
-            amp_ops->stop_amp();
+        worker->stop_amp();
+    }
 
-            // deactivate buttons
-            amp->enable_set_button(false);
-            effect1->enable_set_button(false);
-            effect2->enable_set_button(false);
-            effect3->enable_set_button(false);
-            effect4->enable_set_button(false);
-            ui->actionConnect->setDisabled(false);
-            ui->actionDisconnect->setDisabled(true);
-            ui->actionSave_to_amplifier->setDisabled(true);
-            ui->action_Load_from_amplifier->setDisabled(true);
-            ui->actionSave_effects->setDisabled(true);
-            ui->action_Library_view->setDisabled(true);
-            setWindowTitle(QString(tr("PLUG")));
-            setAccessibleName(QString(tr("Main window: None")));
-            ui->statusBar->showMessage(tr("Disconnected"), 5000);
+    void MainWindow::amp_stopped()
+    {
+        // deactivate buttons
+        amp->enable_set_button(false);
+        effect1->enable_set_button(false);
+        effect2->enable_set_button(false);
+        effect3->enable_set_button(false);
+        effect4->enable_set_button(false);
+        ui->actionConnect->setDisabled(false);
+        ui->actionDisconnect->setDisabled(true);
+        ui->actionSave_to_amplifier->setDisabled(true);
+        ui->action_Load_from_amplifier->setDisabled(true);
+        ui->actionSave_effects->setDisabled(true);
+        ui->action_Library_view->setDisabled(true);
+        setWindowTitle(QString(tr("PLUG")));
+        setAccessibleName(QString(tr("Main window: None")));
+        ui->statusBar->showMessage(tr("Disconnected"), 5000);
 
-            connected = false;
-        }
-        catch (const std::exception& ex)
+        connected = false;
+    }
+
+    void MainWindow::show_error(QString message)
+    {
+        ui->statusBar->showMessage(QString(tr("Error: %1")).arg(message), 5000);
+
+        if (connected == false)
         {
-            qWarning() << "ERROR: " << ex.what();
-            ui->statusBar->showMessage(QString(tr("Error: %1")).arg(ex.what()), 5000);
-            return;
+            ui->actionConnect->setDisabled(false);
         }
     }
 
@@ -371,16 +409,7 @@ namespace plug
 
         if (!settings.value("Settings/oneSetToSetThemAll").toBool())
         {
-            try
-            {
-                amp_ops->set_effect(pedal);
-            }
-            catch (const std::exception& ex)
-            {
-                qWarning() << "ERROR: " << ex.what();
-                ui->statusBar->showMessage(QString(tr("Error: %1")).arg(ex.what()), 5000);
-                return;
-            }
+            worker->set_effect(pedal);
         }
         amp->send_amp();
     }
@@ -395,42 +424,27 @@ namespace plug
 
         QSettings settings;
 
-        try
-        {
-            if (settings.value("Settings/oneSetToSetThemAll").toBool())
-            {
-                fx_pedal_settings pedal{};
-
-                if (effect1->get_changed())
-                {
-                    effect1->get_settings(pedal);
-                    amp_ops->set_effect(pedal);
-                }
-                if (effect2->get_changed())
-                {
-                    effect2->get_settings(pedal);
-                    amp_ops->set_effect(pedal);
-                }
-                if (effect3->get_changed())
-                {
-                    effect3->get_settings(pedal);
-                    amp_ops->set_effect(pedal);
-                }
-                if (effect4->get_changed())
-                {
-                    effect4->get_settings(pedal);
-                    amp_ops->set_effect(pedal);
-                }
-            }
-
-            amp_ops->set_amplifier(amp_settings);
-        }
-        catch (const std::exception& ex)
+        if (settings.value("Settings/oneSetToSetThemAll").toBool())
         {
-            qWarning() << "ERROR: " << ex.what();
-            ui->statusBar->showMessage(QString(tr("Error: %1")).arg(ex.what()), 5000);
+            apply_all(amp_settings);
             return;
         }
+
+        worker->set_amplifier(amp_settings);
+    }
+
+    // send amplifier and all effects as one chain
+    void MainWindow::apply_all(amp_settings amplifier_set)
+    {
+        std::array<fx_pedal_settings, 4> effects_set{{}};
+        get_settings(nullptr, effects_set.data());
+
+        effect1->set_changed(false);
+        effect2->set_changed(false);
+        effect3->set_changed(false);
+        effect4->set_changed(false);
+
+        worker->apply_chain(SignalChain{current_name.toStdString(), amplifier_set, effects_set});
     }
 
     void MainWindow::save_on_amp(char* name, int slot)
@@ -440,18 +454,12 @@ namespace plug
             return;
         }
 
-        try
-        {
-            amp_ops->save_on_amp(name, static_cast<std::uint8_t>(slot));
-        }
-        catch (const std::exception& ex)
-        {
-            qWarning() << "ERROR: " << ex.what();
-            ui->statusBar->showMessage(QString(tr("Error: %1")).arg(ex.what()), 5000);
-            return;
-        }
+        worker->save_on_amp(name, slot);
+    }
 
-        if (name[0] == 0x00)
+    void MainWindow::bank_saved(QString name, int slot)
+    {
+        if (name.isEmpty() == true)
         {
             setWindowTitle(QString(tr("PLUG: NONE")));
             setAccessibleName(QString(tr("Main window: NONE")));
@@ -473,89 +481,84 @@ namespace plug
             return;
         }
 
+        worker->load_memory_bank(slot);
+    }
+
+    void MainWindow::bank_loaded(SignalChain signalChain)
+    {
         QSettings settings;
-        try
-        {
-            const auto signalChain = amp_ops->load_memory_bank(static_cast<std::uint8_t>(slot));
-            const QString bankName = QString::fromStdString(signalChain.name());
+        const QString bankName = QString::fromStdString(signalChain.name());
 
 
-            if (bankName.isEmpty())
-            {
-                setWindowTitle(QString(tr("PLUG: NONE")));
-                setAccessibleName(QString(tr("Main window: NONE")));
-            }
-            else
-            {
-                setWindowTitle(QString(tr("PLUG: %1")).arg(bankName));
-                setAccessibleName(QString(tr("Main window: %1")).arg(bankName));
-            }
+        if (bankName.isEmpty())
+        {
+            setWindowTitle(QString(tr("PLUG: NONE")));
+            setAccessibleName(QString(tr("Main window: NONE")));
+        }
+        else
+        {
+            setWindowTitle(QString(tr("PLUG: %1")).arg(bankName));
+            setAccessibleName(QString(tr("Main window: %1")).arg(bankName));
+        }
 
-            current_name = bankName;
+        current_name = bankName;
 
-            amp->load(signalChain.amp());
-            if (settings.value("Settings/popupChangedWindows").toBool())
-            {
-                amp->show();
-            }
+        amp->load(signalChain.amp());
+        if (settings.value("Settings/popupChangedWindows").toBool())
+        {
+            amp->show();
+        }
 
-               fx_pedal_settings null_effect;
-            null_effect.effect_num=effects::EMPTY;
-            null_effect.fx_slot=0;
-            effect1->load(null_effect);
-                null_effect.fx_slot=1;
-            effect2->load(null_effect);
-            null_effect.fx_slot=2;
-            effect3->load(null_effect);
-            null_effect.fx_slot=3;
-            effect4->load(null_effect);
-        
-            const auto effects_set = signalChain.effects();
-            for (std::size_t i = 0; i < 4; i++)
+           fx_pedal_settings null_effect;
+        null_effect.effect_num=effects::EMPTY;
+        null_effect.fx_slot=0;
+        effect1->load(null_effect);
+            null_effect.fx_slot=1;
+        effect2->load(null_effect);
+        null_effect.fx_slot=2;
+        effect3->load(null_effect);
+        null_effect.fx_slot=3;
+        effect4->load(null_effect);
+    
+        const auto effects_set = signalChain.effects();
+        for (std::size_t i = 0; i < 4; i++)
+        {
+            printf("eff_sect: %d, slot: %d, num:%d\n"
+            ,static_cast<int>(i)
+            ,static_cast<int>(effects_set[i].fx_slot)
+            ,static_cast<int>(effects_set[i].effect_num));
+            if (effects_set[i].effect_num != effects::EMPTY)
             {
-                printf("eff_sect: %d, slot: %d, num:%d\n"
-                ,static_cast<int>(i)
-                ,static_cast<int>(effects_set[i].fx_slot)
-                ,static_cast<int>(effects_set[i].effect_num));
-                if (effects_set[i].effect_num != effects::EMPTY)
+                switch (effects_set[i].fx_slot)
                 {
-                    switch (effects_set[i].fx_slot)
-                    {
-                        case 0x00:
-                        case 0x04:
-                            effect1->load(effects_set[i]);
-                            break;
-
-                        case 0x01:
-                        case 0x05:
-                            effect2->load(effects_set[i]);
-                            break;
-
-                        case 0x02:
-                        case 0x06:
-                            effect3->load(effects_set[i]);
-                            break;
-
-                        case 0x03:
-                        case 0x07:
-                            effect4->load(effects_set[i]);
-                            break;
-                        default:
-                            printf("unknown slot!\n");
-                    }
-                } 
-            }
-            effect1->show();
-            effect2->show();
-            effect3->show();
-            effect4->show();
-        }
-        catch (const std::exception& ex)
-        {
-            qWarning() << "ERROR: " << ex.what();
-            ui->statusBar->showMessage(QString(tr("Error: %1")).arg(ex.what()), 5000);
-            return;
+                    case 0x00:
+                    case 0x04:
+                        effect1->load(effects_set[i]);
+                        break;
+
+                    case 0x01:
+                    case 0x05:
+                        effect2->load(effects_set[i]);
+                        break;
+
+                    case 0x02:
+                    case 0x06:
+                        effect3->load(effects_set[i]);
+                        break;
+
+                    case 0x03:
+                    case 0x07:
+                        effect4->load(effects_set[i]);
+                        break;
+                    default:
+                        printf("unknown slot!\n");
+                }
+            } 
         }
+        effect1->show();
+        effect2->show();
+        effect3->show();
+        effect4->show();
     }
 
     // activate buttons
@@ -619,16 +622,7 @@ namespace plug
             set_effect(effects[1]);
         }
 
-        try
-        {
-            amp_ops->save_effects(static_cast<std::uint8_t>(slot), name, effects);
-        }
-        catch (const std::exception& ex)
-        {
-            qWarning() << "ERROR: " << ex.what();
-            ui->statusBar->showMessage(QString(tr("Error: %1")).arg(ex.what()), 5000);
-            return;
-        }
+        worker->save_effects(slot, name, effects);
     }
 
     void MainWindow::loadfile(QString filename)
@@ -646,36 +640,30 @@ namespace plug
         }
 
         settings.setValue("LoadFile/lastDirectory", QFileInfo(filename).absolutePath());
-        auto file = std::make_unique<QFile>(filename, this);
+        fuse::Preset preset;
 
-        if (file->exists())
+        try
         {
-            if (!file->open(QFile::ReadOnly | QFile::Text))
-            {
-                QMessageBox::critical(this, tr("Error!"), tr("Could not open file"));
-                return;
-            }
+            preset = fuse::readPresetFile(QFile::encodeName(filename).toStdString());
         }
-        else
+        catch (const std::invalid_argument& ex)
         {
-            QMessageBox::critical(this, tr("Error!"), tr("No such file"));
+            QMessageBox::critical(this, tr("Error!"), QString::fromStdString(ex.what()));
             return;
         }
 
-        amp_settings amplifier_set{};
-        fx_pedal_settings effects_set[4];
-        QString name;
-        auto loader = std::make_unique<LoadFromFile>(file.get(), &name, &amplifier_set, effects_set);
-        loader->loadfile();
-        file->close();
+        load_preset(preset.chain);
+    }
 
-        change_title(name);
+    void MainWindow::load_preset(const SignalChain& chain)
+    {
+        QSettings settings;
+        amp_settings amplifier_set = chain.amp();
+        const auto effects_set = chain.effects();
+
+        change_title(QString::fromStdString(chain.name()));
 
         amp->load(amplifier_set);
-        if (connected)
-        {
-            amp->send_amp();
-        }
         if (settings.value("Settings/popupChangedWindows").toBool())
         {
             amp->show();
@@ -724,10 +712,8 @@ namespace plug
     }
 
     if (connected) {
-        effect1->send_fx();
-        effect2->send_fx();
-        effect3->send_fx();
-        effect4->send_fx();
+        amp->get_settings(&amplifier_set);
+        apply_all(amplifier_set);
     }
 
     effect1->show();
@@ -833,9 +819,8 @@ namespace plug
     void MainWindow::update_firmware()
     {
         QString filename;
-        int ret = 0;
 
-        QMessageBox::information(this, "Prepare", R"(Please power off the amplifier, then power it back on while holding down:<ul><li>The "Save" button (Mustang I and II)</li><li>The Data Wheel (Mustang III, IV and IV)</li></ul>After pressing "OK" choose firmware file and then update will begin.It will take about one minute. You will be notified when it's finished.)");
+        QMessageBox::information(this, "Prepare", R"(Please power off the amplifier, then power it back on while holding down:<ul><li>The "Save" button (Mustang I and II)</li><li>The Data Wheel (Mustang III, IV and IV)</li></ul>After pressing "OK" choose firmware file and then update will begin. You will be notified when it's finished.)");
 
         filename = QFileDialog::getOpenFileName(this, tr("Open..."), QDir::homePath(), tr("Mustang firmware (*.upd)"));
         if (filename.isEmpty())
@@ -851,19 +836,22 @@ namespace plug
         ui->statusBar->showMessage("Updating firmware. Please wait...");
         ui->centralWidget->setDisabled(true);
         ui->menuBar->setDisabled(true);
-        this->repaint();
-        ret = com::updateFirmware(filename.toLatin1().constData());
+        worker->update_firmware(filename.toStdString());
+    }
+
+    void MainWindow::firmware_progress(int percent, double bytesPerSecond)
+    {
+        ui->statusBar->showMessage(QString(tr("Updating firmware: %1% (%2 kB/s)")).arg(percent).arg(bytesPerSecond / 1024.0, 0, 'f', 1));
+    }
+
+    void MainWindow::firmware_updated(QString errorMessage)
+    {
         ui->centralWidget->setDisabled(false);
         ui->menuBar->setDisabled(false);
         ui->statusBar->showMessage("", 1);
-        if (ret == -100)
+        if (errorMessage.isEmpty() == false)
         {
-            ui->statusBar->showMessage(tr("Error: Suitable device not found!"), 5000);
-            return;
-        }
-        if (ret != 0)
-        {
-            ui->statusBar->showMessage(QString(tr("Communication error: %1")).arg(ret), 5000);
+            ui->statusBar->showMessage(errorMessage, 5000);
             return;
         }
         QMessageBox::information(this, "Update finished", R"(<b>Update finished</b><br>If "Exit" button is lit - update was succesful<br>If "Save" button is lit - update failed<br><br>Power off the amplifier and then back on to finish the process.)");
@@ -1001,6 +989,25 @@ namespace plug
         if (settings.contains("DefaultPresets/Preset9"))
             load_from_amp(settings.value("DefaultPresets/Preset9").toInt());
     }
+
+    void MainWindow::update_stats()
+    {
+        if (connected == false)
+        {
+            statsLabel->clear();
+            return;
+        }
+
+        const auto stats = worker->statistics();
+        const auto& send = stats.latency(com::Operation::send);
+        const auto toMillis = [](std::chrono::microseconds value) { return static_cast<double>(value.count()) / 1000.0; };
+
+        statsLabel->setText(QString(tr("USB p50 %1 ms, p99 %2 ms | retries: %3 | timeouts: %4"))
+                                .arg(toMillis(send.p50), 0, 'f', 1)
+                                .arg(toMillis(send.p99), 0, 'f', 1)
+                                .arg(stats.counter(com::Counter::sendRetries))
+                                .arg(stats.counter(com::Counter::receiveTimeouts)));
+    }
 }
 
 #include "ui/moc_mainwindow.moc"
@@ -0,0 +1,450 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ui/mustangworker.h"
+#include "com/Mustang.h"
+#include "com/ConnectionFactory.h"
+#include "com/CommunicationException.h"
+#include "com/MustangUpdater.h"
+#include <QDebug>
+#include <QDir>
+#include <QSettings>
+#include <QStandardPaths>
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+namespace plug
+{
+    namespace
+    {
+        com::DSP effectTarget(std::uint8_t fxSlot)
+        {
+            constexpr std::uint8_t slotCount{4};
+
+            switch (fxSlot % slotCount)
+            {
+                case 0:
+                    return com::DSP::effect0;
+                case 1:
+                    return com::DSP::effect1;
+                case 2:
+                    return com::DSP::effect2;
+                default:
+                    return com::DSP::effect3;
+            }
+        }
+
+        std::size_t countPresets(const std::vector<std::string>& names)
+        {
+            const auto end = std::find_if(names.cbegin(), names.cend(), [](const auto& name) { return name.empty(); });
+            return static_cast<std::size_t>(std::distance(names.cbegin(), end));
+        }
+
+        std::string stateDirectory()
+        {
+            const auto dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+            QDir{}.mkpath(dir);
+            return dir.toStdString();
+        }
+    }
+
+
+    MustangWorker::MustangWorker()
+        : QObject(nullptr), processing(false), amp_ops(nullptr), prefetching(false), stateCache(stateDirectory()), listenRequested(false)
+    {
+        qRegisterMetaType<SignalChain>();
+        qRegisterMetaType<std::vector<std::string>>();
+
+        thread.setObjectName("MustangWorker");
+        moveToThread(&thread);
+        thread.start();
+    }
+
+    MustangWorker::~MustangWorker()
+    {
+        thread.quit();
+        thread.wait();
+    }
+
+    // The state stored for the amp is reported right away, then replaced if
+    // the amp reports something different.
+    void MustangWorker::start_amp()
+    {
+        enqueue([this] {
+            const auto device = com::openUsbDevice();
+            deviceId = device.connection->deviceId();
+            device.connection->setReceiveListener([this] { request_listen(); });
+            amp_ops = com::createMustang(device.connection, device.protocol);
+            {
+                std::lock_guard<std::mutex> lock{mutex};
+                stats = amp_ops->statistics();
+            }
+            amp_ops->subscribe([this](const SignalChain& chain) { emit state_changed(chain); });
+
+            const auto stored = stateCache.load(deviceId);
+
+            if (stored.has_value() == true)
+            {
+                emit amp_started(stored->chain, stored->presetNames);
+            }
+
+            try
+            {
+                const auto [signalChain, presets] = amp_ops->start_amp([this](std::uint8_t slot, const std::string& name) {
+                    emit preset_name_loaded(slot, QString::fromStdString(name));
+                });
+                presetNames = presets;
+                cache.reset(countPresets(presets));
+
+                if ((stored.has_value() == true) && (stored->presetNames == presets))
+                {
+                    cache.restore(stored->banks);
+                }
+
+                if ((stored.has_value() == false) || (com::fingerprint(stored->presetNames, stored->chain) != com::fingerprint(presets, signalChain)))
+                {
+                    emit amp_started(signalChain, presets);
+                }
+                prefetching = QSettings{}.value("Settings/prefetchBanks").toBool();
+            }
+            catch (const std::exception&)
+            {
+                amp_ops.reset();
+
+                if (stored.has_value() == true)
+                {
+                    emit amp_stopped();
+                }
+                throw;
+            }
+        });
+    }
+
+    void MustangWorker::stop_amp()
+    {
+        enqueue([this] {
+            store_state();
+            prefetching = false;
+            cache.reset(0);
+            mustang().stop_amp();
+            amp_ops.reset();
+            emit amp_stopped();
+        });
+    }
+
+    void MustangWorker::set_effect(fx_pedal_settings pedal)
+    {
+        enqueue([this, pedal] { mustang().set_effect(pedal); }, effectTarget(pedal.fx_slot));
+    }
+
+    void MustangWorker::set_amplifier(amp_settings settings)
+    {
+        enqueue([this, settings] { mustang().set_amplifier(settings); }, com::DSP::amp);
+    }
+
+    void MustangWorker::apply_chain(const SignalChain& chain)
+    {
+        enqueue([this, chain] { mustang().applyChain(chain); });
+    }
+
+    void MustangWorker::save_on_amp(const std::string& name, int slot)
+    {
+        enqueue([this, name, slot] {
+            const auto bank = static_cast<std::uint8_t>(slot);
+            cache.invalidate(bank);
+            mustang().save_on_amp(name, bank);
+
+            if (const auto state = mustang().current_state(); state.has_value() == true)
+            {
+                cache.put(bank, *state);
+            }
+
+            if (bank < presetNames.size())
+            {
+                presetNames[bank] = name;
+            }
+            store_state();
+            emit bank_saved(QString::fromStdString(name), slot);
+        });
+    }
+
+    // A cached bank is reported immediately, the amp is switched to it anyway
+    void MustangWorker::load_memory_bank(int slot)
+    {
+        const auto bank = static_cast<std::uint8_t>(slot);
+        const auto cached = cache.get(bank);
+
+        if (cached.has_value() == true)
+        {
+            emit bank_loaded(*cached);
+        }
+
+        enqueue([this, bank, notify = !cached.has_value()] {
+            const auto signalChain = mustang().load_memory_bank(bank);
+
+            if (mustang().current_state().has_value() == true)
+            {
+                cache.put(bank, signalChain);
+            }
+
+            if (notify == true)
+            {
+                emit bank_loaded(signalChain);
+            }
+        });
+    }
+
+    void MustangWorker::save_effects(int slot, const std::string& name, const std::vector<fx_pedal_settings>& effects)
+    {
+        enqueue([this, slot, name, effects] {
+            cache.invalidate(static_cast<std::uint8_t>(slot));
+            mustang().save_effects(static_cast<std::uint8_t>(slot), name, effects);
+        });
+    }
+
+    // Progress is reported once per percent, so the GUI isn't flooded
+    void MustangWorker::update_firmware(const std::string& filename)
+    {
+        enqueue([this, filename] {
+            int shownPercent{-1};
+            const auto onProgress = [this, &shownPercent](const com::UpdateProgress& progress) {
+                const auto percent = static_cast<int>(progress.bytesSent * 100 / progress.totalBytes);
+
+                if (percent != shownPercent)
+                {
+                    shownPercent = percent;
+                    emit firmware_progress(percent, progress.bytesPerSecond());
+                }
+            };
+
+            try
+            {
+                com::updateFirmware(filename, onProgress);
+                emit firmware_updated(QString{});
+            }
+            catch (const std::invalid_argument& ex)
+            {
+                emit firmware_updated(QString(tr("Invalid firmware file: %1")).arg(QString::fromStdString(ex.what())));
+            }
+            catch (const std::exception& ex)
+            {
+                emit firmware_updated(QString(tr("Communication error: %1")).arg(QString::fromStdString(ex.what())));
+            }
+        });
+    }
+
+    com::StatsSnapshot MustangWorker::statistics()
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        return (stats != nullptr ? stats->snapshot() : com::StatsSnapshot{});
+    }
+
+    void MustangWorker::enqueue(Command command, std::optional<com::DSP> target)
+    {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+
+            if (target.has_value() == true)
+            {
+                // Only look back to the last untargeted command, which must not be overtaken
+                const auto barrier = std::find_if(commands.rbegin(), commands.rend(), [](const auto& queued) { return queued.target.has_value() == false; });
+                const auto pending = std::find_if(commands.rbegin(), barrier, [&target](const auto& queued) { return queued.target == target; });
+
+                if (pending != barrier)
+                {
+                    pending->command = std::move(command);
+                    return;
+                }
+            }
+
+            commands.push_back({target, std::move(command)});
+
+            if (processing == true)
+            {
+                return;
+            }
+            processing = true;
+        }
+
+        QMetaObject::invokeMethod(this, "process_commands", Qt::QueuedConnection);
+    }
+
+    bool MustangWorker::next_command(Command& command)
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        if (commands.empty() == true)
+        {
+            return false;
+        }
+
+        command = std::move(commands.front().command);
+        commands.pop_front();
+        return true;
+    }
+
+    bool MustangWorker::has_pending_commands()
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        return (commands.empty() == false);
+    }
+
+    // Returns true if interrupted by new commands
+    bool MustangWorker::prefetch_banks()
+    {
+        if ((prefetching == false) || (amp_ops == nullptr))
+        {
+            return false;
+        }
+
+        const auto state = amp_ops->current_state();
+
+        if (state.has_value() == false)
+        {
+            return false;
+        }
+
+        bool loaded{false};
+        bool interrupted{false};
+
+        try
+        {
+            for (auto slot = cache.nextMissing(); (slot.has_value() == true) && (interrupted == false); slot = cache.nextMissing())
+            {
+                loaded = true;
+                const auto signalChain = amp_ops->load_memory_bank(*slot);
+
+                // The state is only known if the bank was decoded completely
+                if (amp_ops->current_state().has_value() == false)
+                {
+                    throw com::CommunicationException{"Incomplete memory bank " + std::to_string(*slot)};
+                }
+                cache.put(*slot, signalChain);
+                interrupted = has_pending_commands();
+            }
+        }
+        catch (const std::exception& ex)
+        {
+            qWarning() << "ERROR: " << ex.what();
+            prefetching = false;
+        }
+
+        if (loaded == true)
+        {
+            try
+            {
+                amp_ops->applyChain(*state);
+            }
+            catch (const std::exception& ex)
+            {
+                qWarning() << "ERROR: " << ex.what();
+                emit error(QString::fromStdString(ex.what()));
+                return interrupted;
+            }
+
+            if (interrupted == false)
+            {
+                store_state();
+            }
+        }
+
+        return interrupted;
+    }
+
+    void MustangWorker::store_state()
+    {
+        if (amp_ops == nullptr)
+        {
+            return;
+        }
+
+        if (const auto state = amp_ops->current_state(); state.has_value() == true)
+        {
+            stateCache.store(deviceId, com::AmpState{presetNames, *state, cache.snapshot()});
+        }
+    }
+
+    // Called on the USB event thread; runs listen() on the worker thread,
+    // where it can't interfere with a command in progress.
+    void MustangWorker::request_listen()
+    {
+        if (listenRequested.exchange(true) == false)
+        {
+            QMetaObject::invokeMethod(this, "listen", Qt::QueuedConnection);
+        }
+    }
+
+    com::Mustang& MustangWorker::mustang()
+    {
+        if (amp_ops == nullptr)
+        {
+            throw com::CommunicationException{"Device not connected"};
+        }
+        return *amp_ops;
+    }
+
+    void MustangWorker::process_commands()
+    {
+        Command command;
+
+        while (true)
+        {
+            while (next_command(command) == true)
+            {
+                try
+                {
+                    command();
+                }
+                catch (const std::exception& ex)
+                {
+                    qWarning() << "ERROR: " << ex.what();
+                    emit error(QString::fromStdString(ex.what()));
+                }
+            }
+
+            if (prefetch_banks() == true)
+            {
+                continue;
+            }
+
+            std::lock_guard<std::mutex> lock{mutex};
+
+            if (commands.empty() == true)
+            {
+                processing = false;
+                return;
+            }
+        }
+    }
+
+    void MustangWorker::listen()
+    {
+        listenRequested = false;
+
+        if (amp_ops != nullptr)
+        {
+            amp_ops->listen();
+        }
+    }
+}
+
+#include "ui/moc_mustangworker.moc"
@@ -47,108 +47,64 @@ namespace plug
 
     void QuickPresets::load_names(const std::vector<std::string>& names)
     {
-        int i;
-        QSettings settings;
+        delete_items();
 
-        for (i = 0; i < 100; i++)
+        for (std::size_t i = 0; (i < names.size()) && (names[i].empty() == false); ++i)
         {
-            if (names[i][0] == 0x00)
-            {
-                break;
-            }
-            const QString name = QString::fromStdString(names[i]);
-            ui->comboBox->addItem(QString("[%1] %2").arg(i + 1).arg(name));
-            ui->comboBox_2->addItem(QString("[%1] %2").arg(i + 1).arg(name));
-            ui->comboBox_3->addItem(QString("[%1] %2").arg(i + 1).arg(name));
-            ui->comboBox_4->addItem(QString("[%1] %2").arg(i + 1).arg(name));
-            ui->comboBox_5->addItem(QString("[%1] %2").arg(i + 1).arg(name));
-            ui->comboBox_6->addItem(QString("[%1] %2").arg(i + 1).arg(name));
-            ui->comboBox_7->addItem(QString("[%1] %2").arg(i + 1).arg(name));
-            ui->comboBox_8->addItem(QString("[%1] %2").arg(i + 1).arg(name));
-            ui->comboBox_9->addItem(QString("[%1] %2").arg(i + 1).arg(name));
-            ui->comboBox_10->addItem(QString("[%1] %2").arg(i + 1).arg(name));
+            set_name(static_cast<int>(i), names[i]);
         }
+    }
 
-        ui->comboBox->addItem(tr("[Empty]"));
-        ui->comboBox_2->addItem(tr("[Empty]"));
-        ui->comboBox_3->addItem(tr("[Empty]"));
-        ui->comboBox_4->addItem(tr("[Empty]"));
-        ui->comboBox_5->addItem(tr("[Empty]"));
-        ui->comboBox_6->addItem(tr("[Empty]"));
-        ui->comboBox_7->addItem(tr("[Empty]"));
-        ui->comboBox_8->addItem(tr("[Empty]"));
-        ui->comboBox_9->addItem(tr("[Empty]"));
-        ui->comboBox_10->addItem(tr("[Empty]"));
-
-        if (settings.contains("DefaultPresets/Preset0"))
-            ui->comboBox->setCurrentIndex(settings.value("DefaultPresets/Preset0").toInt());
-        else
-            ui->comboBox->setCurrentIndex(i);
-
-        if (settings.contains("DefaultPresets/Preset1"))
-            ui->comboBox_2->setCurrentIndex(settings.value("DefaultPresets/Preset1").toInt());
-        else
-            ui->comboBox_2->setCurrentIndex(i);
-
-        if (settings.contains("DefaultPresets/Preset2"))
-            ui->comboBox_3->setCurrentIndex(settings.value("DefaultPresets/Preset2").toInt());
-        else
-            ui->comboBox_3->setCurrentIndex(i);
-
-        if (settings.contains("DefaultPresets/Preset3"))
-            ui->comboBox_4->setCurrentIndex(settings.value("DefaultPresets/Preset3").toInt());
-        else
-            ui->comboBox_4->setCurrentIndex(i);
-
-        if (settings.contains("DefaultPresets/Preset4"))
-            ui->comboBox_5->setCurrentIndex(settings.value("DefaultPresets/Preset4").toInt());
-        else
-            ui->comboBox_5->setCurrentIndex(i);
+    // Names are inserted in order of their slots, in front of the trailing
+    // "[Empty]" entry; a stored default is selected once its name arrives.
+    void QuickPresets::set_name(int slot, const std::string& name)
+    {
+        QSettings settings;
+        const QString text = QString("[%1] %2").arg(slot + 1).arg(QString::fromStdString(name));
+        const auto boxes = comboBoxes();
 
-        if (settings.contains("DefaultPresets/Preset5"))
-            ui->comboBox_6->setCurrentIndex(settings.value("DefaultPresets/Preset5").toInt());
-        else
-            ui->comboBox_6->setCurrentIndex(i);
+        for (std::size_t i = 0; i < boxes.size(); ++i)
+        {
+            auto box = boxes[i];
 
-        if (settings.contains("DefaultPresets/Preset6"))
-            ui->comboBox_7->setCurrentIndex(settings.value("DefaultPresets/Preset6").toInt());
-        else
-            ui->comboBox_7->setCurrentIndex(i);
+            if (box->count() == 0)
+            {
+                box->addItem(tr("[Empty]"));
+            }
 
-        if (settings.contains("DefaultPresets/Preset7"))
-            ui->comboBox_8->setCurrentIndex(settings.value("DefaultPresets/Preset7").toInt());
-        else
-            ui->comboBox_8->setCurrentIndex(i);
+            const int nameCount = box->count() - 1;
 
-        if (settings.contains("DefaultPresets/Preset8"))
-            ui->comboBox_9->setCurrentIndex(settings.value("DefaultPresets/Preset8").toInt());
-        else
-            ui->comboBox_9->setCurrentIndex(i);
+            if (slot < nameCount)
+            {
+                box->setItemText(slot, text);
+            }
+            else if (slot == nameCount)
+            {
+                box->insertItem(slot, text);
 
-        if (settings.contains("DefaultPresets/Preset9"))
-            ui->comboBox_10->setCurrentIndex(settings.value("DefaultPresets/Preset9").toInt());
-        else
-            ui->comboBox_10->setCurrentIndex(i);
+                if (settings.value(QString("DefaultPresets/Preset%1").arg(i), -1).toInt() == slot)
+                {
+                    box->setCurrentIndex(slot);
+                }
+            }
+        }
     }
 
     void QuickPresets::delete_items()
     {
-        int j = ui->comboBox->count();
-        for (int i = 0; i < j; i++)
+        for (auto box : comboBoxes())
         {
-            ui->comboBox->removeItem(0);
-            ui->comboBox_2->removeItem(0);
-            ui->comboBox_3->removeItem(0);
-            ui->comboBox_4->removeItem(0);
-            ui->comboBox_5->removeItem(0);
-            ui->comboBox_6->removeItem(0);
-            ui->comboBox_7->removeItem(0);
-            ui->comboBox_8->removeItem(0);
-            ui->comboBox_9->removeItem(0);
-            ui->comboBox_10->removeItem(0);
+            box->clear();
+            box->addItem(tr("[Empty]"));
         }
     }
 
+    std::array<QComboBox*, 10> QuickPresets::comboBoxes() const
+    {
+        return {{ui->comboBox, ui->comboBox_2, ui->comboBox_3, ui->comboBox_4, ui->comboBox_5,
+                 ui->comboBox_6, ui->comboBox_7, ui->comboBox_8, ui->comboBox_9, ui->comboBox_10}};
+    }
+
     void QuickPresets::change_name(int slot, QString* name)
     {
         ui->comboBox->setItemText(slot, *name);
@@ -62,24 +62,34 @@ namespace plug
 
     void SaveOnAmp::load_names(const std::vector<std::string>& names)
     {
-        for (std::size_t i = 0; i < 100; ++i)
+        ui->comboBox->clear();
+
+        for (std::size_t i = 0; (i < names.size()) && (names[i].empty() == false); ++i)
         {
-            if (names[i][0] == 0x00)
-            {
-                break;
-            }
-            ui->comboBox->addItem(QString("[%1] %2").arg(i + 1).arg(QString::fromStdString(names[i])));
+            set_name(static_cast<int>(i), names[i]);
         }
     }
 
-    void SaveOnAmp::delete_items()
+    // Names are added in order of their slots; a gap ends the list
+    void SaveOnAmp::set_name(int slot, const std::string& name)
     {
-        for (int i = 0; i < ui->comboBox->count(); ++i)
+        const QString text = QString("[%1] %2").arg(slot + 1).arg(QString::fromStdString(name));
+
+        if (slot < ui->comboBox->count())
+        {
+            ui->comboBox->setItemText(slot, text);
+        }
+        else if (slot == ui->comboBox->count())
         {
-            ui->comboBox->removeItem(0);
+            ui->comboBox->addItem(text);
         }
     }
 
+    void SaveOnAmp::delete_items()
+    {
+        ui->comboBox->clear();
+    }
+
     void SaveOnAmp::change_index(int value, const QString& name)
     {
         if (value > 0)
@@ -0,0 +1,168 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "com/Mustang.h"
+#include "com/PacketSerializer.h"
+#include "helper/AllocationCounter.h"
+#include <algorithm>
+#include <gmock/gmock.h>
+
+using namespace plug;
+using namespace plug::com;
+using namespace test::helper;
+using namespace testing;
+
+namespace
+{
+    // Replies without allocating: the bank data after a load command,
+    // an empty packet to everything else
+    class StaticConnection : public Connection
+    {
+    public:
+        explicit StaticConnection(const std::array<PacketRawType, 7>& bankData)
+            : bank(bankData), next(bankData.size())
+        {
+        }
+
+        void close() override
+        {
+        }
+
+        bool isOpen() const override
+        {
+            return true;
+        }
+
+        std::vector<std::uint8_t> receive(std::size_t recvSize) override
+        {
+            std::vector<std::uint8_t> data(recvSize);
+            data.resize(receiveIntoImpl(data.data(), data.size()));
+            return data;
+        }
+
+        std::size_t packetsSent{0};
+
+    private:
+        std::size_t sendImpl(const std::uint8_t* data, std::size_t size) override
+        {
+            const auto loadSlot = serializeLoadSlotCommand(0).getBytes();
+            next = (std::equal(loadSlot.cbegin(), std::next(loadSlot.cbegin(), 3), data) == true ? 0 : bank.size());
+            ++packetsSent;
+            return size;
+        }
+
+        std::size_t receiveIntoImpl(std::uint8_t* buffer, std::size_t size) override
+        {
+            const PacketRawType reply = (next < bank.size() ? bank[next++] : PacketRawType{});
+            std::copy_n(reply.cbegin(), std::min(size, reply.size()), buffer);
+            return std::min(size, reply.size());
+        }
+
+        const std::array<PacketRawType, 7> bank;
+        std::size_t next;
+    };
+}
+
+
+class AllocationTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        std::array<PacketRawType, 7> bank{{}};
+        bank[0] = serializeName(0, "bank").getBytes();
+        bank[1] = serializeAmpSettings(ampA).getBytes();
+
+        for (std::uint8_t i = 0; i < 4; ++i)
+        {
+            bank[2 + i] = serializeEffectSettings(fx_pedal_settings{i, effects::SINE_CHORUS, 1, 2, 3, 4, 5, 6, Position::input}).getBytes();
+        }
+        bank[6] = serializeAmpSettingsUsbGain(ampA).getBytes();
+
+        conn = std::make_shared<StaticConnection>(bank);
+        m = std::make_unique<BasicMustang<SmallAmpsV1>>(conn);
+        m->load_memory_bank(0);
+    }
+
+    std::shared_ptr<StaticConnection> conn;
+    std::unique_ptr<Mustang> m;
+    const amp_settings ampA{amps::BRITISH_80S, 2, 1, 3, 4, 5, cabinets::cab4x12M, 0, 9, 10, 11, 0, 0x80, 13, 1, false, 0xab};
+    const amp_settings ampB{amps::FENDER_57_DELUXE, 7, 6, 5, 4, 3, cabinets::cab2x12C, 1, 2, 3, 4, 5, 0x80, 1, 0, true, 0x12};
+    const fx_pedal_settings effectA{1, effects::TAPE_DELAY, 1, 2, 3, 4, 5, 6, Position::effectsLoop};
+    const fx_pedal_settings effectB{1, effects::TAPE_DELAY, 6, 5, 4, 3, 2, 1, Position::effectsLoop};
+};
+
+TEST_F(AllocationTest, setEffectAndAmplifierDontAllocate)
+{
+    m->set_effect(effectA);
+    m->set_amplifier(ampB);
+
+    const auto sent = conn->packetsSent;
+    const auto allocations = allocationCount();
+
+    for (int i = 0; i < 10; ++i)
+    {
+        m->set_effect((i % 2 == 0) ? effectB : effectA);
+        m->set_amplifier((i % 2 == 0) ? ampA : ampB);
+    }
+
+    EXPECT_THAT(allocationCount() - allocations, Eq(0));
+    EXPECT_THAT(conn->packetsSent - sent, Eq(10 * (2 + 4)));
+    EXPECT_THAT(m->current_state(), Ne(std::nullopt));
+}
+
+TEST_F(AllocationTest, saveEffectsDoesntAllocate)
+{
+    const std::array<fx_pedal_settings, 2> delays{{effectA, effectB}};
+    m->save_effects(0, "fx", delays);
+
+    const auto sent = conn->packetsSent;
+    const auto allocations = allocationCount();
+
+    for (std::uint8_t i = 0; i < 10; ++i)
+    {
+        m->save_effects(i, "fx", delays);
+    }
+
+    EXPECT_THAT(allocationCount() - allocations, Eq(0));
+    EXPECT_THAT(conn->packetsSent - sent, Eq(10 * (1 + 2 + 1)));
+}
+
+TEST_F(AllocationTest, listenDoesntAllocateIfNothingReceived)
+{
+    m->listen();
+
+    const auto allocations = allocationCount();
+
+    for (int i = 0; i < 10; ++i)
+    {
+        m->listen();
+    }
+
+    EXPECT_THAT(allocationCount() - allocations, Eq(0));
+}
+
+TEST_F(AllocationTest, counterSeesAllocations)
+{
+    const auto allocations = allocationCount();
+    auto data = std::make_unique<int>(3);
+
+    EXPECT_THAT(allocationCount() - allocations, Eq(1));
+}
@@ -0,0 +1,121 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "com/AmpStateCache.h"
+#include <cstdio>
+#include <fstream>
+#include <gmock/gmock.h>
+
+using namespace plug;
+using namespace plug::com;
+using namespace testing;
+
+class AmpStateCacheTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        std::remove(file.c_str());
+    }
+
+    void TearDown() override
+    {
+        std::remove(file.c_str());
+    }
+
+    AmpState createState() const
+    {
+        const amp_settings amp{amps::BRITISH_80S, 2, 1, 3, 4, 5, cabinets::cab4x12M, 0, 9, 10, 11, 0, 0x80, 13, 1, true, 0xab};
+        const fx_pedal_settings chorus{1, effects::TRIANGLE_CHORUS, 0, 0, 0, 1, 1, 0, Position::input};
+        const fx_pedal_settings delay{3, effects::TAPE_DELAY, 1, 2, 3, 4, 5, 6, Position::effectsLoop};
+        const SignalChain chain{"current", amp, {{fx_pedal_settings{}, chorus, fx_pedal_settings{}, delay}}};
+
+        return AmpState{{"bank 0", "bank 1", ""}, chain, {chain, std::nullopt, SignalChain{"bank 2", amp, {{}}}}};
+    }
+
+    const std::string deviceId{"0012-A1/B2"};
+    const std::string file{TempDir() + "/amp-0012_A1_B2.state"};
+    const AmpStateCache cache{TempDir()};
+};
+
+TEST_F(AmpStateCacheTest, loadReturnsStoredState)
+{
+    const auto state = createState();
+    ASSERT_THAT(cache.store(deviceId, state), Eq(true));
+
+    const auto loaded = cache.load(deviceId);
+    ASSERT_THAT(loaded, Ne(std::nullopt));
+    EXPECT_THAT(loaded->presetNames, ContainerEq(state.presetNames));
+    EXPECT_THAT(fingerprint(loaded->presetNames, loaded->chain), Eq(fingerprint(state.presetNames, state.chain)));
+    EXPECT_THAT(loaded->chain.name(), StrEq("current"));
+    EXPECT_THAT(loaded->chain.amp().usb_gain, Eq(0xab));
+    EXPECT_THAT(loaded->chain.effects()[3].effect_num, Eq(effects::TAPE_DELAY));
+    EXPECT_THAT(loaded->chain.effects()[3].position, Eq(Position::effectsLoop));
+    ASSERT_THAT(loaded->banks.size(), Eq(3));
+    EXPECT_THAT(loaded->banks[1], Eq(std::nullopt));
+    ASSERT_THAT(loaded->banks[2], Ne(std::nullopt));
+    EXPECT_THAT(loaded->banks[2]->name(), StrEq("bank 2"));
+}
+
+TEST_F(AmpStateCacheTest, loadReturnsNothingIfNotStored)
+{
+    EXPECT_THAT(cache.load(deviceId), Eq(std::nullopt));
+}
+
+TEST_F(AmpStateCacheTest, emptyDeviceIdIsNotCached)
+{
+    EXPECT_THAT(cache.store("", createState()), Eq(false));
+    EXPECT_THAT(cache.load(""), Eq(std::nullopt));
+}
+
+TEST_F(AmpStateCacheTest, loadRejectsFileOfOtherDevice)
+{
+    cache.store(deviceId, createState());
+    EXPECT_THAT(cache.load("0012-A1_B2"), Eq(std::nullopt));
+}
+
+TEST_F(AmpStateCacheTest, loadRejectsTruncatedFile)
+{
+    cache.store(deviceId, createState());
+    {
+        std::ifstream in{file, std::ios::binary};
+        std::string content{std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+        in.close();
+        std::ofstream out{file, std::ios::binary | std::ios::trunc};
+        out << content.substr(0, content.size() - 5);
+    }
+
+    EXPECT_THAT(cache.load(deviceId), Eq(std::nullopt));
+}
+
+TEST_F(AmpStateCacheTest, fingerprintChangesWithState)
+{
+    const auto state = createState();
+    auto names = state.presetNames;
+    names[1] = "changed";
+    auto chain = state.chain;
+    auto amp = chain.amp();
+    amp.gain = 99;
+    chain.setAmp(amp);
+
+    const auto original = fingerprint(state.presetNames, state.chain);
+    EXPECT_THAT(fingerprint(names, state.chain), Ne(original));
+    EXPECT_THAT(fingerprint(state.presetNames, chain), Ne(original));
+}
@@ -0,0 +1,202 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "com/BankArchive.h"
+#include "com/CommunicationException.h"
+#include "com/Mustang.h"
+#include "com/Stats.h"
+#include "simulator/SimulatedMustang.h"
+#include "matcher/TypeMatcher.h"
+#include <cstdio>
+#include <fstream>
+#include <gmock/gmock.h>
+
+using namespace plug;
+using namespace plug::com;
+using namespace test::matcher;
+using namespace test::simulator;
+using namespace testing;
+
+class BankArchiveTest : public testing::Test
+{
+protected:
+    void TearDown() override
+    {
+        std::remove(file.c_str());
+    }
+
+    static std::unique_ptr<Mustang> connect(std::shared_ptr<SimulatedMustang> sim)
+    {
+        auto m = createMustang(sim, ProtocolKind::bigAmpsV2);
+        m->start_amp();
+        return m;
+    }
+
+    static std::shared_ptr<SimulatedMustang> simulator()
+    {
+        return std::make_shared<SimulatedMustang>(ProtocolKind::bigAmpsV2, SimulatedMustang::noDelay());
+    }
+
+    static BankImage imageOf(std::uint8_t value)
+    {
+        BankImage image{};
+        std::for_each(image.begin(), image.end(), [value](auto& packet) { packet.fill(value); });
+        return image;
+    }
+
+    SignalChain preset(const std::string& name, std::uint8_t gain) const
+    {
+        auto settings = ampSettings;
+        settings.gain = gain;
+        return SignalChain{name, settings, {{{0, effects::EMPTY, 0, 0, 0, 0, 0, 0, Position::input}, {1, effects::EMPTY, 0, 0, 0, 0, 0, 0, Position::input}, {2, effects::EMPTY, 0, 0, 0, 0, 0, 0, Position::input}, delay}}};
+    }
+
+    const std::string file{TempDir() + "/plug-bank-archive-test.bin"};
+    const amp_settings ampSettings{amps::BRITISH_80S, 2, 1, 3, 4, 5, cabinets::cab4x12M, 0, 9, 10, 11, 0, 0x80, 13, 1, false, 0xab};
+    const fx_pedal_settings delay{3, effects::TAPE_DELAY, 1, 2, 3, 4, 5, 6, Position::effectsLoop};
+};
+
+TEST_F(BankArchiveTest, archiveKeepsImagesAndHashes)
+{
+    const std::vector<BankImage> images{imageOf(1), imageOf(2), imageOf(3)};
+
+    writeBankArchive(file, images);
+    const BankArchive archive{file};
+
+    ASSERT_THAT(archive.size(), Eq(3));
+    EXPECT_THAT(archive.image(1), ContainerEq(images[1]));
+    EXPECT_THAT(archive.image(2), ContainerEq(images[2]));
+    EXPECT_THAT(archive.hash(0), Eq(bankHash(images[0])));
+    EXPECT_THAT(bankHashes(archive), ContainerEq(bankHashes(images)));
+}
+
+TEST_F(BankArchiveTest, hashIgnoresHeaders)
+{
+    auto image = imageOf(7);
+    const auto hash = bankHash(image);
+
+    image[2][1] = 0x00;
+    EXPECT_THAT(bankHash(image), Eq(hash));
+
+    image[2][sizeHeader] = 0x00;
+    EXPECT_THAT(bankHash(image), Ne(hash));
+}
+
+TEST_F(BankArchiveTest, openRejectsInvalidFiles)
+{
+    EXPECT_THROW(BankArchive{file}, std::invalid_argument);
+
+    writeBankArchive(file, {imageOf(1), imageOf(2)});
+    {
+        std::ofstream out{file, std::ios::binary | std::ios::app};
+        out << "trailing";
+    }
+    EXPECT_THROW(BankArchive{file}, std::invalid_argument);
+
+    {
+        std::ofstream out{file, std::ios::binary | std::ios::trunc};
+        out << "no archive at all";
+    }
+    EXPECT_THROW(BankArchive{file}, std::invalid_argument);
+}
+
+TEST_F(BankArchiveTest, changedBanksComparesHashes)
+{
+    writeBankArchive(file, {imageOf(1), imageOf(2), imageOf(3)});
+    const BankArchive archive{file};
+
+    EXPECT_THAT(changedBanks(archive, {bankHash(imageOf(1)), bankHash(imageOf(9))}), ElementsAre(1, 2));
+    EXPECT_THAT(changedBanks(archive, bankHashes(archive)), IsEmpty());
+}
+
+TEST_F(BankArchiveTest, writeBankImageSavesBankAsReceived)
+{
+    const auto source = simulator();
+    const auto target = simulator();
+    source->setBank(5, preset("bank 5", 7));
+    const auto from = connect(source);
+    const auto to = connect(target);
+
+    to->writeBankImage(9, from->loadBankImage(5));
+
+    EXPECT_THAT(target->bank(9).name(), StrEq("bank 5"));
+    EXPECT_THAT(target->bank(9).amp(), AmpIs(preset("bank 5", 7).amp()));
+    EXPECT_THAT(target->bank(9).effects()[3], EffectIs(delay));
+    ASSERT_THAT(to->current_state(), Ne(std::nullopt));
+    EXPECT_THAT(to->current_state()->name(), StrEq("bank 5"));
+}
+
+TEST_F(BankArchiveTest, writeBankImageRejectsInvalidBank)
+{
+    const auto sim = simulator();
+    const auto m = connect(sim);
+    const auto image = m->loadBankImage(0);
+
+    EXPECT_THROW(m->writeBankImage(100, image), std::invalid_argument);
+}
+
+TEST_F(BankArchiveTest, loadBankImageThrowsIfBankIsIncomplete)
+{
+    const auto sim = simulator();
+    const auto m = connect(sim);
+    sim->close();
+
+    EXPECT_THROW(m->loadBankImage(0), CommunicationException);
+}
+
+TEST_F(BankArchiveTest, restoreWritesChangedBanksOnly)
+{
+    const auto source = simulator();
+    const auto target = simulator();
+    const std::vector<std::uint8_t> changed{3, 17, 42, 80, 99};
+    std::for_each(changed.cbegin(), changed.cend(), [this, &source](std::uint8_t slot) { source->setBank(slot, preset("changed " + std::to_string(slot), slot)); });
+    const auto from = connect(source);
+    writeBankArchive(file, loadBankImages(*from, source->bankCount()));
+    const auto to = connect(target);
+    const BankArchive archive{file};
+
+    const auto written = restoreBanks(*to, archive, bankHashes(loadBankImages(*to, archive.size())));
+
+    EXPECT_THAT(written, ContainerEq(changed));
+    EXPECT_THAT(to->statistics()->snapshot().latency(Operation::writeBank).count, Eq(changed.size()));
+
+    for (std::uint8_t slot = 0; slot < target->bankCount(); ++slot)
+    {
+        EXPECT_THAT(target->bank(slot).name(), StrEq(source->bank(slot).name()));
+        EXPECT_THAT(target->bank(slot).amp(), AmpIs(source->bank(slot).amp()));
+    }
+}
+
+TEST_F(BankArchiveTest, restoreUsesCachedHashesWithoutReadingTheAmp)
+{
+    const auto target = simulator();
+    const auto to = connect(target);
+    const auto images = loadBankImages(*to, target->bankCount());
+    auto restored = images;
+    restored[4][0][sizeHeader] = 'X';
+    writeBankArchive(file, restored);
+    const BankArchive archive{file};
+    const auto loads = to->statistics()->snapshot().latency(Operation::loadMemoryBank).count;
+
+    const auto written = restoreBanks(*to, archive, bankHashes(images));
+
+    EXPECT_THAT(written, ElementsAre(4));
+    EXPECT_THAT(to->statistics()->snapshot().latency(Operation::loadMemoryBank).count, Eq(loads));
+}
@@ -0,0 +1,103 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "com/BankCache.h"
+#include <gmock/gmock.h>
+
+using namespace plug;
+using namespace plug::com;
+using namespace testing;
+
+class BankCacheTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        cache.reset(bankCount);
+    }
+
+    BankCache cache;
+    const SignalChain chain{"abc", amp_settings{}, {{}}};
+    static inline constexpr std::size_t bankCount{24};
+};
+
+TEST_F(BankCacheTest, resetClearsAllBanks)
+{
+    cache.put(3, chain);
+    cache.reset(bankCount);
+
+    EXPECT_THAT(cache.size(), Eq(bankCount));
+    EXPECT_THAT(cache.get(3), Eq(std::nullopt));
+}
+
+TEST_F(BankCacheTest, getReturnsStoredBank)
+{
+    cache.put(3, chain);
+
+    const auto bank = cache.get(3);
+    ASSERT_THAT(bank, Ne(std::nullopt));
+    EXPECT_THAT(bank->name(), StrEq("abc"));
+    EXPECT_THAT(cache.get(4), Eq(std::nullopt));
+}
+
+TEST_F(BankCacheTest, invalidateRemovesBank)
+{
+    cache.put(3, chain);
+    cache.invalidate(3);
+
+    EXPECT_THAT(cache.get(3), Eq(std::nullopt));
+}
+
+TEST_F(BankCacheTest, slotsOutOfRangeAreIgnored)
+{
+    cache.put(bankCount, chain);
+    cache.invalidate(bankCount);
+
+    EXPECT_THAT(cache.get(bankCount), Eq(std::nullopt));
+}
+
+TEST_F(BankCacheTest, nextMissingReturnsFirstUncachedSlot)
+{
+    EXPECT_THAT(cache.nextMissing(), Eq(0));
+
+    cache.put(0, chain);
+    cache.put(2, chain);
+    EXPECT_THAT(cache.nextMissing(), Eq(1));
+
+    for (std::uint8_t i = 0; i < bankCount; ++i)
+    {
+        cache.put(i, chain);
+    }
+    EXPECT_THAT(cache.nextMissing(), Eq(std::nullopt));
+}
+
+TEST_F(BankCacheTest, restoreFillsBanksFromSnapshot)
+{
+    cache.put(1, chain);
+    const auto snapshot = cache.snapshot();
+
+    cache.reset(2);
+    cache.restore(snapshot);
+
+    EXPECT_THAT(cache.get(0), Eq(std::nullopt));
+    ASSERT_THAT(cache.get(1), Ne(std::nullopt));
+    EXPECT_THAT(cache.get(1)->name(), StrEq("abc"));
+    EXPECT_THAT(cache.size(), Eq(2));
+}
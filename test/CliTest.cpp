@@ -0,0 +1,231 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "cli/Commands.h"
+#include "cli/Json.h"
+#include "simulator/SimulatedMustang.h"
+#include "matcher/TypeMatcher.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <gmock/gmock.h>
+
+using namespace plug;
+using namespace plug::cli;
+using namespace test::matcher;
+using namespace test::simulator;
+using namespace testing;
+
+class CliTest : public testing::Test
+{
+protected:
+    void TearDown() override
+    {
+        std::remove(file.c_str());
+        std::remove(fuseFile.c_str());
+    }
+
+    static std::string print(const Json& json)
+    {
+        std::ostringstream os;
+        os << json;
+        return os.str();
+    }
+
+    void writeFile(const Json& json) const
+    {
+        std::ofstream out{file, std::ios::trunc};
+        out << json;
+    }
+
+    std::shared_ptr<SimulatedMustang> connect()
+    {
+        auto sim = std::make_shared<SimulatedMustang>(com::ProtocolKind::smallAmpsV1, SimulatedMustang::noDelay());
+        amp = com::createMustang(sim, com::ProtocolKind::smallAmpsV1);
+        initial = amp->start_amp();
+        return sim;
+    }
+
+    const std::string file{TempDir() + "/plug-cli-test.json"};
+    const std::string fuseFile{TempDir() + "/plug-cli-test.fuse"};
+    std::unique_ptr<com::Mustang> amp;
+    com::InitalData initial;
+    const amp_settings ampSettings{amps::BRITISH_80S, 2, 1, 3, 4, 5, cabinets::cab4x12M, 0, 9, 10, 11, 0, 0x80, 13, 1, true, 0xab};
+    const fx_pedal_settings delay{3, effects::TAPE_DELAY, 1, 2, 3, 4, 5, 6, Position::effectsLoop};
+    const SignalChain chain{"cli \"preset\"", ampSettings, {{{0, effects::EMPTY, 0, 0, 0, 0, 0, 0, Position::input}, {1, effects::EMPTY, 0, 0, 0, 0, 0, 0, Position::input}, {2, effects::EMPTY, 0, 0, 0, 0, 0, 0, Position::input}, delay}}};
+};
+
+TEST_F(CliTest, jsonIsPrintedCompact)
+{
+    const Json json{Json::Object{{"name", "a\"b\\c\n"}, {"values", Json::Array{1, 2.5, true, nullptr}}, {"empty", Json::Object{}}}};
+    EXPECT_THAT(print(json), StrEq(R"({"name":"a\"b\\c\n","values":[1,2.5,true,null],"empty":{}})"));
+}
+
+TEST_F(CliTest, jsonParsesPrintedDocument)
+{
+    const auto json = parseJson(R"( { "a" : [1, -2.5e1, "xä🎸"], "b": {"c": false} } )");
+
+    EXPECT_THAT(json["a"].array().size(), Eq(3));
+    EXPECT_THAT(json["a"].array()[1].number(), DoubleEq(-25.0));
+    EXPECT_THAT(json["a"].array()[2].string(), StrEq("x\xc3\xa4\xf0\x9f\x8e\xb8"));
+    EXPECT_THAT(json["b"]["c"].boolean(), Eq(false));
+    EXPECT_THAT(json.find("d"), Eq(nullptr));
+}
+
+TEST_F(CliTest, jsonThrowsOnMalformedInput)
+{
+    EXPECT_THROW(parseJson(R"({"a": 1,})"), std::invalid_argument);
+    EXPECT_THROW(parseJson(R"([1, 2)"), std::invalid_argument);
+    EXPECT_THROW(parseJson(R"("abc)"), std::invalid_argument);
+    EXPECT_THROW(parseJson("1 2"), std::invalid_argument);
+    EXPECT_THROW(parseJson("").number(), std::invalid_argument);
+}
+
+TEST_F(CliTest, chainRoundTripsThroughJson)
+{
+    const auto parsed = chainFromJson(parseJson(print(toJson(chain))));
+
+    EXPECT_THAT(parsed.name(), StrEq(chain.name()));
+    EXPECT_THAT(parsed.amp(), AmpIs(ampSettings));
+    EXPECT_THAT(parsed.effects()[3], EffectIs(delay));
+}
+
+TEST_F(CliTest, chainFromJsonRejectsInvalidValues)
+{
+    auto invalidKnob = print(toJson(chain));
+    invalidKnob.replace(invalidKnob.find("\"gain\":2"), 8, "\"gain\":256");
+    auto invalidModel = print(toJson(chain));
+    invalidModel.replace(invalidModel.find("\"model\":9"), 9, "\"model\":99");
+
+    EXPECT_THROW(chainFromJson(parseJson(invalidKnob)), std::invalid_argument);
+    EXPECT_THROW(chainFromJson(parseJson(invalidModel)), std::invalid_argument);
+    EXPECT_THROW(chainFromJson(parseJson("{}")), std::invalid_argument);
+}
+
+TEST_F(CliTest, validateRejectsUnknownCommandsAndArguments)
+{
+    EXPECT_NO_THROW(validateCommand({"load-bank", "3"}));
+    EXPECT_THROW(validateCommand({"format-amp"}), std::invalid_argument);
+    EXPECT_THROW(validateCommand({"load-bank"}), std::invalid_argument);
+    EXPECT_THROW(validateCommand({"list-names", "x"}), std::invalid_argument);
+    EXPECT_THROW(validateCommand({}), std::invalid_argument);
+}
+
+TEST_F(CliTest, listNamesPrintsAllBanks)
+{
+    connect();
+
+    const auto names = runCommand(*amp, initial, {"list-names"}).array();
+    ASSERT_THAT(names.size(), Eq(24));
+    EXPECT_THAT(names[23].string(), StrEq("SIM 24"));
+}
+
+TEST_F(CliTest, loadBankRejectsBankOutOfRange)
+{
+    connect();
+
+    EXPECT_THROW(runCommand(*amp, initial, {"load-bank", "24"}), std::invalid_argument);
+    EXPECT_THROW(runCommand(*amp, initial, {"load-bank", "-1"}), std::invalid_argument);
+}
+
+TEST_F(CliTest, applyFileAcceptsOutputOfLoadBank)
+{
+    auto sim = connect();
+    sim->setBank(4, chain);
+    writeFile(Json::Object{{"command", "load-bank"}, {"result", runCommand(*amp, initial, {"load-bank", "4"})}});
+    sim->setBank(4, SignalChain{});
+    runCommand(*amp, initial, {"load-bank", "0"});
+
+    runCommand(*amp, initial, {"apply-file", file});
+
+    EXPECT_THAT(sim->current().amp(), AmpIs(ampSettings));
+    EXPECT_THAT(sim->current().effects()[3], EffectIs(delay));
+}
+
+TEST_F(CliTest, applyFileAcceptsSavedFuseFile)
+{
+    auto sim = connect();
+    sim->setBank(4, chain);
+    runCommand(*amp, initial, {"load-bank", "4"});
+    runCommand(*amp, initial, {"save-file", fuseFile, "author"});
+    runCommand(*amp, initial, {"load-bank", "0"});
+
+    const auto result = runCommand(*amp, initial, {"apply-file", fuseFile});
+
+    EXPECT_THAT(result["name"].string(), StrEq(chain.name()));
+    EXPECT_THAT(sim->current().amp().amp_num, Eq(ampSettings.amp_num));
+    EXPECT_THAT(sim->current().amp().gain, Eq(ampSettings.gain));
+    EXPECT_THAT(sim->current().effects()[0].effect_num, Eq(delay.effect_num));
+    EXPECT_THAT(sim->current().effects()[0].position, Eq(Position::effectsLoop));
+}
+
+TEST_F(CliTest, saveBankStoresCurrentStateUnderName)
+{
+    auto sim = connect();
+
+    const auto saved = runCommand(*amp, initial, {"save-bank", "7", "saved"});
+
+    EXPECT_THAT(saved["slot"].number(), Eq(7));
+    EXPECT_THAT(sim->bank(7).name(), StrEq("saved"));
+}
+
+TEST_F(CliTest, restoreBanksWritesDumpToAnotherAmp)
+{
+    auto source = connect();
+    source->setBank(5, chain);
+    writeFile(Json::Object{{"result", runCommand(*amp, initial, {"dump-banks"})}});
+
+    auto target = connect();
+    const auto result = runCommand(*amp, initial, {"restore-banks", file});
+
+    EXPECT_THAT(result["restored"].number(), Eq(24));
+    EXPECT_THAT(target->bank(5).name(), StrEq(chain.name()));
+    EXPECT_THAT(target->bank(5).amp(), AmpIs(ampSettings));
+    EXPECT_THAT(target->bank(5).effects()[3], EffectIs(delay));
+    EXPECT_THAT(target->bank(23).name(), StrEq("SIM 24"));
+}
+
+TEST_F(CliTest, restoreArchiveWritesChangedBanksOnly)
+{
+    auto source = connect();
+    source->setBank(5, chain);
+    runCommand(*amp, initial, {"dump-archive", file});
+
+    auto target = connect();
+    const auto result = runCommand(*amp, initial, {"restore-archive", file});
+
+    EXPECT_THAT(result["written"].array(), SizeIs(1));
+    EXPECT_THAT(result["written"].array()[0].number(), Eq(5));
+    EXPECT_THAT(result["unchanged"].number(), Eq(23));
+    EXPECT_THAT(target->bank(5).name(), StrEq(chain.name()));
+    EXPECT_THAT(target->bank(5).effects()[3], EffectIs(delay));
+}
+
+TEST_F(CliTest, timingsListUsedOperations)
+{
+    connect();
+    runCommand(*amp, initial, {"load-bank", "1"});
+
+    const auto timings = timingsJson(amp->statistics()->snapshot(), std::chrono::milliseconds{1500});
+
+    EXPECT_THAT(timings["total_ms"].number(), DoubleEq(1500.0));
+    EXPECT_THAT(timings["operations"]["load_memory_bank"]["count"].number(), Eq(1));
+    EXPECT_THAT(timings["operations"].find("save_on_amp"), Eq(nullptr));
+    EXPECT_THAT(timings["counters"].find("packets_sent"), Ne(nullptr));
+}
@@ -55,7 +55,7 @@ protected:
     static inline constexpr std::uint16_t vid{0x1ed8};
 };
 
-TEST_F(ConnectionFactoryTest, createUsbConnectionOpensDevice)
+TEST_F(ConnectionFactoryTest, openUsbDeviceOpensDevice)
 {
 
     InSequence s;
@@ -64,11 +64,11 @@ TEST_F(ConnectionFactoryTest, createUsbConnectionOpensDevice)
     EXPECT_CALL(*usbmock, kernel_driver_active(&handle, 0));
     EXPECT_CALL(*usbmock, claim_interface(&handle, 0));
 
-    auto conn = createUsbConnection();
-    EXPECT_TRUE(conn->isOpen());
+    const auto device = openUsbDevice();
+    EXPECT_TRUE(device.connection->isOpen());
 }
 
-TEST_F(ConnectionFactoryTest, createUsbConnectionOpensFirstMatchedDevice)
+TEST_F(ConnectionFactoryTest, openUsbDeviceOpensFirstMatchedDevice)
 {
     InSequence s;
     EXPECT_CALL(*usbmock, init(nullptr));
@@ -79,11 +79,11 @@ TEST_F(ConnectionFactoryTest, createUsbConnectionOpensFirstMatchedDevice)
     EXPECT_CALL(*usbmock, kernel_driver_active(&handle, 0));
     EXPECT_CALL(*usbmock, claim_interface(&handle, 0));
 
-    auto conn = createUsbConnection();
-    EXPECT_TRUE(conn->isOpen());
+    const auto device = openUsbDevice();
+    EXPECT_TRUE(device.connection->isOpen());
 }
 
-TEST_F(ConnectionFactoryTest, createUsbConnectionThrowsIfNoMatchingDeviceFound)
+TEST_F(ConnectionFactoryTest, openUsbDeviceThrowsIfNoMatchingDeviceFound)
 {
     InSequence s;
     EXPECT_CALL(*usbmock, init(nullptr));
@@ -91,5 +91,18 @@ TEST_F(ConnectionFactoryTest, createUsbConnectionThrowsIfNoMatchingDeviceFound)
         .Times(AtLeast(1))
         .WillRepeatedly(Return(nullptr));
 
-    EXPECT_THROW(createUsbConnection(), CommunicationException);
+    EXPECT_THROW(openUsbDevice(), CommunicationException);
+}
+
+TEST_F(ConnectionFactoryTest, openUsbDeviceSelectsProtocolByProductId)
+{
+    InSequence s;
+    EXPECT_CALL(*usbmock, init(nullptr));
+    EXPECT_CALL(*usbmock, open_device_with_vid_pid(nullptr, vid, 0x0004)).WillOnce(Return(nullptr));
+    EXPECT_CALL(*usbmock, open_device_with_vid_pid(nullptr, vid, 0x0005)).WillOnce(Return(&handle));
+    EXPECT_CALL(*usbmock, kernel_driver_active(&handle, 0));
+    EXPECT_CALL(*usbmock, claim_interface(&handle, 0));
+
+    const auto device = openUsbDevice();
+    EXPECT_THAT(device.protocol, Eq(ProtocolKind::bigAmpsV1));
 }
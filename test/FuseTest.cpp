@@ -0,0 +1,188 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fuse/FuseFile.h"
+#include "matcher/TypeMatcher.h"
+#include <cstdio>
+#include <gmock/gmock.h>
+
+using namespace plug;
+using namespace plug::fuse;
+using namespace test::matcher;
+using namespace testing;
+
+class FuseTest : public testing::Test
+{
+protected:
+    void TearDown() override
+    {
+        std::remove(file.c_str());
+    }
+
+    static std::string testFile(const std::string& name)
+    {
+        return std::string{PLUG_TEST_DIR} + "/" + name;
+    }
+
+    static std::string write(const Preset& preset)
+    {
+        std::string out;
+        writePreset(out, preset);
+        return out;
+    }
+
+    const std::string file{TempDir() + "/plug-fuse-test.fuse"};
+    const amp_settings ampSettings{amps::BRITISH_80S, 2, 1, 3, 4, 5, cabinets::cab4x12M, 6, 9, 10, 11, 7, 0x80, 13, 1, true, 0xab};
+    const std::array<fx_pedal_settings, 4> effectList{{{0, effects::OVERDRIVE, 10, 20, 30, 40, 50, 0, Position::input},
+                                                       {1, effects::SINE_CHORUS, 1, 2, 3, 4, 5, 0, Position::input},
+                                                       {2, effects::TAPE_DELAY, 6, 5, 4, 3, 2, 1, Position::effectsLoop},
+                                                       {3, effects::ARENA_REVERB, 9, 8, 7, 6, 5, 0, Position::effectsLoop}}};
+};
+
+TEST_F(FuseTest, readPresetFile)
+{
+    const auto preset = readPresetFile(testFile("zachary-volt-queen.fuse"));
+    const amp_settings amp{amps::BRITISH_60S, 255, 255, 129, 129, 130, cabinets::cab2x12C, 0, 100, 129, 255, 0, 129, 129, 1, true, 0};
+
+    EXPECT_THAT(preset.chain.name(), StrEq("Queen"));
+    EXPECT_THAT(preset.author, StrEq("Zachary Volt"));
+    EXPECT_THAT(preset.chain.amp(), AmpIs(amp));
+    EXPECT_THAT(preset.chain.effects()[0], EffectIs(fx_pedal_settings{0, effects::RANGE_BOOST, 185, 141, 0, 155, 0, 0, Position::input}));
+    EXPECT_THAT(preset.chain.effects()[1], EffectIs(fx_pedal_settings{1, effects::STEREO_TAPE_DELAY, 126, 0, 0, 100, 255, 129, Position::effectsLoop}));
+    EXPECT_THAT(preset.chain.effects()[2].effect_num, Eq(effects::EMPTY));
+    EXPECT_THAT(preset.chain.effects()[3].effect_num, Eq(effects::EMPTY));
+}
+
+TEST_F(FuseTest, readPresetAssignsSlotsByPosition)
+{
+    const auto preset = readPresetFile(testFile("yakitori-floyd-phaser.fuse"));
+    const auto fx = preset.chain.effects();
+
+    EXPECT_THAT(preset.chain.amp().amp_num, Eq(amps::BRITTISH_WATTS));
+    EXPECT_THAT(fx[0].effect_num, Eq(effects::PHASER));
+    EXPECT_THAT(fx[0].position, Eq(Position::input));
+    EXPECT_THAT(fx[1].effect_num, Eq(effects::MONO_DELAY));
+    EXPECT_THAT(fx[1].position, Eq(Position::effectsLoop));
+    EXPECT_THAT(fx[2].effect_num, Eq(effects::SMALL_HALL_REVERB));
+    EXPECT_THAT(fx[2].fx_slot, Eq(2));
+    EXPECT_THAT(fx[3].effect_num, Eq(effects::EMPTY));
+    EXPECT_THAT(fx[3].fx_slot, Eq(3));
+}
+
+TEST_F(FuseTest, readPresetIgnoresEmptyModules)
+{
+    const auto preset = readPresetFile(testFile("wipika-white-stripes-v2.fuse"));
+    const auto fx = preset.chain.effects();
+
+    EXPECT_THAT(preset.chain.name(), StrEq("White Stripes V2"));
+    EXPECT_THAT(fx[0].effect_num, Eq(effects::FUZZ));
+    EXPECT_THAT(fx[1].effect_num, Eq(effects::DIATONIC_PITCH_SHIFT));
+    EXPECT_THAT(fx[2].effect_num, Eq(effects::SMALL_HALL_REVERB));
+    EXPECT_THAT(fx[3].effect_num, Eq(effects::EMPTY));
+}
+
+TEST_F(FuseTest, readPresetFileThrowsIfFileIsMissing)
+{
+    EXPECT_THROW(readPresetFile(testFile("missing.fuse")), std::invalid_argument);
+}
+
+TEST_F(FuseTest, parseRejectsOtherDocuments)
+{
+    EXPECT_THROW(parsePreset(R"(<?xml version="1.0"?><Other><Amplifier/></Other>)"), std::invalid_argument);
+    EXPECT_THROW(parsePreset(R"(<Preset><Amplifier><Module ID="94")"), std::invalid_argument);
+    EXPECT_THROW(parsePreset(""), std::invalid_argument);
+}
+
+TEST_F(FuseTest, parseSkipsMarkupAndUnknownValues)
+{
+    const auto preset = parsePreset(R"(<?xml version="1.0"?>
+        <!-- <Preset> in a comment -->
+        <Preset>
+          <Amplifier>
+            <Module ID="94" POS="0">
+              <Param ControlIndex="0"> 2560 </Param>
+              <Param ControlIndex="1">garbage</Param>
+              <Param ControlIndex="17">99</Param>
+              <Param ControlIndex="99">1</Param>
+              <Param ControlIndex="3"/>
+            </Module>
+          </Amplifier>
+          <FX><Delay ID="3"><Module ID="4095" POS="2"></Module></Delay></FX>
+          <FUSE><Info author='a &gt; b' name="x &amp; y &#x263A; &unknown;"/></FUSE>
+          <UsbGain>7</UsbGain>
+        </Preset>)");
+
+    EXPECT_THAT(preset.chain.name(), StrEq("x & y ☺ &unknown;"));
+    EXPECT_THAT(preset.author, StrEq("a > b"));
+    EXPECT_THAT(preset.chain.amp().amp_num, Eq(amps::BRITISH_80S));
+    EXPECT_THAT(preset.chain.amp().volume, Eq(10));
+    EXPECT_THAT(preset.chain.amp().gain, Eq(0));
+    EXPECT_THAT(preset.chain.amp().cabinet, Eq(cabinets::OFF));
+    EXPECT_THAT(preset.chain.amp().usb_gain, Eq(7));
+    EXPECT_THAT(preset.chain.effects()[0].effect_num, Eq(effects::EMPTY));
+}
+
+TEST_F(FuseTest, writtenPresetIsReadBack)
+{
+    const Preset preset{SignalChain{"a \"preset\" <&>", ampSettings, effectList}, "plug"};
+
+    writePresetFile(file, preset);
+    const auto read = readPresetFile(file);
+
+    EXPECT_THAT(read.chain.name(), StrEq(preset.chain.name()));
+    EXPECT_THAT(read.author, StrEq("plug"));
+    EXPECT_THAT(read.chain.amp(), AmpIs(ampSettings));
+
+    for (std::size_t i = 0; i < effectList.size(); ++i)
+    {
+        EXPECT_THAT(read.chain.effects()[i], EffectIs(effectList[i]));
+    }
+}
+
+TEST_F(FuseTest, writeFollowsFuseLayout)
+{
+    auto fx = effectList;
+    fx[0] = fx_pedal_settings{0, effects::SIMPLE_COMP, 2, 0, 0, 0, 0, 0, Position::input};
+    fx[3] = fx_pedal_settings{3, effects::EMPTY, 0, 0, 0, 0, 0, 0, Position::input};
+
+    const auto text = write(Preset{SignalChain{"name", ampSettings, fx}, ""});
+
+    EXPECT_THAT(text, StartsWith(R"(<?xml version="1.0" encoding="UTF-8"?>)"));
+    EXPECT_THAT(text, HasSubstr(R"(<Amplifier><Module ID="94" POS="0" BypassState="1"><Param ControlIndex="0">257</Param>)"));
+    EXPECT_THAT(text, HasSubstr(R"(<Param ControlIndex="8">32896</Param>)"));
+    EXPECT_THAT(text, HasSubstr(R"(<Param ControlIndex="12">9</Param>)"));
+    EXPECT_THAT(text, HasSubstr(R"(<Param ControlIndex="17">6</Param>)"));
+    EXPECT_THAT(text, HasSubstr(R"(<Param ControlIndex="22">23901</Param>)"));
+    EXPECT_THAT(text, HasSubstr(R"(<Stompbox ID="1"><Module ID="136" POS="0" BypassState="1"><Param ControlIndex="0">514</Param></Module></Stompbox>)"));
+    EXPECT_THAT(text, HasSubstr(R"(<Param ControlIndex="5">257</Param></Module></Delay>)"));
+    EXPECT_THAT(text, HasSubstr(R"(<Reverb ID="4"><Module ID="0" POS="0" BypassState="1"></Module></Reverb>)"));
+    EXPECT_THAT(text, HasSubstr(R"(<UsbGain>171</UsbGain>)"));
+}
+
+TEST_F(FuseTest, writeAppendsToBuffer)
+{
+    std::string out{"x"};
+    writePreset(out, Preset{SignalChain{"name", ampSettings, effectList}, ""});
+    const auto size = out.size();
+    writePreset(out, Preset{SignalChain{"name", ampSettings, effectList}, ""});
+
+    EXPECT_THAT(out.size(), Eq(2 * size - 1));
+    EXPECT_THAT(out.front(), Eq('x'));
+}
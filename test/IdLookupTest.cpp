@@ -24,6 +24,12 @@
 using plug::amps;
 using plug::cabinets;
 using plug::effects;
+using plug::ampId;
+using plug::cabinetId;
+using plug::effectId;
+using plug::findAmpById;
+using plug::findCabinetById;
+using plug::findEffectById;
 using plug::lookupAmpById;
 using plug::lookupCabinetById;
 using plug::lookupEffectById;
@@ -131,3 +137,40 @@ TEST_F(IdLookupTest, lookupCabinetByIdThrowsOnInvalidId)
 {
     EXPECT_THROW(lookupCabinetById(0xff), std::invalid_argument);
 }
+
+TEST_F(IdLookupTest, findByIdReturnsModel)
+{
+    EXPECT_EQ(findAmpById(0xfc), amps::BRITTISH_COLOUR);
+    EXPECT_EQ(findEffectById(0x0110), effects::ORANGE_BOX);
+    EXPECT_EQ(findCabinetById(0x0c), cabinets::cabSS112);
+}
+
+TEST_F(IdLookupTest, findByIdReturnsNothingOnInvalidId)
+{
+    EXPECT_EQ(findAmpById(0x00), std::nullopt);
+    EXPECT_EQ(findAmpById(0x1067), std::nullopt);
+    EXPECT_EQ(findEffectById(0xff), std::nullopt);
+    EXPECT_EQ(findEffectById(0x10000), std::nullopt);
+    EXPECT_EQ(findCabinetById(0x0d), std::nullopt);
+}
+
+TEST_F(IdLookupTest, idsMapBackToModel)
+{
+    for (std::uint8_t i = 0; i <= plug::value(amps::BRITTISH_COLOUR); ++i)
+    {
+        const auto amp = static_cast<amps>(i);
+        EXPECT_EQ(lookupAmpById(ampId(amp)), amp);
+    }
+
+    for (std::uint16_t i = 0; i <= plug::value(effects::FENDER_65_SPRING_REVERB); ++i)
+    {
+        const auto effect = static_cast<effects>(i);
+        EXPECT_EQ(lookupEffectById(effectId(effect)), effect);
+    }
+
+    for (std::uint8_t i = 0; i <= plug::value(cabinets::cabSS112); ++i)
+    {
+        const auto cabinet = static_cast<cabinets>(i);
+        EXPECT_EQ(lookupCabinetById(cabinetId(cabinet)), cabinet);
+    }
+}
@@ -0,0 +1,145 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fuse/LibraryWatcher.h"
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <gmock/gmock.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace plug::fuse;
+using namespace testing;
+using namespace std::chrono_literals;
+
+class LibraryWatcherTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        mkdir(directory.c_str(), 0700);
+    }
+
+    void TearDown() override
+    {
+        for (const auto& name : {"a.fuse", "b.fuse", "c.fuse"})
+        {
+            std::remove(path(name).c_str());
+        }
+        for (int i = 0; i < burstSize; ++i)
+        {
+            std::remove(path(std::to_string(i) + ".fuse").c_str());
+        }
+        rmdir(directory.c_str());
+    }
+
+    std::string path(const std::string& name) const
+    {
+        return directory + "/" + name;
+    }
+
+    void writeFile(const std::string& name) const
+    {
+        std::ofstream{path(name), std::ios::trunc} << "<Preset/>";
+    }
+
+    LibraryWatcher::Listener listener()
+    {
+        return [this](const LibraryChanges& changes) {
+            std::lock_guard<std::mutex> lock{mutex};
+            reported.push_back(changes);
+            changed.notify_all();
+        };
+    }
+
+    std::vector<LibraryChanges> waitForChanges(std::size_t count)
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+        changed.wait_for(lock, 5s, [this, count] { return reported.size() >= count; });
+        return reported;
+    }
+
+    static inline constexpr int burstSize{200};
+    const std::string directory{TempDir() + "/plug-library-watcher"};
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<LibraryChanges> reported;
+};
+
+TEST_F(LibraryWatcherTest, reportsWrittenFiles)
+{
+    LibraryWatcher watcher{directory, 20ms, listener()};
+    writeFile("a.fuse");
+
+    const auto changes = waitForChanges(1);
+
+    ASSERT_THAT(changes, SizeIs(1));
+    EXPECT_THAT(changes[0].fileNames, ElementsAre("a.fuse"));
+    EXPECT_THAT(changes[0].rescan, IsFalse());
+}
+
+TEST_F(LibraryWatcherTest, reportsRenamedAndDeletedFiles)
+{
+    writeFile("a.fuse");
+    writeFile("c.fuse");
+    LibraryWatcher watcher{directory, 20ms, listener()};
+
+    std::rename(path("a.fuse").c_str(), path("b.fuse").c_str());
+    std::remove(path("c.fuse").c_str());
+
+    const auto changes = waitForChanges(1);
+
+    ASSERT_THAT(changes, SizeIs(1));
+    EXPECT_THAT(changes[0].fileNames, ElementsAre("a.fuse", "b.fuse", "c.fuse"));
+}
+
+TEST_F(LibraryWatcherTest, burstIsReportedAtOnce)
+{
+    LibraryWatcher watcher{directory, 500ms, listener()};
+
+    for (int i = 0; i < burstSize; ++i)
+    {
+        writeFile(std::to_string(i) + ".fuse");
+        writeFile(std::to_string(i) + ".fuse");
+    }
+
+    const auto changes = waitForChanges(1);
+
+    ASSERT_THAT(changes, SizeIs(1));
+    EXPECT_THAT(changes[0].fileNames, SizeIs(burstSize));
+}
+
+TEST_F(LibraryWatcherTest, removedDirectoryRequestsRescan)
+{
+    LibraryWatcher watcher{directory, 20ms, listener()};
+    rmdir(directory.c_str());
+
+    const auto changes = waitForChanges(1);
+
+    ASSERT_THAT(changes, SizeIs(1));
+    EXPECT_THAT(changes[0].rescan, IsTrue());
+}
+
+TEST_F(LibraryWatcherTest, throwsOnMissingDirectory)
+{
+    EXPECT_THROW(LibraryWatcher(directory + "/missing", 20ms, listener()), std::invalid_argument);
+}
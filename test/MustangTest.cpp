@@ -41,8 +41,8 @@ class MustangTest : public testing::Test
 protected:
     void SetUp() override
     {
-        conn = std::make_shared<mock::MockConnection>();
-        m = std::make_unique<com::Mustang>(conn);
+        conn = std::make_shared<NiceMock<mock::MockConnection>>();
+        m = std::make_unique<BasicMustang<SmallAmpsV1>>(conn);
     }
 
     void TearDown() override
@@ -60,18 +60,41 @@ protected:
         return std::vector<std::uint8_t>{std::cbegin(c), std::cend(c)};
     }
 
+    void loadDeviceState()
+    {
+        EXPECT_CALL(*conn, sendImpl(_, _)).WillOnce(Return(packetRawTypeSize));
+        EXPECT_CALL(*conn, receive(packetRawTypeSize))
+            .WillOnce(Return(ignoreData))
+            .WillOnce(Return(asBuffer(serializeAmpSettings(ampState).getBytes())))
+            .WillOnce(Return(asBuffer(serializeEffectSettings(effectsState[0]).getBytes())))
+            .WillOnce(Return(asBuffer(serializeEffectSettings(effectsState[1]).getBytes())))
+            .WillOnce(Return(asBuffer(serializeEffectSettings(effectsState[2]).getBytes())))
+            .WillOnce(Return(asBuffer(serializeEffectSettings(effectsState[3]).getBytes())))
+            .WillOnce(Return(asBuffer(serializeAmpSettingsUsbGain(ampState).getBytes())));
+
+        m->load_memory_bank(slot);
+        Mock::VerifyAndClearExpectations(conn.get());
+    }
+
 
     std::shared_ptr<mock::MockConnection> conn;
     std::unique_ptr<com::Mustang> m;
     const std::vector<std::uint8_t> noData{};
     const std::vector<std::uint8_t> ignoreData = std::vector<std::uint8_t>(packetRawTypeSize);
-    const std::vector<std::uint8_t> ignoreAmpData = [] { std::vector<std::uint8_t> d(packetRawTypeSize, 0x00); d[ampPos] = 0x5e; return d; }();
+    const std::vector<std::uint8_t> ignoreAmpData = [] { std::vector<std::uint8_t> d(packetRawTypeSize, 0x00); d[0] = 0x1c; d[posDsp] = 0x05; d[ampPos] = 0x5e; return d; }();
     const PacketRawType loadCmd = serializeLoadCommand().getBytes();
     const PacketRawType applyCmd = serializeApplyCommand().getBytes();
     const PacketRawType clearCmd = serializeClearEffectSettings().getBytes();
     static inline constexpr std::size_t presetPacketCountShort{48};
     static inline constexpr std::size_t presetPacketCountFull{200};
     static inline constexpr int slot{5};
+    static inline constexpr amp_settings ampState{amps::BRITISH_80S, 2, 1, 3, 4, 5,
+                                                  cabinets::cab4x12M, 0, 9, 10, 11,
+                                                  0, 0x80, 13, 1, false, 0xab};
+    static inline constexpr std::array<fx_pedal_settings, 4> effectsState{{{0x00, effects::EMPTY, 0, 0, 0, 0, 0, 0, Position::input},
+                                                                           {0x01, effects::TRIANGLE_CHORUS, 0, 0, 0, 1, 1, 0, Position::input},
+                                                                           {0x02, effects::EMPTY, 0, 0, 0, 0, 0, 0, Position::input},
+                                                                           {0x03, effects::TAPE_DELAY, 1, 2, 3, 4, 5, 6, Position::effectsLoop}}};
 };
 
 TEST_F(MustangTest, startInitializesDevice)
@@ -85,9 +108,8 @@ TEST_F(MustangTest, startInitializesDevice)
 
     // Init commands
     EXPECT_CALL(*conn, sendImpl(BufferIs(initCmd1), initCmd1.size())).WillOnce(Return(initCmd1.size()));
-    EXPECT_CALL(*conn, receive(packetRawTypeSize)).WillOnce(Return(ignoreData));
     EXPECT_CALL(*conn, sendImpl(BufferIs(initCmd2), initCmd2.size())).WillOnce(Return(initCmd2.size()));
-    EXPECT_CALL(*conn, receive(packetRawTypeSize)).WillOnce(Return(ignoreData));
+    EXPECT_CALL(*conn, receive(packetRawTypeSize)).Times(2).WillRepeatedly(Return(ignoreData));
 
     // Load cmd
     EXPECT_CALL(*conn, sendImpl(BufferIs(loadCmd), loadCmd.size())).WillOnce(Return(loadCmd.size()));
@@ -103,8 +125,7 @@ TEST_F(MustangTest, startInitializesDevice)
         .WillOnce(Return(ignoreData))
         .WillOnce(Return(ignoreData))
         .WillOnce(Return(ignoreData))
-        .WillOnce(Return(ignoreData))
-        .WillOnce(Return(noData));
+        .WillOnce(Return(ignoreData));
 
 
     m->start_amp();
@@ -118,6 +139,7 @@ TEST_F(MustangTest, startThrowsIfConnectionNotReady)
 
 TEST_F(MustangTest, startRequestsCurrentPresetName)
 {
+    m = std::make_unique<BasicMustang<BigAmpsV1>>(conn);
     const auto [initPacket1, initPacket2] = serializeInitCommand();
     const auto initCmd1 = initPacket1.getBytes();
     const auto initCmd2 = initPacket2.getBytes();
@@ -127,9 +149,8 @@ TEST_F(MustangTest, startRequestsCurrentPresetName)
 
     // Init commands
     EXPECT_CALL(*conn, sendImpl(BufferIs(initCmd1), initCmd1.size())).WillOnce(Return(initCmd1.size()));
-    EXPECT_CALL(*conn, receive(packetRawTypeSize)).WillOnce(Return(ignoreData));
     EXPECT_CALL(*conn, sendImpl(BufferIs(initCmd2), initCmd2.size())).WillOnce(Return(initCmd2.size()));
-    EXPECT_CALL(*conn, receive(packetRawTypeSize)).WillOnce(Return(ignoreData));
+    EXPECT_CALL(*conn, receive(packetRawTypeSize)).Times(2).WillRepeatedly(Return(ignoreData));
 
     // Load cmd
     EXPECT_CALL(*conn, sendImpl(BufferIs(loadCmd), loadCmd.size())).WillOnce(Return(loadCmd.size()));
@@ -148,8 +169,7 @@ TEST_F(MustangTest, startRequestsCurrentPresetName)
         .WillOnce(Return(ignoreData))
         .WillOnce(Return(ignoreData))
         .WillOnce(Return(ignoreData))
-        .WillOnce(Return(ignoreData))
-        .WillOnce(Return(noData));
+        .WillOnce(Return(ignoreData));
 
 
     const auto [signalChain, presets] = m->start_amp();
@@ -174,9 +194,8 @@ TEST_F(MustangTest, startRequestsCurrentAmp)
 
     // Init commands
     EXPECT_CALL(*conn, sendImpl(BufferIs(initCmd1), initCmd1.size())).WillOnce(Return(initCmd1.size()));
-    EXPECT_CALL(*conn, receive(packetRawTypeSize)).WillOnce(Return(ignoreData));
     EXPECT_CALL(*conn, sendImpl(BufferIs(initCmd2), initCmd2.size())).WillOnce(Return(initCmd2.size()));
-    EXPECT_CALL(*conn, receive(packetRawTypeSize)).WillOnce(Return(ignoreData));
+    EXPECT_CALL(*conn, receive(packetRawTypeSize)).Times(2).WillRepeatedly(Return(ignoreData));
 
     // Load cmd
     EXPECT_CALL(*conn, sendImpl(BufferIs(loadCmd), loadCmd.size())).WillOnce(Return(loadCmd.size()));
@@ -192,8 +211,7 @@ TEST_F(MustangTest, startRequestsCurrentAmp)
         .WillOnce(Return(ignoreData))
         .WillOnce(Return(ignoreData))
         .WillOnce(Return(ignoreData))
-        .WillOnce(Return(extendedData))
-        .WillOnce(Return(noData));
+        .WillOnce(Return(extendedData));
 
 
     const auto [signalChain, presets] = m->start_amp();
@@ -222,9 +240,8 @@ TEST_F(MustangTest, startRequestsCurrentEffects)
 
     // Init commands
     EXPECT_CALL(*conn, sendImpl(BufferIs(initCmd1), initCmd1.size())).WillOnce(Return(initCmd1.size()));
-    EXPECT_CALL(*conn, receive(packetRawTypeSize)).WillOnce(Return(ignoreData));
     EXPECT_CALL(*conn, sendImpl(BufferIs(initCmd2), initCmd2.size())).WillOnce(Return(initCmd2.size()));
-    EXPECT_CALL(*conn, receive(packetRawTypeSize)).WillOnce(Return(ignoreData));
+    EXPECT_CALL(*conn, receive(packetRawTypeSize)).Times(2).WillRepeatedly(Return(ignoreData));
 
     // Load cmd
     EXPECT_CALL(*conn, sendImpl(BufferIs(loadCmd), loadCmd.size())).WillOnce(Return(loadCmd.size()));
@@ -240,8 +257,7 @@ TEST_F(MustangTest, startRequestsCurrentEffects)
         .WillOnce(Return(recvData1))
         .WillOnce(Return(recvData2))
         .WillOnce(Return(recvData3))
-        .WillOnce(Return(ignoreData))
-        .WillOnce(Return(noData));
+        .WillOnce(Return(ignoreData));
 
 
     const auto [signalChain, presets] = m->start_amp();
@@ -266,9 +282,8 @@ TEST_F(MustangTest, startRequestsAmpPresetList)
 
     // Init commands
     EXPECT_CALL(*conn, sendImpl(BufferIs(initCmd1), initCmd1.size())).WillOnce(Return(initCmd1.size()));
-    EXPECT_CALL(*conn, receive(packetRawTypeSize)).WillOnce(Return(ignoreData));
     EXPECT_CALL(*conn, sendImpl(BufferIs(initCmd2), initCmd2.size())).WillOnce(Return(initCmd2.size()));
-    EXPECT_CALL(*conn, receive(packetRawTypeSize)).WillOnce(Return(ignoreData));
+    EXPECT_CALL(*conn, receive(packetRawTypeSize)).Times(2).WillRepeatedly(Return(ignoreData));
 
     // Load cmd
     EXPECT_CALL(*conn, sendImpl(BufferIs(loadCmd), loadCmd.size())).WillOnce(Return(loadCmd.size()));
@@ -291,8 +306,7 @@ TEST_F(MustangTest, startRequestsAmpPresetList)
         .WillOnce(Return(ignoreData))
         .WillOnce(Return(ignoreData))
         .WillOnce(Return(ignoreData))
-        .WillOnce(Return(ignoreData))
-        .WillOnce(Return(noData));
+        .WillOnce(Return(ignoreData));
 
 
     const auto [signalChain, presetList] = m->start_amp();
@@ -305,8 +319,9 @@ TEST_F(MustangTest, startRequestsAmpPresetList)
     static_cast<void>(signalChain);
 }
 
-TEST_F(MustangTest, startUsesFullInitialTransmissionSizeIfOverThreshold)
+TEST_F(MustangTest, startReceivesFullPresetListOfBigAmps)
 {
+    m = std::make_unique<BasicMustang<BigAmpsV1>>(conn);
     const auto [initPacket1, initPacket2] = serializeInitCommand();
     const auto initCmd1 = initPacket1.getBytes();
     const auto initCmd2 = initPacket2.getBytes();
@@ -316,9 +331,8 @@ TEST_F(MustangTest, startUsesFullInitialTransmissionSizeIfOverThreshold)
 
     // Init commands
     EXPECT_CALL(*conn, sendImpl(BufferIs(initCmd1), initCmd1.size())).WillOnce(Return(initCmd1.size()));
-    EXPECT_CALL(*conn, receive(packetRawTypeSize)).WillOnce(Return(ignoreData));
     EXPECT_CALL(*conn, sendImpl(BufferIs(initCmd2), initCmd2.size())).WillOnce(Return(initCmd2.size()));
-    EXPECT_CALL(*conn, receive(packetRawTypeSize)).WillOnce(Return(ignoreData));
+    EXPECT_CALL(*conn, receive(packetRawTypeSize)).Times(2).WillRepeatedly(Return(ignoreData));
 
     // Load cmd
     EXPECT_CALL(*conn, sendImpl(BufferIs(loadCmd), loadCmd.size())).WillOnce(Return(loadCmd.size()));
@@ -334,13 +348,59 @@ TEST_F(MustangTest, startUsesFullInitialTransmissionSizeIfOverThreshold)
         .WillOnce(Return(ignoreData))
         .WillOnce(Return(ignoreData))
         .WillOnce(Return(ignoreData))
-        .WillOnce(Return(ignoreData))
-        .WillOnce(Return(noData));
+        .WillOnce(Return(ignoreData));
 
 
     m->start_amp();
 }
 
+TEST_F(MustangTest, startReportsPresetNamesWhileReceiving)
+{
+    m = std::make_unique<BasicMustang<BigAmpsV1>>(conn);
+    const auto nameData = asBuffer(serializeName(0, "abc").getBytes());
+    std::vector<std::pair<std::uint8_t, std::string>> reported;
+
+    EXPECT_CALL(*conn, isOpen()).WillOnce(Return(true));
+    EXPECT_CALL(*conn, sendImpl(_, _)).WillRepeatedly(Return(packetRawTypeSize));
+
+    InSequence s;
+    EXPECT_CALL(*conn, receive(packetRawTypeSize)).Times(2).WillRepeatedly(Return(ignoreData));
+    EXPECT_CALL(*conn, receive(packetRawTypeSize)).Times(presetPacketCountFull).WillRepeatedly(Return(nameData));
+    EXPECT_CALL(*conn, receive(packetRawTypeSize))
+        .Times(7)
+        .WillOnce(Return(ignoreData))
+        .WillOnce(Return(ignoreAmpData))
+        .WillRepeatedly(Return(ignoreData));
+
+    const auto [signalChain, presets] = m->start_amp([&reported](std::uint8_t index, const std::string& name) { reported.emplace_back(index, name); });
+
+    ASSERT_THAT(reported.size(), Eq(presetPacketCountFull / 2));
+    EXPECT_THAT(reported[0], Pair(0, StrEq("abc")));
+    EXPECT_THAT(reported[24], Pair(24, StrEq("abc")));
+    EXPECT_THAT(reported.back(), Pair(99, StrEq("abc")));
+    EXPECT_THAT(presets.size(), Eq(presetPacketCountFull / 2));
+    static_cast<void>(signalChain);
+}
+
+TEST_F(MustangTest, startReportsPresetNamesOfShortList)
+{
+    const auto nameData = asBuffer(serializeName(0, "abc").getBytes());
+    std::vector<std::uint8_t> reported;
+
+    EXPECT_CALL(*conn, isOpen()).WillOnce(Return(true));
+    EXPECT_CALL(*conn, sendImpl(_, _)).WillRepeatedly(Return(packetRawTypeSize));
+
+    InSequence s;
+    EXPECT_CALL(*conn, receive(packetRawTypeSize)).Times(2).WillRepeatedly(Return(ignoreData));
+    EXPECT_CALL(*conn, receive(packetRawTypeSize)).Times(presetPacketCountShort + 1).WillRepeatedly(Return(nameData));
+    EXPECT_CALL(*conn, receive(packetRawTypeSize)).Times(6).WillOnce(Return(ignoreAmpData)).WillRepeatedly(Return(ignoreData));
+
+    m->start_amp([&reported](std::uint8_t index, const std::string&) { reported.push_back(index); });
+
+    EXPECT_THAT(reported.size(), Eq(presetPacketCountShort / 2));
+    EXPECT_THAT(reported.back(), Eq(23));
+}
+
 TEST_F(MustangTest, stopAmpClosesConnection)
 {
     EXPECT_CALL(*conn, close());
@@ -363,11 +423,189 @@ TEST_F(MustangTest, loadMemoryBankSendsBankSelectionCommandAndReceivesPacket)
         .WillOnce(Return(ignoreData))
         .WillOnce(Return(ignoreData))
         .WillOnce(Return(ignoreData))
+        .WillOnce(Return(ignoreData));
+
+
+    m->load_memory_bank(slot);
+}
+
+TEST_F(MustangTest, loadMemoryBankStopsIfAmpStopsSending)
+{
+    InSequence s;
+    EXPECT_CALL(*conn, sendImpl(_, _)).WillOnce(Return(packetRawTypeSize));
+    EXPECT_CALL(*conn, receive(packetRawTypeSize))
         .WillOnce(Return(ignoreData))
+        .WillOnce(Return(ignoreAmpData))
         .WillOnce(Return(noData));
 
+    m->load_memory_bank(slot);
+}
+
+TEST_F(MustangTest, loadMemoryBankUpdatesCurrentState)
+{
+    EXPECT_THAT(m->current_state(), Eq(std::nullopt));
+
+    loadDeviceState();
+
+    const auto state = m->current_state();
+    ASSERT_THAT(state, Ne(std::nullopt));
+    EXPECT_THAT(state->amp(), AmpIs(ampState));
+}
+
+TEST_F(MustangTest, loadMemoryBankDropsCurrentStateIfIncomplete)
+{
+    loadDeviceState();
+
+    InSequence s;
+    EXPECT_CALL(*conn, sendImpl(_, _)).WillOnce(Return(packetRawTypeSize));
+    EXPECT_CALL(*conn, receive(packetRawTypeSize))
+        .WillOnce(Return(ignoreData))
+        .WillOnce(Return(ignoreAmpData))
+        .WillOnce(Return(noData));
 
     m->load_memory_bank(slot);
+    EXPECT_THAT(m->current_state(), Eq(std::nullopt));
+}
+
+TEST_F(MustangTest, loadMemoryBankSkipsUnknownModels)
+{
+    auto unknownEffect = asBuffer(serializeEffectSettings(effectsState[1]).getBytes());
+    unknownEffect[sizeHeader] = 0xff;
+    unknownEffect[sizeHeader + 1] = 0x0f;
+
+    InSequence s;
+    EXPECT_CALL(*conn, sendImpl(_, _)).WillOnce(Return(packetRawTypeSize));
+    EXPECT_CALL(*conn, receive(packetRawTypeSize))
+        .WillOnce(Return(ignoreData))
+        .WillOnce(Return(asBuffer(serializeAmpSettings(ampState).getBytes())))
+        .WillOnce(Return(asBuffer(serializeEffectSettings(effectsState[0]).getBytes())))
+        .WillOnce(Return(unknownEffect))
+        .WillOnce(Return(asBuffer(serializeEffectSettings(effectsState[2]).getBytes())))
+        .WillOnce(Return(asBuffer(serializeEffectSettings(effectsState[3]).getBytes())))
+        .WillOnce(Return(asBuffer(serializeAmpSettingsUsbGain(ampState).getBytes())));
+
+    const auto chain = m->load_memory_bank(slot);
+
+    EXPECT_THAT(chain.amp(), AmpIs(ampState));
+    EXPECT_THAT(chain.effects()[1].effect_num, Eq(effects::EMPTY));
+    EXPECT_THAT(chain.effects()[3].effect_num, Eq(effects::TAPE_DELAY));
+    EXPECT_THAT(m->current_state(), Eq(std::nullopt));
+    EXPECT_THAT(m->statistics()->snapshot().counter(Counter::unknownPackets), Eq(1));
+}
+
+TEST_F(MustangTest, listenAppliesAmpChangeAndNotifiesSubscribers)
+{
+    loadDeviceState();
+
+    auto changed = ampState;
+    changed.gain = 99;
+    changed.usb_gain = 0;
+    std::vector<SignalChain> notified;
+    m->subscribe([&notified](const SignalChain& chain) { notified.push_back(chain); });
+
+    EXPECT_CALL(*conn, takeReceived()).WillOnce(Return(std::vector<std::vector<std::uint8_t>>{asBuffer(serializeAmpSettings(changed).getBytes())}));
+    m->listen();
+
+    changed.usb_gain = ampState.usb_gain;
+    ASSERT_THAT(notified.size(), Eq(1));
+    EXPECT_THAT(notified[0].amp(), AmpIs(changed));
+    EXPECT_THAT(m->current_state()->amp(), AmpIs(changed));
+}
+
+TEST_F(MustangTest, listenAppliesEffectChange)
+{
+    loadDeviceState();
+
+    auto changed = effectsState[3];
+    changed.knob2 = 77;
+    std::vector<SignalChain> notified;
+    m->subscribe([&notified](const SignalChain& chain) { notified.push_back(chain); });
+
+    EXPECT_CALL(*conn, takeReceived()).WillOnce(Return(std::vector<std::vector<std::uint8_t>>{asBuffer(serializeEffectSettings(changed).getBytes())}));
+    m->listen();
+
+    ASSERT_THAT(notified.size(), Eq(1));
+    EXPECT_THAT(notified[0].effects()[3].knob2, Eq(77));
+    EXPECT_THAT(notified[0].effects()[1].effect_num, Eq(effects::TRIANGLE_CHORUS));
+}
+
+TEST_F(MustangTest, listenIgnoresUnknownPackets)
+{
+    loadDeviceState();
+
+    bool notified{false};
+    m->subscribe([&notified](const SignalChain&) { notified = true; });
+
+    EXPECT_CALL(*conn, takeReceived()).WillOnce(Return(std::vector<std::vector<std::uint8_t>>{ignoreData}));
+    m->listen();
+
+    EXPECT_THAT(notified, Eq(false));
+}
+
+TEST_F(MustangTest, listenCountsUnknownModels)
+{
+    loadDeviceState();
+
+    bool notified{false};
+    m->subscribe([&notified](const SignalChain&) { notified = true; });
+    auto unknownAmp = asBuffer(serializeAmpSettings(ampState).getBytes());
+    unknownAmp[ampPos] = 0x01;
+
+    EXPECT_CALL(*conn, takeReceived()).WillOnce(Return(std::vector<std::vector<std::uint8_t>>{unknownAmp}));
+    m->listen();
+
+    EXPECT_THAT(notified, Eq(false));
+    EXPECT_THAT(m->current_state()->amp(), AmpIs(ampState));
+    EXPECT_THAT(m->statistics()->snapshot().counter(Counter::unknownPackets), Eq(1));
+}
+
+TEST_F(MustangTest, listenIgnoresChangesIfStateUnknown)
+{
+    bool notified{false};
+    m->subscribe([&notified](const SignalChain&) { notified = true; });
+
+    EXPECT_CALL(*conn, takeReceived()).WillOnce(Return(std::vector<std::vector<std::uint8_t>>{asBuffer(serializeAmpSettings(ampState).getBytes())}));
+    m->listen();
+
+    EXPECT_THAT(notified, Eq(false));
+    EXPECT_THAT(m->current_state(), Eq(std::nullopt));
+}
+
+TEST_F(MustangTest, setAmpAppliesChangesMadeOnAmpFirst)
+{
+    loadDeviceState();
+
+    auto changed = ampState;
+    changed.gain = 99;
+
+    EXPECT_CALL(*conn, takeReceived()).WillOnce(Return(std::vector<std::vector<std::uint8_t>>{asBuffer(serializeAmpSettings(changed).getBytes())}));
+    EXPECT_CALL(*conn, sendImpl(_, _)).Times(0);
+
+    m->set_amplifier(changed);
+}
+
+TEST_F(MustangTest, setAmpTakesStatePacketDuringCommandAsReply)
+{
+    loadDeviceState();
+
+    auto value = ampState;
+    value.gain = 50;
+    auto changed = effectsState[3];
+    changed.knob2 = 77;
+    std::vector<SignalChain> notified;
+    m->subscribe([&notified](const SignalChain& chain) { notified.push_back(chain); });
+
+    EXPECT_CALL(*conn, sendImpl(_, _)).Times(2).WillRepeatedly(Return(packetRawTypeSize));
+    EXPECT_CALL(*conn, receive(packetRawTypeSize))
+        .Times(2)
+        .WillOnce(Return(asBuffer(serializeEffectSettings(changed).getBytes())))
+        .WillOnce(Return(ignoreData));
+
+    m->set_amplifier(value);
+
+    EXPECT_THAT(notified.size(), Eq(0));
+    EXPECT_THAT(m->current_state()->amp(), AmpIs(value));
+    EXPECT_THAT(m->current_state()->effects()[3].knob2, Eq(effectsState[3].knob2));
 }
 
 TEST_F(MustangTest, loadMemoryBankReceivesName)
@@ -386,8 +624,7 @@ TEST_F(MustangTest, loadMemoryBankReceivesName)
         .WillOnce(Return(ignoreData))
         .WillOnce(Return(ignoreData))
         .WillOnce(Return(ignoreData))
-        .WillOnce(Return(ignoreData))
-        .WillOnce(Return(noData));
+        .WillOnce(Return(ignoreData));
 
     const auto signalChain = m->load_memory_bank(slot);
     EXPECT_THAT(signalChain.name(), StrEq("abc"));
@@ -415,8 +652,7 @@ TEST_F(MustangTest, loadMemoryBankReceivesAmpValues)
         .WillOnce(Return(ignoreData))
         .WillOnce(Return(ignoreData))
         .WillOnce(Return(ignoreData))
-        .WillOnce(Return(extendedData))
-        .WillOnce(Return(noData));
+        .WillOnce(Return(extendedData));
 
 
     const auto signalChain = m->load_memory_bank(slot);
@@ -447,8 +683,7 @@ TEST_F(MustangTest, loadMemoryBankReceivesEffectValues)
         .WillOnce(Return(recvData1))
         .WillOnce(Return(recvData2))
         .WillOnce(Return(recvData3))
-        .WillOnce(Return(ignoreData))
-        .WillOnce(Return(noData));
+        .WillOnce(Return(ignoreData));
 
 
     const auto signalChain = m->load_memory_bank(slot);
@@ -469,22 +704,104 @@ TEST_F(MustangTest, setAmpSendsValues)
     InSequence s;
     // Data #1
     EXPECT_CALL(*conn, sendImpl(BufferIs(data), data.size())).WillOnce(Return(data.size()));
-    EXPECT_CALL(*conn, receive(packetRawTypeSize)).WillOnce(Return(ignoreData));
 
     // Apply command
     EXPECT_CALL(*conn, sendImpl(BufferIs(applyCmd), applyCmd.size())).WillOnce(Return(applyCmd.size()));
-    EXPECT_CALL(*conn, receive(packetRawTypeSize)).WillOnce(Return(ignoreData));
 
     // Data #2
     EXPECT_CALL(*conn, sendImpl(BufferIs(data2), data2.size())).WillOnce(Return(data2.size()));
-    EXPECT_CALL(*conn, receive(packetRawTypeSize)).WillOnce(Return(ignoreData));
 
     // Apply command
     EXPECT_CALL(*conn, sendImpl(BufferIs(applyCmd), applyCmd.size())).WillOnce(Return(applyCmd.size()));
-    EXPECT_CALL(*conn, receive(packetRawTypeSize)).WillOnce(Return(ignoreData));
 
+    // Replies
+    EXPECT_CALL(*conn, receive(packetRawTypeSize)).Times(4).WillRepeatedly(Return(ignoreData));
+
+
+    m->set_amplifier(settings);
+}
+
+TEST_F(MustangTest, setAmpSkipsUsbGainIfUnchanged)
+{
+    loadDeviceState();
+    amp_settings settings = ampState;
+    settings.gain = 0x44;
+    const auto data = serializeAmpSettings(settings).getBytes();
+
+    InSequence s;
+    EXPECT_CALL(*conn, sendImpl(BufferIs(data), data.size())).WillOnce(Return(data.size()));
+    EXPECT_CALL(*conn, sendImpl(BufferIs(applyCmd), applyCmd.size())).WillOnce(Return(applyCmd.size()));
+    EXPECT_CALL(*conn, receive(packetRawTypeSize)).Times(2).WillRepeatedly(Return(ignoreData));
+
+    m->set_amplifier(settings);
+}
+
+TEST_F(MustangTest, setAmpSendsOnlyUsbGainIfAmpUnchanged)
+{
+    loadDeviceState();
+    amp_settings settings = ampState;
+    settings.usb_gain = 0x12;
+    const auto data = serializeAmpSettingsUsbGain(settings).getBytes();
+
+    InSequence s;
+    EXPECT_CALL(*conn, sendImpl(BufferIs(data), data.size())).WillOnce(Return(data.size()));
+    EXPECT_CALL(*conn, sendImpl(BufferIs(applyCmd), applyCmd.size())).WillOnce(Return(applyCmd.size()));
+    EXPECT_CALL(*conn, receive(packetRawTypeSize)).Times(2).WillRepeatedly(Return(ignoreData));
+
+    m->set_amplifier(settings);
+}
+
+TEST_F(MustangTest, setAmpSendsNothingIfUnchanged)
+{
+    loadDeviceState();
+
+    EXPECT_CALL(*conn, sendImpl(_, _)).Times(0);
+
+    m->set_amplifier(ampState);
+}
+
+TEST_F(MustangTest, setAmpRejectsAmpNotSupportedByDevice)
+{
+    amp_settings settings = ampState;
+    settings.amp_num = amps::STUDIO_PREAMP;
 
+    EXPECT_CALL(*conn, sendImpl(_, _)).Times(0);
+
+    EXPECT_THROW(m->set_amplifier(settings), std::invalid_argument);
+}
+
+TEST_F(MustangTest, setAmpSendsAmpOfNewerGeneration)
+{
+    m = std::make_unique<BasicMustang<SmallAmpsV2>>(conn);
+    amp_settings settings = ampState;
+    settings.amp_num = amps::STUDIO_PREAMP;
+
+    EXPECT_CALL(*conn, sendImpl(_, _)).Times(AtLeast(1)).WillRepeatedly(Return(packetRawTypeSize));
+
+    m->set_amplifier(settings);
+}
+
+TEST_F(MustangTest, operationsAreMeasured)
+{
+    loadDeviceState();
+    amp_settings settings = ampState;
+    settings.gain = 0x44;
     m->set_amplifier(settings);
+
+    const auto snapshot = m->statistics()->snapshot();
+    EXPECT_THAT(snapshot.latency(Operation::setAmplifier).count, Eq(1));
+    EXPECT_THAT(snapshot.latency(Operation::setEffect).count, Eq(0));
+}
+
+TEST_F(MustangTest, unchangedSettingsAreNotMeasured)
+{
+    loadDeviceState();
+    m->set_amplifier(ampState);
+    m->set_effect(effectsState[0]);
+
+    const auto snapshot = m->statistics()->snapshot();
+    EXPECT_THAT(snapshot.latency(Operation::setAmplifier).count, Eq(0));
+    EXPECT_THAT(snapshot.latency(Operation::setEffect).count, Eq(0));
 }
 
 TEST_F(MustangTest, setEffectSendsValue)
@@ -496,19 +813,18 @@ TEST_F(MustangTest, setEffectSendsValue)
     InSequence s;
     // Clear command
     EXPECT_CALL(*conn, sendImpl(BufferIs(clearCmd), clearCmd.size())).WillOnce(Return(clearCmd.size()));
-    EXPECT_CALL(*conn, receive(packetRawTypeSize)).WillOnce(Return(ignoreData));
 
     // Apply command
     EXPECT_CALL(*conn, sendImpl(BufferIs(applyCmd), applyCmd.size())).WillOnce(Return(applyCmd.size()));
-    EXPECT_CALL(*conn, receive(packetRawTypeSize)).WillOnce(Return(ignoreData));
 
     // Data
     EXPECT_CALL(*conn, sendImpl(BufferIs(data), data.size())).WillOnce(Return(data.size()));
-    EXPECT_CALL(*conn, receive(packetRawTypeSize)).WillOnce(Return(ignoreData));
 
     // Apply command
     EXPECT_CALL(*conn, sendImpl(BufferIs(applyCmd), applyCmd.size())).WillOnce(Return(applyCmd.size()));
-    EXPECT_CALL(*conn, receive(packetRawTypeSize)).WillOnce(Return(ignoreData));
+
+    // Replies
+    EXPECT_CALL(*conn, receive(packetRawTypeSize)).Times(4).WillRepeatedly(Return(ignoreData));
 
 
     m->set_effect(settings);
@@ -522,16 +838,162 @@ TEST_F(MustangTest, setEffectClearsEffectIfEmptyEffect)
     InSequence s;
     // Clear command
     EXPECT_CALL(*conn, sendImpl(BufferIs(clearCmd), clearCmd.size())).WillOnce(Return(clearCmd.size()));
-    EXPECT_CALL(*conn, receive(packetRawTypeSize)).WillOnce(Return(ignoreData));
 
     // Apply command
     EXPECT_CALL(*conn, sendImpl(BufferIs(applyCmd), applyCmd.size())).WillOnce(Return(applyCmd.size()));
-    EXPECT_CALL(*conn, receive(packetRawTypeSize)).WillOnce(Return(ignoreData));
 
+    // Replies
+    EXPECT_CALL(*conn, receive(packetRawTypeSize)).Times(2).WillRepeatedly(Return(ignoreData));
+
+
+    m->set_effect(settings);
+}
+
+TEST_F(MustangTest, setEffectCollectsRepliesIfSendFails)
+{
+    constexpr fx_pedal_settings settings{2, effects::EMPTY, 0, 0, 0, 0, 0, 0, Position::input};
+
+    InSequence s;
+    EXPECT_CALL(*conn, sendImpl(BufferIs(clearCmd), clearCmd.size())).WillOnce(Throw(CommunicationException{"failed"}));
+    EXPECT_CALL(*conn, sendImpl(BufferIs(applyCmd), applyCmd.size())).WillOnce(Return(applyCmd.size()));
+    EXPECT_CALL(*conn, receive(packetRawTypeSize)).Times(2).WillRepeatedly(Return(noData));
+
+    EXPECT_THROW(m->set_effect(settings), CommunicationException);
+}
+
+TEST_F(MustangTest, setEffectSendsOnlySettingsIfModelUnchanged)
+{
+    loadDeviceState();
+    fx_pedal_settings settings = effectsState[1];
+    settings.knob1 = 0x33;
+    const auto data = serializeEffectSettings(settings).getBytes();
+
+    InSequence s;
+    EXPECT_CALL(*conn, sendImpl(BufferIs(data), data.size())).WillOnce(Return(data.size()));
+    EXPECT_CALL(*conn, sendImpl(BufferIs(applyCmd), applyCmd.size())).WillOnce(Return(applyCmd.size()));
+    EXPECT_CALL(*conn, receive(packetRawTypeSize)).Times(2).WillRepeatedly(Return(ignoreData));
 
     m->set_effect(settings);
 }
 
+TEST_F(MustangTest, setEffectClearsEffectIfModelChanged)
+{
+    loadDeviceState();
+    fx_pedal_settings settings = effectsState[1];
+    settings.effect_num = effects::SINE_CHORUS;
+    const auto data = serializeEffectSettings(settings).getBytes();
+
+    InSequence s;
+    EXPECT_CALL(*conn, sendImpl(BufferIs(clearCmd), clearCmd.size())).WillOnce(Return(clearCmd.size()));
+    EXPECT_CALL(*conn, sendImpl(BufferIs(applyCmd), applyCmd.size())).WillOnce(Return(applyCmd.size()));
+    EXPECT_CALL(*conn, sendImpl(BufferIs(data), data.size())).WillOnce(Return(data.size()));
+    EXPECT_CALL(*conn, sendImpl(BufferIs(applyCmd), applyCmd.size())).WillOnce(Return(applyCmd.size()));
+    EXPECT_CALL(*conn, receive(packetRawTypeSize)).Times(4).WillRepeatedly(Return(ignoreData));
+
+    m->set_effect(settings);
+}
+
+TEST_F(MustangTest, setEffectSendsNothingIfUnchanged)
+{
+    loadDeviceState();
+
+    EXPECT_CALL(*conn, sendImpl(_, _)).Times(0);
+
+    m->set_effect(effectsState[3]);
+    m->set_effect(fx_pedal_settings{0x02, effects::EMPTY, 1, 2, 3, 4, 5, 6, Position::input});
+}
+
+TEST_F(MustangTest, setEffectSendsEverythingAfterFailure)
+{
+    loadDeviceState();
+    fx_pedal_settings settings = effectsState[1];
+    settings.knob1 = 0x33;
+
+    EXPECT_CALL(*conn, sendImpl(_, _)).WillOnce(Throw(CommunicationException{"failed"})).WillOnce(Return(packetRawTypeSize));
+    EXPECT_CALL(*conn, receive(packetRawTypeSize)).Times(2).WillRepeatedly(Return(noData));
+    EXPECT_THROW(m->set_effect(settings), CommunicationException);
+    Mock::VerifyAndClearExpectations(conn.get());
+
+    EXPECT_CALL(*conn, sendImpl(_, _)).Times(4).WillRepeatedly(Return(packetRawTypeSize));
+    EXPECT_CALL(*conn, receive(packetRawTypeSize)).Times(4).WillRepeatedly(Return(ignoreData));
+    m->set_effect(settings);
+}
+
+TEST_F(MustangTest, setEffectRejectsEffectNotSupportedByDevice)
+{
+    constexpr fx_pedal_settings settings{0, effects::BIG_FUZZ, 1, 2, 3, 4, 5, 6, Position::input};
+
+    EXPECT_CALL(*conn, sendImpl(_, _)).Times(0);
+
+    EXPECT_THROW(m->set_effect(settings), std::invalid_argument);
+}
+
+TEST_F(MustangTest, applyChainSendsEverythingWithSingleApply)
+{
+    const SignalChain chain{"abc", ampState, effectsState};
+    const auto ampData = serializeAmpSettings(ampState).getBytes();
+    const auto usbGainData = serializeAmpSettingsUsbGain(ampState).getBytes();
+    const auto effect1Data = serializeEffectSettings(effectsState[1]).getBytes();
+    const auto effect3Data = serializeEffectSettings(effectsState[3]).getBytes();
+
+    InSequence s;
+    EXPECT_CALL(*conn, sendImpl(BufferIs(clearCmd), clearCmd.size())).WillOnce(Return(clearCmd.size()));
+    EXPECT_CALL(*conn, sendImpl(BufferIs(ampData), ampData.size())).WillOnce(Return(ampData.size()));
+    EXPECT_CALL(*conn, sendImpl(BufferIs(usbGainData), usbGainData.size())).WillOnce(Return(usbGainData.size()));
+    EXPECT_CALL(*conn, sendImpl(BufferIs(effect1Data), effect1Data.size())).WillOnce(Return(effect1Data.size()));
+    EXPECT_CALL(*conn, sendImpl(BufferIs(effect3Data), effect3Data.size())).WillOnce(Return(effect3Data.size()));
+    EXPECT_CALL(*conn, sendImpl(BufferIs(applyCmd), applyCmd.size())).WillOnce(Return(applyCmd.size()));
+    EXPECT_CALL(*conn, receive(packetRawTypeSize)).Times(6).WillRepeatedly(Return(ignoreData));
+
+    m->applyChain(chain);
+}
+
+TEST_F(MustangTest, applyChainSendsOnlyChangedValues)
+{
+    loadDeviceState();
+    amp_settings amp = ampState;
+    amp.gain = 0x44;
+    auto effects = effectsState;
+    effects[3].knob2 = 0x55;
+    const auto ampData = serializeAmpSettings(amp).getBytes();
+    const auto effect3Data = serializeEffectSettings(effects[3]).getBytes();
+
+    InSequence s;
+    EXPECT_CALL(*conn, sendImpl(BufferIs(ampData), ampData.size())).WillOnce(Return(ampData.size()));
+    EXPECT_CALL(*conn, sendImpl(BufferIs(effect3Data), effect3Data.size())).WillOnce(Return(effect3Data.size()));
+    EXPECT_CALL(*conn, sendImpl(BufferIs(applyCmd), applyCmd.size())).WillOnce(Return(applyCmd.size()));
+    EXPECT_CALL(*conn, receive(packetRawTypeSize)).Times(3).WillRepeatedly(Return(ignoreData));
+
+    m->applyChain(SignalChain{"abc", amp, effects});
+}
+
+TEST_F(MustangTest, applyChainResendsUnchangedEffectsAfterClear)
+{
+    loadDeviceState();
+    auto effects = effectsState;
+    effects[1].effect_num = effects::SINE_CHORUS;
+    const auto effect1Data = serializeEffectSettings(effects[1]).getBytes();
+    const auto effect3Data = serializeEffectSettings(effects[3]).getBytes();
+
+    InSequence s;
+    EXPECT_CALL(*conn, sendImpl(BufferIs(clearCmd), clearCmd.size())).WillOnce(Return(clearCmd.size()));
+    EXPECT_CALL(*conn, sendImpl(BufferIs(effect1Data), effect1Data.size())).WillOnce(Return(effect1Data.size()));
+    EXPECT_CALL(*conn, sendImpl(BufferIs(effect3Data), effect3Data.size())).WillOnce(Return(effect3Data.size()));
+    EXPECT_CALL(*conn, sendImpl(BufferIs(applyCmd), applyCmd.size())).WillOnce(Return(applyCmd.size()));
+    EXPECT_CALL(*conn, receive(packetRawTypeSize)).Times(4).WillRepeatedly(Return(ignoreData));
+
+    m->applyChain(SignalChain{"abc", ampState, effects});
+}
+
+TEST_F(MustangTest, applyChainSendsNothingIfUnchanged)
+{
+    loadDeviceState();
+
+    EXPECT_CALL(*conn, sendImpl(_, _)).Times(0);
+
+    m->applyChain(SignalChain{"abc", ampState, effectsState});
+}
+
 TEST_F(MustangTest, saveEffectsSendsValues)
 {
     const std::vector<fx_pedal_settings> settings{fx_pedal_settings{1, effects::MONO_DELAY, 0, 1, 2, 3, 4, 5, Position::input},
@@ -545,21 +1007,20 @@ TEST_F(MustangTest, saveEffectsSendsValues)
     InSequence s;
     // Save effect name cmd
     EXPECT_CALL(*conn, sendImpl(BufferIs(dataName), dataName.size())).WillOnce(Return(0));
-    EXPECT_CALL(*conn, receive(packetRawTypeSize)).WillOnce(Return(noData));
 
     // Effect #0
     const auto effect0 = packets[0].getBytes();
     EXPECT_CALL(*conn, sendImpl(BufferIs(effect0), effect0.size())).WillOnce(Return(0));
-    EXPECT_CALL(*conn, receive(packetRawTypeSize)).WillOnce(Return(noData));
 
     // Effect #1
     const auto effect1 = packets[1].getBytes();
     EXPECT_CALL(*conn, sendImpl(BufferIs(effect1), effect1.size())).WillOnce(Return(0));
-    EXPECT_CALL(*conn, receive(packetRawTypeSize)).WillOnce(Return(noData));
 
     // Apply cmd
     EXPECT_CALL(*conn, sendImpl(BufferIs(cmdExecute), cmdExecute.size())).WillOnce(Return(0));
-    EXPECT_CALL(*conn, receive(packetRawTypeSize)).WillOnce(Return(noData));
+
+    // Replies
+    EXPECT_CALL(*conn, receive(packetRawTypeSize)).Times(4).WillRepeatedly(Return(noData));
 
 
     m->save_effects(slot, name, settings);
@@ -579,16 +1040,16 @@ TEST_F(MustangTest, saveEffectsLimitsNumberOfValues)
     InSequence s;
     // Save effect cmd
     EXPECT_CALL(*conn, sendImpl(BufferIs(dataName), dataName.size())).WillOnce(Return(0));
-    EXPECT_CALL(*conn, receive(packetRawTypeSize)).WillOnce(Return(noData));
 
     // Effect #0
     const auto effect0 = packets[0].getBytes();
     EXPECT_CALL(*conn, sendImpl(BufferIs(effect0), effect0.size())).WillOnce(Return(0));
-    EXPECT_CALL(*conn, receive(packetRawTypeSize)).WillOnce(Return(noData));
 
     // Apply cmd
     EXPECT_CALL(*conn, sendImpl(BufferIs(cmdExecute), cmdExecute.size())).WillOnce(Return(0));
-    EXPECT_CALL(*conn, receive(packetRawTypeSize)).WillOnce(Return(noData));
+
+    // Replies
+    EXPECT_CALL(*conn, receive(packetRawTypeSize)).Times(3).WillRepeatedly(Return(noData));
 
     m->save_effects(slot, name, settings);
 }
@@ -613,3 +1074,26 @@ TEST_F(MustangTest, saveOnAmp)
 
     m->save_on_amp(name, slot);
 }
+
+TEST_F(MustangTest, saveOnAmpRejectsBankBeyondBankCount)
+{
+    EXPECT_CALL(*conn, sendImpl(_, _)).Times(0);
+
+    EXPECT_THROW(m->save_on_amp("abc", 24), std::invalid_argument);
+}
+
+TEST_F(MustangTest, loadMemoryBankRejectsBankBeyondBankCount)
+{
+    EXPECT_CALL(*conn, sendImpl(_, _)).Times(0);
+
+    EXPECT_THROW(m->load_memory_bank(24), std::invalid_argument);
+}
+
+TEST_F(MustangTest, createMustangSelectsProtocol)
+{
+    m = createMustang(conn, ProtocolKind::bigAmpsV1);
+    EXPECT_CALL(*conn, sendImpl(_, _)).WillOnce(Return(packetRawTypeSize));
+    EXPECT_CALL(*conn, receive(packetRawTypeSize)).Times(7).WillRepeatedly(Return(ignoreData));
+
+    m->load_memory_bank(99);
+}
@@ -0,0 +1,214 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "com/PacketCapture.h"
+#include "com/RecordingConnection.h"
+#include "com/ReplayConnection.h"
+#include "com/CommunicationException.h"
+#include "mocks/MockConnection.h"
+#include <array>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <gmock/gmock.h>
+
+using namespace plug::com;
+using namespace testing;
+using namespace std::chrono_literals;
+
+class PacketCaptureTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        std::remove(file.c_str());
+    }
+
+    void TearDown() override
+    {
+        std::remove(file.c_str());
+    }
+
+    Capture readFile() const
+    {
+        std::ifstream stream{file, std::ios::binary};
+        return readCapture(stream);
+    }
+
+    template <class T>
+    static T readLE(const std::string& data, std::size_t offset)
+    {
+        std::uint64_t value{0};
+
+        for (std::size_t i = 0; i < sizeof(T); ++i)
+        {
+            value |= static_cast<std::uint64_t>(static_cast<std::uint8_t>(data[offset + i])) << (8 * i);
+        }
+        return static_cast<T>(value);
+    }
+
+
+    const std::string file{TempDir() + "/plug-capture-test.cap"};
+    const std::vector<std::uint8_t> packetOut{0x1c, 0x01, 0x00, 0x00, 0x01};
+    const std::vector<std::uint8_t> packetIn{0x1c, 0x03, 0x05, 0x00, 0x02, 0xff};
+};
+
+TEST_F(PacketCaptureTest, writtenPacketsAreRead)
+{
+    std::stringstream stream;
+    CaptureWriter writer{stream};
+    writer.write(Direction::out, packetOut.data(), packetOut.size());
+    writer.write(Direction::in, packetIn.data(), packetIn.size());
+    writer.write(Direction::in, nullptr, 0);
+
+    const auto capture = readCapture(stream);
+    ASSERT_THAT(capture.packets.size(), Eq(3));
+    EXPECT_THAT(capture.packets[0].direction, Eq(Direction::out));
+    EXPECT_THAT(capture.packets[0].data, ContainerEq(packetOut));
+    EXPECT_THAT(capture.packets[1].direction, Eq(Direction::in));
+    EXPECT_THAT(capture.packets[1].data, ContainerEq(packetIn));
+    EXPECT_THAT(capture.packets[2].data, IsEmpty());
+    EXPECT_THAT(capture.packets[0].time, Le(capture.packets[1].time));
+    EXPECT_THAT(capture.packets[1].time, Le(capture.packets[2].time));
+}
+
+TEST_F(PacketCaptureTest, readThrowsOnInvalidData)
+{
+    std::stringstream invalid{"XXXX\x01"};
+    EXPECT_THROW(readCapture(invalid), std::runtime_error);
+
+    std::stringstream truncated;
+    CaptureWriter writer{truncated};
+    writer.write(Direction::out, packetOut.data(), packetOut.size());
+    std::stringstream cut{truncated.str().substr(0, truncated.str().size() - 1)};
+    EXPECT_THROW(readCapture(cut), std::runtime_error);
+}
+
+TEST_F(PacketCaptureTest, recordingWritesAllTraffic)
+{
+    auto conn = std::make_shared<NiceMock<mock::MockConnection>>();
+    EXPECT_CALL(*conn, sendImpl(_, packetOut.size())).WillOnce(Return(packetOut.size()));
+    EXPECT_CALL(*conn, receive(64)).WillOnce(Return(packetIn)).WillOnce(Return(std::vector<std::uint8_t>{}));
+    EXPECT_CALL(*conn, takeReceived()).WillOnce(Return(std::vector<std::vector<std::uint8_t>>{packetOut}));
+
+    {
+        RecordingConnection recording{conn, file};
+        EXPECT_THAT(recording.send(packetOut), Eq(packetOut.size()));
+        EXPECT_THAT(recording.receiveAsync(64).get(), ContainerEq(packetIn));
+        EXPECT_THAT(recording.receive(64), IsEmpty());
+        EXPECT_THAT(recording.takeReceived().size(), Eq(1));
+    }
+
+    const auto capture = readFile();
+    ASSERT_THAT(capture.packets.size(), Eq(4));
+    EXPECT_THAT(capture.packets[0].direction, Eq(Direction::out));
+    EXPECT_THAT(capture.packets[0].data, ContainerEq(packetOut));
+    EXPECT_THAT(capture.packets[1].direction, Eq(Direction::in));
+    EXPECT_THAT(capture.packets[1].data, ContainerEq(packetIn));
+    EXPECT_THAT(capture.packets[2].data, IsEmpty());
+    EXPECT_THAT(capture.packets[3].direction, Eq(Direction::in));
+}
+
+TEST_F(PacketCaptureTest, recordingThrowsIfFileCantBeOpened)
+{
+    auto conn = std::make_shared<NiceMock<mock::MockConnection>>();
+    EXPECT_THROW(RecordingConnection(conn, TempDir() + "/not/existing/file.cap"), CommunicationException);
+}
+
+TEST_F(PacketCaptureTest, replayReturnsReceivedPackets)
+{
+    const Capture capture{{}, {{0ms, Direction::out, packetOut}, {1ms, Direction::in, packetIn}, {2ms, Direction::in, {}}}};
+    ReplayConnection replay{capture, 0.0};
+
+    EXPECT_THAT(replay.send(packetOut), Eq(packetOut.size()));
+    EXPECT_THAT(replay.receive(64), ContainerEq(packetIn));
+    EXPECT_THAT(replay.receive(64), IsEmpty());
+    EXPECT_THAT(replay.receive(64), IsEmpty());
+    EXPECT_THAT(replay.mismatches(), Eq(0));
+}
+
+TEST_F(PacketCaptureTest, replayCountsMismatchingSends)
+{
+    const Capture capture{{}, {{0ms, Direction::out, packetOut}}};
+    ReplayConnection replay{capture, 0.0};
+
+    replay.send(packetIn);
+    replay.send(packetOut);
+    EXPECT_THAT(replay.mismatches(), Eq(2));
+}
+
+TEST_F(PacketCaptureTest, replayScalesTiming)
+{
+    const Capture capture{{}, {{40ms, Direction::in, packetIn}}};
+    ReplayConnection replay{capture, 0.5};
+    const auto start = std::chrono::steady_clock::now();
+
+    replay.receive(64);
+    EXPECT_THAT(std::chrono::steady_clock::now() - start, Ge(20ms));
+}
+
+TEST_F(PacketCaptureTest, replayTakesPacketsDueButNotReceived)
+{
+    const Capture capture{{}, {{0ms, Direction::in, packetIn}, {1h, Direction::in, packetOut}}};
+    ReplayConnection replay{capture, 1.0};
+
+    const auto packets = replay.takeReceived();
+    ASSERT_THAT(packets.size(), Eq(1));
+    EXPECT_THAT(packets[0], ContainerEq(packetIn));
+}
+
+TEST_F(PacketCaptureTest, replayThrowsIfClosed)
+{
+    ReplayConnection replay{Capture{}, 0.0};
+    replay.close();
+    EXPECT_FALSE(replay.isOpen());
+    EXPECT_THROW(replay.receive(64), CommunicationException);
+}
+
+TEST_F(PacketCaptureTest, exportWritesPcapngBlocks)
+{
+    const Capture capture{std::chrono::system_clock::time_point{1s}, {{2ms, Direction::out, packetOut}, {3ms, Direction::in, packetIn}}};
+    std::stringstream stream;
+    exportPcapng(capture, stream);
+    const auto data = stream.str();
+
+    EXPECT_THAT(readLE<std::uint32_t>(data, 0), Eq(0x0a0d0d0a));
+    EXPECT_THAT(readLE<std::uint32_t>(data, 8), Eq(0x1a2b3c4d));
+    const auto shbLength = readLE<std::uint32_t>(data, 4);
+
+    EXPECT_THAT(readLE<std::uint32_t>(data, shbLength), Eq(1));
+    EXPECT_THAT(readLE<std::uint16_t>(data, shbLength + 8), Eq(220));
+    const auto epbOffset = shbLength + readLE<std::uint32_t>(data, shbLength + 4);
+
+    EXPECT_THAT(readLE<std::uint32_t>(data, epbOffset), Eq(6));
+    const auto epbLength = readLE<std::uint32_t>(data, epbOffset + 4);
+    EXPECT_THAT(epbLength % 4, Eq(0));
+    EXPECT_THAT(readLE<std::uint32_t>(data, epbOffset + epbLength - 4), Eq(epbLength));
+    EXPECT_THAT(readLE<std::uint32_t>(data, epbOffset + 12), Eq(0));
+    EXPECT_THAT(readLE<std::uint32_t>(data, epbOffset + 16), Eq(1'002'000'000));
+    EXPECT_THAT(readLE<std::uint32_t>(data, epbOffset + 20), Eq(64 + packetOut.size()));
+    EXPECT_THAT(data[epbOffset + 28 + 8], Eq('S'));
+    EXPECT_THAT(static_cast<std::uint8_t>(data[epbOffset + 28 + 10]), Eq(0x01));
+
+    const auto secondOffset = epbOffset + epbLength;
+    EXPECT_THAT(data[secondOffset + 28 + 8], Eq('C'));
+    EXPECT_THAT(static_cast<std::uint8_t>(data[secondOffset + 28 + 10]), Eq(0x81));
+    EXPECT_THAT(secondOffset + readLE<std::uint32_t>(data, secondOffset + 4), Eq(data.size()));
+}
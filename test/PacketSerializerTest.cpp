@@ -617,6 +617,19 @@ TEST_F(PacketSerializerTest, serializeEffectSettingsMultitapDelayLimitsValue)
     EXPECT_THAT(packet.getBytes(), KnobsAre(1, 2, 3, 2, 3, 0));
 }
 
+TEST_F(PacketSerializerTest, serializeEffectSettingsThrowsOnInvalidEffect)
+{
+    constexpr fx_pedal_settings settings{0, static_cast<effects>(0x7f), 1, 2, 3, 4, 5, 6, Position::input};
+    EXPECT_THROW(serializeEffectSettings(settings), std::invalid_argument);
+}
+
+TEST_F(PacketSerializerTest, serializeAmpSettingsThrowsOnInvalidAmp)
+{
+    amp_settings settings{};
+    settings.amp_num = static_cast<amps>(0x7f);
+    EXPECT_THROW(serializeAmpSettings(settings), std::invalid_argument);
+}
+
 TEST_F(PacketSerializerTest, serializeSaveEffectNameData)
 {
     constexpr std::uint8_t slot{17};
@@ -1026,6 +1039,39 @@ TEST_F(PacketSerializerTest, decodeAmpFromDataThrowsOnInvalidCabinetId)
     EXPECT_THROW(decodeAmpFromData(cabinetPackage(0xe0), emptyAmpPayload), std::invalid_argument);
 }
 
+TEST_F(PacketSerializerTest, tryDecodeAmpFromDataReportsUnknownIds)
+{
+    const auto unknownAmp = ampPackage(0xf0).getBytes();
+    const auto unknownCabinet = cabinetPackage(0xe0).getBytes();
+    const auto known = ampPackage(0x67).getBytes();
+
+    const auto amp = tryDecodeAmpFromData(PacketView<AmpPayload>{unknownAmp}, PacketView<AmpPayload>{known});
+    const auto cabinet = tryDecodeAmpFromData(PacketView<AmpPayload>{unknownCabinet}, PacketView<AmpPayload>{known});
+    const auto valid = tryDecodeAmpFromData(PacketView<AmpPayload>{known}, PacketView<AmpPayload>{known});
+
+    ASSERT_THAT(amp.has_value(), Eq(false));
+    EXPECT_THAT(amp.error(), Eq(DecodeError::unknownAmp));
+    ASSERT_THAT(cabinet.has_value(), Eq(false));
+    EXPECT_THAT(cabinet.error(), Eq(DecodeError::unknownCabinet));
+    ASSERT_THAT(valid.has_value(), Eq(true));
+    EXPECT_THAT(valid.value().amp_num, Eq(amps::FENDER_57_DELUXE));
+}
+
+TEST_F(PacketSerializerTest, tryDecodeEffectFromDataReportsUnknownId)
+{
+    const auto unknown = effectPackage(0xff)[0].getBytes();
+    const auto known = effectPackage(0x12)[0].getBytes();
+
+    const auto effect = tryDecodeEffectFromData(PacketView<EffectPayload>{unknown});
+    const auto valid = tryDecodeEffectFromData(PacketView<EffectPayload>{known});
+
+    ASSERT_THAT(effect.has_value(), Eq(false));
+    EXPECT_THAT(effect.error(), Eq(DecodeError::unknownEffect));
+    EXPECT_THROW(effect.value(), std::invalid_argument);
+    ASSERT_THAT(valid.has_value(), Eq(true));
+    EXPECT_THAT(valid.value().effect_num, Eq(effects::SINE_CHORUS));
+}
+
 TEST_F(PacketSerializerTest, decodeEffectsFromDataSetsData)
 {
     auto package = filledPackage(0x00);
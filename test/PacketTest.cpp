@@ -286,6 +286,18 @@ TEST_F(PacketTest, headerDSPFromDataThrowsOnInvalidValue)
     EXPECT_THROW(header.getDSP(), std::domain_error);
 }
 
+TEST_F(PacketTest, headerFindReturnsNothingOnInvalidValue)
+{
+    std::array<std::uint8_t, 16> data{{}};
+    Header header{};
+
+    data[1] = 0x99;
+    data[2] = 0x99;
+    header.fromBytes(data);
+    EXPECT_THAT(header.findType(), Eq(std::nullopt));
+    EXPECT_THAT(header.findDSP(), Eq(std::nullopt));
+}
+
 TEST_F(PacketTest, headerSlotFromData)
 {
     std::array<std::uint8_t, 16> data{{}};
@@ -598,3 +610,32 @@ TEST_F(PacketTest, ampPayloadUsbGainFromData)
 
     EXPECT_THAT(p.getUsbGain(), Eq(0x12));
 }
+
+TEST_F(PacketTest, packetViewReadsData)
+{
+    PacketRawType data{{}};
+    data[2] = 0x07;
+    data[4] = 0x03;
+    data[sizeHeader + 0] = 0x1f;
+    data[sizeHeader + 1] = 0x10;
+    data[sizeHeader + 16] = 0x11;
+    data[sizeHeader + 21] = 0x66;
+
+    const PacketView<EffectPayload> view{data};
+
+    EXPECT_THAT(view.getHeader().getDSP(), Eq(DSP::effect1));
+    EXPECT_THAT(view.getHeader().getSlot(), Eq(0x03));
+    EXPECT_THAT(view.getPayload().getModel(), Eq(0x101f));
+    EXPECT_THAT(view.getPayload().getKnob1(), Eq(0x11));
+    EXPECT_THAT(view.getPayload().getKnob6(), Eq(0x66));
+}
+
+TEST_F(PacketTest, packetViewDoesNotCopyData)
+{
+    PacketRawType data{{}};
+    const PacketView<NamePayload> view{data};
+    const std::string name = "abc";
+    std::copy(name.cbegin(), name.cend(), std::next(data.begin(), sizeHeader));
+
+    EXPECT_THAT(view.getPayload().getName(), Eq(name));
+}
@@ -0,0 +1,225 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fuse/PresetIndex.h"
+#include "matcher/TypeMatcher.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <gmock/gmock.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace plug;
+using namespace plug::fuse;
+using namespace test::matcher;
+using namespace testing;
+
+class PresetIndexTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        mkdir(directory.c_str(), 0700);
+    }
+
+    void TearDown() override
+    {
+        std::for_each(created.cbegin(), created.cend(), [](const auto& name) { std::remove(name.c_str()); });
+        std::remove(indexFile.c_str());
+        rmdir(directory.c_str());
+    }
+
+    void writeFile(const std::string& name, const std::string& content)
+    {
+        const auto path = directory + "/" + name;
+        std::ofstream{path, std::ios::binary | std::ios::trunc} << content;
+        created.push_back(path);
+    }
+
+    void writeFile(const std::string& name, const SignalChain& content)
+    {
+        std::string document;
+        writePreset(document, Preset{content, "author"});
+        writeFile(name, document);
+    }
+
+    static std::vector<std::string> fileNames(const PresetIndex& index)
+    {
+        std::vector<std::string> names;
+        std::transform(index.entries().cbegin(), index.entries().cend(), std::back_inserter(names), [](const auto& entry) { return entry.fileName; });
+        return names;
+    }
+
+    const std::string directory{TempDir() + "/plug-preset-index"};
+    const std::string indexFile{TempDir() + "/plug-preset-index.index"};
+    std::vector<std::string> created;
+    const amp_settings ampSettings{amps::BRITISH_80S, 2, 1, 3, 4, 5, cabinets::cab4x12M, 6, 9, 10, 11, 7, 0x80, 13, 1, true, 0xab};
+    const SignalChain chain{"indexed", ampSettings, {{{0, effects::OVERDRIVE, 10, 20, 30, 40, 50, 0, Position::input},
+                                                     {1, effects::EMPTY, 0, 0, 0, 0, 0, 0, Position::input},
+                                                     {2, effects::EMPTY, 0, 0, 0, 0, 0, 0, Position::input},
+                                                     {3, effects::EMPTY, 0, 0, 0, 0, 0, 0, Position::input}}}};
+};
+
+TEST_F(PresetIndexTest, refreshParsesPresetFiles)
+{
+    writeFile("a.fuse", chain);
+    writeFile("b.txt", chain);
+
+    PresetIndex index{directory, indexFile};
+
+    EXPECT_THAT(index.refresh(), Eq(1));
+    ASSERT_THAT(index.entries(), SizeIs(1));
+    EXPECT_THAT(index.entries()[0].fileName, StrEq("a.fuse"));
+    EXPECT_THAT(index.path(index.entries()[0]), StrEq(directory + "/a.fuse"));
+    ASSERT_THAT(index.entries()[0].preset.has_value(), IsTrue());
+    EXPECT_THAT(index.entries()[0].preset->author, StrEq("author"));
+    EXPECT_THAT(index.entries()[0].preset->chain.name(), StrEq("indexed"));
+    EXPECT_THAT(index.entries()[0].preset->chain.amp(), AmpIs(ampSettings));
+    EXPECT_THAT(index.entries()[0].preset->chain.effects()[0], EffectIs(chain.effects()[0]));
+}
+
+TEST_F(PresetIndexTest, filesAreSortedIgnoringCase)
+{
+    writeFile("b.fuse", chain);
+    writeFile("C.FUSE", chain);
+    writeFile("A.fuse", chain);
+
+    PresetIndex index{directory, indexFile};
+    index.refresh(2);
+
+    EXPECT_THAT(fileNames(index), ElementsAre("A.fuse", "b.fuse", "C.FUSE"));
+}
+
+TEST_F(PresetIndexTest, invalidFilesAreKeptWithoutPreset)
+{
+    writeFile("broken.fuse", "<Other/>");
+
+    PresetIndex index{directory, indexFile};
+
+    EXPECT_THAT(index.refresh(), Eq(1));
+    ASSERT_THAT(index.entries(), SizeIs(1));
+    EXPECT_THAT(index.entries()[0].preset.has_value(), IsFalse());
+    EXPECT_THAT(index.refresh(), Eq(0));
+}
+
+TEST_F(PresetIndexTest, storedIndexAvoidsParsing)
+{
+    writeFile("a.fuse", chain);
+    writeFile("broken.fuse", "<Other/>");
+    PresetIndex stored{directory, indexFile};
+    stored.refresh();
+    ASSERT_THAT(stored.store(), IsTrue());
+
+    PresetIndex index{directory, indexFile};
+    index.load();
+
+    ASSERT_THAT(index.entries(), SizeIs(2));
+    EXPECT_THAT(index.entries()[0].preset->chain.amp(), AmpIs(ampSettings));
+    EXPECT_THAT(index.entries()[1].preset.has_value(), IsFalse());
+    EXPECT_THAT(index.refresh(), Eq(0));
+}
+
+TEST_F(PresetIndexTest, changedAndRemovedFilesAreUpdated)
+{
+    writeFile("a.fuse", chain);
+    writeFile("b.fuse", chain);
+    PresetIndex index{directory, indexFile};
+    index.refresh();
+
+    writeFile("a.fuse", SignalChain{"changed name", ampSettings, chain.effects()});
+    std::remove((directory + "/b.fuse").c_str());
+
+    EXPECT_THAT(index.refresh(), Eq(1));
+    ASSERT_THAT(index.entries(), SizeIs(1));
+    EXPECT_THAT(index.entries()[0].preset->chain.name(), StrEq("changed name"));
+}
+
+TEST_F(PresetIndexTest, indexOfOtherDirectoryIsIgnored)
+{
+    writeFile("a.fuse", chain);
+    PresetIndex other{TempDir(), indexFile};
+    other.refresh();
+    other.store();
+
+    PresetIndex index{directory, indexFile};
+    index.load();
+
+    EXPECT_THAT(index.entries(), IsEmpty());
+}
+
+TEST_F(PresetIndexTest, truncatedIndexIsIgnored)
+{
+    writeFile("a.fuse", chain);
+    PresetIndex stored{directory, indexFile};
+    stored.refresh();
+    stored.store();
+    truncate(indexFile.c_str(), 20);
+
+    PresetIndex index{directory, indexFile};
+    index.load();
+
+    EXPECT_THAT(index.entries(), IsEmpty());
+}
+
+TEST_F(PresetIndexTest, missingDirectoryIsEmpty)
+{
+    PresetIndex index{directory + "/missing", indexFile};
+
+    EXPECT_THAT(index.refresh(), Eq(0));
+    EXPECT_THAT(index.entries(), IsEmpty());
+}
+
+TEST_F(PresetIndexTest, indexFileNameDependsOnDirectory)
+{
+    EXPECT_THAT(indexFileName("/a"), StartsWith("library-"));
+    EXPECT_THAT(indexFileName("/a"), Ne(indexFileName("/b")));
+}
+
+TEST_F(PresetIndexTest, updateParsesOnlyChangedFiles)
+{
+    writeFile("b.fuse", chain);
+    writeFile("d.fuse", chain);
+    PresetIndex index{directory, indexFile};
+    index.refresh();
+
+    writeFile("a.fuse", chain);
+    writeFile("C.fuse", chain);
+    writeFile("d.fuse", SignalChain{"changed name", ampSettings, chain.effects()});
+
+    EXPECT_THAT(index.update({"a.fuse", "b.fuse", "C.fuse", "d.fuse"}), Eq(3));
+    EXPECT_THAT(fileNames(index), ElementsAre("a.fuse", "b.fuse", "C.fuse", "d.fuse"));
+    EXPECT_THAT(index.entries()[3].preset->chain.name(), StrEq("changed name"));
+}
+
+TEST_F(PresetIndexTest, updateDropsRemovedAndRenamedFiles)
+{
+    writeFile("a.fuse", chain);
+    writeFile("b.fuse", chain);
+    PresetIndex index{directory, indexFile};
+    index.refresh();
+
+    std::remove((directory + "/a.fuse").c_str());
+    std::rename((directory + "/b.fuse").c_str(), (directory + "/b.txt").c_str());
+    created.push_back(directory + "/b.txt");
+
+    EXPECT_THAT(index.update({"a.fuse", "b.fuse", "b.txt", "unknown.fuse"}), Eq(0));
+    EXPECT_THAT(index.entries(), IsEmpty());
+}
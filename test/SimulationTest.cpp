@@ -0,0 +1,203 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "com/Mustang.h"
+#include "simulator/SimulatedMustang.h"
+#include "matcher/TypeMatcher.h"
+#include <chrono>
+#include <gmock/gmock.h>
+
+using namespace plug;
+using namespace plug::com;
+using namespace test::matcher;
+using namespace test::simulator;
+using namespace testing;
+
+class SimulationTest : public testing::Test
+{
+protected:
+    void connect(ProtocolKind protocol, SimulatedMustang::Timing timing = SimulatedMustang::noDelay())
+    {
+        amp = std::make_shared<SimulatedMustang>(protocol, timing);
+        m = createMustang(amp, amp->protocol());
+    }
+
+    std::shared_ptr<SimulatedMustang> amp;
+    std::unique_ptr<Mustang> m;
+    const amp_settings ampSettings{amps::BRITISH_80S, 2, 1, 3, 4, 5, cabinets::cab4x12M, 0, 9, 10, 11, 0, 0x80, 13, 1, false, 0xab};
+    const fx_pedal_settings delay{3, effects::TAPE_DELAY, 1, 2, 3, 4, 5, 6, Position::effectsLoop};
+};
+
+TEST_F(SimulationTest, startReadsPresetListOfSmallAmpsV1)
+{
+    connect(ProtocolKind::smallAmpsV1);
+
+    const auto [signalChain, presets] = m->start_amp();
+    EXPECT_THAT(presets.size(), Eq(24));
+    EXPECT_THAT(presets[23], StrEq("SIM 24"));
+    EXPECT_THAT(signalChain.name(), StrEq("SIM 1"));
+    EXPECT_THAT(m->current_state(), Ne(std::nullopt));
+}
+
+TEST_F(SimulationTest, startReadsPresetListOfBigAmpsV1)
+{
+    connect(ProtocolKind::bigAmpsV1);
+
+    const auto [signalChain, presets] = m->start_amp();
+    EXPECT_THAT(presets.size(), Eq(100));
+    EXPECT_THAT(presets[99], StrEq("SIM 100"));
+    EXPECT_THAT(m->current_state(), Ne(std::nullopt));
+}
+
+TEST_F(SimulationTest, startReadsPresetListOfSmallAmpsV2)
+{
+    connect(ProtocolKind::smallAmpsV2);
+
+    const auto [signalChain, presets] = m->start_amp();
+    EXPECT_THAT(presets.size(), Eq(24));
+    EXPECT_THAT(presets[23], StrEq("SIM 24"));
+    EXPECT_THAT(m->current_state(), Ne(std::nullopt));
+}
+
+TEST_F(SimulationTest, startReadsPresetListOfBigAmpsV2)
+{
+    connect(ProtocolKind::bigAmpsV2);
+
+    const auto [signalChain, presets] = m->start_amp();
+    EXPECT_THAT(presets.size(), Eq(100));
+    EXPECT_THAT(presets[99], StrEq("SIM 100"));
+    EXPECT_THAT(m->current_state(), Ne(std::nullopt));
+}
+
+TEST_F(SimulationTest, loadMemoryBankSelectsLastBankOfBigAmpsV1)
+{
+    connect(ProtocolKind::bigAmpsV1);
+    amp->setBank(99, SignalChain{"bank 99", ampSettings, {{{0, effects::EMPTY, 0, 0, 0, 0, 0, 0, Position::input}, {}, {}, delay}}});
+    m->start_amp();
+
+    const auto bank = m->load_memory_bank(99);
+
+    EXPECT_THAT(bank.name(), StrEq("bank 99"));
+    EXPECT_THAT(bank.effects()[3], EffectIs(delay));
+    EXPECT_THAT(amp->current().name(), StrEq("bank 99"));
+}
+
+TEST_F(SimulationTest, smallAmpsV2AcceptV2EffectsButNoBigAmpBanks)
+{
+    connect(ProtocolKind::smallAmpsV2);
+    m->start_amp();
+    const fx_pedal_settings fuzz{0, effects::BIG_FUZZ, 1, 2, 3, 4, 5, 0, Position::input};
+
+    m->set_effect(fuzz);
+
+    EXPECT_THAT(amp->current().effects()[0], EffectIs(fuzz));
+    EXPECT_THROW(m->load_memory_bank(24), std::invalid_argument);
+}
+
+TEST_F(SimulationTest, loadMemoryBankSelectsBank)
+{
+    connect(ProtocolKind::bigAmpsV2);
+    amp->setBank(5, SignalChain{"bank 5", ampSettings, {{{0, effects::EMPTY, 0, 0, 0, 0, 0, 0, Position::input}, {}, {}, delay}}});
+
+    const auto bank = m->load_memory_bank(5);
+
+    EXPECT_THAT(bank.name(), StrEq("bank 5"));
+    EXPECT_THAT(bank.amp(), AmpIs(ampSettings));
+    EXPECT_THAT(bank.effects()[3], EffectIs(delay));
+    EXPECT_THAT(amp->current().name(), StrEq("bank 5"));
+}
+
+TEST_F(SimulationTest, settingsChangeDeviceState)
+{
+    connect(ProtocolKind::smallAmpsV1);
+    m->start_amp();
+
+    m->set_amplifier(ampSettings);
+    m->set_effect(delay);
+
+    EXPECT_THAT(amp->current().amp(), AmpIs(ampSettings));
+    EXPECT_THAT(amp->current().effects()[3], EffectIs(delay));
+}
+
+TEST_F(SimulationTest, applyChainReplacesAllEffects)
+{
+    connect(ProtocolKind::smallAmpsV1);
+    m->start_amp();
+    m->set_effect(delay);
+    const fx_pedal_settings overdrive{0, effects::OVERDRIVE, 8, 7, 6, 5, 4, 0, Position::input};
+    const SignalChain chain{"chain", ampSettings, {{overdrive, {1, effects::EMPTY, 0, 0, 0, 0, 0, 0, Position::input}, {2, effects::EMPTY, 0, 0, 0, 0, 0, 0, Position::input}, delay}}};
+
+    m->applyChain(chain);
+
+    EXPECT_THAT(amp->current().effects()[0], EffectIs(overdrive));
+    EXPECT_THAT(amp->current().effects()[3], EffectIs(delay));
+}
+
+TEST_F(SimulationTest, saveOnAmpStoresBank)
+{
+    connect(ProtocolKind::smallAmpsV1);
+    m->start_amp();
+    m->set_amplifier(ampSettings);
+
+    m->save_on_amp("saved", 3);
+
+    EXPECT_THAT(amp->bank(3).name(), StrEq("saved"));
+    EXPECT_THAT(amp->bank(3).amp(), AmpIs(ampSettings));
+    ASSERT_THAT(m->current_state(), Ne(std::nullopt));
+    EXPECT_THAT(m->current_state()->name(), StrEq("saved"));
+}
+
+TEST_F(SimulationTest, unchangedSettingsAreNotSent)
+{
+    connect(ProtocolKind::smallAmpsV1);
+    m->start_amp();
+    m->set_amplifier(ampSettings);
+    const auto sent = amp->packetsReceived();
+
+    m->set_amplifier(ampSettings);
+
+    EXPECT_THAT(amp->packetsReceived(), Eq(sent));
+}
+
+TEST_F(SimulationTest, listenPicksUpChangeOnDevice)
+{
+    connect(ProtocolKind::smallAmpsV1);
+    m->start_amp();
+    bool notified{false};
+    amp->setReceiveListener([&notified] { notified = true; });
+
+    amp->changeAmpOnDevice(ampSettings);
+    m->listen();
+
+    EXPECT_THAT(notified, Eq(true));
+    ASSERT_THAT(m->current_state(), Ne(std::nullopt));
+    EXPECT_THAT(m->current_state()->amp().gain, Eq(ampSettings.gain));
+}
+
+TEST_F(SimulationTest, repliesAreDelayed)
+{
+    using std::chrono::microseconds;
+    connect(ProtocolKind::smallAmpsV1, SimulatedMustang::Timing{microseconds{3000}, microseconds{500}, microseconds{0}, microseconds{0}});
+
+    const auto start = std::chrono::steady_clock::now();
+    m->load_memory_bank(0);
+
+    EXPECT_THAT(std::chrono::steady_clock::now() - start, Ge(microseconds{3000 + 6 * 500}));
+}
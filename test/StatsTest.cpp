@@ -0,0 +1,135 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "com/Stats.h"
+#include <sstream>
+#include <gmock/gmock.h>
+
+using namespace plug::com;
+using namespace testing;
+using namespace std::chrono_literals;
+
+class StatsTest : public testing::Test
+{
+protected:
+    LatencyHistogram histogram;
+    Stats stats;
+};
+
+TEST_F(StatsTest, emptyHistogramReportsZero)
+{
+    EXPECT_THAT(histogram.count(), Eq(0));
+    EXPECT_THAT(histogram.percentile(50.0), Eq(0us));
+    EXPECT_THAT(histogram.max(), Eq(0us));
+}
+
+TEST_F(StatsTest, smallValuesAreExact)
+{
+    for (int i = 1; i <= 50; ++i)
+    {
+        histogram.record(std::chrono::microseconds{i});
+    }
+
+    EXPECT_THAT(histogram.count(), Eq(50));
+    EXPECT_THAT(histogram.percentile(50.0), Eq(25us));
+    EXPECT_THAT(histogram.percentile(100.0), Eq(50us));
+    EXPECT_THAT(histogram.max(), Eq(50us));
+}
+
+TEST_F(StatsTest, percentilesAreWithinPrecision)
+{
+    for (int i = 1; i <= 1000; ++i)
+    {
+        histogram.record(std::chrono::microseconds{i * 100});
+    }
+
+    const auto p50 = static_cast<double>(histogram.percentile(50.0).count());
+    const auto p99 = static_cast<double>(histogram.percentile(99.0).count());
+    EXPECT_THAT(p50, DoubleNear(50'000.0, 50'000.0 * 0.032));
+    EXPECT_THAT(p99, DoubleNear(99'000.0, 99'000.0 * 0.032));
+    EXPECT_THAT(histogram.percentile(100.0), Eq(100'000us));
+}
+
+TEST_F(StatsTest, hugeValuesAreClamped)
+{
+    histogram.record(std::chrono::hours{24 * 365});
+    histogram.record(-1ms);
+
+    EXPECT_THAT(histogram.count(), Eq(2));
+    EXPECT_THAT(histogram.percentile(0.0), Eq(0us));
+    EXPECT_THAT(histogram.percentile(100.0), Eq(histogram.max()));
+}
+
+TEST_F(StatsTest, resetClearsHistogram)
+{
+    histogram.record(5ms);
+    histogram.reset();
+
+    EXPECT_THAT(histogram.count(), Eq(0));
+    EXPECT_THAT(histogram.max(), Eq(0us));
+}
+
+TEST_F(StatsTest, snapshotContainsLatenciesAndCounters)
+{
+    stats.record(Operation::setEffect, 2ms);
+    stats.record(Operation::setEffect, 4ms);
+    stats.add(Counter::sendRetries);
+    stats.add(Counter::bytesSent, 128);
+
+    const auto snapshot = stats.snapshot();
+    EXPECT_THAT(snapshot.latency(Operation::setEffect).count, Eq(2));
+    EXPECT_THAT(snapshot.latency(Operation::setEffect).max, Eq(4000us));
+    EXPECT_THAT(snapshot.latency(Operation::setAmplifier).count, Eq(0));
+    EXPECT_THAT(snapshot.counter(Counter::sendRetries), Eq(1));
+    EXPECT_THAT(snapshot.counter(Counter::bytesSent), Eq(128));
+    EXPECT_THAT(snapshot.counter(Counter::receiveTimeouts), Eq(0));
+}
+
+TEST_F(StatsTest, timerRecordsOnDestruction)
+{
+    {
+        const auto timer = stats.measure(Operation::loadMemoryBank);
+        EXPECT_THAT(stats.snapshot().latency(Operation::loadMemoryBank).count, Eq(0));
+    }
+
+    EXPECT_THAT(stats.snapshot().latency(Operation::loadMemoryBank).count, Eq(1));
+}
+
+TEST_F(StatsTest, resetClearsStats)
+{
+    stats.record(Operation::send, 1ms);
+    stats.add(Counter::errors);
+    stats.reset();
+
+    const auto snapshot = stats.snapshot();
+    EXPECT_THAT(snapshot.latency(Operation::send).count, Eq(0));
+    EXPECT_THAT(snapshot.counter(Counter::errors), Eq(0));
+}
+
+TEST_F(StatsTest, printContainsAllOperationsAndCounters)
+{
+    stats.record(Operation::saveOnAmp, 1500us);
+    std::ostringstream os;
+    os << stats.snapshot();
+
+    EXPECT_THAT(os.str(), HasSubstr("save_on_amp"));
+    EXPECT_THAT(os.str(), HasSubstr("1.500"));
+    EXPECT_THAT(os.str(), HasSubstr("receive timeouts"));
+}
@@ -0,0 +1,147 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "com/MustangUpdater.h"
+#include "com/CommunicationException.h"
+#include "simulator/SimulatedUpdater.h"
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <gmock/gmock.h>
+
+using namespace plug::com;
+using namespace test::simulator;
+using namespace testing;
+
+class UpdaterTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        writeFile(firmware);
+    }
+
+    void TearDown() override
+    {
+        std::remove(file.c_str());
+    }
+
+    void writeFile(const std::vector<std::uint8_t>& content) const
+    {
+        std::vector<std::uint8_t> header(FirmwareImage::firmwareOffset, 0x00);
+        std::copy(date.cbegin(), date.cend(), std::next(header.begin(), FirmwareImage::dateOffset));
+
+        std::ofstream out{file, std::ios::binary | std::ios::trunc};
+        out.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+        out.write(reinterpret_cast<const char*>(content.data()), static_cast<std::streamsize>(content.size()));
+    }
+
+    static std::vector<std::uint8_t> createFirmware(std::size_t size)
+    {
+        std::vector<std::uint8_t> data(size);
+        std::generate(data.begin(), data.end(), [i = 0u]() mutable { return static_cast<std::uint8_t>(i++ * 7); });
+        return data;
+    }
+
+    const std::string file{TempDir() + "/plug-firmware.upd"};
+    const std::string date{"2013-08-27 "};
+    // More than 256 packets, the last one partially filled
+    const std::vector<std::uint8_t> firmware = createFirmware(300 * 56 + 20);
+};
+
+TEST_F(UpdaterTest, imageMapsDateAndFirmware)
+{
+    const FirmwareImage image{file};
+
+    EXPECT_THAT(std::string(image.date(), std::next(image.date(), FirmwareImage::dateSize)), StrEq(date));
+    ASSERT_THAT(image.firmwareSize(), Eq(firmware.size()));
+    EXPECT_THAT(std::vector<std::uint8_t>(image.firmware(), std::next(image.firmware(), static_cast<std::ptrdiff_t>(image.firmwareSize()))), ContainerEq(firmware));
+}
+
+TEST_F(UpdaterTest, imageThrowsOnMissingFile)
+{
+    EXPECT_THROW(FirmwareImage{TempDir() + "/plug-missing.upd"}, std::invalid_argument);
+}
+
+TEST_F(UpdaterTest, imageThrowsIfFileHoldsNoFirmware)
+{
+    writeFile({});
+    EXPECT_THROW(FirmwareImage{file}, std::invalid_argument);
+}
+
+TEST_F(UpdaterTest, updateTransfersWholeImage)
+{
+    const FirmwareImage image{file};
+    SimulatedUpdater amp;
+
+    updateFirmware(amp, image);
+
+    EXPECT_THAT(std::string(amp.date().cbegin(), amp.date().cend()), StrEq(date));
+    EXPECT_THAT(amp.firmware(), ContainerEq(firmware));
+    EXPECT_THAT(amp.countersInSequence(), Eq(true));
+    EXPECT_THAT(amp.finished(), Eq(true));
+}
+
+TEST_F(UpdaterTest, updateDoesNotWaitForReplyToFinished)
+{
+    const FirmwareImage image{file};
+    SimulatedUpdater amp;
+
+    updateFirmware(amp, image);
+
+    const auto reply = amp.receive(packetRawTypeSize);
+    ASSERT_THAT(reply.empty(), Eq(false));
+    EXPECT_THAT(reply[0], Eq(0x04));
+}
+
+TEST_F(UpdaterTest, updateKeepsWindowOfPacketsInFlight)
+{
+    const FirmwareImage image{file};
+    SimulatedUpdater amp{std::chrono::microseconds{100}};
+
+    updateFirmware(amp, image);
+
+    EXPECT_THAT(amp.maxUnacknowledged(), Eq(updateWindowSize));
+}
+
+TEST_F(UpdaterTest, updateReportsProgress)
+{
+    const FirmwareImage image{file};
+    SimulatedUpdater amp;
+    std::vector<UpdateProgress> reported;
+
+    updateFirmware(amp, image, [&reported](const UpdateProgress& progress) { reported.push_back(progress); });
+
+    ASSERT_THAT(reported.size(), Eq(301));
+    EXPECT_THAT(reported.front().bytesSent, Eq(56));
+    EXPECT_THAT(reported.back().bytesSent, Eq(firmware.size()));
+    EXPECT_THAT(reported.back().totalBytes, Eq(firmware.size()));
+    EXPECT_THAT(std::is_sorted(reported.cbegin(), reported.cend(), [](const auto& lhs, const auto& rhs) { return lhs.bytesSent < rhs.bytesSent; }), Eq(true));
+}
+
+TEST_F(UpdaterTest, updateThrowsIfAmpStopsAcknowledging)
+{
+    const FirmwareImage image{file};
+    SimulatedUpdater amp;
+    amp.stopAcknowledgingAfter(10);
+
+    EXPECT_THROW(updateFirmware(amp, image), CommunicationException);
+    EXPECT_THAT(amp.finished(), Eq(false));
+}
@@ -22,12 +22,19 @@
 #include "com/CommunicationException.h"
 #include "mocks/LibUsbMocks.h"
 #include "matcher/Matcher.h"
+#include "matcher/TransferMatcher.h"
+#include <string>
 #include <vector>
 #include <array>
+#include <chrono>
+#include <future>
+#include <thread>
 #include <libusb-1.0/libusb.h>
 #include <gmock/gmock.h>
 
 using plug::com::CommunicationException;
+using plug::com::Counter;
+using plug::com::Operation;
 using plug::com::UsbComm;
 using namespace testing;
 using namespace test::matcher;
@@ -73,7 +80,6 @@ protected:
     static inline constexpr std::uint8_t endpointSend{0x01};
     static inline constexpr std::uint8_t endpointRecv{0x81};
     static inline constexpr int failed{LIBUSB_ERROR_NO_DEVICE};
-    static inline constexpr int errorTimeout{LIBUSB_ERROR_TIMEOUT};
     static inline constexpr std::uint16_t timeout{500};
 };
 
@@ -205,6 +211,37 @@ TEST_F(UsbCommTest, openFirstThrowsIfClaimingInterfaceFailed)
     EXPECT_THROW(comm->openFirst(vid, {pid}), CommunicationException);
 }
 
+TEST_F(UsbCommTest, deviceIdContainsPidAndSerialNumber)
+{
+    const std::string serial{"A1B2"};
+    libusb_device_descriptor descriptor{};
+    descriptor.iSerialNumber = 3;
+    EXPECT_CALL(*usbmock, open_device_with_vid_pid(_, _, _)).WillOnce(Return(&handle));
+    EXPECT_CALL(*usbmock, get_device_descriptor(_, _)).WillOnce(DoAll(SetArgPointee<1>(descriptor), Return(LIBUSB_SUCCESS)));
+    EXPECT_CALL(*usbmock, get_string_descriptor_ascii(&handle, 3, _, _))
+        .WillOnce(DoAll(SetArrayArgument<2>(serial.cbegin(), serial.cend()), Return(static_cast<int>(serial.size()))));
+
+    comm->openFirst(vid, {0x0012});
+    EXPECT_THAT(comm->deviceId(), StrEq("0012-A1B2"));
+}
+
+TEST_F(UsbCommTest, deviceIdContainsPidIfNoSerialNumber)
+{
+    EXPECT_CALL(*usbmock, open_device_with_vid_pid(_, _, _)).WillOnce(Return(&handle));
+    EXPECT_CALL(*usbmock, get_string_descriptor_ascii(_, _, _, _)).Times(0);
+
+    comm->openFirst(vid, {0x0005});
+    EXPECT_THAT(comm->deviceId(), StrEq("0005"));
+}
+
+TEST_F(UsbCommTest, deviceIdIsEmptyIfClosed)
+{
+    setupHandle();
+    ignoreClose();
+    comm->close();
+    EXPECT_THAT(comm->deviceId(), IsEmpty());
+}
+
 TEST_F(UsbCommTest, closeClosesConnection)
 {
     setupHandle();
@@ -253,15 +290,31 @@ TEST_F(UsbCommTest, closeDoesNotReattachDriverIfNoDevice)
     comm->close();
 }
 
+TEST_F(UsbCommTest, openSubmitsReceiveTransfers)
+{
+    setupHandle();
+
+    EXPECT_THAT(mock::transfersInFlight(endpointRecv), Gt(0u));
+}
+
+TEST_F(UsbCommTest, closeCancelsTransfersInFlight)
+{
+    setupHandle();
+    ignoreClose();
+
+    comm->close();
+    EXPECT_THAT(mock::transfersInFlight(endpointRecv), Eq(0u));
+    EXPECT_THAT(mock::transfersInFlight(endpointSend), Eq(0u));
+}
+
 TEST_F(UsbCommTest, interruptWriteTransfersDataVector)
 {
     setupHandle();
 
     const std::vector<std::uint8_t> data{0, 1, 2, 3, 4, 5, 6};
 
-    InSequence s;
-    EXPECT_CALL(*usbmock, interrupt_transfer(&handle, endpointSend, BufferIs(data), data.size(), _, timeout))
-        .WillOnce(DoAll(SetArgPointee<4>(data.size()), Return(0)));
+    EXPECT_CALL(*usbmock, submit_transfer(TransferIs(endpointSend, data, timeout)))
+        .WillOnce(DoAll(mock::CompleteTransfer(LIBUSB_TRANSFER_COMPLETED, data.size()), Return(0)));
 
     const auto n = comm->send(data);
     EXPECT_THAT(n, Eq(data.size()));
@@ -273,9 +326,8 @@ TEST_F(UsbCommTest, interruptWriteTransfersDataArray)
 
     const std::array<std::uint8_t, 4> data{{0, 1, 2, 3}};
 
-    InSequence s;
-    EXPECT_CALL(*usbmock, interrupt_transfer(&handle, endpointSend, BufferIs(data), data.size(), _, timeout))
-        .WillOnce(DoAll(SetArgPointee<4>(data.size()), Return(0)));
+    EXPECT_CALL(*usbmock, submit_transfer(TransferIs(endpointSend, data, timeout)))
+        .WillOnce(DoAll(mock::CompleteTransfer(LIBUSB_TRANSFER_COMPLETED, data.size()), Return(0)));
 
     const auto n = comm->send(data);
     EXPECT_THAT(n, Eq(data.size()));
@@ -285,11 +337,9 @@ TEST_F(UsbCommTest, interruptWriteDoesNothingOnEmptyData)
 {
     setupHandle();
 
-    const std::array<std::uint8_t, 4> data{};
+    const std::vector<std::uint8_t> data{};
 
-    InSequence s;
-    EXPECT_CALL(*usbmock, interrupt_transfer(&handle, endpointSend, BufferIs(data), data.size(), _, timeout))
-        .WillOnce(DoAll(SetArgPointee<4>(data.size()), Return(0)));
+    EXPECT_CALL(*usbmock, submit_transfer(TransferTo(endpointSend))).Times(0);
 
     const auto n = comm->send(data);
     EXPECT_THAT(n, Eq(data.size()));
@@ -300,14 +350,13 @@ TEST_F(UsbCommTest, interruptWriteReturnsActualWrittenOnPartialTransfer)
     setupHandle();
 
     const std::vector<std::uint8_t> data{0, 1, 2, 3, 4, 5, 6};
-    const std::vector<std::uint8_t> partial(data.cbegin(), std::next(data.cbegin(), 4));
+    constexpr std::size_t partialSize{4};
 
-    InSequence s;
-    EXPECT_CALL(*usbmock, interrupt_transfer(&handle, endpointSend, BufferIs(data), data.size(), _, timeout))
-        .WillOnce(DoAll(SetArgPointee<4>(partial.size()), Return(0)));
+    EXPECT_CALL(*usbmock, submit_transfer(TransferIs(endpointSend, data, timeout)))
+        .WillOnce(DoAll(mock::CompleteTransfer(LIBUSB_TRANSFER_COMPLETED, partialSize), Return(0)));
 
     const auto n = comm->send(data);
-    EXPECT_THAT(n, Eq(partial.size()));
+    EXPECT_THAT(n, Eq(partialSize));
 }
 
 TEST_F(UsbCommTest, interruptWriteThrowsOnTransferError)
@@ -316,13 +365,129 @@ TEST_F(UsbCommTest, interruptWriteThrowsOnTransferError)
 
     const std::array<std::uint8_t, 4> data{{0, 1, 2, 3}};
 
-    InSequence s;
-    EXPECT_CALL(*usbmock, interrupt_transfer(&handle, endpointSend, BufferIs(data), data.size(), _, timeout))
-        .WillOnce(DoAll(SetArgPointee<4>(data.size()), Return(failed)));
+    EXPECT_CALL(*usbmock, submit_transfer(TransferIs(endpointSend, data, timeout)))
+        .WillOnce(DoAll(mock::CompleteTransfer(LIBUSB_TRANSFER_ERROR, 0), Return(0)));
 
     EXPECT_THROW(comm->send(data), CommunicationException);
 }
 
+TEST_F(UsbCommTest, interruptWriteThrowsOnSubmitError)
+{
+    setupHandle();
+
+    const std::array<std::uint8_t, 4> data{{0, 1, 2, 3}};
+
+    EXPECT_CALL(*usbmock, submit_transfer(TransferTo(endpointSend))).WillOnce(Return(failed));
+
+    EXPECT_THROW(comm->send(data), CommunicationException);
+}
+
+TEST_F(UsbCommTest, interruptWriteRetriesOnTimeout)
+{
+    setupHandle();
+
+    const std::array<std::uint8_t, 4> data{{0, 1, 2, 3}};
+
+    EXPECT_CALL(*usbmock, submit_transfer(TransferIs(endpointSend, data, timeout)))
+        .WillOnce(DoAll(mock::CompleteTransfer(LIBUSB_TRANSFER_TIMED_OUT, 0), Return(0)))
+        .WillOnce(DoAll(mock::CompleteTransfer(LIBUSB_TRANSFER_COMPLETED, data.size()), Return(0)));
+
+    const auto n = comm->send(data);
+    EXPECT_THAT(n, Eq(data.size()));
+}
+
+TEST_F(UsbCommTest, statsCountSentPacketsAndRetries)
+{
+    setupHandle();
+
+    const std::array<std::uint8_t, 4> data{{0, 1, 2, 3}};
+
+    EXPECT_CALL(*usbmock, submit_transfer(TransferIs(endpointSend, data, timeout)))
+        .WillOnce(DoAll(mock::CompleteTransfer(LIBUSB_TRANSFER_TIMED_OUT, 0), Return(0)))
+        .WillOnce(DoAll(mock::CompleteTransfer(LIBUSB_TRANSFER_COMPLETED, data.size()), Return(0)));
+
+    comm->send(data);
+
+    const auto snapshot = comm->stats()->snapshot();
+    EXPECT_THAT(snapshot.counter(Counter::sendRetries), Eq(1));
+    EXPECT_THAT(snapshot.counter(Counter::packetsSent), Eq(1));
+    EXPECT_THAT(snapshot.counter(Counter::bytesSent), Eq(data.size()));
+    EXPECT_THAT(snapshot.latency(Operation::send).count, Eq(1));
+}
+
+TEST_F(UsbCommTest, interruptWriteAsyncCompletesLater)
+{
+    setupHandle();
+
+    const std::array<std::uint8_t, 4> data{{0, 1, 2, 3}};
+
+    auto result = comm->sendAsync(data);
+    EXPECT_THAT(result.wait_for(std::chrono::milliseconds{0}), Eq(std::future_status::timeout));
+
+    EXPECT_TRUE(mock::completeTransfer(endpointSend, LIBUSB_TRANSFER_COMPLETED, {data.cbegin(), data.cend()}));
+    EXPECT_THAT(result.get(), Eq(data.size()));
+}
+
+TEST_F(UsbCommTest, interruptWriteAsyncPipelinesPackets)
+{
+    setupHandle();
+
+    const std::array<std::uint8_t, 4> data0{{0, 1, 2, 3}};
+    const std::array<std::uint8_t, 2> data1{{4, 5}};
+
+    auto result0 = comm->sendAsync(data0);
+    auto result1 = comm->sendAsync(data1);
+    EXPECT_THAT(mock::transfersInFlight(endpointSend), Eq(2u));
+
+    EXPECT_TRUE(mock::completeTransfer(endpointSend, LIBUSB_TRANSFER_COMPLETED, {data0.cbegin(), data0.cend()}));
+    EXPECT_TRUE(mock::completeTransfer(endpointSend, LIBUSB_TRANSFER_COMPLETED, {data1.cbegin(), data1.cend()}));
+    EXPECT_THAT(result0.get(), Eq(data0.size()));
+    EXPECT_THAT(result1.get(), Eq(data1.size()));
+}
+
+TEST_F(UsbCommTest, sendQueuedReportsFailureOnWaitSent)
+{
+    setupHandle();
+
+    const std::array<std::uint8_t, 4> data{{0, 1, 2, 3}};
+
+    comm->sendQueued(data);
+    comm->sendQueued(data);
+    EXPECT_TRUE(mock::completeTransfer(endpointSend, LIBUSB_TRANSFER_ERROR));
+    EXPECT_TRUE(mock::completeTransfer(endpointSend, LIBUSB_TRANSFER_COMPLETED, {data.cbegin(), data.cend()}));
+
+    EXPECT_THROW(comm->waitSent(), CommunicationException);
+    EXPECT_NO_THROW(comm->waitSent());
+}
+
+TEST_F(UsbCommTest, receiveIntoCopiesPacket)
+{
+    setupHandle();
+
+    const std::vector<std::uint8_t> data{0, 1, 2, 3, 4, 5, 6};
+    std::array<std::uint8_t, 64> buffer{{}};
+    EXPECT_TRUE(mock::completeTransfer(endpointRecv, LIBUSB_TRANSFER_COMPLETED, data));
+
+    EXPECT_THAT(comm->receiveInto(buffer), Eq(data.size()));
+    EXPECT_TRUE(std::equal(data.cbegin(), data.cend(), buffer.cbegin()));
+}
+
+TEST_F(UsbCommTest, receiveIntoWaitsForPacket)
+{
+    setupHandle();
+
+    const std::vector<std::uint8_t> data{7, 8, 9};
+    std::array<std::uint8_t, 64> buffer{{}};
+    auto delivery = std::async(std::launch::async, [&data] {
+        std::this_thread::sleep_for(std::chrono::milliseconds{20});
+        return mock::completeTransfer(endpointRecv, LIBUSB_TRANSFER_COMPLETED, data);
+    });
+
+    EXPECT_THAT(comm->receiveInto(buffer), Eq(data.size()));
+    EXPECT_TRUE(delivery.get());
+    EXPECT_THAT(buffer[0], Eq(7));
+}
+
 TEST_F(UsbCommTest, interruptReadReceivesData)
 {
     setupHandle();
@@ -330,24 +495,84 @@ TEST_F(UsbCommTest, interruptReadReceivesData)
     const std::vector<std::uint8_t> data{0, 1, 2, 3, 4, 5, 6};
     const std::size_t readSize = data.size();
 
-    InSequence s;
-    EXPECT_CALL(*usbmock, interrupt_transfer(&handle, endpointRecv, _, data.size(), _, timeout))
-        .WillOnce(DoAll(SetArrayArgument<2>(data.cbegin(), data.cend()), SetArgPointee<4>(readSize), Return(0)));
+    EXPECT_TRUE(mock::completeTransfer(endpointRecv, LIBUSB_TRANSFER_COMPLETED, data));
 
     const auto buffer = comm->receive(readSize);
     EXPECT_THAT(buffer, ContainerEq(data));
 }
 
-TEST_F(UsbCommTest, interruptReadReturnsEmptyContainerIfReceiveSizeIsEmpty)
+TEST_F(UsbCommTest, interruptReadReceivesDataInOrder)
 {
     setupHandle();
 
-    const std::vector<std::uint8_t> data{};
-    const std::size_t readSize = data.size();
+    const std::vector<std::uint8_t> data0{0, 1, 2};
+    const std::vector<std::uint8_t> data1{3, 4, 5};
 
-    InSequence s;
-    EXPECT_CALL(*usbmock, interrupt_transfer(&handle, endpointRecv, _, data.size(), _, timeout))
-        .WillOnce(DoAll(SetArrayArgument<2>(data.cbegin(), data.cend()), SetArgPointee<4>(readSize), Return(0)));
+    auto buffer0 = comm->receiveAsync(data0.size());
+    EXPECT_TRUE(mock::completeTransfer(endpointRecv, LIBUSB_TRANSFER_COMPLETED, data0));
+    EXPECT_TRUE(mock::completeTransfer(endpointRecv, LIBUSB_TRANSFER_COMPLETED, data1));
+
+    EXPECT_THAT(buffer0.get(), ContainerEq(data0));
+    EXPECT_THAT(comm->receive(data1.size()), ContainerEq(data1));
+}
+
+TEST_F(UsbCommTest, discardReceivedDropsQueuedPackets)
+{
+    setupHandle();
+
+    const std::vector<std::uint8_t> stale{0, 1, 2};
+    const std::vector<std::uint8_t> data{3, 4, 5};
+
+    EXPECT_TRUE(mock::completeTransfer(endpointRecv, LIBUSB_TRANSFER_COMPLETED, stale));
+    comm->discardReceived();
+    EXPECT_TRUE(mock::completeTransfer(endpointRecv, LIBUSB_TRANSFER_COMPLETED, data));
+
+    EXPECT_THAT(comm->receive(data.size()), ContainerEq(data));
+}
+
+TEST_F(UsbCommTest, takeReceivedReturnsQueuedPackets)
+{
+    setupHandle();
+
+    const std::vector<std::uint8_t> data0{0, 1, 2};
+    const std::vector<std::uint8_t> data1{3, 4, 5};
+
+    EXPECT_TRUE(mock::completeTransfer(endpointRecv, LIBUSB_TRANSFER_COMPLETED, data0));
+    EXPECT_TRUE(mock::completeTransfer(endpointRecv, LIBUSB_TRANSFER_COMPLETED, data1));
+
+    EXPECT_THAT(comm->takeReceived(), ElementsAre(ContainerEq(data0), ContainerEq(data1)));
+    EXPECT_THAT(comm->takeReceived(), IsEmpty());
+}
+
+TEST_F(UsbCommTest, receiveListenerIsNotifiedOfUnrequestedPackets)
+{
+    std::size_t notified{0};
+    comm->setReceiveListener([&notified] { ++notified; });
+    setupHandle();
+
+    const std::vector<std::uint8_t> data{0, 1, 2};
+    auto reply = comm->receiveAsync(data.size());
+    EXPECT_TRUE(mock::completeTransfer(endpointRecv, LIBUSB_TRANSFER_COMPLETED, data));
+    EXPECT_THAT(notified, Eq(0));
+
+    EXPECT_TRUE(mock::completeTransfer(endpointRecv, LIBUSB_TRANSFER_COMPLETED, data));
+    EXPECT_THAT(notified, Eq(1));
+    EXPECT_THAT(reply.get(), ContainerEq(data));
+}
+
+TEST_F(UsbCommTest, interruptReadResubmitsReceiveTransfer)
+{
+    setupHandle();
+
+    const auto inFlight = mock::transfersInFlight(endpointRecv);
+    EXPECT_TRUE(mock::completeTransfer(endpointRecv, LIBUSB_TRANSFER_COMPLETED, {0, 1}));
+
+    EXPECT_THAT(mock::transfersInFlight(endpointRecv), Eq(inFlight));
+}
+
+TEST_F(UsbCommTest, interruptReadReturnsEmptyContainerIfReceiveSizeIsEmpty)
+{
+    setupHandle();
 
     const auto buffer = comm->receive(0);
     EXPECT_THAT(buffer, IsEmpty());
@@ -362,9 +587,7 @@ TEST_F(UsbCommTest, interruptReadResizesBufferOnPartialTransfer)
     const std::size_t readSize = data.size();
     constexpr std::size_t actualSize{4};
 
-    InSequence s;
-    EXPECT_CALL(*usbmock, interrupt_transfer(&handle, endpointRecv, _, data.size(), _, timeout))
-        .WillOnce(DoAll(SetArrayArgument<2>(data.cbegin(), std::next(data.cbegin(), actualSize)), SetArgPointee<4>(actualSize), Return(0)));
+    EXPECT_TRUE(mock::completeTransfer(endpointRecv, LIBUSB_TRANSFER_COMPLETED, {data.cbegin(), std::next(data.cbegin(), actualSize)}));
 
     const auto buffer = comm->receive(readSize);
     EXPECT_THAT(buffer, ContainerEq(expected));
@@ -374,26 +597,48 @@ TEST_F(UsbCommTest, interruptReceiveThrowsOnTransferError)
 {
     setupHandle();
 
-    const std::array<std::uint8_t, 4> data{{0, 1, 2, 3}};
+    EXPECT_TRUE(mock::completeTransfer(endpointRecv, LIBUSB_TRANSFER_ERROR));
 
-    InSequence s;
-    EXPECT_CALL(*usbmock, interrupt_transfer(&handle, endpointRecv, _, data.size(), _, timeout))
-        .WillOnce(DoAll(SetArrayArgument<2>(data.cbegin(), data.cend()), SetArgPointee<4>(data.size()), Return(failed)));
-
-    EXPECT_THROW(comm->receive(data.size()), CommunicationException);
+    EXPECT_THROW(comm->receive(4), CommunicationException);
 }
 
 TEST_F(UsbCommTest, interruptReceiveAcceptsTimeoutAndReturnsEmpty)
 {
     setupHandle();
 
-    const std::array<std::uint8_t, 4> data{{0, 1, 2, 3}};
-    constexpr std::size_t readSize{0};
+    const auto buffer = comm->receive(4);
+    EXPECT_THAT(buffer, IsEmpty());
+}
 
-    InSequence s;
-    EXPECT_CALL(*usbmock, interrupt_transfer(&handle, endpointRecv, _, data.size(), _, timeout))
-        .WillOnce(DoAll(SetArrayArgument<2>(data.cbegin(), data.cend()), SetArgPointee<4>(readSize), Return(errorTimeout)));
+TEST_F(UsbCommTest, statsCountReceivedPacketsAndTimeouts)
+{
+    setupHandle();
 
-    const auto buffer = comm->receive(data.size());
-    EXPECT_THAT(buffer, IsEmpty());
+    const std::vector<std::uint8_t> data{0, 1, 2};
+    EXPECT_TRUE(mock::completeTransfer(endpointRecv, LIBUSB_TRANSFER_COMPLETED, data));
+    comm->receive(data.size());
+    comm->receive(data.size());
+
+    const auto snapshot = comm->stats()->snapshot();
+    EXPECT_THAT(snapshot.counter(Counter::packetsReceived), Eq(1));
+    EXPECT_THAT(snapshot.counter(Counter::bytesReceived), Eq(data.size()));
+    EXPECT_THAT(snapshot.counter(Counter::receiveTimeouts), Eq(1));
+}
+
+TEST_F(UsbCommTest, statsSkipLatencyOfPacketsAlreadyReceived)
+{
+    setupHandle();
+
+    const std::vector<std::uint8_t> data{0, 1, 2};
+    EXPECT_TRUE(mock::completeTransfer(endpointRecv, LIBUSB_TRANSFER_COMPLETED, data));
+    comm->receive(data.size());
+
+    EXPECT_THAT(comm->stats()->snapshot().latency(Operation::receive).count, Eq(0));
+}
+
+TEST_F(UsbCommTest, sendThrowsIfNotOpen)
+{
+    const std::array<std::uint8_t, 4> data{{0, 1, 2, 3}};
+
+    EXPECT_THROW(comm->send(data), CommunicationException);
 }
@@ -0,0 +1,83 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "com/PacketSerializer.h"
+#include "com/IdLookup.h"
+#include <benchmark/benchmark.h>
+
+using namespace plug;
+using namespace plug::com;
+
+static void decodeBank(benchmark::State& state)
+{
+    amp_settings amp{};
+    amp.amp_num = amps::BRITTISH_COLOUR;
+    amp.cabinet = cabinets::cab4x12G;
+    const auto ampPacket = serializeAmpSettings(amp).getBytes();
+    const auto usbGainPacket = serializeAmpSettingsUsbGain(amp).getBytes();
+
+    constexpr std::array<effects, 4> models{{effects::BIG_FUZZ, effects::DIATONIC_PITCH_SHIFT, effects::STEREO_TAPE_DELAY, effects::FENDER_65_SPRING_REVERB}};
+    std::array<PacketRawType, 4> effectPackets{};
+
+    for (std::uint8_t i = 0; i < models.size(); ++i)
+    {
+        fx_pedal_settings effect{};
+        effect.fx_slot = i;
+        effect.effect_num = models[i];
+        effectPackets[i] = serializeEffectSettings(effect).getBytes();
+    }
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(decodeAmpFromData(PacketView<AmpPayload>{ampPacket}, PacketView<AmpPayload>{usbGainPacket}));
+        benchmark::DoNotOptimize(decodeEffectsFromData({{PacketView<EffectPayload>{effectPackets[0]}, PacketView<EffectPayload>{effectPackets[1]},
+                                                         PacketView<EffectPayload>{effectPackets[2]}, PacketView<EffectPayload>{effectPackets[3]}}}));
+    }
+}
+BENCHMARK(decodeBank);
+
+static void decodePresetList(benchmark::State& state)
+{
+    std::vector<PacketRawType> packets(200);
+
+    for (std::size_t i = 0; i < packets.size(); i += 2)
+    {
+        packets[i] = serializeName(static_cast<std::uint8_t>(i / 2), "preset " + std::to_string(i / 2)).getBytes();
+    }
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(decodePresetListFromData(packets, packets.size()));
+    }
+}
+BENCHMARK(decodePresetList);
+
+// Every possible id, most of them invalid, as found in damaged files
+static void findEffectByAnyId(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        for (std::uint32_t id = 0; id <= 0xffff; ++id)
+        {
+            benchmark::DoNotOptimize(findEffectById(id));
+        }
+    }
+}
+BENCHMARK(findEffectByAnyId);
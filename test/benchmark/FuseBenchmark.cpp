@@ -0,0 +1,213 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fuse/FuseFile.h"
+#include "fuse/PresetIndex.h"
+#include "com/ModelTable.h"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace plug;
+using namespace plug::fuse;
+
+namespace
+{
+    std::string readFile(const std::string& name)
+    {
+        std::ifstream file{std::string{PLUG_TEST_DIR} + "/" + name, std::ios::binary};
+        std::ostringstream content;
+        content << file.rdbuf();
+        return content.str();
+    }
+
+    // The files shipped for the tests, followed by generated presets using
+    // every amp and effect model
+    const std::vector<std::string>& corpus()
+    {
+        static const std::vector<std::string> documents = [] {
+            constexpr std::size_t size{4096};
+            std::vector<std::string> result{readFile("zachary-volt-queen.fuse"), readFile("zachary-volt-21st-century-breakdown.fuse"),
+                                            readFile("yakitori-floyd-phaser.fuse"), readFile("wipika-white-stripes-v2.fuse")};
+
+            for (std::size_t i = result.size(); i < size; ++i)
+            {
+                const auto knob = static_cast<std::uint8_t>(i);
+                amp_settings amp{};
+                amp.amp_num = com::ampDescriptors[i % com::ampDescriptors.size()].amp;
+                amp.cabinet = com::cabinetDescriptors[i % com::cabinetDescriptors.size()].cabinet;
+                amp.volume = knob;
+                amp.gain = static_cast<std::uint8_t>(knob * 3);
+                amp.usb_gain = static_cast<std::uint8_t>(knob / 2);
+
+                std::array<fx_pedal_settings, 4> effectList{{}};
+
+                for (std::uint8_t slot = 0; slot < effectList.size(); ++slot)
+                {
+                    const auto model = com::effectDescriptors[(i + slot * 11) % com::effectDescriptors.size()].effect;
+                    effectList[slot] = fx_pedal_settings{slot, model, knob, static_cast<std::uint8_t>(knob + 1), 0x80, 0xff, slot, knob, (slot > 1 ? Position::effectsLoop : Position::input)};
+                }
+
+                std::string document;
+                writePreset(document, Preset{SignalChain{"Generated preset " + std::to_string(i), amp, effectList}, "plug benchmark"});
+                result.push_back(std::move(document));
+            }
+            return result;
+        }();
+        return documents;
+    }
+
+    // The corpus as files in a temporary directory
+    class Library
+    {
+    public:
+        Library()
+        {
+            std::string name{"/tmp/plug-library-XXXXXX"};
+
+            if (mkdtemp(name.data()) == nullptr)
+            {
+                throw std::runtime_error{"Can't create library directory"};
+            }
+            directory = name;
+            indexFile = directory + ".index";
+
+            for (std::size_t i = 0; i < corpus().size(); ++i)
+            {
+                files.push_back(directory + "/preset-" + std::to_string(i) + ".fuse");
+                std::ofstream{files.back(), std::ios::binary} << corpus()[i];
+            }
+        }
+
+        ~Library()
+        {
+            std::for_each(files.cbegin(), files.cend(), [](const auto& file) { std::remove(file.c_str()); });
+            std::remove(indexFile.c_str());
+            rmdir(directory.c_str());
+        }
+
+        std::string directory;
+        std::string indexFile;
+        std::vector<std::string> files;
+    };
+
+    const Library& library()
+    {
+        static const Library instance;
+        return instance;
+    }
+
+    std::size_t corpusBytes()
+    {
+        return std::accumulate(corpus().cbegin(), corpus().cend(), std::size_t{0}, [](std::size_t sum, const auto& document) { return sum + document.size(); });
+    }
+}
+
+static void parseFuseCorpus(benchmark::State& state)
+{
+    const auto& documents = corpus();
+
+    for (auto _ : state)
+    {
+        for (const auto& document : documents)
+        {
+            benchmark::DoNotOptimize(parsePreset(document));
+        }
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * corpusBytes()));
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * documents.size()));
+}
+BENCHMARK(parseFuseCorpus)->Unit(benchmark::kMillisecond);
+
+static void writeFuseCorpus(benchmark::State& state)
+{
+    std::vector<Preset> presets;
+    std::transform(corpus().cbegin(), corpus().cend(), std::back_inserter(presets), [](const auto& document) { return parsePreset(document); });
+    std::string out;
+    std::size_t bytes{0};
+
+    for (auto _ : state)
+    {
+        out.clear();
+        std::for_each(presets.cbegin(), presets.cend(), [&out](const auto& preset) { writePreset(out, preset); });
+        benchmark::DoNotOptimize(out.data());
+        bytes += out.size();
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(bytes));
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * presets.size()));
+}
+BENCHMARK(writeFuseCorpus)->Unit(benchmark::kMillisecond);
+
+static void indexLibrary(benchmark::State& state)
+{
+    const auto& files = library();
+
+    for (auto _ : state)
+    {
+        PresetIndex index{files.directory, files.indexFile};
+        benchmark::DoNotOptimize(index.refresh(static_cast<std::size_t>(state.range(0))));
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * files.files.size()));
+}
+BENCHMARK(indexLibrary)->Arg(1)->Arg(4)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void openIndexedLibrary(benchmark::State& state)
+{
+    const auto& files = library();
+    PresetIndex stored{files.directory, files.indexFile};
+    stored.refresh();
+    stored.store();
+
+    for (auto _ : state)
+    {
+        PresetIndex index{files.directory, files.indexFile};
+        index.load();
+        benchmark::DoNotOptimize(index.refresh());
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * files.files.size()));
+}
+BENCHMARK(openIndexedLibrary)->Unit(benchmark::kMillisecond);
+
+static void updateChangedPreset(benchmark::State& state)
+{
+    const auto& files = library();
+    PresetIndex index{files.directory, files.indexFile};
+    index.refresh();
+    const std::vector<std::string> changed{"preset-0.fuse"};
+    std::size_t i{0};
+
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        std::ofstream{files.files[0], std::ios::binary | std::ios::trunc} << corpus()[++i % corpus().size()];
+        state.ResumeTiming();
+        benchmark::DoNotOptimize(index.update(changed));
+    }
+
+    std::ofstream{files.files[0], std::ios::binary | std::ios::trunc} << corpus()[0];
+}
+BENCHMARK(updateChangedPreset)->Unit(benchmark::kMicrosecond);
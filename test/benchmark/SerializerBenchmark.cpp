@@ -0,0 +1,62 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "com/PacketSerializer.h"
+#include "com/ModelTable.h"
+#include <benchmark/benchmark.h>
+
+using namespace plug;
+using namespace plug::com;
+
+// Run once per model; the timings should not depend on the model
+static void serializeEffect(benchmark::State& state)
+{
+    fx_pedal_settings settings{};
+    settings.fx_slot = 1;
+    settings.effect_num = static_cast<effects>(state.range(0));
+    settings.knob1 = 0x11;
+    settings.knob2 = 0x22;
+    settings.knob3 = 0x33;
+    settings.knob4 = 0x44;
+    settings.knob5 = 0x55;
+    settings.knob6 = 0x66;
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(serializeEffectSettings(settings));
+    }
+}
+BENCHMARK(serializeEffect)->DenseRange(0, effectDescriptors.size() - 1);
+
+static void serializeAmp(benchmark::State& state)
+{
+    amp_settings settings{};
+    settings.amp_num = static_cast<amps>(state.range(0));
+    settings.gain = 0x10;
+    settings.volume = 0x20;
+    settings.noise_gate = 0x05;
+    settings.threshold = 0x04;
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(serializeAmpSettings(settings));
+    }
+}
+BENCHMARK(serializeAmp)->DenseRange(0, ampDescriptors.size() - 1);
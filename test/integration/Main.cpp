@@ -27,8 +27,9 @@ int main()
 {
     std::cout << " === Plug v" << plug::version() << " - Integrationtest ===\n\n";
 
-    plug::com::Mustang m{plug::com::createUsbConnection()};
-    const auto initialData = m.start_amp();
+    const auto device = plug::com::openUsbDevice();
+    const auto m = plug::com::createMustang(device.connection, device.protocol);
+    const auto initialData = m->start_amp();
 
     return 0;
 }
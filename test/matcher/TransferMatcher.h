@@ -3,7 +3,6 @@
  *        Linux replacement for Fender FUSE software
  *
  * Copyright (C) 2017-2020  offa
- * Copyright (C) 2010-2016  piorekf <piorek@piorekf.org>
  *
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -21,31 +20,18 @@
 
 #pragma once
 
-#include "data_structs.h"
-#include "effects_enum.h"
-#include <QFile>
-#include <QTextEdit>
-#include <QXmlStreamReader>
-#include <memory>
+#include <libusb-1.0/libusb.h>
+#include <gmock/gmock.h>
 
-namespace plug
+namespace test::matcher
 {
-
-    class LoadFromFile
+    MATCHER_P(TransferTo, endpoint, "")
     {
-    public:
-        LoadFromFile(QFile* file, QString* name, amp_settings* amp_settings, fx_pedal_settings fx_settings[4]);
-
-        void loadfile();
+        return arg->endpoint == endpoint;
+    }
 
-    private:
-        QString* m_name;
-        amp_settings* m_amp_settings;
-        fx_pedal_settings* m_fx_settings;
-        const std::unique_ptr<QXmlStreamReader> m_xml;
-
-        void parseAmp();
-        void parseFX();
-        void parseFUSE();
-    };
+    MATCHER_P3(TransferIs, endpoint, expected, timeout, "")
+    {
+        return (arg->endpoint == endpoint) && (arg->timeout == timeout) && (static_cast<std::size_t>(arg->length) == expected.size()) && std::equal(expected.cbegin(), expected.cend(), arg->buffer);
+    }
 }
@@ -19,11 +19,65 @@
  */
 
 #include "LibUsbMocks.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <mutex>
 #include <stdexcept>
+#include <thread>
 
 namespace mock
 {
     static std::unique_ptr<UsbMock> usbmock;
+    static std::deque<libusb_transfer*> submitted;
+    static std::mutex submittedMutex;
+
+
+    namespace
+    {
+        int submit(libusb_transfer* transfer)
+        {
+            std::lock_guard<std::mutex> lock{submittedMutex};
+            submitted.push_back(transfer);
+            return LIBUSB_SUCCESS;
+        }
+
+        libusb_transfer* takeSubmitted(std::function<bool(libusb_transfer*)> pred)
+        {
+            std::lock_guard<std::mutex> lock{submittedMutex};
+            const auto itr = std::find_if(submitted.begin(), submitted.end(), pred);
+
+            if (itr == submitted.end())
+            {
+                return nullptr;
+            }
+
+            auto transfer = *itr;
+            submitted.erase(itr);
+            return transfer;
+        }
+
+        int cancel(libusb_transfer* transfer)
+        {
+            if (takeSubmitted([transfer](auto* t) { return t == transfer; }) == nullptr)
+            {
+                return LIBUSB_ERROR_NOT_FOUND;
+            }
+
+            transfer->status = LIBUSB_TRANSFER_CANCELLED;
+            transfer->actual_length = 0;
+            transfer->callback(transfer);
+            return LIBUSB_SUCCESS;
+        }
+
+        int handleEvents(libusb_context*, timeval*, int*)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+            return LIBUSB_SUCCESS;
+        }
+    }
 
 
     UsbMock* getUsbMock()
@@ -37,7 +91,13 @@ namespace mock
 
     UsbMock* resetUsbMock()
     {
-        usbmock = std::make_unique<UsbMock>();
+        using namespace testing;
+
+        clearUsbMock();
+        usbmock = std::make_unique<NiceMock<UsbMock>>();
+        ON_CALL(*usbmock, submit_transfer(_)).WillByDefault(Invoke(submit));
+        ON_CALL(*usbmock, cancel_transfer(_)).WillByDefault(Invoke(cancel));
+        ON_CALL(*usbmock, handle_events_timeout_completed(_, _, _)).WillByDefault(Invoke(handleEvents));
         return getUsbMock();
     }
 
@@ -45,6 +105,32 @@ namespace mock
     void clearUsbMock()
     {
         usbmock.reset();
+
+        std::lock_guard<std::mutex> lock{submittedMutex};
+        submitted.clear();
+    }
+
+    bool completeTransfer(unsigned char endpoint, libusb_transfer_status status, const std::vector<std::uint8_t>& data)
+    {
+        auto transfer = takeSubmitted([endpoint](auto* t) { return t->endpoint == endpoint; });
+
+        if (transfer == nullptr)
+        {
+            return false;
+        }
+
+        const auto size = std::min(data.size(), static_cast<std::size_t>(transfer->length));
+        std::copy_n(data.cbegin(), size, transfer->buffer);
+        transfer->actual_length = static_cast<int>(size);
+        transfer->status = status;
+        transfer->callback(transfer);
+        return true;
+    }
+
+    std::size_t transfersInFlight(unsigned char endpoint)
+    {
+        std::lock_guard<std::mutex> lock{submittedMutex};
+        return static_cast<std::size_t>(std::count_if(submitted.cbegin(), submitted.cend(), [endpoint](auto* t) { return t->endpoint == endpoint; }));
     }
 }
 
@@ -66,6 +152,21 @@ extern "C"
         return mock::getUsbMock()->open_device_with_vid_pid(ctx, vendor_id, product_id);
     }
 
+    libusb_device* libusb_get_device(libusb_device_handle* dev_handle)
+    {
+        return mock::getUsbMock()->get_device(dev_handle);
+    }
+
+    int libusb_get_device_descriptor(libusb_device* dev, libusb_device_descriptor* desc)
+    {
+        return mock::getUsbMock()->get_device_descriptor(dev, desc);
+    }
+
+    int libusb_get_string_descriptor_ascii(libusb_device_handle* dev_handle, uint8_t desc_index, unsigned char* data, int length)
+    {
+        return mock::getUsbMock()->get_string_descriptor_ascii(dev_handle, desc_index, data, length);
+    }
+
     int libusb_interrupt_transfer(libusb_device_handle* dev_handle, unsigned char endpoint,
                                   unsigned char* data, int length, int* actual_length, unsigned int timeout)
     {
@@ -101,4 +202,29 @@ extern "C"
     {
         mock::getUsbMock()->close(dev_handle);
     }
+
+    libusb_transfer* libusb_alloc_transfer(int iso_packets)
+    {
+        return static_cast<libusb_transfer*>(std::calloc(1, sizeof(libusb_transfer) + static_cast<std::size_t>(iso_packets) * sizeof(libusb_iso_packet_descriptor)));
+    }
+
+    void libusb_free_transfer(libusb_transfer* transfer)
+    {
+        std::free(transfer);
+    }
+
+    int libusb_submit_transfer(libusb_transfer* transfer)
+    {
+        return mock::getUsbMock()->submit_transfer(transfer);
+    }
+
+    int libusb_cancel_transfer(libusb_transfer* transfer)
+    {
+        return mock::getUsbMock()->cancel_transfer(transfer);
+    }
+
+    int libusb_handle_events_timeout_completed(libusb_context* ctx, timeval* tv, int* completed)
+    {
+        return mock::getUsbMock()->handle_events_timeout_completed(ctx, tv, completed);
+    }
 }
@@ -22,6 +22,8 @@
 
 #include <gmock/gmock.h>
 #include <libusb-1.0/libusb.h>
+#include <vector>
+#include <cstdint>
 
 namespace mock
 {
@@ -31,6 +33,9 @@ namespace mock
         MOCK_METHOD1(init, int(libusb_context**));
         MOCK_METHOD1(close, void(libusb_device_handle*));
         MOCK_METHOD3(open_device_with_vid_pid, libusb_device_handle*(libusb_context*, uint16_t, uint16_t));
+        MOCK_METHOD1(get_device, libusb_device*(libusb_device_handle*));
+        MOCK_METHOD2(get_device_descriptor, int(libusb_device*, libusb_device_descriptor*));
+        MOCK_METHOD4(get_string_descriptor_ascii, int(libusb_device_handle*, uint8_t, unsigned char*, int));
         MOCK_METHOD1(exit, void(libusb_context*));
         MOCK_METHOD2(release_interface, int(libusb_device_handle*, int));
         MOCK_METHOD2(kernel_driver_active, int(libusb_device_handle*, int));
@@ -38,11 +43,27 @@ namespace mock
         MOCK_METHOD2(attach_kernel_driver, int(libusb_device_handle*, int));
         MOCK_METHOD6(interrupt_transfer, int(libusb_device_handle*, unsigned char, unsigned char*, int, int*, unsigned int));
         MOCK_METHOD2(claim_interface, int(libusb_device_handle*, int));
+        MOCK_METHOD1(submit_transfer, int(libusb_transfer*));
+        MOCK_METHOD1(cancel_transfer, int(libusb_transfer*));
+        MOCK_METHOD3(handle_events_timeout_completed, int(libusb_context*, timeval*, int*));
     };
 
     UsbMock* getUsbMock();
     UsbMock* resetUsbMock();
     void clearUsbMock();
+
+    // Completes the oldest transfer submitted to the endpoint, like libusb
+    // does when handling events. Returns false if none is in flight.
+    bool completeTransfer(unsigned char endpoint, libusb_transfer_status status, const std::vector<std::uint8_t>& data = {});
+    std::size_t transfersInFlight(unsigned char endpoint);
+
+
+    ACTION_P2(CompleteTransfer, status, size)
+    {
+        arg0->status = status;
+        arg0->actual_length = static_cast<int>(size);
+        arg0->callback(arg0);
+    }
 }
 
 
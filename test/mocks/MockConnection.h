@@ -37,6 +37,8 @@ namespace mock
         MOCK_METHOD0(close, void());
         MOCK_CONST_METHOD0(isOpen, bool());
         MOCK_METHOD1(receive, std::vector<std::uint8_t>(std::size_t));
-        MOCK_METHOD2(sendImpl, std::size_t(std::uint8_t*, std::size_t));
+        MOCK_METHOD0(takeReceived, std::vector<std::vector<std::uint8_t>>());
+        MOCK_METHOD2(sendImpl, std::size_t(const std::uint8_t*, std::size_t));
+        MOCK_METHOD3(receiveWithinImpl, std::size_t(std::uint8_t*, std::size_t, std::chrono::milliseconds));
     };
 }
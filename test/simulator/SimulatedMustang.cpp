@@ -0,0 +1,391 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SimulatedMustang.h"
+#include "com/PacketSerializer.h"
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace test::simulator
+{
+    using namespace plug;
+    using namespace plug::com;
+
+    namespace
+    {
+        PacketRawType ack()
+        {
+            Header header{};
+            header.setStage(Stage::ready);
+            header.setType(Type::operation);
+            header.setDSP(DSP::none);
+
+            Packet<EmptyPayload> packet{};
+            packet.setHeader(header);
+            packet.setPayload(EmptyPayload{});
+            return packet.getBytes();
+        }
+
+        SignalChain defaultBank(std::size_t slot)
+        {
+            std::array<fx_pedal_settings, 4> fxSettings{{}};
+            std::for_each(fxSettings.begin(), fxSettings.end(), [i = std::uint8_t{0}](auto& effect) mutable { effect.fx_slot = i++; });
+            return SignalChain{"SIM " + std::to_string(slot + 1), amp_settings{}, fxSettings};
+        }
+
+        std::size_t bankCountOf(ProtocolKind protocol)
+        {
+            switch (protocol)
+            {
+                case ProtocolKind::smallAmpsV1:
+                    return SmallAmpsV1::bankCount;
+                case ProtocolKind::bigAmpsV1:
+                    return BigAmpsV1::bankCount;
+                case ProtocolKind::smallAmpsV2:
+                    return SmallAmpsV2::bankCount;
+                case ProtocolKind::bigAmpsV2:
+                    return BigAmpsV2::bankCount;
+            }
+            throw std::invalid_argument{"Invalid protocol"};
+        }
+    }
+
+
+    SimulatedMustang::Timing SimulatedMustang::timingOf(ProtocolKind protocol)
+    {
+        using std::chrono::microseconds;
+
+        switch (protocol)
+        {
+            case ProtocolKind::smallAmpsV1:
+            case ProtocolKind::bigAmpsV1:
+                return Timing{microseconds{2000}, microseconds{1000}, microseconds{250}, microseconds{1000000}};
+            default:
+                return Timing{microseconds{1000}, microseconds{1000}, microseconds{250}, microseconds{1000000}};
+        }
+    }
+
+    SimulatedMustang::Timing SimulatedMustang::noDelay()
+    {
+        using std::chrono::microseconds;
+        return Timing{microseconds{0}, microseconds{0}, microseconds{0}, microseconds{0}};
+    }
+
+    SimulatedMustang::SimulatedMustang(ProtocolKind protocol)
+        : SimulatedMustang(protocol, timingOf(protocol))
+    {
+    }
+
+    SimulatedMustang::SimulatedMustang(ProtocolKind protocol, Timing t, std::uint32_t seed)
+        : kind(protocol), timing(t), random(seed), received(0), open(true)
+    {
+        const std::size_t count = bankCountOf(protocol);
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            banks.push_back(defaultBank(i));
+        }
+        state = banks.front();
+    }
+
+    void SimulatedMustang::close()
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        open = false;
+        replies.clear();
+    }
+
+    bool SimulatedMustang::isOpen() const
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        return open;
+    }
+
+    std::vector<std::uint8_t> SimulatedMustang::receive(std::size_t recvSize)
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+
+        if (replies.empty() == true)
+        {
+            lock.unlock();
+            std::this_thread::sleep_for(timing.timeout);
+            return {};
+        }
+
+        const auto reply = replies.front();
+        replies.pop_front();
+        lock.unlock();
+
+        std::this_thread::sleep_until(reply.due);
+        const auto size = std::min(recvSize, reply.packet.size());
+        return std::vector<std::uint8_t>(reply.packet.cbegin(), std::next(reply.packet.cbegin(), static_cast<std::ptrdiff_t>(size)));
+    }
+
+    // Waits no longer than the regular timeout, so noDelay() doesn't wait at all
+    std::size_t SimulatedMustang::receiveWithinImpl(std::uint8_t* buffer, std::size_t size, std::chrono::milliseconds timeout)
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+        const auto deadline = Clock::now() + std::min(std::chrono::duration_cast<std::chrono::microseconds>(timeout), timing.timeout);
+
+        if ((replies.empty() == true) || (replies.front().due > deadline))
+        {
+            lock.unlock();
+            std::this_thread::sleep_until(deadline);
+            return 0;
+        }
+
+        const auto reply = replies.front();
+        replies.pop_front();
+        lock.unlock();
+
+        std::this_thread::sleep_until(reply.due);
+        const auto count = std::min(size, reply.packet.size());
+        std::copy_n(reply.packet.cbegin(), count, buffer);
+        return count;
+    }
+
+    void SimulatedMustang::discardReceived()
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        const auto now = Clock::now();
+        const auto end = std::find_if(replies.cbegin(), replies.cend(), [now](const auto& reply) { return reply.due > now; });
+        replies.erase(replies.cbegin(), end);
+    }
+
+    std::vector<std::vector<std::uint8_t>> SimulatedMustang::takeReceived()
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        return std::exchange(unrequested, {});
+    }
+
+    void SimulatedMustang::setReceiveListener(std::function<void()> listener)
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        receiveListener = std::move(listener);
+    }
+
+    ProtocolKind SimulatedMustang::protocol() const
+    {
+        return kind;
+    }
+
+    std::size_t SimulatedMustang::bankCount() const
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        return banks.size();
+    }
+
+    SignalChain SimulatedMustang::bank(std::uint8_t slot) const
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        return banks.at(slot);
+    }
+
+    void SimulatedMustang::setBank(std::uint8_t slot, const SignalChain& chain)
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        banks.at(slot) = chain;
+    }
+
+    SignalChain SimulatedMustang::current() const
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        return state;
+    }
+
+    void SimulatedMustang::changeAmpOnDevice(const amp_settings& amp)
+    {
+        std::function<void()> listener;
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            state.setAmp(amp);
+            const auto packet = serializeAmpSettings(amp).getBytes();
+            unrequested.emplace_back(packet.cbegin(), packet.cend());
+            listener = receiveListener;
+        }
+
+        if (listener != nullptr)
+        {
+            listener();
+        }
+    }
+
+    std::size_t SimulatedMustang::packetsReceived() const
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        return received;
+    }
+
+    std::size_t SimulatedMustang::sendImpl(const std::uint8_t* data, std::size_t size)
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        if (open == false)
+        {
+            return 0;
+        }
+
+        PacketRawType packet{};
+        std::copy_n(data, std::min(size, packet.size()), packet.begin());
+        ++received;
+        schedule(handle(packet));
+        return size;
+    }
+
+    std::vector<PacketRawType> SimulatedMustang::handle(const PacketRawType& packet)
+    {
+        const auto header = PacketView<EmptyPayload>{packet}.getHeader();
+
+        try
+        {
+            switch (header.getStage())
+            {
+                case Stage::init0:
+                case Stage::init1:
+                    return {ack()};
+                case Stage::unknown:
+                    return (header.getType() == Type::load ? presetList() : std::vector<PacketRawType>{});
+                default:
+                    break;
+            }
+
+            const auto dsp = header.getDSP();
+
+            if (header.getType() == Type::operation)
+            {
+                const auto slot = header.getSlot();
+
+                if (dsp == DSP::opSelectMemBank)
+                {
+                    if (slot >= banks.size())
+                    {
+                        return {};
+                    }
+                    state = banks[slot];
+                    return serializeChain(slot, state);
+                }
+                if ((dsp == DSP::opSave) && (slot < banks.size()))
+                {
+                    state.setName(decodeNameFromData(PacketView<NamePayload>{packet}));
+                    banks[slot] = state;
+                }
+                return {ack()};
+            }
+
+            switch (dsp)
+            {
+                case DSP::amp:
+                {
+                    const PacketView<AmpPayload> view{packet};
+                    auto amp = decodeAmpFromData(view, view);
+                    amp.usb_gain = state.amp().usb_gain;
+                    state.setAmp(amp);
+                    break;
+                }
+                case DSP::usbGain:
+                {
+                    auto amp = state.amp();
+                    amp.usb_gain = PacketView<AmpPayload>{packet}.getPayload().getUsbGain();
+                    state.setAmp(amp);
+                    break;
+                }
+                case DSP::effect0:
+                case DSP::effect1:
+                case DSP::effect2:
+                case DSP::effect3:
+                {
+                    const auto effect = decodeEffectFromData(PacketView<EffectPayload>{packet});
+                    auto fxSettings = state.effects();
+                    fxSettings[effect.fx_slot] = effect;
+                    state.setEffects(fxSettings);
+                    break;
+                }
+                default:
+                    break;
+            }
+            return {ack()};
+        }
+        catch (const std::logic_error&)
+        {
+            // Garbage isn't answered by the amp either
+            return {};
+        }
+    }
+
+    // Each name is followed by an empty packet, then the current preset
+    std::vector<PacketRawType> SimulatedMustang::presetList() const
+    {
+        std::vector<PacketRawType> packets;
+
+        for (std::size_t i = 0; i < banks.size(); ++i)
+        {
+            packets.push_back(serializeName(static_cast<std::uint8_t>(i), banks[i].name()).getBytes());
+            packets.push_back(PacketRawType{});
+        }
+
+        const auto current = serializeChain(0, state);
+        packets.insert(packets.end(), current.cbegin(), current.cend());
+        return packets;
+    }
+
+    std::vector<PacketRawType> SimulatedMustang::serializeChain(std::uint8_t slot, const SignalChain& chain) const
+    {
+        std::vector<PacketRawType> packets;
+        packets.push_back(serializeName(slot, chain.name()).getBytes());
+        packets.push_back(serializeAmpSettings(chain.amp()).getBytes());
+
+        for (const auto& effect : chain.effects())
+        {
+            packets.push_back(serializeEffectSettings(effect).getBytes());
+        }
+
+        packets.push_back(serializeAmpSettingsUsbGain(chain.amp()).getBytes());
+        return packets;
+    }
+
+    // Replies queue up behind the ones still pending, like on the wire
+    void SimulatedMustang::schedule(const std::vector<PacketRawType>& packets)
+    {
+        auto due = std::max(Clock::now(), (replies.empty() == true ? Clock::time_point{} : replies.back().due));
+        bool first{true};
+
+        for (const auto& packet : packets)
+        {
+            due += delay(first == true ? timing.latency : timing.interval);
+            replies.push_back({due, packet});
+            first = false;
+        }
+    }
+
+    std::chrono::microseconds SimulatedMustang::delay(std::chrono::microseconds base)
+    {
+        if (timing.jitter.count() == 0)
+        {
+            return base;
+        }
+
+        std::uniform_int_distribution<std::chrono::microseconds::rep> distribution{-timing.jitter.count(), timing.jitter.count()};
+        return std::max(std::chrono::microseconds{0}, base + std::chrono::microseconds{distribution(random)});
+    }
+}
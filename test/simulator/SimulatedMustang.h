@@ -0,0 +1,114 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "SignalChain.h"
+#include "com/Connection.h"
+#include "com/Packet.h"
+#include "com/Protocol.h"
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <vector>
+
+namespace test::simulator
+{
+
+    // Emulates an amp on protocol level, answering the packets produced by
+    // PacketSerializer: init, preset list, bank selection, settings, apply
+    // and save. Replies become available after a latency with some random
+    // jitter, so a whole conversation takes about as long as with an amp.
+    // The bank count follows the protocol, small amps have 24 and the others
+    // 100 banks.
+    //
+    // The clear command carries no slot, it's acknowledged but doesn't change
+    // the state; effects are replaced by the next settings of their slot.
+    class SimulatedMustang : public plug::com::Connection
+    {
+    public:
+        struct Timing
+        {
+            std::chrono::microseconds latency;
+            std::chrono::microseconds interval;
+            std::chrono::microseconds jitter;
+            std::chrono::microseconds timeout;
+        };
+
+        // Approximations of a full speed interrupt endpoint (1 ms polling)
+        static Timing timingOf(plug::com::ProtocolKind protocol);
+        static Timing noDelay();
+
+        explicit SimulatedMustang(plug::com::ProtocolKind protocol);
+        SimulatedMustang(plug::com::ProtocolKind protocol, Timing timing, std::uint32_t seed = 0);
+
+        void close() override;
+        bool isOpen() const override;
+
+        std::vector<std::uint8_t> receive(std::size_t recvSize) override;
+        void discardReceived() override;
+        std::vector<std::vector<std::uint8_t>> takeReceived() override;
+        void setReceiveListener(std::function<void()> listener) override;
+
+        plug::com::ProtocolKind protocol() const;
+        std::size_t bankCount() const;
+        plug::SignalChain bank(std::uint8_t slot) const;
+        void setBank(std::uint8_t slot, const plug::SignalChain& chain);
+        plug::SignalChain current() const;
+
+        // Like turning a knob on the amp, the change is sent unrequested
+        void changeAmpOnDevice(const plug::amp_settings& amp);
+
+        std::size_t packetsReceived() const;
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct Reply
+        {
+            Clock::time_point due;
+            plug::com::PacketRawType packet;
+        };
+
+        std::size_t sendImpl(const std::uint8_t* data, std::size_t size) override;
+        std::size_t receiveWithinImpl(std::uint8_t* buffer, std::size_t size, std::chrono::milliseconds timeout) override;
+
+        std::vector<plug::com::PacketRawType> handle(const plug::com::PacketRawType& packet);
+        std::vector<plug::com::PacketRawType> presetList() const;
+        std::vector<plug::com::PacketRawType> serializeChain(std::uint8_t slot, const plug::SignalChain& chain) const;
+        void schedule(const std::vector<plug::com::PacketRawType>& packets);
+        std::chrono::microseconds delay(std::chrono::microseconds base);
+
+        mutable std::mutex mutex;
+        const plug::com::ProtocolKind kind;
+        const Timing timing;
+        std::mt19937 random;
+        std::vector<plug::SignalChain> banks;
+        plug::SignalChain state;
+        std::deque<Reply> replies;
+        std::vector<std::vector<std::uint8_t>> unrequested;
+        std::function<void()> receiveListener;
+        std::size_t received;
+        bool open;
+    };
+}
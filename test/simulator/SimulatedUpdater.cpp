@@ -0,0 +1,126 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "SimulatedUpdater.h"
+#include <algorithm>
+#include <iterator>
+#include <thread>
+
+namespace test::simulator
+{
+    using namespace plug::com;
+
+    SimulatedUpdater::SimulatedUpdater(std::chrono::microseconds delay)
+        : latency(delay), received(0), nextCounter(0), inSequence(true), done(false), maxPending(0), open(true)
+    {
+    }
+
+    void SimulatedUpdater::close()
+    {
+        open = false;
+        pending.clear();
+    }
+
+    bool SimulatedUpdater::isOpen() const
+    {
+        return open;
+    }
+
+    std::vector<std::uint8_t> SimulatedUpdater::receive(std::size_t recvSize)
+    {
+        if (pending.empty() == true)
+        {
+            return {};
+        }
+
+        const auto acknowledge = pending.front();
+        pending.pop_front();
+
+        std::this_thread::sleep_until(acknowledge.due);
+        const auto size = std::min(recvSize, acknowledge.packet.size());
+        return std::vector<std::uint8_t>(acknowledge.packet.cbegin(), std::next(acknowledge.packet.cbegin(), static_cast<std::ptrdiff_t>(size)));
+    }
+
+    void SimulatedUpdater::stopAcknowledgingAfter(std::size_t count)
+    {
+        acknowledgeLimit = count;
+    }
+
+    const std::vector<std::uint8_t>& SimulatedUpdater::date() const
+    {
+        return buildDate;
+    }
+
+    const std::vector<std::uint8_t>& SimulatedUpdater::firmware() const
+    {
+        return image;
+    }
+
+    bool SimulatedUpdater::countersInSequence() const
+    {
+        return inSequence;
+    }
+
+    bool SimulatedUpdater::finished() const
+    {
+        return done;
+    }
+
+    std::size_t SimulatedUpdater::maxUnacknowledged() const
+    {
+        return maxPending;
+    }
+
+    // Date: 02 03 01 06 <date>, firmware: 03 03 <counter> <size> <data>,
+    // finished: 04 03
+    std::size_t SimulatedUpdater::sendImpl(const std::uint8_t* data, std::size_t size)
+    {
+        PacketRawType packet{};
+        std::copy_n(data, std::min(size, packet.size()), packet.begin());
+
+        switch (packet[0])
+        {
+            case 0x02:
+                buildDate.assign(std::next(packet.cbegin(), 4), std::next(packet.cbegin(), 15));
+                break;
+            case 0x03:
+                inSequence = (inSequence == true) && (packet[2] == nextCounter);
+                ++nextCounter;
+                image.insert(image.end(), std::next(packet.cbegin(), 4), std::next(packet.cbegin(), 4 + packet[3]));
+                break;
+            case 0x04:
+                done = true;
+                break;
+            default:
+                break;
+        }
+
+        ++received;
+
+        if ((acknowledgeLimit.has_value() == false) || (received <= *acknowledgeLimit))
+        {
+            PacketRawType acknowledge{};
+            acknowledge[0] = packet[0];
+            acknowledge[1] = packet[1];
+            pending.push_back({Clock::now() + latency, acknowledge});
+            maxPending = std::max(maxPending, pending.size());
+        }
+        return size;
+    }
+}
@@ -0,0 +1,79 @@
+/*
+ * PLUG - software to operate Fender Mustang amplifier
+ *        Linux replacement for Fender FUSE software
+ *
+ * Copyright (C) 2017-2020  offa
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include "com/Connection.h"
+#include "com/Packet.h"
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <vector>
+
+namespace test::simulator
+{
+
+    // Emulates an amp in update mode. Every packet is acknowledged after a
+    // latency, the firmware is reassembled from the packets received.
+    class SimulatedUpdater : public plug::com::Connection
+    {
+    public:
+        explicit SimulatedUpdater(std::chrono::microseconds delay = std::chrono::microseconds{0});
+
+        void close() override;
+        bool isOpen() const override;
+
+        std::vector<std::uint8_t> receive(std::size_t recvSize) override;
+
+        // Packets beyond the count are received but not acknowledged
+        void stopAcknowledgingAfter(std::size_t count);
+
+        const std::vector<std::uint8_t>& date() const;
+        const std::vector<std::uint8_t>& firmware() const;
+        bool countersInSequence() const;
+        bool finished() const;
+
+        // Most packets sent, but not acknowledged yet, at the same time
+        std::size_t maxUnacknowledged() const;
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct Acknowledge
+        {
+            Clock::time_point due;
+            plug::com::PacketRawType packet;
+        };
+
+        std::size_t sendImpl(const std::uint8_t* data, std::size_t size) override;
+
+        const std::chrono::microseconds latency;
+        std::deque<Acknowledge> pending;
+        std::optional<std::size_t> acknowledgeLimit;
+        std::size_t received;
+        std::vector<std::uint8_t> buildDate;
+        std::vector<std::uint8_t> image;
+        std::uint8_t nextCounter;
+        bool inSequence;
+        bool done;
+        std::size_t maxPending;
+        bool open;
+    };
+}